@@ -0,0 +1,130 @@
+#include "bench.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <sys/resource.h>
+
+#ifndef NETLIB_BENCH_VERSION
+#define NETLIB_BENCH_VERSION "unknown"
+#endif
+
+namespace netlib::bench
+{
+	Result::Result(
+		char const * benchmark):
+		m_json("{")
+	{
+		add("version", NETLIB_BENCH_VERSION);
+		add("benchmark", benchmark);
+	}
+
+	void Result::key(
+		char const * name)
+	{
+		if(m_json.size() > 1)
+			m_json += ',';
+		((m_json += '"') += name) += "\":";
+	}
+
+	Result &Result::add(
+		char const * name,
+		std::uint64_t value)
+	{
+		key(name);
+		m_json += std::to_string(value);
+		return *this;
+	}
+
+	Result &Result::add(
+		char const * name,
+		double value)
+	{
+		char number[32];
+		std::snprintf(number, sizeof(number), "%.6g", value);
+		key(name);
+		m_json += number;
+		return *this;
+	}
+
+	Result &Result::add(
+		char const * name,
+		char const * value)
+	{
+		// Names and parameters never need escaping.
+		key(name);
+		((m_json += '"') += value) += '"';
+		return *this;
+	}
+
+	Result &Result::add(
+		char const * prefix,
+		util::Histogram const& latency)
+	{
+		static struct { char const * name; double percentile; } const percentiles[] = {
+			{ "p50_ns", 50 },
+			{ "p90_ns", 90 },
+			{ "p99_ns", 99 },
+			{ "p999_ns", 99.9 },
+			{ "max_ns", 100 }
+		};
+
+		std::string name = prefix;
+		add((name + "count").c_str(), latency.count());
+		add((name + "mean_ns").c_str(), latency.mean());
+		for(auto const& p : percentiles)
+			add((name + p.name).c_str(), latency.percentile(p.percentile));
+		return *this;
+	}
+
+	void Result::print()
+	{
+		std::printf("%s}\n", m_json.c_str());
+		std::fflush(stdout);
+	}
+
+	void require(
+		bool condition,
+		char const * what)
+	{
+		if(!condition)
+		{
+			std::fprintf(stderr, "netlib_bench: %s\n", what);
+			std::exit(EXIT_FAILURE);
+		}
+	}
+
+	std::size_t raise_file_limit()
+	{
+		::rlimit limit;
+		if(::getrlimit(RLIMIT_NOFILE, &limit))
+			return 1024;
+
+		if(limit.rlim_cur < limit.rlim_max)
+		{
+			limit.rlim_cur = limit.rlim_max;
+			::setrlimit(RLIMIT_NOFILE, &limit);
+			::getrlimit(RLIMIT_NOFILE, &limit);
+		}
+		return limit.rlim_cur == RLIM_INFINITY ? std::size_t(-1) : std::size_t(limit.rlim_cur);
+	}
+
+	SocketAddress loopback(
+		port_t port)
+	{
+		SocketAddress address;
+		address.family = AddressFamily::kIPv4;
+		address.address.ipv4.address = IPv4Address(127, 0, 0, 1);
+		address.address.ipv4.port = port;
+		return address;
+	}
+
+	bool await_connect(
+		StreamSocket &socket)
+	{
+		Status status;
+		while(Status::kInProgress == (status = socket.finish_connect()))
+			std::this_thread::yield();
+		return status == Status::kSuccess;
+	}
+}
@@ -0,0 +1,118 @@
+/** @file bench.hpp
+	Contains the benchmark harness of the netlib benchmarks. */
+#ifndef __netlib_bench_bench_hpp_defined
+#define __netlib_bench_bench_hpp_defined
+
+#include "../src/util/Histogram.hpp"
+#include "../src/Socket.hpp"
+
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+/** The netlib benchmarks.
+	Every benchmark prints its results as a single JSON object per line, so that results of different netlib versions can be collected and compared by scripts. */
+namespace netlib::bench
+{
+	/** The clock used for all measurements. */
+	typedef std::chrono::steady_clock Clock;
+
+	/** The nanoseconds elapsed since `start`. */
+	inline std::uint64_t elapsed_ns(
+		Clock::time_point start)
+	{
+		return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+	}
+
+	/** Prevents the compiler from optimising away a value. */
+	template<class T>
+	inline void keep(
+		T const& value)
+	{
+		asm volatile("" : : "g"(&value) : "memory");
+	}
+
+	/** A single benchmark result, printed as one line of JSON.
+		Every line contains the netlib version, the benchmark name, its parameters, and its metrics. */
+	class Result
+	{
+		/** The JSON object built so far. */
+		std::string m_json;
+
+		/** Appends a key. */
+		void key(
+			char const * name);
+	public:
+		/** Starts a result.
+		@param[in] benchmark:
+			The benchmark's name. */
+		explicit Result(
+			char const * benchmark);
+
+		/** Adds an integer parameter or metric. */
+		Result &add(
+			char const * name,
+			std::uint64_t value);
+		/** Adds a floating point metric. */
+		Result &add(
+			char const * name,
+			double value);
+		/** Adds a string parameter. */
+		Result &add(
+			char const * name,
+			char const * value);
+		/** Adds the count, mean, and the 50th, 90th, 99th, 99.9th, and 100th percentile of a latency histogram in nanoseconds, prefixed with `prefix`. */
+		Result &add(
+			char const * prefix,
+			util::Histogram const& latency);
+
+		/** Prints the result to stdout, and flushes it. */
+		void print();
+	};
+
+	/** Checks a condition that the benchmark relies on, and aborts with a message if it fails. */
+	void require(
+		bool condition,
+		char const * what);
+
+	/** Raises the open file limit as far as allowed.
+	@return
+		The resulting limit. */
+	std::size_t raise_file_limit();
+
+	/** A loopback address with the given port. */
+	SocketAddress loopback(
+		port_t port);
+
+	/** Waits until a nonblocking connect completed.
+	@return
+		Whether the connection was established. */
+	bool await_connect(
+		StreamSocket &socket);
+
+	void tcp_echo();
+	void tcp_throughput();
+	void tcp_accept();
+	void udp_packets();
+	void udp_multicast();
+	void udp_timestamps();
+	void buffer();
+	void address_parse();
+	void prefix_table();
+	void checksum();
+	void websocket_mask();
+	void websocket_read();
+	void http_keepalive();
+	void fanout();
+	void proxy_throughput();
+	void handoff();
+	void resolver();
+	void pacing();
+	void reliable_udp();
+	void rpc();
+#ifdef NETLIB_TLS
+	void tls_throughput();
+#endif
+}
+
+#endif
@@ -0,0 +1,175 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/FanOut.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The size of broadcast messages, in bytes. */
+		constexpr std::size_t kMessageSize = 256;
+		/** How many messages are published per poll iteration. */
+		constexpr std::size_t kBurst = 8;
+		/** The maximum number of queued messages per subscriber. */
+		constexpr std::size_t kQueueLimit = 256;
+		/** The output buffer size of subscriber connections, in bytes. */
+		constexpr std::size_t kBufferSize = 4096;
+		/** The number of threads reading on the subscribers' side. */
+		constexpr std::size_t kReaders = 2;
+
+		/** Reads everything that arrives on the given sockets until `stop` is set, and counts the bytes. */
+		void subscriber_reader(
+			std::vector<StreamSocket> &sockets,
+			std::size_t first,
+			std::size_t end,
+			std::atomic<std::uint64_t> &received,
+			std::atomic<bool> &stop)
+		{
+			Poller poller;
+			poller.reserve(end - first);
+			for(std::size_t i = first; i < end; i++)
+				poller.watch(&sockets[i], true, false);
+
+			std::vector<PollEvent> events;
+			std::uint8_t chunk[1 << 16];
+			std::uint64_t total = 0;
+			while(!stop)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+				{
+					StreamSocket &socket = *static_cast<StreamSocket *>(event.entry->socket);
+					std::size_t size;
+					while(Status::kSuccess == socket.recv(chunk, sizeof(chunk), size) && size)
+						total += size;
+				}
+				received.store(total, std::memory_order_relaxed);
+			}
+		}
+
+		/** Broadcasts to `count` subscribers, either through a `FanOut`, or by copying every message into every connection's output buffer. */
+		void fanout(
+			std::size_t count,
+			bool shared)
+		{
+			// Every subscriber needs a client and a server socket.
+			std::size_t const limit = raise_file_limit();
+			if(limit < 64 + 2 * count)
+				count = (limit - 64) / 2;
+
+			SocketAddress const address = loopback(39607);
+			x::ConnectionListener listener;
+			require(listener.listen(address, true), "fanout: could not listen");
+
+			std::vector<StreamSocket> clients;
+			clients.reserve(count);
+			std::vector<std::unique_ptr<x::BufferedConnection>> connections;
+			connections.reserve(count);
+			{
+				Poller poller;
+				poller.watch(&listener, true, false);
+				std::vector<PollEvent> events;
+				StreamSocket socket;
+				while(connections.size() < count)
+				{
+					if(clients.size() < count)
+					{
+						clients.emplace_back(AddressFamily::kIPv4);
+						Status status = clients.back().connect(address);
+						require(status == Status::kSuccess || status == Status::kInProgress, "fanout: could not connect");
+					}
+
+					events.clear();
+					poller.poll(events, clients.size() < count ? 0 : 10);
+					while(Status::kSuccess == listener.accept(socket))
+						connections.emplace_back(new x::BufferedConnection(std::move(socket), kBufferSize));
+				}
+			}
+			for(StreamSocket &client : clients)
+				require(await_connect(client), "fanout: could not connect");
+
+			std::atomic<bool> stop(false);
+			std::atomic<std::uint64_t> received[kReaders];
+			std::vector<std::thread> readers;
+			for(std::size_t i = 0; i < kReaders; i++)
+			{
+				received[i] = 0;
+				readers.emplace_back(subscriber_reader,
+					std::ref(clients),
+					count * i / kReaders,
+					count * (i + 1) / kReaders,
+					std::ref(received[i]),
+					std::ref(stop));
+			}
+
+			x::FanOut fan_out(kQueueLimit, x::SlowPolicy::kDropOldest);
+			for(auto &connection : connections)
+				fan_out.subscribe(*connection);
+
+			std::uint8_t message[kMessageSize];
+			std::memset(message, 'x', sizeof(message));
+			std::vector<x::FanOut::Subscriber *> disconnect;
+			std::uint64_t published = 0;
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				if(shared)
+				{
+					for(std::size_t i = 0; i < kBurst; i++)
+						fan_out.publish(x::SharedMessage(message, sizeof(message)));
+					fan_out.flush(disconnect);
+				} else
+				{
+					// Messages that do not fit are dropped, like the fan-out drops queued messages.
+					for(auto &connection : connections)
+					{
+						for(std::size_t i = 0; i < kBurst; i++)
+							if(connection->output().free_space() >= sizeof(message))
+								connection->write(message, sizeof(message));
+						connection->flush_some();
+					}
+				}
+				published += kBurst;
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			stop = true;
+			for(std::thread &reader : readers)
+				reader.join();
+
+			std::uint64_t bytes = 0;
+			for(std::size_t i = 0; i < kReaders; i++)
+				bytes += received[i];
+
+			for(auto &connection : connections)
+				connection->discard();
+
+			Result("fanout")
+				.add("mode", shared ? "shared" : "copy")
+				.add("subscribers", std::uint64_t(count))
+				.add("message_size", std::uint64_t(kMessageSize))
+				.add("seconds", seconds)
+				.add("published_per_s", double(published) / seconds)
+				.add("delivered_per_s", double(bytes / kMessageSize) / seconds)
+				.print();
+		}
+	}
+
+	void fanout()
+	{
+		for(std::size_t subscribers : { 1000, 10000 })
+			for(bool shared : { false, true })
+				fanout(subscribers, shared);
+	}
+}
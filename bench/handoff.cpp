@@ -0,0 +1,208 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/Handoff.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long to wait for any step before giving up. */
+		constexpr std::chrono::seconds kTimeout(5);
+		/** The port of the handed off listener. */
+		constexpr port_t kPort = 39617;
+		/** The size of the connection's buffers, in bytes. */
+		constexpr std::size_t kBufferSize = 4096;
+		/** How many bytes the old process receives before the handoff. */
+		constexpr std::size_t kPending = 1000;
+		/** How many of the pending bytes the old process consumes before the handoff. */
+		constexpr std::size_t kConsumed = 100;
+		/** Sent by the client after the handoff. */
+		constexpr char kAfter[] = "after handoff";
+		/** Sent back by the new process once everything was verified. */
+		constexpr char kReply[] = "ok";
+
+		/** The byte at a position of the client's stream. */
+		std::uint8_t pattern(
+			std::size_t position)
+		{
+			return std::uint8_t(position * 7 + 3);
+		}
+
+		/** Exits the new process with a failure code if a check fails. The old process reports it. */
+		void check(
+			bool condition,
+			int code)
+		{
+			if(!condition)
+				::_exit(code);
+		}
+
+		/** Runs in the new process: adopts the listener and connection, verifies the pending input and the data sent after the handoff, and accepts a connection on the adopted listener. */
+		[[noreturn]] void adopt(
+			DatagramSocket &channel)
+		{
+			x::ConnectionListener listener;
+			std::unique_ptr<x::BufferedConnection> connection;
+			x::Handoff::Kind kind;
+
+			bool listener_received = false;
+			auto const start = Clock::now();
+			for(;;)
+			{
+				std::unique_ptr<x::BufferedConnection> received;
+				Status const status = x::Handoff::receive(channel, kind, listener, received);
+				check(status != Status::kError, 2);
+				check(Clock::now() - start < kTimeout, 3);
+				if(status == Status::kNotReady)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				if(kind == x::Handoff::Kind::kDone)
+					break;
+				if(kind == x::Handoff::Kind::kListener)
+					listener_received = true;
+				else
+					connection = std::move(received);
+			}
+			check(listener_received && listener.listening() && connection, 4);
+
+			// The unconsumed input arrives exactly as the old process left it.
+			check(connection->input().size() == kPending - kConsumed, 5);
+			std::vector<std::uint8_t> input(kPending - kConsumed);
+			connection->read(input.data(), input.size());
+			for(std::size_t i = 0; i < input.size(); i++)
+				check(input[i] == pattern(kConsumed + i), 6);
+
+			// The socket itself keeps working. Receiving fails while no data is pending.
+			while(connection->input().size() < sizeof(kAfter))
+			{
+				if(!connection->receive_some())
+					std::this_thread::yield();
+				check(Clock::now() - start < kTimeout, 7);
+			}
+			char after[sizeof(kAfter)];
+			connection->read(after, sizeof(after));
+			check(!std::memcmp(after, kAfter, sizeof(after)), 8);
+
+			// So does the listener.
+			StreamSocket accepted;
+			while(Status::kSuccess != listener.accept(accepted))
+			{
+				check(Clock::now() - start < kTimeout, 9);
+				std::this_thread::yield();
+			}
+
+			connection->write(kReply, sizeof(kReply));
+			while(!connection->output().empty())
+			{
+				connection->flush_some();
+				check(Clock::now() - start < kTimeout, 10);
+			}
+
+			// Skips the destructors and stdout buffers inherited from the old process.
+			::_exit(0);
+		}
+	}
+
+	void handoff()
+	{
+		x::ConnectionListener listener;
+		require(listener.listen(loopback(kPort), true), "handoff: could not listen");
+
+		StreamSocket client(AddressFamily::kIPv4);
+		Status status = client.connect(loopback(kPort));
+		require(status == Status::kSuccess || status == Status::kInProgress, "handoff: could not connect");
+		StreamSocket server_socket;
+		auto const start = Clock::now();
+		while(Status::kSuccess != listener.accept(server_socket))
+			require(Clock::now() - start < kTimeout, "handoff: could not accept");
+		require(await_connect(client), "handoff: could not connect");
+
+		// Leaves some received input unconsumed in the connection's buffer.
+		std::vector<std::uint8_t> pending(kPending);
+		for(std::size_t i = 0; i < kPending; i++)
+			pending[i] = pattern(i);
+		std::size_t sent;
+		require(Status::kSuccess == client.send(pending.data(), pending.size(), sent) && sent == kPending, "handoff: could not send");
+
+		x::BufferedConnection connection(std::move(server_socket), kBufferSize, kBufferSize);
+		while(connection.input().size() < kPending)
+		{
+			if(!connection.receive_some())
+				std::this_thread::yield();
+			require(Clock::now() - start < kTimeout, "handoff: input did not arrive");
+		}
+		connection.skip(kConsumed);
+
+		DatagramSocket channel, child_channel;
+		require(DatagramSocket::pair(channel, child_channel), "handoff: could not create channel");
+
+		pid_t const child = ::fork();
+		require(child >= 0, "handoff: could not fork");
+		if(!child)
+		{
+			channel.close();
+			adopt(child_channel);
+		}
+		child_channel.close();
+
+		auto const handoff_start = Clock::now();
+		require(Status::kSuccess == x::Handoff::send(channel, listener), "handoff: could not send listener");
+		require(Status::kSuccess == x::Handoff::send(channel, connection), "handoff: could not send connection");
+		require(Status::kSuccess == x::Handoff::finish(channel), "handoff: could not finish");
+		std::uint64_t const handoff_ns = elapsed_ns(handoff_start);
+		require(!listener.listening() && !connection.exists(), "handoff: objects still open");
+
+		require(Status::kSuccess == client.send(kAfter, sizeof(kAfter), sent) && sent == sizeof(kAfter), "handoff: could not send");
+		StreamSocket second(AddressFamily::kIPv4);
+		status = second.connect(loopback(kPort));
+		require(status == Status::kSuccess || status == Status::kInProgress, "handoff: could not connect to adopted listener");
+
+		// A failed check ends the new process before it replies.
+		char reply[sizeof(kReply)];
+		std::size_t received = 0;
+		int child_status;
+		bool exited = false, lost = false;
+		while(received < sizeof(reply) && !exited && !lost)
+		{
+			std::size_t size;
+			status = client.recv(reply + received, sizeof(reply) - received, size);
+			lost = status == Status::kError || (status == Status::kSuccess && !size);
+			if(status == Status::kSuccess)
+				received += size;
+			else
+			{
+				exited = child == ::waitpid(child, &child_status, WNOHANG);
+				std::this_thread::yield();
+			}
+			require(Clock::now() - start < 2 * kTimeout, "handoff: no reply");
+		}
+
+		require(exited || child == ::waitpid(child, &child_status, 0), "handoff: could not wait");
+		require(WIFEXITED(child_status), "handoff: new process crashed");
+		if(WEXITSTATUS(child_status))
+		{
+			std::fprintf(stderr, "handoff: new process failed check %d\n", WEXITSTATUS(child_status));
+			require(false, "handoff: verification failed");
+		}
+		require(!lost, "handoff: connection lost");
+		require(received == sizeof(reply) && !std::memcmp(reply, kReply, sizeof(reply)), "handoff: wrong reply");
+
+		Result("handoff")
+			.add("pending_bytes", std::uint64_t(kPending - kConsumed))
+			.add("handoff_us", double(handoff_ns) / 1e3)
+			.print();
+	}
+}
@@ -0,0 +1,232 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/Http.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The size of the connections' buffers, in bytes. */
+		constexpr std::size_t kBufferSize = 1 << 14;
+
+		constexpr char kRequest[] =
+			"GET /plaintext HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"User-Agent: netlib_bench\r\n"
+			"Accept: text/plain\r\n"
+			"\r\n";
+		constexpr char kBody[] = "Hello, World!";
+
+		/** A server connection with its parser state. */
+		struct ServerConnection : x::BufferedConnection
+		{
+			x::http::HeadParser parser;
+
+			ServerConnection(
+				StreamSocket && socket):
+				x::BufferedConnection(std::move(socket), kBufferSize)
+			{
+			}
+		};
+
+		/** Answers every request with a small plaintext response, until `stop` is set. */
+		void http_server(
+			x::ConnectionListener &listener,
+			std::size_t count,
+			std::atomic<bool> &stop)
+		{
+			std::vector<std::unique_ptr<ServerConnection>> connections;
+			connections.reserve(count);
+			std::vector<PollEvent> events;
+
+			{
+				Poller poller;
+				poller.watch(&listener, true, false);
+				StreamSocket socket;
+				while(connections.size() < count && !stop)
+				{
+					events.clear();
+					poller.poll(events, 10);
+					while(connections.size() < count
+					&& Status::kSuccess == listener.accept(socket))
+						connections.emplace_back(new ServerConnection(std::move(socket)));
+				}
+			}
+
+			Poller poller;
+			poller.reserve(connections.size());
+			for(auto &connection : connections)
+				poller.watch(connection.get(), true, false);
+
+			x::http::Request request;
+			while(!stop)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+				{
+					ServerConnection * connection = static_cast<ServerConnection *>(x::BufferedConnection::cast_from_base(event.entry->socket));
+					if(!connection->receive_some())
+						continue;
+
+					// Answer all pipelined requests.
+					x::http::ParseStatus status;
+					while(x::http::ParseStatus::kComplete == (status = connection->parser.parse(*connection, request)))
+					{
+						x::http::ResponseWriter response(200, "OK", request.minor_version);
+						response.header("Server", "netlib");
+						response.header("Content-Type", "text/plain");
+						std::size_t sent;
+						require(response.send(*connection, kBody, sizeof(kBody) - 1, sent), "http_keepalive: could not send response");
+						require(sent == response.head_size() + sizeof(kBody) - 1, "http_keepalive: output buffer full");
+						connection->skip(request.head_size);
+					}
+					require(status == x::http::ParseStatus::kIncomplete, "http_keepalive: invalid request");
+				}
+			}
+
+			for(auto &connection : connections)
+				connection->discard();
+		}
+
+		/** A client connection, with the send times of its requests in flight. */
+		struct ClientConnection : x::BufferedConnection
+		{
+			x::http::HeadParser parser;
+			x::http::BodyReader body;
+			/** Whether the current response's head was parsed. */
+			bool in_body;
+			std::vector<Clock::time_point> sent;
+			/** The index of the oldest request in flight in `sent`. */
+			std::size_t first;
+
+			ClientConnection(
+				StreamSocket && socket,
+				std::size_t depth):
+				x::BufferedConnection(std::move(socket), kBufferSize),
+				in_body(false),
+				sent(depth),
+				first(0)
+			{
+			}
+		};
+
+		/** Runs the benchmark with the given number of connections, each with `depth` pipelined requests in flight. */
+		void http_keepalive(
+			std::size_t count,
+			std::size_t depth)
+		{
+			SocketAddress const address = loopback(39606);
+			x::ConnectionListener listener;
+			require(listener.listen(address, true), "http_keepalive: could not listen");
+
+			std::atomic<bool> stop(false);
+			std::thread server(http_server, std::ref(listener), count, std::ref(stop));
+
+			std::vector<std::unique_ptr<ClientConnection>> clients;
+			clients.reserve(count);
+			Poller poller;
+			poller.reserve(count);
+			for(std::size_t i = 0; i < count; i++)
+			{
+				StreamSocket socket(AddressFamily::kIPv4);
+				Status status = socket.connect(address);
+				require(status == Status::kSuccess || status == Status::kInProgress, "http_keepalive: could not connect");
+				require(await_connect(socket), "http_keepalive: could not connect");
+				clients.emplace_back(new ClientConnection(std::move(socket), depth));
+				poller.watch(clients.back().get(), true, false);
+			}
+
+			auto const send_request = [](ClientConnection &client, std::size_t slot) {
+				client.sent[slot] = Clock::now();
+				client.write(kRequest, sizeof(kRequest) - 1);
+			};
+
+			for(auto &client : clients)
+			{
+				for(std::size_t i = 0; i < depth; i++)
+					send_request(*client, i);
+				client->flush_some();
+			}
+
+			util::Histogram latency;
+			x::http::Response response;
+			std::vector<PollEvent> events;
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+				{
+					ClientConnection &client = *static_cast<ClientConnection *>(x::BufferedConnection::cast_from_base(event.entry->socket));
+					if(!client.receive_some())
+						continue;
+
+					for(;;)
+					{
+						if(!client.in_body)
+						{
+							x::http::ParseStatus const status = client.parser.parse(client, response);
+							if(status == x::http::ParseStatus::kIncomplete)
+								break;
+							require(status == x::http::ParseStatus::kComplete && response.status == 200, "http_keepalive: invalid response");
+							client.skip(response.head_size);
+							client.body.begin(response, "GET");
+							client.in_body = true;
+						}
+
+						std::string_view piece;
+						std::size_t consumed;
+						x::http::ParseStatus const status = client.body.read(client, piece, consumed);
+						client.skip(consumed);
+						if(status != x::http::ParseStatus::kComplete)
+						{
+							require(status == x::http::ParseStatus::kIncomplete, "http_keepalive: invalid response");
+							if(client.input().empty())
+								break;
+							continue;
+						}
+
+						client.in_body = false;
+						auto const now = Clock::now();
+						latency.record(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - client.sent[client.first]).count()));
+						send_request(client, client.first);
+						client.first = (client.first + 1) % depth;
+					}
+					client.flush_some();
+				}
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			stop = true;
+			server.join();
+			for(auto &client : clients)
+				client->discard();
+
+			Result("http_keepalive")
+				.add("connections", std::uint64_t(count))
+				.add("pipeline_depth", std::uint64_t(depth))
+				.add("seconds", seconds)
+				.add("requests_per_s", double(latency.count()) / seconds)
+				.add("latency_", latency)
+				.print();
+		}
+	}
+
+	void http_keepalive()
+	{
+		http_keepalive(1, 1);
+		http_keepalive(64, 1);
+		http_keepalive(64, 16);
+	}
+}
@@ -0,0 +1,69 @@
+#include "bench.hpp"
+#include "../src/Runtime.hpp"
+
+#include <cstring>
+#include <cstdio>
+
+namespace
+{
+	struct Benchmark
+	{
+		char const * name;
+		void (*run)();
+	};
+
+	Benchmark const benchmarks[] = {
+		{ "tcp_echo", &netlib::bench::tcp_echo },
+		{ "tcp_throughput", &netlib::bench::tcp_throughput },
+		{ "tcp_accept", &netlib::bench::tcp_accept },
+		{ "udp_packets", &netlib::bench::udp_packets },
+		{ "udp_multicast", &netlib::bench::udp_multicast },
+		{ "udp_timestamps", &netlib::bench::udp_timestamps },
+		{ "buffer", &netlib::bench::buffer },
+		{ "address_parse", &netlib::bench::address_parse },
+		{ "prefix_table", &netlib::bench::prefix_table },
+		{ "checksum", &netlib::bench::checksum },
+		{ "websocket_mask", &netlib::bench::websocket_mask },
+		{ "websocket_read", &netlib::bench::websocket_read },
+		{ "http_keepalive", &netlib::bench::http_keepalive },
+		{ "fanout", &netlib::bench::fanout },
+		{ "proxy_throughput", &netlib::bench::proxy_throughput },
+		{ "handoff", &netlib::bench::handoff },
+		{ "resolver", &netlib::bench::resolver },
+		{ "pacing", &netlib::bench::pacing },
+		{ "reliable_udp", &netlib::bench::reliable_udp },
+		{ "rpc", &netlib::bench::rpc },
+#ifdef NETLIB_TLS
+		{ "tls_throughput", &netlib::bench::tls_throughput },
+#endif
+	};
+}
+
+/** Runs all benchmarks whose name contains any of the arguments, or all benchmarks if there are no arguments.
+	Results are printed to stdout as JSON lines. */
+int main(
+	int argc,
+	char ** argv)
+{
+	netlib::Runtime runtime;
+
+	if(argc > 1 && (!std::strcmp(argv[1], "-h") || !std::strcmp(argv[1], "--help")))
+	{
+		std::printf("usage: %s [filter...]\nbenchmarks:\n", argv[0]);
+		for(Benchmark const& benchmark : benchmarks)
+			std::printf("\t%s\n", benchmark.name);
+		return 0;
+	}
+
+	for(Benchmark const& benchmark : benchmarks)
+	{
+		bool selected = argc <= 1;
+		for(int i = 1; i < argc && !selected; i++)
+			selected = std::strstr(benchmark.name, argv[i]) != nullptr;
+
+		if(selected)
+			benchmark.run();
+	}
+
+	return 0;
+}
@@ -0,0 +1,200 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/SendScheduler.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The requested rate, in bytes per second. */
+		constexpr double kRate = 50e6;
+		/** The burst size and output buffer size, in bytes. */
+		constexpr std::size_t kBurst = 1 << 16;
+		/** The number of connections sharing the rate in the scheduler benchmark. */
+		constexpr std::size_t kFlows = 4;
+
+		/** Connects `count` client sockets to server sockets on the given port. */
+		void connect_pairs(
+			std::size_t count,
+			port_t port,
+			std::vector<StreamSocket> &clients,
+			std::vector<StreamSocket> &servers)
+		{
+			x::ConnectionListener listener;
+			require(listener.listen(loopback(port), true), "pacing: could not listen");
+
+			Poller poller;
+			poller.watch(&listener, true, false);
+			std::vector<PollEvent> events;
+			StreamSocket socket;
+			auto const start = Clock::now();
+			while(servers.size() < count)
+			{
+				if(clients.size() < count)
+				{
+					clients.emplace_back(AddressFamily::kIPv4);
+					Status status = clients.back().connect(loopback(port));
+					require(status == Status::kSuccess || status == Status::kInProgress, "pacing: could not connect");
+				}
+
+				events.clear();
+				poller.poll(events, clients.size() < count ? 0 : 10);
+				while(Status::kSuccess == listener.accept(socket))
+					servers.push_back(std::move(socket));
+				require(Clock::now() - start < kDuration, "pacing: could not accept");
+			}
+			for(StreamSocket &client : clients)
+				require(await_connect(client), "pacing: could not connect");
+		}
+
+		/** Reads everything that arrives on the given sockets until `stop` is set, and counts the bytes per socket. */
+		void counting_receiver(
+			std::vector<StreamSocket> &sockets,
+			std::atomic<std::uint64_t> * received,
+			std::atomic<bool> &stop)
+		{
+			Poller poller;
+			for(StreamSocket &socket : sockets)
+				poller.watch(&socket, true, false);
+
+			std::vector<PollEvent> events;
+			std::vector<std::uint8_t> chunk(1 << 16);
+			while(!stop)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+				{
+					std::size_t const i = static_cast<StreamSocket *>(event.entry->socket) - sockets.data();
+					std::size_t size;
+					while(Status::kSuccess == sockets[i].recv(chunk.data(), chunk.size(), size) && size)
+						received[i].fetch_add(size, std::memory_order_relaxed);
+				}
+			}
+		}
+
+		/** Waits until the sockets can send, or for a millisecond at most. */
+		void await_output(
+			Poller &poller,
+			std::vector<PollEvent> &events)
+		{
+			events.clear();
+			poller.poll(events, 1);
+		}
+
+		/** Sends as fast as the limit allows for `kDuration`, and reports the achieved rates.
+		@param[in] mode:
+			"kernel" for `Socket::set_max_pacing_rate()`, "shaper" for `x::BufferedConnection::set_rate_limit()`, and "scheduler" for `x::SendScheduler` with `kFlows` connections. */
+		void pacing(
+			char const * mode)
+		{
+			bool const kernel = !std::strcmp(mode, "kernel");
+			bool const scheduled = !std::strcmp(mode, "scheduler");
+			std::size_t const count = scheduled ? kFlows : 1;
+
+			std::vector<StreamSocket> clients, servers;
+			clients.reserve(count);
+			servers.reserve(count);
+			connect_pairs(count, 39612, clients, servers);
+
+			std::atomic<bool> stop(false);
+			std::unique_ptr<std::atomic<std::uint64_t>[]> received(new std::atomic<std::uint64_t>[count]);
+			for(std::size_t i = 0; i < count; i++)
+				received[i] = 0;
+			std::thread receiver(counting_receiver, std::ref(servers), received.get(), std::ref(stop));
+
+			std::vector<std::uint8_t> chunk(kBurst, 'x');
+			std::vector<PollEvent> events;
+
+			auto const start = Clock::now();
+			if(kernel)
+			{
+				require(clients[0].set_max_pacing_rate(std::uint64_t(kRate)), "pacing: could not set pacing rate");
+				Poller poller;
+				poller.watch(&clients[0], false, true);
+				while(Clock::now() - start < kDuration)
+				{
+					std::size_t sent;
+					if(Status::kSuccess != clients[0].send(chunk.data(), chunk.size(), sent))
+						await_output(poller, events);
+				}
+			} else
+			{
+				std::vector<std::unique_ptr<x::BufferedConnection>> connections;
+				Poller poller;
+				x::SendScheduler scheduler(kRate, kBurst);
+				for(StreamSocket &client : clients)
+				{
+					connections.emplace_back(new x::BufferedConnection(std::move(client), kBurst));
+					poller.watch(connections.back().get(), false, true);
+					if(scheduled)
+						scheduler.add(*connections.back());
+					else
+						connections.back()->set_rate_limit(kRate, kBurst);
+				}
+
+				while(Clock::now() - start < kDuration)
+				{
+					for(auto &connection : connections)
+						connection->write(chunk.data(), connection->output().free_space());
+
+					Clock::duration delay;
+					if(scheduled)
+						delay = scheduler.flush();
+					else
+					{
+						connections[0]->flush_some();
+						delay = connections[0]->send_delay();
+					}
+
+					// Throttled connections are writable, so polling would not wait.
+					if(delay != Clock::duration::max() && delay.count() > 0)
+						std::this_thread::sleep_for(delay);
+					else
+						await_output(poller, events);
+				}
+
+				for(auto &connection : connections)
+					connection->discard();
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			stop = true;
+			receiver.join();
+
+			std::uint64_t total = 0, min = ~std::uint64_t(0), max = 0;
+			for(std::size_t i = 0; i < count; i++)
+			{
+				total += received[i];
+				min = std::min<std::uint64_t>(min, received[i]);
+				max = std::max<std::uint64_t>(max, received[i]);
+			}
+
+			Result("pacing")
+				.add("mode", mode)
+				.add("connections", std::uint64_t(count))
+				.add("seconds", seconds)
+				.add("target_mbit_per_s", kRate * 8 / 1e6)
+				.add("achieved_mbit_per_s", double(total) * 8 / seconds / 1e6)
+				.add("min_share", double(min) / double(total))
+				.add("max_share", double(max) / double(total))
+				.print();
+		}
+	}
+
+	void pacing()
+	{
+		for(char const * mode : { "kernel", "shaper", "scheduler" })
+			pacing(mode);
+	}
+}
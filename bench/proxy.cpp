@@ -0,0 +1,153 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/Proxy.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The size of sent and received chunks, in bytes. */
+		constexpr std::size_t kChunkSize = 1 << 16;
+
+		/** Accepts one connection from a listener. */
+		StreamSocket accept_one(
+			x::ConnectionListener &listener,
+			char const * what)
+		{
+			Poller poller;
+			poller.watch(&listener, true, false);
+			std::vector<PollEvent> events;
+			StreamSocket socket;
+			auto const start = Clock::now();
+			while(Status::kSuccess != listener.accept(socket))
+			{
+				require(Clock::now() - start < kDuration, what);
+				events.clear();
+				poller.poll(events, 10);
+			}
+			return socket;
+		}
+
+		/** Sends as fast as possible for `kDuration`, then shuts down sending. */
+		void bulk_sender(
+			StreamSocket &socket)
+		{
+			Poller poller;
+			poller.watch(&socket, false, true);
+			std::vector<PollEvent> events;
+			std::vector<std::uint8_t> chunk(kChunkSize, 'x');
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				std::size_t sent;
+				if(Status::kSuccess != socket.send(chunk.data(), chunk.size(), sent))
+				{
+					events.clear();
+					poller.poll(events, 10);
+				}
+			}
+			socket.shutdown(Shutdown::kSend);
+		}
+
+		/** Receives and discards everything until the peer shuts down sending. */
+		void bulk_receiver(
+			StreamSocket &socket,
+			std::atomic<std::uint64_t> &received)
+		{
+			Poller poller;
+			poller.watch(&socket, true, false);
+			std::vector<PollEvent> events;
+			std::vector<std::uint8_t> chunk(kChunkSize);
+
+			std::uint64_t total = 0;
+			for(;;)
+			{
+				std::size_t size;
+				Status const status = socket.recv(chunk.data(), chunk.size(), size);
+				if(status == Status::kSuccess)
+				{
+					if(!size)
+						break;
+					total += size;
+				} else if(status == Status::kNotReady)
+				{
+					events.clear();
+					poller.poll(events, 10);
+				} else
+					break;
+			}
+			received = total;
+		}
+
+		/** Forwards a bulk transfer through a proxy, with or without `splice()`. */
+		void proxy_throughput(
+			bool zero_copy)
+		{
+			x::ConnectionListener front, back;
+			require(front.listen(loopback(39608), true), "proxy_throughput: could not listen");
+			require(back.listen(loopback(39609), true), "proxy_throughput: could not listen");
+
+			StreamSocket client(AddressFamily::kIPv4), upstream(AddressFamily::kIPv4);
+			Status status = client.connect(loopback(39608));
+			require(status == Status::kSuccess || status == Status::kInProgress, "proxy_throughput: could not connect");
+			status = upstream.connect(loopback(39609));
+			require(status == Status::kSuccess || status == Status::kInProgress, "proxy_throughput: could not connect");
+
+			StreamSocket downstream = accept_one(front, "proxy_throughput: could not accept");
+			StreamSocket server = accept_one(back, "proxy_throughput: could not accept");
+			require(await_connect(client) && await_connect(upstream), "proxy_throughput: could not connect");
+
+			x::Proxy proxy(std::move(downstream), std::move(upstream), 1 << 16, zero_copy);
+			Poller poller;
+			require(proxy.attach(poller), "proxy_throughput: could not watch");
+
+			// The server never sends, so that the proxy finishes once the client's transfer was forwarded.
+			require(Status::kSuccess == server.shutdown(Shutdown::kSend), "proxy_throughput: could not shut down");
+
+			std::atomic<std::uint64_t> received(0);
+			auto const start = Clock::now();
+			std::thread sender(bulk_sender, std::ref(client));
+			std::thread receiver(bulk_receiver, std::ref(server), std::ref(received));
+
+			std::vector<PollEvent> events;
+			bool running = true;
+			while(running)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+					if(!x::Proxy::Endpoint::cast_from_base(event.entry->socket)->proxy().handle(event))
+						running = false;
+				require(Clock::now() - start < 5 * kDuration, "proxy_throughput: transfer did not finish");
+			}
+
+			sender.join();
+			receiver.join();
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			require(!proxy.failed() && received == proxy.forwarded(true), "proxy_throughput: data was lost");
+
+			Result("proxy_throughput")
+				.add("mode", proxy.zero_copy() ? "splice" : "buffered")
+				.add("seconds", seconds)
+				.add("bytes", std::uint64_t(received))
+				.add("gbit_per_s", double(received) * 8 / seconds / 1e9)
+				.print();
+		}
+	}
+
+	void proxy_throughput()
+	{
+		for(bool zero_copy : { false, true })
+			proxy_throughput(zero_copy);
+	}
+}
@@ -0,0 +1,150 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/ReliableChannel.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** How long the sender may take to deliver its remaining messages afterwards. */
+		constexpr std::chrono::seconds kDrainTimeout(10);
+		/** The number of streams messages are spread over. */
+		constexpr std::uint16_t kStreams = 4;
+		/** The size of each message, in bytes, which takes several packets. */
+		constexpr std::size_t kMessageSize = 3000;
+		/** The send limit, in bytes. */
+		constexpr std::size_t kSendLimit = 1 << 20;
+		/** The receive limit of the slow receiver, in bytes, which holds only a few messages. */
+		constexpr std::size_t kSmallReceiveLimit = 4 * kMessageSize;
+
+		/** How the channels are driven. */
+		enum class Mode
+		{
+			/** Via `send()` and `receive()`. */
+			kPlain,
+			/** Via the `Send` and `Receive` coroutines. */
+			kCoroutines,
+			/** Via `send()` and `receive()`, but the receiver takes only one message per poll, with a small receive limit. */
+			kSlowReceiver
+		};
+
+		/** Sends messages over a reliable channel on loopback, with outgoing datagrams dropped at the given rate in both directions, and checks that every stream's messages arrive complete and in order. */
+		void reliable_udp(
+			double loss,
+			Mode mode)
+		{
+			DatagramSocket a(AddressFamily::kIPv4), b(AddressFamily::kIPv4);
+			require(a.bind(loopback(39614), true) && b.bind(loopback(39615), true), "reliable_udp: could not bind");
+			require(Status::kSuccess == a.connect(loopback(39615))
+				&& Status::kSuccess == b.connect(loopback(39614)), "reliable_udp: could not connect");
+
+			x::ReliableChannel sender(a, kSendLimit), receiver(b, kSendLimit, 1 << 16,
+				mode == Mode::kSlowReceiver ? kSmallReceiveLimit : std::size_t(1) << 20);
+			sender.simulate_loss(loss, 1);
+			receiver.simulate_loss(loss, 2);
+
+			Poller poller;
+			poller.watch(&a, true, false);
+			poller.watch(&b, true, false);
+			std::vector<PollEvent> events;
+
+			// Each message starts with its number within its stream.
+			std::vector<std::uint8_t> message(kMessageSize, 'x'), received;
+			std::uint32_t sent_numbers[kStreams] = {}, received_numbers[kStreams] = {};
+			std::uint16_t next_stream = 0;
+			std::uint64_t messages = 0;
+			// The coroutines would wait while the send limit is reached, or no message arrived, so they are only started when they finish right away.
+			std::size_t const message_datagrams = kMessageSize
+				+ (kMessageSize + x::ReliableChannel::kMaxFragmentSize - 1) / x::ReliableChannel::kMaxFragmentSize * x::ReliableChannel::kHeaderSize;
+
+			auto const pump = [&] {
+				auto const delay = std::min(sender.update(), receiver.update());
+				events.clear();
+				poller.poll(events, std::clamp<std::int64_t>(
+					std::chrono::duration_cast<std::chrono::milliseconds>(delay).count(), 0, 10));
+				for(PollEvent const& event : events)
+				{
+					x::ReliableChannel &channel = event.entry->socket == &a ? sender : receiver;
+					require(channel.receive_packets(), "reliable_udp: channel failed");
+				}
+
+				for(std::size_t taken = 0; mode != Mode::kSlowReceiver || taken < 1; taken++)
+				{
+					std::uint16_t stream;
+					if(mode == Mode::kCoroutines)
+					{
+						if(!receiver.received())
+							break;
+						x::ReliableChannel::Receive receive{&receiver, stream, received};
+						require(receive(), "reliable_udp: channel failed");
+					} else if(!receiver.receive(stream, received))
+						break;
+
+					require(stream < kStreams && received.size() == kMessageSize, "reliable_udp: corrupt message");
+					std::uint32_t number;
+					std::memcpy(&number, received.data(), sizeof(number));
+					require(number == received_numbers[stream]++, "reliable_udp: message out of order");
+					++messages;
+				}
+			};
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				for(;;)
+				{
+					std::memcpy(message.data(), &sent_numbers[next_stream], sizeof(std::uint32_t));
+					if(mode == Mode::kCoroutines)
+					{
+						if(sender.queued() + message_datagrams > kSendLimit)
+							break;
+						x::ReliableChannel::Send send{&sender, next_stream, message.data(), message.size()};
+						require(send(), "reliable_udp: channel failed");
+					} else if(!sender.send(next_stream, message.data(), message.size()))
+						break;
+					++sent_numbers[next_stream];
+					next_stream = (next_stream + 1) % kStreams;
+				}
+
+				pump();
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+			std::uint64_t const delivered = messages;
+
+			// Everything that was sent has to arrive.
+			auto const drain_start = Clock::now();
+			while(sender.queued() || receiver.received() || receiver.buffered())
+			{
+				pump();
+				require(Clock::now() - drain_start < kDrainTimeout, "reliable_udp: messages were not delivered");
+			}
+			for(std::uint16_t stream = 0; stream < kStreams; stream++)
+				require(received_numbers[stream] == sent_numbers[stream], "reliable_udp: messages were lost");
+
+			Result("reliable_udp")
+				.add("mode", mode == Mode::kPlain ? "plain" : mode == Mode::kCoroutines ? "coroutines" : "slow_receiver")
+				.add("loss", loss)
+				.add("seconds", seconds)
+				.add("messages", delivered)
+				.add("mbit_per_s", double(delivered * kMessageSize) * 8 / seconds / 1e6)
+				.add("retransmissions", sender.retransmissions())
+				.add("congestion_window", sender.congestion_window())
+				.add("smoothed_rtt_us", double(std::chrono::duration_cast<std::chrono::nanoseconds>(sender.smoothed_rtt()).count()) / 1e3)
+				.print();
+		}
+	}
+
+	void reliable_udp()
+	{
+		for(double loss : { 0.0, 0.01, 0.05 })
+			reliable_udp(loss, Mode::kPlain);
+		reliable_udp(0.01, Mode::kCoroutines);
+		reliable_udp(0.01, Mode::kSlowReceiver);
+	}
+}
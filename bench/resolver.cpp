@@ -0,0 +1,431 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/Resolver.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <set>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** The port of the stub name server, for UDP and TCP. */
+		constexpr port_t kPort = 39618;
+		/** How long the resolver waits for an answer before retrying. */
+		constexpr std::chrono::milliseconds kRetry(50);
+		/** How often the resolver sends a query before giving up. */
+		constexpr unsigned kAttempts = 3;
+		/** How long any single lookup may take. */
+		constexpr std::chrono::seconds kTimeout(5);
+		/** The number of distinct names resolved for the throughput measurement. */
+		constexpr std::size_t kNames = 1000;
+		/** How many of them are resolved concurrently. Larger bursts overflow the stub server's receive buffer. */
+		constexpr std::size_t kConcurrent = 50;
+		/** The number of addresses in the answer that only fits over TCP. */
+		constexpr std::size_t kLargeAnswer = 200;
+
+		constexpr std::uint16_t kTypeA = 1, kTypeCname = 5, kTypeSoa = 6, kTypeAaaa = 28;
+
+		void put16(
+			std::vector<std::uint8_t> &out,
+			std::uint16_t value)
+		{
+			out.push_back(std::uint8_t(value >> 8));
+			out.push_back(std::uint8_t(value));
+		}
+
+		void put32(
+			std::vector<std::uint8_t> &out,
+			std::uint32_t value)
+		{
+			put16(out, std::uint16_t(value >> 16));
+			put16(out, std::uint16_t(value));
+		}
+
+		std::uint16_t get16(
+			std::uint8_t const * in)
+		{
+			return std::uint16_t((in[0] << 8) | in[1]);
+		}
+
+		/** Encodes a name without compression. */
+		void put_name(
+			std::vector<std::uint8_t> &out,
+			std::string const& name)
+		{
+			std::size_t begin = 0;
+			while(begin < name.size())
+			{
+				std::size_t end = name.find('.', begin);
+				if(end == std::string::npos)
+					end = name.size();
+				out.push_back(std::uint8_t(end - begin));
+				out.insert(out.end(), name.begin() + begin, name.begin() + end);
+				begin = end + 1;
+			}
+			out.push_back(0);
+		}
+
+		/** Appends a resource record. */
+		void put_record(
+			std::vector<std::uint8_t> &out,
+			std::string const& name,
+			std::uint16_t type,
+			std::vector<std::uint8_t> const& data)
+		{
+			put_name(out, name);
+			put16(out, type);
+			put16(out, 1);
+			put32(out, 300);
+			put16(out, std::uint16_t(data.size()));
+			out.insert(out.end(), data.begin(), data.end());
+		}
+
+		/** A name server that answers from a fixed zone, with some misbehaviour to exercise the resolver:
+			- `host.test` has an A and an AAAA record,
+			- `alias.test` is a CNAME of `target.test`, which only has an A record,
+			- `large.test` has too many A records for UDP, so UDP answers are truncated,
+			- `flaky.test` ignores the first UDP query of each record type,
+			- `silent.test` never answers,
+			- `nN.test` has the A record 10.1.N/256.N%256,
+			- all other names do not exist. */
+		class StubServer
+		{
+			DatagramSocket m_udp;
+			x::ConnectionListener m_tcp;
+			std::atomic<bool> m_stop;
+			std::thread m_thread;
+			/** The record types that `flaky.test` was queried for via UDP. */
+			std::set<std::uint16_t> m_flaky_types;
+
+			/** Creates the answer to a query. */
+			std::vector<std::uint8_t> answer(
+				std::uint8_t const * query,
+				std::size_t size,
+				bool tcp)
+			{
+				std::vector<std::uint8_t> out;
+				if(size < 12 || get16(query + 4) != 1)
+					return out;
+
+				// Reads the question.
+				std::string name;
+				std::size_t offset = 12;
+				while(offset < size && query[offset])
+				{
+					std::size_t const length = query[offset++];
+					if(offset + length > size)
+						return out;
+					if(!name.empty())
+						name += '.';
+					name.append(reinterpret_cast<char const *>(query + offset), length);
+					offset += length;
+				}
+				if(offset + 5 > size)
+					return out;
+				std::size_t const question_end = offset + 5;
+				std::uint16_t const type = get16(query + offset + 1);
+
+				if(name == "silent.test")
+					return out;
+				if(name == "flaky.test" && !tcp && m_flaky_types.insert(type).second)
+					return out;
+
+				std::vector<std::uint8_t> answers;
+				std::uint16_t answer_count = 0, authority_count = 0;
+				bool exists = true, truncated = false;
+				auto const add_a = [&](std::string const& owner, std::uint8_t c, std::uint8_t d) {
+					put_record(answers, owner, kTypeA, { 10, 1, c, d });
+					++answer_count;
+				};
+
+				if(name == "host.test")
+				{
+					if(type == kTypeA)
+						add_a(name, 0, 1);
+					else
+					{
+						std::vector<std::uint8_t> ipv6(16, 0);
+						ipv6[0] = 0x20; ipv6[1] = 0x01; ipv6[2] = 0x0d; ipv6[3] = 0xb8; ipv6[15] = 1;
+						put_record(answers, name, kTypeAaaa, ipv6);
+						++answer_count;
+					}
+				} else if(name == "alias.test")
+				{
+					std::vector<std::uint8_t> target;
+					put_name(target, "target.test");
+					put_record(answers, name, kTypeCname, target);
+					++answer_count;
+					if(type == kTypeA)
+						add_a("target.test", 0, 2);
+				} else if(name == "large.test")
+				{
+					if(type == kTypeA)
+					{
+						if(tcp)
+							for(std::size_t i = 0; i < kLargeAnswer; i++)
+								add_a(name, 2, std::uint8_t(i));
+						else
+							truncated = true;
+					}
+				} else if(name == "flaky.test")
+				{
+					if(type == kTypeA)
+						add_a(name, 0, 3);
+				} else if(name.size() > 6 && name[0] == 'n' && name.compare(name.size() - 5, 5, ".test") == 0)
+				{
+					std::size_t const number = std::stoul(name.substr(1, name.size() - 6));
+					if(type == kTypeA)
+						add_a(name, std::uint8_t(number >> 8), std::uint8_t(number));
+				} else
+				{
+					// Negative answers carry the zone's SOA record, whose minimum bounds their caching.
+					exists = false;
+					std::vector<std::uint8_t> soa;
+					put_name(soa, "ns.test");
+					put_name(soa, "admin.test");
+					for(std::uint32_t value : { 1u, 3600u, 600u, 86400u, 60u })
+						put32(soa, value);
+					put_record(answers, "test", kTypeSoa, soa);
+					++authority_count;
+				}
+
+				out.assign(query, query + question_end);
+				out[2] = std::uint8_t(0x81 | (truncated ? 0x02 : 0));
+				out[3] = std::uint8_t(0x80 | (exists ? 0 : 3));
+				out[6] = std::uint8_t(answer_count >> 8);
+				out[7] = std::uint8_t(answer_count);
+				out[8] = std::uint8_t(authority_count >> 8);
+				out[9] = std::uint8_t(authority_count);
+				out[10] = out[11] = 0;
+				out.insert(out.end(), answers.begin(), answers.end());
+				return out;
+			}
+
+			/** Answers a single query on an accepted TCP connection, then closes it. */
+			void serve_tcp(
+				StreamSocket &socket)
+			{
+				std::vector<std::uint8_t> query;
+				std::uint8_t buffer[512];
+				auto const start = Clock::now();
+				while(query.size() < 2 || query.size() < 2 + std::size_t(get16(query.data())))
+				{
+					std::size_t received;
+					Status const status = socket.recv(buffer, sizeof(buffer), received);
+					if(status == Status::kError || (status == Status::kSuccess && !received)
+					|| Clock::now() - start > kTimeout)
+						return;
+					if(status == Status::kSuccess)
+						query.insert(query.end(), buffer, buffer + received);
+					else
+						std::this_thread::yield();
+				}
+
+				std::vector<std::uint8_t> reply = answer(query.data() + 2, query.size() - 2, true);
+				std::vector<std::uint8_t> framed;
+				put16(framed, std::uint16_t(reply.size()));
+				framed.insert(framed.end(), reply.begin(), reply.end());
+
+				std::size_t offset = 0;
+				while(offset < framed.size() && Clock::now() - start < kTimeout)
+				{
+					std::size_t sent;
+					Status const status = socket.send(framed.data() + offset, framed.size() - offset, sent);
+					if(status == Status::kError)
+						return;
+					if(status == Status::kSuccess)
+						offset += sent;
+				}
+			}
+
+			void run()
+			{
+				Poller poller;
+				poller.watch(&m_udp, true, false);
+				poller.watch(&m_tcp, true, false);
+				std::vector<PollEvent> events;
+				std::uint8_t query[512];
+
+				while(!m_stop)
+				{
+					events.clear();
+					poller.poll(events, 10);
+
+					SocketAddress from;
+					std::size_t received, sent;
+					while(Status::kSuccess == m_udp.recvfrom(query, sizeof(query), from, received))
+					{
+						std::vector<std::uint8_t> const reply = answer(query, received, false);
+						if(!reply.empty())
+							m_udp.sendto(reply.data(), reply.size(), from, sent);
+					}
+
+					StreamSocket connection;
+					while(Status::kSuccess == m_tcp.accept(connection))
+						serve_tcp(connection);
+				}
+			}
+		public:
+			StubServer():
+				m_udp(AddressFamily::kIPv4),
+				m_stop(false)
+			{
+				require(m_udp.bind(loopback(kPort), true), "resolver: could not bind stub server");
+				require(m_tcp.listen(loopback(kPort), true), "resolver: could not listen on stub server");
+				m_thread = std::thread(&StubServer::run, this);
+			}
+
+			~StubServer()
+			{
+				m_stop = true;
+				m_thread.join();
+			}
+		};
+
+		/** Drives the resolver until the lookup of every given name finished.
+		@return
+			How long it took, in nanoseconds. */
+		std::uint64_t resolve_all(
+			x::Resolver &resolver,
+			std::vector<std::string> const& names,
+			std::vector<std::vector<AddressInfo>> &results)
+		{
+			Poller poller;
+			poller.watch(&resolver, true, false);
+			std::vector<PollEvent> events;
+
+			auto const start = Clock::now();
+			results.assign(names.size(), {});
+			std::vector<bool> done(names.size());
+			std::size_t remaining = names.size();
+			for(std::size_t i = 0; i < names.size(); i++)
+			{
+				Status const status = resolver.begin(names[i].c_str(), results[i]);
+				require(status != Status::kError, "resolver: could not send query");
+				if(status == Status::kSuccess)
+				{
+					done[i] = true;
+					--remaining;
+				}
+			}
+
+			while(remaining)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				require(resolver.update(), "resolver: update failed");
+				for(std::size_t i = 0; i < names.size(); i++)
+					if(!done[i] && resolver.finished(names[i].c_str(), results[i]))
+					{
+						done[i] = true;
+						--remaining;
+					}
+				require(Clock::now() - start < kTimeout, "resolver: lookup did not finish");
+			}
+			return elapsed_ns(start);
+		}
+
+		/** Resolves a single name. */
+		std::vector<AddressInfo> resolve(
+			x::Resolver &resolver,
+			char const * name,
+			std::uint64_t * ns = nullptr)
+		{
+			std::vector<std::vector<AddressInfo>> results;
+			std::uint64_t const elapsed = resolve_all(resolver, { name }, results);
+			if(ns)
+				*ns = elapsed;
+			return results[0];
+		}
+
+		bool has_ipv4(
+			std::vector<AddressInfo> const& addresses,
+			IPv4Address const& address)
+		{
+			for(AddressInfo const& info : addresses)
+				if(info.address.family == AddressFamily::kIPv4
+				&& info.address.address.ipv4.address == address)
+					return true;
+			return false;
+		}
+	}
+
+	void resolver()
+	{
+		StubServer server;
+		x::Resolver resolver(loopback(kPort), true, kRetry, kAttempts);
+		require(resolver.exists(), "resolver: could not create resolver");
+
+		// IPv6 addresses come first.
+		std::vector<AddressInfo> addresses = resolve(resolver, "host.test");
+		require(addresses.size() == 2
+			&& addresses[0].address.family == AddressFamily::kIPv6
+			&& has_ipv4(addresses, IPv4Address(10, 1, 0, 1)), "resolver: wrong answer for A and AAAA");
+
+		// Answered from the cache, without a query.
+		std::uint64_t const misses = resolver.statistics().misses;
+		require(Status::kSuccess == resolver.begin("HOST.test.", addresses) && addresses.size() == 2
+			&& resolver.statistics().misses == misses
+			&& resolver.statistics().hits == 1, "resolver: answer was not cached");
+
+		// The address of the CNAME's target is returned for the alias.
+		addresses = resolve(resolver, "alias.test");
+		require(addresses.size() == 1 && has_ipv4(addresses, IPv4Address(10, 1, 0, 2)), "resolver: CNAME not followed");
+
+		// Truncated UDP answers are retried over TCP.
+		addresses = resolve(resolver, "large.test");
+		require(addresses.size() == kLargeAnswer
+			&& resolver.statistics().truncated == 1, "resolver: truncated answer not retried over TCP");
+
+		// Unanswered queries are retransmitted.
+		std::uint64_t retry_ns;
+		addresses = resolve(resolver, "flaky.test", &retry_ns);
+		require(has_ipv4(addresses, IPv4Address(10, 1, 0, 3))
+			&& retry_ns >= std::uint64_t(std::chrono::nanoseconds(kRetry).count()), "resolver: query not retransmitted");
+
+		// Lookups fail once all attempts timed out.
+		std::uint64_t timeout_ns;
+		addresses = resolve(resolver, "silent.test", &timeout_ns);
+		require(addresses.empty()
+			&& resolver.statistics().timeouts == 1
+			&& timeout_ns >= kAttempts * std::uint64_t(std::chrono::nanoseconds(kRetry).count()), "resolver: query did not time out");
+
+		addresses = resolve(resolver, "missing.test");
+		require(addresses.empty(), "resolver: nonexistent name resolved");
+
+		// Concurrent lookups of the same name share a query.
+		std::vector<std::vector<AddressInfo>> results;
+		std::uint64_t const coalesced = resolver.statistics().coalesced;
+		resolve_all(resolver, { "n1.test", "n1.test", "n1.test" }, results);
+		require(resolver.statistics().coalesced == coalesced + 2
+			&& has_ipv4(results[2], IPv4Address(10, 1, 0, 1)), "resolver: lookups not coalesced");
+
+		// Many distinct names, some at once.
+		std::uint64_t concurrent_ns = 0;
+		for(std::size_t first = 2; first < 2 + kNames; first += kConcurrent)
+		{
+			std::vector<std::string> names;
+			for(std::size_t i = first; i < first + kConcurrent; i++)
+				names.push_back("n" + std::to_string(i) + ".test");
+			concurrent_ns += resolve_all(resolver, names, results);
+			for(std::size_t i = 0; i < kConcurrent; i++)
+				require(has_ipv4(results[i], IPv4Address(10, 1, std::uint8_t((first + i) >> 8), std::uint8_t(first + i))), "resolver: wrong answer under load");
+		}
+
+		Result("resolver")
+			.add("names", std::uint64_t(kNames))
+			.add("concurrent", std::uint64_t(kConcurrent))
+			.add("lookups_per_s", double(kNames) / (double(concurrent_ns) / 1e9))
+			.add("retry_ms", double(retry_ns) / 1e6)
+			.add("timeout_ms", double(timeout_ns) / 1e6)
+			.add("truncated", resolver.statistics().truncated)
+			.add("timeouts", resolver.statistics().timeouts)
+			.print();
+	}
+}
@@ -0,0 +1,142 @@
+#include "bench.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/RpcChannel.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** How long calls may take before they count as failed. */
+		constexpr std::chrono::seconds kTimeout(10);
+		/** The size of requests and responses, in bytes. */
+		constexpr std::size_t kMessageSize = 512;
+		/** The buffer sizes of both connections, in bytes, which are far smaller than the concurrent calls' requests. */
+		constexpr std::size_t kBufferSize = 4096;
+		/** How long the slow server waits before every read. */
+		constexpr std::chrono::microseconds kReadDelay(200);
+
+		/** Answers every request with its own payload until `stop` is set, optionally waiting before every read. */
+		void echo_server(
+			x::BufferedConnection &connection,
+			bool slow,
+			std::atomic<bool> &stop)
+		{
+			x::RpcChannel channel(connection, kMessageSize);
+			Poller poller;
+			poller.watch(&connection, true, false);
+			std::vector<PollEvent> events;
+			while(!stop)
+			{
+				events.clear();
+				poller.poll(events, 1);
+				if(!events.empty())
+				{
+					if(slow)
+						std::this_thread::sleep_for(kReadDelay);
+					if(!channel.receive())
+						return;
+
+					std::uint32_t id;
+					std::string_view payload;
+					while(channel.next_request(id, payload))
+					{
+						require(channel.reply(id, payload.data(), payload.size()), "rpc: could not reply");
+						require(channel.finish_request(), "rpc: invalid request");
+					}
+				}
+				if(!channel.update())
+					return;
+			}
+		}
+
+		/** Keeps `concurrency` calls in flight for `kDuration`, and checks every response. */
+		void rpc(
+			std::size_t concurrency,
+			bool slow)
+		{
+			// A socket pair needs no port, which earlier benchmarks' connections may still hold in TIME_WAIT.
+			StreamSocket client_socket, server_socket;
+			require(StreamSocket::pair(client_socket, server_socket), "rpc: could not create socket pair");
+
+			x::BufferedConnection client(std::move(client_socket), kBufferSize);
+			x::BufferedConnection server(std::move(server_socket), kBufferSize);
+			std::atomic<bool> stop(false);
+			std::thread server_thread(echo_server, std::ref(server), slow, std::ref(stop));
+
+			std::uint64_t completed = 0;
+			util::Histogram latency;
+			{
+				// Pending calls are failed when the channel is destroyed, so they have to outlive it.
+				std::unique_ptr<x::RpcCall[]> calls(new x::RpcCall[concurrency]);
+				x::RpcChannel channel(client, kMessageSize);
+				// Every call's request starts with its index and its sequence number, so that mixed up responses are noticed.
+				std::vector<std::vector<std::uint8_t>> requests(concurrency, std::vector<std::uint8_t>(kMessageSize, 'x'));
+				std::vector<std::uint32_t> sequence(concurrency, 0);
+				std::vector<Clock::time_point> started(concurrency);
+
+				Poller poller;
+				poller.watch(&client, true, false);
+				std::vector<PollEvent> events;
+
+				auto const start = Clock::now();
+				while(Clock::now() - start < kDuration)
+				{
+					for(std::size_t i = 0; i < concurrency; i++)
+					{
+						x::RpcCall &call = calls[i];
+						if(call.state() == x::RpcCall::State::kPending)
+							continue;
+						if(call.state() != x::RpcCall::State::kIdle)
+						{
+							require(call.state() == x::RpcCall::State::kSuccess, "rpc: call failed");
+							require(call.response() == requests[i], "rpc: wrong response");
+							latency.record(elapsed_ns(started[i]));
+							completed++;
+						}
+
+						std::uint32_t const tag[2] = { std::uint32_t(i), ++sequence[i] };
+						std::memcpy(requests[i].data(), tag, sizeof(tag));
+						started[i] = Clock::now();
+						require(channel.start(call, requests[i].data(), kMessageSize, kTimeout), "rpc: could not start call");
+					}
+
+					require(channel.update(), "rpc: connection failed");
+					events.clear();
+					poller.poll(events, 1);
+					if(!events.empty())
+						require(channel.receive(), "rpc: connection failed");
+				}
+				double const seconds = double(elapsed_ns(start)) / 1e9;
+
+				Result("rpc")
+					.add("reader", slow ? "slow" : "fast")
+					.add("concurrency", std::uint64_t(concurrency))
+					.add("message_size", std::uint64_t(kMessageSize))
+					.add("seconds", seconds)
+					.add("calls_per_s", double(completed) / seconds)
+					.add("latency_", latency)
+					.print();
+			}
+
+			stop = true;
+			server_thread.join();
+			client.discard();
+			server.discard();
+		}
+	}
+
+	void rpc()
+	{
+		for(bool slow : { false, true })
+			for(std::size_t concurrency : { 1, 64, 1024 })
+				rpc(concurrency, slow);
+	}
+}
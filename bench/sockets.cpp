@@ -0,0 +1,437 @@
+#include "bench.hpp"
+#include "../src/Socket.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/BufferedConnection.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each socket benchmark runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The size of echoed messages, in bytes. */
+		constexpr std::size_t kMessageSize = 64;
+
+		/** Accepts `count` connections, and echoes everything they send until `stop` is set. */
+		void echo_server(
+			x::ConnectionListener &listener,
+			std::size_t count,
+			std::atomic<bool> &stop)
+		{
+			std::vector<std::unique_ptr<x::BufferedConnection>> connections;
+			connections.reserve(count);
+			std::vector<PollEvent> events;
+
+			{
+				Poller poller;
+				poller.watch(&listener, true, false);
+				StreamSocket socket;
+				while(connections.size() < count && !stop)
+				{
+					events.clear();
+					poller.poll(events, 10);
+					while(connections.size() < count
+					&& Status::kSuccess == listener.accept(socket))
+						connections.emplace_back(new x::BufferedConnection(std::move(socket), 4096));
+				}
+			}
+
+			Poller poller;
+			poller.reserve(connections.size());
+			for(auto &connection : connections)
+				poller.watch(connection.get(), true, false);
+
+			// Connections whose echo did not fit into the socket's send buffer at once. No new input event arrives for data that is already buffered.
+			std::vector<x::BufferedConnection *> pending, still_pending;
+			while(!stop)
+			{
+				events.clear();
+				poller.poll(events, pending.empty() ? 10 : 0);
+				for(PollEvent const& event : events)
+				{
+					x::BufferedConnection * connection = x::BufferedConnection::cast_from_base(event.entry->socket);
+					if(connection->receive_some()
+					&& Status::kNotReady == connection->forward(*connection)
+					&& std::find(pending.begin(), pending.end(), connection) == pending.end())
+						pending.push_back(connection);
+				}
+
+				still_pending.clear();
+				for(x::BufferedConnection * connection : pending)
+					if(Status::kNotReady == connection->forward(*connection))
+						still_pending.push_back(connection);
+				pending.swap(still_pending);
+			}
+
+			for(auto &connection : connections)
+				connection->discard();
+		}
+
+		/** Runs the echo benchmark with the given number of connections. */
+		void tcp_echo(
+			std::size_t count)
+		{
+			// Every connection needs a client and a server socket.
+			std::size_t const limit = raise_file_limit();
+			if(limit < 64 + 2 * count)
+				count = (limit - 64) / 2;
+
+			SocketAddress const address = loopback(39601);
+			x::ConnectionListener listener;
+			require(listener.listen(address, true), "tcp_echo: could not listen");
+
+			std::atomic<bool> stop(false);
+			std::thread server(echo_server, std::ref(listener), count, std::ref(stop));
+
+			std::vector<StreamSocket> clients;
+			clients.reserve(count);
+			for(std::size_t i = 0; i < count; i++)
+			{
+				clients.emplace_back(AddressFamily::kIPv4);
+				Status status = clients.back().connect(address);
+				require(status == Status::kSuccess || status == Status::kInProgress, "tcp_echo: could not connect");
+			}
+			for(StreamSocket &client : clients)
+				require(await_connect(client), "tcp_echo: could not connect");
+
+			Poller poller;
+			poller.reserve(count);
+			for(StreamSocket &client : clients)
+				poller.watch(&client, true, false);
+
+			std::uint8_t message[kMessageSize];
+			std::memset(message, 'x', sizeof(message));
+			std::vector<Clock::time_point> sent(count);
+			std::vector<std::size_t> received(count, 0);
+			util::Histogram latency;
+			std::vector<PollEvent> events;
+
+			// Keep one request in flight per connection.
+			for(std::size_t i = 0; i < count; i++)
+			{
+				std::size_t size;
+				sent[i] = Clock::now();
+				require(Status::kSuccess == clients[i].send(message, sizeof(message), size) && size == sizeof(message), "tcp_echo: could not send");
+			}
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				events.clear();
+				poller.poll(events, 10);
+				for(PollEvent const& event : events)
+				{
+					std::size_t const i = static_cast<StreamSocket *>(event.entry->socket) - clients.data();
+					std::uint8_t reply[kMessageSize];
+					std::size_t size;
+					if(Status::kSuccess != clients[i].recv(reply, kMessageSize - received[i], size))
+						continue;
+					if((received[i] += size) < kMessageSize)
+						continue;
+
+					received[i] = 0;
+					auto const now = Clock::now();
+					latency.record(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent[i]).count()));
+					sent[i] = now;
+					clients[i].send(message, sizeof(message), size);
+				}
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			stop = true;
+			server.join();
+
+			Result("tcp_echo")
+				.add("connections", std::uint64_t(count))
+				.add("message_size", std::uint64_t(kMessageSize))
+				.add("seconds", seconds)
+				.add("requests_per_s", double(latency.count()) / seconds)
+				.add("latency_", latency)
+				.print();
+		}
+	}
+
+	void tcp_echo()
+	{
+		for(std::size_t connections : { 1, 100, 10000 })
+			tcp_echo(connections);
+	}
+
+	void tcp_throughput()
+	{
+		constexpr std::size_t kBufferSize = 1 << 16;
+
+		SocketAddress const address = loopback(39602);
+		x::ConnectionListener listener;
+		require(listener.listen(address, true), "tcp_throughput: could not listen");
+
+		StreamSocket client(AddressFamily::kIPv4), server;
+		client.connect(address);
+		require(await_connect(client), "tcp_throughput: could not connect");
+		while(Status::kNotReady == listener.accept(server))
+			std::this_thread::yield();
+		require(server.exists(), "tcp_throughput: could not accept");
+
+		x::BufferedConnection sender(std::move(client), kBufferSize);
+		x::BufferedConnection receiver(std::move(server), kBufferSize);
+
+		Poller poller;
+		poller.watch(&sender, false, true);
+		poller.watch(&receiver, true, false);
+
+		std::vector<std::uint8_t> chunk(kBufferSize, 'x');
+		std::uint64_t bytes = 0;
+		std::vector<PollEvent> events;
+
+		auto const start = Clock::now();
+		while(Clock::now() - start < kDuration)
+		{
+			events.clear();
+			poller.poll(events, 10);
+			for(PollEvent const& event : events)
+			{
+				x::BufferedConnection * connection = x::BufferedConnection::cast_from_base(event.entry->socket);
+				if(connection == &sender)
+				{
+					sender.write(chunk.data(), sender.output().free_space());
+					sender.flush_some();
+				} else if(receiver.receive_some())
+					bytes += receiver.read(chunk.data(), chunk.size());
+			}
+		}
+		double const seconds = double(elapsed_ns(start)) / 1e9;
+
+		sender.discard();
+		receiver.discard();
+
+		Result("tcp_throughput")
+			.add("buffer_size", std::uint64_t(kBufferSize))
+			.add("seconds", seconds)
+			.add("bytes", bytes)
+			.add("bytes_per_s", double(bytes) / seconds)
+			.print();
+	}
+
+	void tcp_accept()
+	{
+		constexpr std::size_t kConnections = 20000;
+
+		SocketAddress const address = loopback(39603);
+		x::ConnectionListener listener;
+		require(listener.listen(address, true), "tcp_accept: could not listen");
+
+		// Resetting the connections keeps them out of TIME_WAIT, so the ephemeral ports do not run out.
+		std::thread client([&address] {
+			for(std::size_t i = 0; i < kConnections; i++)
+			{
+				StreamSocket socket(AddressFamily::kIPv4);
+				socket.connect(address);
+				if(await_connect(socket))
+					socket.abort();
+			}
+		});
+
+		Poller poller;
+		poller.watch(&listener, true, false);
+		std::vector<PollEvent> events;
+		StreamSocket socket;
+		std::size_t accepted = 0;
+
+		auto const start = Clock::now();
+		while(accepted < kConnections && Clock::now() - start < 10 * kDuration)
+		{
+			events.clear();
+			poller.poll(events, 10);
+			while(Status::kSuccess == listener.accept(socket))
+			{
+				++accepted;
+				socket.close();
+			}
+		}
+		double const seconds = double(elapsed_ns(start)) / 1e9;
+
+		client.join();
+
+		Result("tcp_accept")
+			.add("connections", std::uint64_t(accepted))
+			.add("seconds", seconds)
+			.add("accepts_per_s", double(accepted) / seconds)
+			.print();
+	}
+
+	void udp_packets()
+	{
+		constexpr std::size_t kBurst = 64;
+
+		for(std::size_t size : { 64, 1400 })
+		{
+			DatagramSocket sender(AddressFamily::kIPv4), receiver(AddressFamily::kIPv4);
+			require(receiver.bind(loopback(39604), true), "udp_packets: could not bind");
+			require(Status::kSuccess == sender.connect(loopback(39604)), "udp_packets: could not connect");
+
+			std::vector<std::uint8_t> packet(size, 'x');
+			std::uint64_t sent = 0, received = 0;
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				std::size_t transferred;
+				for(std::size_t i = 0; i < kBurst; i++)
+					if(Status::kSuccess == sender.send(packet.data(), size, transferred))
+						++sent;
+					else
+						break;
+
+				while(Status::kSuccess == receiver.recv(packet.data(), size, transferred))
+					++received;
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			Result("udp_packets")
+				.add("packet_size", std::uint64_t(size))
+				.add("seconds", seconds)
+				.add("sent", sent)
+				.add("received", received)
+				.add("packets_per_s", double(received) / seconds)
+				.add("bytes_per_s", double(received * size) / seconds)
+				.print();
+		}
+	}
+
+	void udp_multicast()
+	{
+		constexpr std::size_t kBurst = 64;
+		constexpr std::size_t kSize = 256;
+
+		std::uint32_t const interface = DatagramSocket::interface_index("lo");
+		SocketAddress const group("239.255.0.1:39610");
+
+		for(bool batched : { false, true })
+		{
+			DatagramSocket sender(AddressFamily::kIPv4), receiver(AddressFamily::kIPv4);
+			require(receiver.bind(SocketAddress("0.0.0.0:39610"), true), "udp_multicast: could not bind");
+			require(receiver.join(group, interface), "udp_multicast: could not join");
+			require(sender.set_multicast_interface(interface)
+				&& sender.set_multicast_loopback(true), "udp_multicast: could not configure sender");
+
+			std::vector<std::uint8_t> packets(kBurst * kSize, 'x');
+			ReceivedDatagram datagrams[kBurst];
+			for(std::size_t i = 0; i < kBurst; i++)
+			{
+				datagrams[i].data = &packets[i * kSize];
+				datagrams[i].capacity = kSize;
+			}
+			std::uint64_t sent = 0, received = 0, calls = 0;
+
+			auto const start = Clock::now();
+			while(Clock::now() - start < kDuration)
+			{
+				std::size_t transferred;
+				for(std::size_t i = 0; i < kBurst; i++)
+					if(Status::kSuccess == sender.sendto(packets.data(), kSize, group, transferred))
+						++sent;
+					else
+						break;
+
+				if(batched)
+				{
+					while(Status::kSuccess == receiver.recv_batch(datagrams, kBurst, transferred))
+					{
+						received += transferred;
+						++calls;
+					}
+				} else
+				{
+					SocketAddress from;
+					while(Status::kSuccess == receiver.recvfrom(packets.data(), kSize, from, transferred))
+					{
+						++received;
+						++calls;
+					}
+				}
+			}
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			Result("udp_multicast")
+				.add("mode", batched ? "recv_batch" : "recvfrom")
+				.add("packet_size", std::uint64_t(kSize))
+				.add("seconds", seconds)
+				.add("sent", sent)
+				.add("received", received)
+				.add("packets_per_receive", calls ? double(received) / double(calls) : 0.0)
+				.add("packets_per_s", double(received) / seconds)
+				.print();
+		}
+	}
+
+	void udp_timestamps()
+	{
+		constexpr std::size_t kBurst = 16;
+		constexpr std::size_t kSize = 256;
+
+		DatagramSocket sender(AddressFamily::kIPv4), receiver(AddressFamily::kIPv4);
+		SocketAddress const address = loopback(39611);
+		require(receiver.bind(address, true), "udp_timestamps: could not bind");
+		require(sender.enable_timestamps(true) && receiver.enable_timestamps(), "udp_timestamps: timestamps not supported");
+
+		std::vector<std::uint8_t> packets(kBurst * kSize, 'x');
+		ReceivedDatagram datagrams[kBurst];
+		for(std::size_t i = 0; i < kBurst; i++)
+		{
+			datagrams[i].data = &packets[i * kSize];
+			datagrams[i].capacity = kSize;
+		}
+		TxTimestamp transmitted[kBurst];
+
+		// The time of each send, indexed by its transmit timestamp ID.
+		std::vector<std::uint64_t> send_times;
+		// From sending until the kernel transmitted the datagram.
+		util::Histogram transmit;
+		// From the kernel receiving the datagram until the application handles it.
+		util::Histogram receive;
+
+		auto const start = Clock::now();
+		while(Clock::now() - start < kDuration)
+		{
+			std::size_t transferred;
+			for(std::size_t i = 0; i < kBurst; i++)
+			{
+				std::uint64_t const now = Socket::timestamp_now();
+				if(Status::kSuccess != sender.sendto(packets.data(), kSize, address, transferred))
+					break;
+				send_times.push_back(now);
+			}
+
+			while(Status::kSuccess == receiver.recv_batch(datagrams, kBurst, transferred))
+			{
+				std::uint64_t const now = Socket::timestamp_now();
+				for(std::size_t i = 0; i < transferred; i++)
+					if(datagrams[i].timestamp && datagrams[i].timestamp <= now)
+						receive.record(now - datagrams[i].timestamp);
+			}
+
+			while(Status::kSuccess == sender.recv_tx_timestamps(transmitted, kBurst, transferred))
+				for(std::size_t i = 0; i < transferred; i++)
+				{
+					TxTimestamp const& timestamp = transmitted[i];
+					if(timestamp.id < send_times.size() && send_times[timestamp.id] <= timestamp.time)
+						transmit.record(timestamp.time - send_times[timestamp.id]);
+				}
+		}
+
+		Result("udp_timestamps")
+			.add("packet_size", std::uint64_t(kSize))
+			.add("sent", std::uint64_t(send_times.size()))
+			.add("transmit_", transmit)
+			.add("receive_", receive)
+			.print();
+	}
+}
@@ -0,0 +1,211 @@
+#include "bench.hpp"
+
+#ifdef NETLIB_TLS
+
+#include "../src/Poller.hpp"
+#include "../src/x/TlsConnection.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <vector>
+#include <thread>
+#include <string>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each configuration runs. */
+		constexpr std::chrono::seconds kDuration(2);
+		/** The size of sent and received chunks, in bytes. */
+		constexpr std::size_t kChunkSize = 1 << 14;
+
+		/** Reads all data of a memory BIO. */
+		std::string bio_text(
+			::BIO * bio)
+		{
+			char * data;
+			long const size = BIO_get_mem_data(bio, &data);
+			return std::string(data, std::size_t(size));
+		}
+
+		/** Creates a self-signed certificate for "localhost", in PEM format. */
+		void self_signed(
+			std::string &certificate_pem,
+			std::string &key_pem)
+		{
+			::EVP_PKEY * key = ::EVP_EC_gen("P-256");
+			::X509 * certificate = ::X509_new();
+			require(key && certificate, "tls: could not create certificate");
+
+			::X509_set_version(certificate, 2);
+			::ASN1_INTEGER_set(::X509_get_serialNumber(certificate), 1);
+			::X509_gmtime_adj(::X509_getm_notBefore(certificate), 0);
+			::X509_gmtime_adj(::X509_getm_notAfter(certificate), 3600);
+			::X509_set_pubkey(certificate, key);
+			::X509_NAME * name = ::X509_get_subject_name(certificate);
+			::X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<unsigned char const *>("localhost"), -1, -1, 0);
+			::X509_set_issuer_name(certificate, name);
+			require(::X509_sign(certificate, key, ::EVP_sha256()), "tls: could not sign certificate");
+
+			::BIO * bio = ::BIO_new(::BIO_s_mem());
+			::PEM_write_bio_X509(bio, certificate);
+			certificate_pem = bio_text(bio);
+			::BIO_free(bio);
+
+			bio = ::BIO_new(::BIO_s_mem());
+			::PEM_write_bio_PrivateKey(bio, key, nullptr, nullptr, 0, nullptr, nullptr);
+			key_pem = bio_text(bio);
+			::BIO_free(bio);
+
+			::X509_free(certificate);
+			::EVP_PKEY_free(key);
+		}
+
+		/** Sends as fast as possible for `kDuration`, then closes the stream. */
+		void tls_sender(
+			x::TlsConnection &connection)
+		{
+			Poller poller;
+			poller.watch(&connection, false, true);
+			std::vector<PollEvent> events;
+			std::vector<std::uint8_t> chunk(kChunkSize, 'x');
+
+			// A write that was not ready has to be completed before the closure alert can be sent.
+			bool pending = false;
+			auto const start = Clock::now();
+			while(pending || Clock::now() - start < kDuration)
+			{
+				std::size_t sent;
+				Status const status = connection.send(chunk.data(), chunk.size(), sent);
+				require(status != Status::kError, "tls: could not send");
+				pending = status == Status::kNotReady;
+				if(pending)
+				{
+					events.clear();
+					poller.poll(events, 10);
+				}
+			}
+
+			Status status;
+			while(Status::kNotReady == (status = connection.shutdown()))
+			{
+				events.clear();
+				poller.poll(events, 10);
+			}
+			require(status == Status::kSuccess, "tls: could not shut down");
+		}
+
+		/** Receives until the peer closes the stream, through the TLS connection or, if it was detached, the plain socket. */
+		template<class Connection>
+		std::uint64_t tls_receiver(
+			Connection &connection)
+		{
+			Poller poller;
+			poller.watch(&connection, true, false);
+			std::vector<PollEvent> events;
+			std::vector<std::uint8_t> chunk(kChunkSize);
+
+			std::uint64_t total = 0;
+			for(;;)
+			{
+				std::size_t size;
+				Status const status = connection.recv(chunk.data(), chunk.size(), size);
+				if(status == Status::kSuccess)
+				{
+					if(!size)
+						break;
+					total += size;
+				} else if(status == Status::kNotReady)
+				{
+					events.clear();
+					poller.poll(events, 10);
+				} else
+					break;
+			}
+			return total;
+		}
+
+		/** Transfers data over a TLS connection on loopback, with or without kernel TLS. */
+		void tls_throughput(
+			bool kernel_offload,
+			std::string const& certificate_pem,
+			std::string const& key_pem)
+		{
+			x::TlsContext server_context(true, kernel_offload), client_context(false, kernel_offload);
+			require(server_context.use_certificate(certificate_pem.c_str(), key_pem.c_str()), "tls: could not use certificate");
+			require(client_context.use_trusted(certificate_pem.c_str()), "tls: could not trust certificate");
+			// Allows offloading receiving on OpenSSL versions that only support it for TLS 1.2.
+			server_context.disable_tls13();
+
+			x::ConnectionListener listener;
+			require(listener.listen(loopback(39613), true), "tls: could not listen");
+			StreamSocket client_socket(AddressFamily::kIPv4);
+			Status status = client_socket.connect(loopback(39613));
+			require(status == Status::kSuccess || status == Status::kInProgress, "tls: could not connect");
+
+			StreamSocket server_socket;
+			auto const connect_start = Clock::now();
+			while(Status::kSuccess != listener.accept(server_socket))
+				require(Clock::now() - connect_start < kDuration, "tls: could not accept");
+			require(await_connect(client_socket), "tls: could not connect");
+
+			x::TlsConnection client(client_context, std::move(client_socket), "localhost");
+			x::TlsConnection server(server_context, std::move(server_socket));
+
+			auto const handshake_start = Clock::now();
+			bool client_done = false, server_done = false;
+			while(!client_done || !server_done)
+			{
+				if(!client_done)
+				{
+					status = client.handshake();
+					require(status != Status::kError, "tls: client handshake failed");
+					client_done = status == Status::kSuccess;
+				}
+				if(!server_done)
+				{
+					status = server.handshake();
+					require(status != Status::kError, "tls: server handshake failed");
+					server_done = status == Status::kSuccess;
+				}
+				require(Clock::now() - handshake_start < kDuration, "tls: handshake timed out");
+			}
+			std::uint64_t const handshake_ns = elapsed_ns(handshake_start);
+
+			// With both directions in the kernel, the receiver reads plaintext from the socket itself.
+			StreamSocket plain;
+			bool const detached = server.detach(plain);
+
+			std::uint64_t received = 0;
+			auto const start = Clock::now();
+			std::thread sender(tls_sender, std::ref(client));
+			received = detached ? tls_receiver(plain) : tls_receiver(server);
+			sender.join();
+			double const seconds = double(elapsed_ns(start)) / 1e9;
+
+			Result("tls_throughput")
+				.add("mode", kernel_offload ? "kernel" : "user")
+				.add("kernel_send", std::uint64_t(client.kernel_send()))
+				.add("kernel_receive", std::uint64_t(detached))
+				.add("handshake_us", double(handshake_ns) / 1e3)
+				.add("seconds", seconds)
+				.add("gbit_per_s", double(received) * 8 / seconds / 1e9)
+				.print();
+		}
+	}
+
+	void tls_throughput()
+	{
+		std::string certificate_pem, key_pem;
+		self_signed(certificate_pem, key_pem);
+
+		for(bool kernel_offload : { false, true })
+			tls_throughput(kernel_offload, certificate_pem, key_pem);
+	}
+}
+
+#endif
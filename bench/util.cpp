@@ -0,0 +1,376 @@
+#include "bench.hpp"
+#include "../src/SocketAddress.hpp"
+#include "../src/util/Buffer.hpp"
+#include "../src/util/Checksum.hpp"
+#include "../src/x/PrefixTable.hpp"
+#include "../src/x/WebSocket.hpp"
+
+#include <vector>
+#include <string>
+#include <random>
+#include <cstdio>
+#include <cstring>
+#include <arpa/inet.h>
+
+namespace netlib::bench
+{
+	namespace
+	{
+		/** How long each microbenchmark runs, at least. */
+		constexpr std::chrono::milliseconds kDuration(500);
+
+		/** Repeatedly runs `round`, which performs `per_round` operations, for at least `kDuration`.
+		@return
+			The nanoseconds per operation. */
+		template<class Round>
+		double measure(
+			std::size_t per_round,
+			Round &&round)
+		{
+			std::uint64_t rounds = 0;
+			auto const start = Clock::now();
+			do {
+				round();
+				++rounds;
+			} while(Clock::now() - start < kDuration);
+
+			return double(elapsed_ns(start)) / double(rounds * per_round);
+		}
+
+		/** Prints the result of a microbenchmark. */
+		void report(
+			char const * benchmark,
+			char const * variant,
+			double ns_per_op)
+		{
+			Result(benchmark)
+				.add("variant", variant)
+				.add("ns_per_op", ns_per_op)
+				.add("ops_per_s", 1e9 / ns_per_op)
+				.print();
+		}
+	}
+
+	void buffer()
+	{
+		constexpr std::size_t kCapacity = 1 << 16;
+		constexpr std::size_t kOperations = 1024;
+
+		for(std::size_t size : { 16, 256, 4096 })
+		{
+			util::Buffer buffer(kCapacity);
+			std::vector<std::uint8_t> chunk(size, 'x');
+
+			// Keep the buffer half full, so that appends and consumes wrap around its edges.
+			while(buffer.size() < kCapacity / 2)
+				buffer.append(chunk.data(), size);
+
+			double const ns = measure(kOperations, [&] {
+				for(std::size_t i = 0; i < kOperations; i++)
+				{
+					buffer.append(chunk.data(), size);
+					buffer.consume(chunk.data(), size);
+				}
+				keep(chunk[0]);
+			});
+
+			Result("buffer")
+				.add("chunk_size", std::uint64_t(size))
+				.add("ns_per_op", ns)
+				.add("bytes_per_s", double(size) * 1e9 / ns)
+				.print();
+		}
+	}
+
+	void address_parse()
+	{
+		constexpr std::size_t kAddresses = 1024;
+
+		// The parser has to agree with inet_pton(), including on malformed addresses.
+		static char const * const kEdgeCases[] = {
+			"::", "::1", "1::", "1:2:3:4:5:6:7::", "::2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8",
+			"::ffff:1.2.3.4", "1:2:3:4:5:6:1.2.3.4", "1::1.2.3.4",
+			"1:2:3:4:5:6:7:8::", "0:0:0:0:0:0:0:0::", "::1:2:3:4:5:6:7:8", "1:2:3:4:5:6:7:8:9",
+			"1::2::3", ":::", "1:2:3:4:5:6:7", ":1::", "1::2:", "12345::", "::1.2.3",
+			"1:2:3:4:5:6:7:1.2.3.4", ""
+		};
+		for(char const * address : kEdgeCases)
+		{
+			IPv6Address out;
+			in6_addr native;
+			bool const valid = inet_pton(AF_INET6, address, &native) == 1;
+			bool agrees = IPv6Address::parse(address, out) == valid;
+			if(agrees && valid)
+			{
+				std::uint16_t f[8];
+				for(std::size_t i = 0; i < 8; i++)
+					f[i] = std::uint16_t(native.s6_addr[2 * i] << 8 | native.s6_addr[2 * i + 1]);
+				agrees = out == IPv6Address(f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7]);
+			}
+			if(!agrees)
+				std::fprintf(stderr, "address_parse: \"%s\"\n", address);
+			require(agrees, "address_parse: disagrees with inet_pton");
+		}
+
+		std::mt19937_64 random(1);
+		std::vector<std::string> ipv4, ipv6;
+		char text[INET6_ADDRSTRLEN];
+		for(std::size_t i = 0; i < kAddresses; i++)
+		{
+			std::uint32_t v4 = std::uint32_t(random());
+			ipv4.push_back(inet_ntop(AF_INET, &v4, text, sizeof(text)));
+
+			// Typical addresses have zero runs, so that compression is exercised.
+			std::uint8_t v6[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+			std::uint64_t bits = random();
+			std::memcpy(v6 + 8, &bits, 8);
+			if(i & 1)
+				v6[8] = v6[9] = v6[10] = v6[11] = 0;
+			ipv6.push_back(inet_ntop(AF_INET6, v6, text, sizeof(text)));
+		}
+
+		report("address_parse", "ipv4_netlib", measure(kAddresses, [&] {
+			for(std::string const& address : ipv4)
+			{
+				IPv4Address out;
+				keep(IPv4Address::parse(address.data(), address.data() + address.size(), out));
+				keep(out);
+			}
+		}));
+		report("address_parse", "ipv4_inet_pton", measure(kAddresses, [&] {
+			for(std::string const& address : ipv4)
+			{
+				in_addr out;
+				keep(inet_pton(AF_INET, address.c_str(), &out));
+				keep(out);
+			}
+		}));
+		report("address_parse", "ipv4_sscanf", measure(kAddresses, [&] {
+			for(std::string const& address : ipv4)
+			{
+				unsigned char d[4];
+				keep(std::sscanf(address.c_str(), "%hhu.%hhu.%hhu.%hhu", &d[0], &d[1], &d[2], &d[3]));
+				keep(d);
+			}
+		}));
+		report("address_parse", "ipv6_netlib", measure(kAddresses, [&] {
+			for(std::string const& address : ipv6)
+			{
+				IPv6Address out;
+				keep(IPv6Address::parse(address.data(), address.data() + address.size(), out));
+				keep(out);
+			}
+		}));
+		report("address_parse", "ipv6_inet_pton", measure(kAddresses, [&] {
+			for(std::string const& address : ipv6)
+			{
+				in6_addr out;
+				keep(inet_pton(AF_INET6, address.c_str(), &out));
+				keep(out);
+			}
+		}));
+
+		std::vector<IPv6Address> parsed(kAddresses);
+		std::vector<in6_addr> native(kAddresses);
+		for(std::size_t i = 0; i < kAddresses; i++)
+		{
+			IPv6Address::parse(ipv6[i].data(), ipv6[i].data() + ipv6[i].size(), parsed[i]);
+			inet_pton(AF_INET6, ipv6[i].c_str(), &native[i]);
+		}
+
+		report("address_format", "ipv6_netlib", measure(kAddresses, [&] {
+			for(IPv6Address const& address : parsed)
+				keep(address.to_chars(text, text + sizeof(text)));
+		}));
+		report("address_format", "ipv6_inet_ntop", measure(kAddresses, [&] {
+			for(in6_addr const& address : native)
+				keep(inet_ntop(AF_INET6, &address, text, sizeof(text)));
+		}));
+	}
+
+	void prefix_table()
+	{
+		constexpr std::size_t kPrefixes = 1000000;
+		constexpr std::size_t kLookups = 1 << 20;
+
+		std::mt19937_64 random(1);
+		x::PrefixTable::Builder builder;
+		while(builder.size() < kPrefixes)
+		{
+			// Roughly the length distribution of a full routing table: mostly /24s.
+			std::uint64_t bits = random();
+			unsigned length = (bits & 3) ? 24 : unsigned(8 + (bits >> 8) % 25);
+			std::uint32_t address = std::uint32_t(bits >> 32);
+			builder.add(
+				IPv4Address(address >> 24, address >> 16, address >> 8, address),
+				length,
+				std::uint32_t(builder.size()));
+		}
+
+		auto const start = Clock::now();
+		x::PrefixTable table = builder.build();
+		double const build_seconds = double(elapsed_ns(start)) / 1e9;
+
+		std::vector<IPv4Address> addresses;
+		addresses.reserve(kLookups);
+		for(std::size_t i = 0; i < kLookups; i++)
+		{
+			std::uint32_t address = std::uint32_t(random());
+			addresses.emplace_back(address >> 24, address >> 16, address >> 8, address);
+		}
+
+		std::uint64_t matches = 0;
+		double const ns = measure(kLookups, [&] {
+			for(IPv4Address const& address : addresses)
+				matches += table.lookup(address) != x::PrefixTable::kNone;
+		});
+		keep(matches);
+
+		Result("prefix_table")
+			.add("prefixes", std::uint64_t(builder.size()))
+			.add("build_seconds", build_seconds)
+			.add("memory_bytes", std::uint64_t(table.memory()))
+			.add("ns_per_lookup", ns)
+			.add("lookups_per_s", 1e9 / ns)
+			.print();
+	}
+
+	void checksum()
+	{
+		constexpr std::size_t kBytes = 1 << 20;
+
+		std::vector<std::uint8_t> data(kBytes);
+		std::mt19937 random(1);
+		for(std::uint8_t &byte : data)
+			byte = std::uint8_t(random());
+
+		// Typical datagram sizes: a small message, an Ethernet MTU, and a maximal UDP payload.
+		for(std::size_t size : { 64, 1500, 65536 })
+		{
+			std::size_t const count = kBytes / size;
+			auto const run = [&](char const * kernel, auto &&compute) {
+				std::uint64_t sink = 0;
+				double const ns = measure(count, [&] {
+					for(std::size_t i = 0; i < count; i++)
+						sink += compute(data.data() + i * size, size);
+				});
+				keep(sink);
+
+				Result("checksum")
+					.add("kernel", kernel)
+					.add("size", std::uint64_t(size))
+					.add("ns_per_op", ns)
+					.add("bytes_per_s", double(size) * 1e9 / ns)
+					.print();
+			};
+
+			run("crc32c", [](void const * p, std::size_t n) { return util::crc32c(p, n); });
+			run("crc32c_portable", [](void const * p, std::size_t n) { return util::detail::crc32c_portable(p, n, 0); });
+			run("internet", [](void const * p, std::size_t n) { return util::internet_checksum(p, n); });
+			run("internet_portable", [](void const * p, std::size_t n) { return util::detail::ones_sum_portable(p, n, 0); });
+			run("xxh64", [](void const * p, std::size_t n) { return util::xxh64(p, n); });
+		}
+	}
+
+	void websocket_mask()
+	{
+		std::uint8_t const key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+		for(std::size_t size : { 125, 4096, 65536 })
+		{
+			std::vector<std::uint8_t> payload(size, 'x');
+			auto const run = [&](char const * kernel, void (*mask)(void *, std::size_t, std::uint8_t const (&)[4], std::uint64_t)) {
+				constexpr std::size_t kRepetitions = 64;
+				double const ns = measure(kRepetitions, [&] {
+					for(std::size_t i = 0; i < kRepetitions; i++)
+						mask(payload.data(), size, key, i);
+				});
+				keep(payload[0]);
+
+				Result("websocket_mask")
+					.add("kernel", kernel)
+					.add("size", std::uint64_t(size))
+					.add("ns_per_op", ns)
+					.add("bytes_per_s", double(size) * 1e9 / ns)
+					.print();
+			};
+
+			run("dispatched", &x::websocket::mask);
+			run("portable", &x::websocket::detail::mask_portable);
+		}
+	}
+
+	void websocket_read()
+	{
+		using x::websocket::Opcode;
+		using x::websocket::ParseStatus;
+
+		StreamSocket first, second;
+		require(StreamSocket::pair(first, second), "websocket_read: could not create socket pair");
+		x::BufferedConnection client(std::move(first), 1 << 16), server(std::move(second), 1 << 16);
+		std::uint8_t const key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+
+		// Passes masked frames from the client to the server's input buffer.
+		auto const transfer = [&] {
+			while(!client.output().empty())
+				require(client.flush_some(), "websocket_read: could not send");
+			while(server.receive_some() && !server.input().full())
+				;
+		};
+
+		// Close frames must carry a status code that a peer may send (RFC 6455, section 7.4).
+		static std::uint16_t const kValidCodes[] = { 1000, 1001, 1003, 1007, 1011, 1012, 1014, 3000, 4999 };
+		static std::uint16_t const kInvalidCodes[] = { 0, 999, 1004, 1005, 1006, 1015, 1016, 2999, 5000, 65535 };
+		auto const close_status = [&](std::uint16_t code) {
+			std::uint8_t const payload[2] = { std::uint8_t(code >> 8), std::uint8_t(code) };
+			require(x::websocket::send_masked(client, Opcode::kClose, payload, sizeof(payload), key), "websocket_read: could not send");
+			transfer();
+
+			x::websocket::Reader reader(true);
+			x::websocket::Piece piece;
+			std::size_t consumed;
+			ParseStatus const status = reader.read(server, piece, consumed);
+			server.discard();
+			return status;
+		};
+		for(std::uint16_t code : kValidCodes)
+			require(close_status(code) == ParseStatus::kComplete, "websocket_read: valid close code rejected");
+		for(std::uint16_t code : kInvalidCodes)
+			require(close_status(code) == ParseStatus::kInvalid, "websocket_read: invalid close code accepted");
+
+		// Text messages are validated as UTF-8, binary messages are not.
+		constexpr std::size_t kMessages = 32;
+		std::string message;
+		while(message.size() < 1024)
+			message += "netlib \xc3\xa9\xe2\x82\xac ";
+		for(Opcode opcode : { Opcode::kBinary, Opcode::kText })
+		{
+			x::websocket::Reader reader(true);
+			double const ns = measure(kMessages, [&] {
+				for(std::size_t i = 0; i < kMessages; i++)
+					x::websocket::send_masked(client, opcode, message.data(), message.size(), key);
+				transfer();
+
+				std::size_t read = 0;
+				x::websocket::Piece piece;
+				std::size_t consumed;
+				ParseStatus status;
+				while(ParseStatus::kComplete == (status = reader.read(server, piece, consumed)))
+				{
+					read += piece.last;
+					server.skip(consumed);
+				}
+				require(status == ParseStatus::kIncomplete && read == kMessages, "websocket_read: could not read messages");
+			});
+
+			Result("websocket_read")
+				.add("opcode", opcode == Opcode::kText ? "text" : "binary")
+				.add("size", std::uint64_t(message.size()))
+				.add("ns_per_message", ns)
+				.add("bytes_per_s", double(message.size()) * 1e9 / ns)
+				.print();
+		}
+
+		client.discard();
+		server.discard();
+	}
+}
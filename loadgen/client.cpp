@@ -0,0 +1,444 @@
+#include "loadgen.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/BufferedConnection.hpp"
+#include "../src/util/Histogram.hpp"
+
+#include <memory>
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <cstring>
+#include <cstdio>
+
+namespace netlib::loadgen
+{
+	std::vector<std::uint8_t> make_request(
+		Options const& options)
+	{
+		std::vector<std::uint8_t> request(options.size, 'x');
+		switch(options.protocol)
+		{
+		case Protocol::kFixed:
+			break;
+		case Protocol::kLengthPrefixed:
+			{
+				std::uint32_t payload = std::uint32_t(options.size - 4);
+				request[0] = std::uint8_t(payload >> 24);
+				request[1] = std::uint8_t(payload >> 16);
+				request[2] = std::uint8_t(payload >> 8);
+				request[3] = std::uint8_t(payload);
+			} break;
+		case Protocol::kLine:
+			request.back() = '\n';
+			break;
+		}
+		return request;
+	}
+
+	ResponseParser::ResponseParser(
+		Protocol protocol,
+		std::size_t size):
+		m_protocol(protocol),
+		m_size(size),
+		m_received(0),
+		m_expected(0)
+	{
+	}
+
+	std::size_t ResponseParser::parse(
+		std::uint8_t const * data,
+		std::size_t size)
+	{
+		std::size_t responses = 0;
+		switch(m_protocol)
+		{
+		case Protocol::kFixed:
+			m_received += size;
+			responses = m_received / m_size;
+			m_received %= m_size;
+			break;
+		case Protocol::kLengthPrefixed:
+			while(size)
+			{
+				if(m_received < 4)
+				{
+					m_expected = (m_expected << 8) | *data++;
+					--size;
+					if(++m_received == 4)
+						m_expected += 4;
+				} else
+				{
+					std::size_t part = std::min(size, m_expected - m_received);
+					m_received += part;
+					data += part;
+					size -= part;
+				}
+
+				if(m_received >= 4 && m_received == m_expected)
+				{
+					++responses;
+					m_received = m_expected = 0;
+				}
+			}
+			break;
+		case Protocol::kLine:
+			for(std::uint8_t const * end = data + size;
+				(data = static_cast<std::uint8_t const *>(std::memchr(data, '\n', end - data)));
+				++data)
+				++responses;
+			break;
+		}
+		return responses;
+	}
+
+	namespace
+	{
+		/** The input and output buffer size of each connection. */
+		constexpr std::size_t kBufferSize = 1 << 16;
+		/** How long to wait for outstanding responses after the last request. */
+		constexpr std::chrono::seconds kDrainTime(1);
+		/** How many due requests are scheduled between polls, so that an unreachable rate cannot starve the responses. */
+		constexpr std::size_t kMaxScheduledPerPoll = 1024;
+
+		/** A connection and its requests. */
+		struct Client
+		{
+			/** The connection. */
+			std::unique_ptr<x::BufferedConnection> connection;
+			/** The scheduled send times of all unanswered requests, oldest first. */
+			std::deque<Clock::time_point> outstanding;
+			/** How many requests were scheduled, but not buffered completely yet. */
+			std::size_t unwritten;
+			/** How many bytes of the first unwritten request were buffered. */
+			std::size_t partial;
+			/** Finds the responses. */
+			ResponseParser parser;
+			/** Whether the connection has output pending. */
+			bool pending;
+			/** Whether the connection failed. */
+			bool failed;
+		};
+
+		/** The nanoseconds from `from` to `to`. */
+		std::uint64_t nanoseconds(
+			Clock::time_point from,
+			Clock::time_point to)
+		{
+			return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+		}
+
+		/** Prints a latency summary in microseconds. */
+		void print_latency(
+			util::Histogram const& latency)
+		{
+			std::printf(" p50 %8.1f  p90 %8.1f  p99 %8.1f  p99.9 %8.1f  max %8.1f us\n",
+				double(latency.percentile(50)) / 1e3,
+				double(latency.percentile(90)) / 1e3,
+				double(latency.percentile(99)) / 1e3,
+				double(latency.percentile(99.9)) / 1e3,
+				double(latency.max()) / 1e3);
+		}
+
+		/** Runs the load generator. */
+		class Generator
+		{
+			Options const& m_options;
+			/** The request sent on every connection. */
+			std::vector<std::uint8_t> m_request;
+			std::vector<Client> m_clients;
+			/** The client index of each connection. */
+			std::unordered_map<x::BufferedConnection const *, std::size_t> m_indices;
+			/** The clients with output pending, which are flushed on every poll. */
+			std::vector<std::size_t> m_pending;
+			/** The pending clients being flushed. */
+			std::vector<std::size_t> m_flushing;
+			Poller m_poller;
+			std::vector<PollEvent> m_events;
+			/** The latencies since the last interval report. */
+			util::Histogram m_interval;
+			/** All latencies. */
+			util::Histogram m_total;
+			std::uint64_t m_requests;
+			std::uint64_t m_responses;
+			std::uint64_t m_failures;
+
+			/** Buffers and flushes a client's unwritten requests. */
+			void write(
+				Client &client)
+			{
+				x::BufferedConnection &connection = *client.connection;
+				while(client.unwritten)
+				{
+					client.partial += connection.write(
+						m_request.data() + client.partial,
+						m_request.size() - client.partial);
+					if(client.partial < m_request.size())
+						break;
+					client.partial = 0;
+					--client.unwritten;
+				}
+
+				if(!connection.output().empty() && !connection.flush_some())
+					return fail(client);
+
+				if(!client.pending && (client.unwritten || !connection.output().empty()))
+				{
+					client.pending = true;
+					m_pending.push_back(std::size_t(&client - m_clients.data()));
+				}
+			}
+
+			/** Schedules a request on a client. */
+			void request(
+				Client &client,
+				Clock::time_point scheduled)
+			{
+				++m_requests;
+				client.outstanding.push_back(scheduled);
+				++client.unwritten;
+				if(!client.failed)
+					write(client);
+			}
+
+			/** Receives a client's responses. */
+			void read(
+				Client &client,
+				bool sending)
+			{
+				x::BufferedConnection &connection = *client.connection;
+				std::size_t const before = connection.input().size();
+				if(!connection.receive_some())
+					return fail(client);
+				// Readable, but nothing received: the server closed the connection.
+				if(!connection.input().full() && connection.input().size() == before)
+					return fail(client);
+
+				std::uint8_t chunk[4096];
+				std::size_t size;
+				auto const now = Clock::now();
+				while((size = connection.read(chunk, sizeof(chunk))))
+					for(std::size_t n = client.parser.parse(chunk, size); n--;)
+					{
+						if(client.outstanding.empty())
+							return fail(client);
+
+						std::uint64_t const latency = nanoseconds(client.outstanding.front(), now);
+						client.outstanding.pop_front();
+						m_interval.record(latency);
+						m_total.record(latency);
+						++m_responses;
+
+						// In closed-loop mode, every response triggers the next request.
+						if(sending && m_options.rate == 0)
+							request(client, now);
+					}
+			}
+
+			/** Closes a failed client's connection, which also stops polling it. */
+			void fail(
+				Client &client)
+			{
+				if(client.failed)
+					return;
+				client.failed = true;
+				++m_failures;
+				client.connection->discard();
+				client.connection->close();
+			}
+
+			/** Polls the connections and handles their responses.
+			@param[in] timeout:
+				The poll timeout, in milliseconds. */
+			void poll(
+				std::size_t timeout,
+				bool sending)
+			{
+				m_events.clear();
+				m_poller.poll(m_events, timeout);
+				for(PollEvent const& event : m_events)
+				{
+					Client &client = m_clients[m_indices[x::BufferedConnection::cast_from_base(event.entry->socket)]];
+					if(event.error)
+						fail(client);
+					else if(!client.failed)
+						read(client, sending);
+				}
+
+				// Keep flushing requests that did not fit into the socket's send buffer at once.
+				m_flushing.clear();
+				m_flushing.swap(m_pending);
+				for(std::size_t index : m_flushing)
+				{
+					Client &client = m_clients[index];
+					client.pending = false;
+					if(!client.failed)
+						write(client);
+				}
+			}
+
+			/** Prints and resets the interval statistics. */
+			void report(
+				double second,
+				std::uint64_t requests,
+				std::uint64_t responses)
+			{
+				std::printf("%6.0fs  requests %9llu  responses %9llu ",
+					second,
+					(unsigned long long) requests,
+					(unsigned long long) responses);
+				print_latency(m_interval);
+				std::fflush(stdout);
+				m_interval.clear();
+			}
+
+		public:
+			Generator(
+				Options const& options):
+				m_options(options),
+				m_request(make_request(options)),
+				m_requests(0),
+				m_responses(0),
+				m_failures(0)
+			{
+			}
+
+			/** Opens all connections. */
+			bool connect()
+			{
+				std::vector<StreamSocket> sockets;
+				sockets.reserve(m_options.connections);
+				for(std::size_t i = 0; i < m_options.connections; i++)
+				{
+					sockets.emplace_back(m_options.address.family);
+					Status status = sockets.back().connect(m_options.address);
+					if(status != Status::kSuccess && status != Status::kInProgress)
+						return false;
+				}
+
+				m_clients.reserve(m_options.connections);
+				m_poller.reserve(m_options.connections);
+				for(StreamSocket &socket : sockets)
+				{
+					Status status;
+					while(Status::kInProgress == (status = socket.finish_connect()))
+						std::this_thread::yield();
+					if(status != Status::kSuccess)
+						return false;
+
+					m_clients.push_back(Client{
+						std::unique_ptr<x::BufferedConnection>(
+							new x::BufferedConnection(std::move(socket), kBufferSize)),
+						{},
+						0,
+						0,
+						ResponseParser(m_options.protocol, m_options.size),
+						false,
+						false
+					});
+					m_indices.emplace(m_clients.back().connection.get(), m_clients.size() - 1);
+					m_poller.watch(m_clients.back().connection.get(), true, false);
+				}
+				return true;
+			}
+
+			/** Sends requests for the configured duration, and prints the results. */
+			void run()
+			{
+				auto const start = Clock::now();
+				auto const end = start + m_options.duration;
+				auto next_report = start + std::chrono::seconds(1);
+				std::uint64_t reported_requests = 0, reported_responses = 0;
+
+				// Open-loop requests are spread evenly over time, and round-robin over the connections.
+				std::chrono::nanoseconds const interval(m_options.rate > 0
+					? std::max<std::int64_t>(1, std::int64_t(1e9 / m_options.rate))
+					: 0);
+				std::uint64_t scheduled = 0;
+
+				if(m_options.rate == 0)
+					for(Client &client : m_clients)
+						request(client, start);
+
+				for(auto now = start; now < end; now = Clock::now())
+				{
+					std::size_t timeout = 1;
+					if(m_options.rate > 0)
+					{
+						// Schedule all requests that are due, even if the connection is still busy.
+						Clock::time_point due;
+						for(std::size_t batch = 0;
+							batch < kMaxScheduledPerPoll && (due = start + interval * scheduled) <= now;
+							batch++)
+							request(m_clients[scheduled++ % m_clients.size()], due);
+						if(due - now < std::chrono::milliseconds(1))
+							timeout = 0;
+					}
+
+					poll(timeout, true);
+
+					if(now >= next_report)
+					{
+						report(
+							double(std::chrono::duration_cast<std::chrono::seconds>(now - start).count()),
+							m_requests - reported_requests,
+							m_responses - reported_responses);
+						reported_requests = m_requests;
+						reported_responses = m_responses;
+						next_report += std::chrono::seconds(1);
+					}
+				}
+
+				double const seconds = double(nanoseconds(start, Clock::now())) / 1e9;
+
+				// Give outstanding requests a chance to complete.
+				for(auto const drain = Clock::now() + kDrainTime;
+					m_responses < m_requests && Clock::now() < drain;)
+					poll(1, false);
+
+				for(Client &client : m_clients)
+					client.connection->discard();
+
+				std::printf("\nrequests %llu  responses %llu  unanswered %llu  failed connections %llu\n",
+					(unsigned long long) m_requests,
+					(unsigned long long) m_responses,
+					(unsigned long long) (m_requests - m_responses),
+					(unsigned long long) m_failures);
+				std::printf("throughput %.0f responses/s  %.3f MB/s\n",
+					double(m_responses) / seconds,
+					double(m_responses * m_request.size()) / seconds / 1e6);
+				std::printf("latency");
+				print_latency(m_total);
+
+				std::printf("\npercentile distribution (us):\n");
+				for(double percentile : { 0.0, 50.0, 75.0, 90.0, 99.0, 99.9, 99.99, 99.999, 100.0 })
+					std::printf("%10.3f%%  %12.1f\n",
+						percentile,
+						double(m_total.percentile(percentile)) / 1e3);
+			}
+		};
+	}
+
+	bool generate(
+		Options const& options)
+	{
+		char address[SocketAddress::kMaxChars + 1];
+		*options.address.to_chars(address, address + SocketAddress::kMaxChars) = '\0';
+		std::printf("netlib_loadgen: %s, %zu connections, ", address, options.connections);
+		if(options.rate > 0)
+			std::printf("open loop at %.0f requests/s", options.rate);
+		else
+			std::printf("closed loop");
+		static char const * const protocols[] = { "fixed", "length-prefixed", "line" };
+		std::printf(", %zu-byte %s requests, %llds\n\n",
+			options.size,
+			protocols[static_cast<int>(options.protocol)],
+			(long long) options.duration.count());
+
+		Generator generator(options);
+		if(!generator.connect())
+			return false;
+		generator.run();
+		return true;
+	}
+}
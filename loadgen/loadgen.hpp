@@ -0,0 +1,103 @@
+/** @file loadgen.hpp
+	Contains the declarations shared by the parts of the netlib load generator. */
+#ifndef __netlib_loadgen_loadgen_hpp_defined
+#define __netlib_loadgen_loadgen_hpp_defined
+
+#include "../src/SocketAddress.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+/** The netlib load generator.
+	Opens connections through the `Poller` and `x::BufferedConnection`, sends requests in a closed loop (a new request as soon as the previous response arrived) or an open loop (requests at a fixed rate, whether or not earlier requests were answered), and reports latency histograms and throughput.
+
+	In open-loop mode, latency is measured from the time a request was scheduled to be sent, not from when it was actually sent. This way, requests delayed by a stalled connection or a busy load generator are not left out of the histogram (coordinated omission). */
+namespace netlib::loadgen
+{
+	/** The clock used for all measurements. */
+	typedef std::chrono::steady_clock Clock;
+
+	/** How requests and responses are framed. */
+	enum class Protocol
+	{
+		/** Requests and responses have a fixed size. */
+		kFixed,
+		/** Requests and responses start with their payload size as a 4-byte big-endian integer. */
+		kLengthPrefixed,
+		/** Requests and responses end with a newline. */
+		kLine
+	};
+
+	/** The load generator's configuration. */
+	struct Options
+	{
+		/** The address to connect to, or to listen on. */
+		SocketAddress address;
+		/** The number of connections. */
+		std::size_t connections;
+		/** The total request rate, in requests per second. 0 for closed-loop mode. */
+		double rate;
+		/** How long to send requests. */
+		std::chrono::seconds duration;
+		/** The request size, in bytes, including framing. */
+		std::size_t size;
+		/** The request and response framing. */
+		Protocol protocol;
+		/** Whether to only run the echo server. */
+		bool serve;
+		/** Whether to run an echo server in the same process. */
+		bool local;
+	};
+
+	/** Builds a request of the configured size and protocol. */
+	std::vector<std::uint8_t> make_request(
+		Options const& options);
+
+	/** Finds complete responses in a received byte stream. */
+	class ResponseParser
+	{
+		/** The framing. */
+		Protocol m_protocol;
+		/** The size of fixed-size responses. */
+		std::size_t m_size;
+		/** The bytes of the current response received so far, or of its length prefix. */
+		std::size_t m_received;
+		/** The size of the current length-prefixed response, once its prefix was received. */
+		std::size_t m_expected;
+	public:
+		ResponseParser(
+			Protocol protocol,
+			std::size_t size);
+
+		/** Consumes received bytes.
+		@return
+			The number of responses completed by the bytes. */
+		std::size_t parse(
+			std::uint8_t const * data,
+			std::size_t size);
+	};
+
+	/** Runs an echo server built from `x::ConnectionListener` and `x::BufferedConnection`, until `stop` is set.
+	@param[in] address:
+		The address to listen on.
+	@param[in] ready:
+		Set once the server listens.
+	@param[in] stop:
+		Stops the server.
+	@return
+		Whether the server could listen. */
+	bool serve(
+		SocketAddress const& address,
+		std::atomic<bool> &ready,
+		std::atomic<bool> const& stop);
+
+	/** Generates load as configured, and prints the results to stdout.
+	@return
+		Whether all connections could be established. */
+	bool generate(
+		Options const& options);
+}
+
+#endif
@@ -0,0 +1,155 @@
+#include "loadgen.hpp"
+#include "../src/Runtime.hpp"
+
+#include <thread>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+namespace
+{
+	using namespace netlib::loadgen;
+
+	std::atomic<bool> interrupted(false);
+
+	void print_usage(
+		char const * program)
+	{
+		std::printf(
+			"usage: %s [options]\n"
+			"\t--address=ADDRESS     address to connect to, or to listen on (default 127.0.0.1:39700)\n"
+			"\t--connections=N       number of connections (default 16)\n"
+			"\t--rate=R              total requests per second up to 1e9, 0 for closed loop (default 0)\n"
+			"\t--duration=S          seconds to send requests (default 10)\n"
+			"\t--size=BYTES          request size including framing (default 64)\n"
+			"\t--protocol=P          fixed, length or line (default fixed)\n"
+			"\t--serve               only run the echo server\n"
+			"\t--local               also run the echo server in this process\n",
+			program);
+	}
+
+	/** Matches `--name=value` arguments.
+	@return
+		The value, or null if the argument does not match. */
+	char const * option(
+		char const * argument,
+		char const * name)
+	{
+		std::size_t length = std::strlen(name);
+		if(std::strncmp(argument, name, length) || argument[length] != '=')
+			return nullptr;
+		return argument + length + 1;
+	}
+
+	bool parse(
+		int argc,
+		char ** argv,
+		Options &out)
+	{
+		out.connections = 16;
+		out.rate = 0;
+		out.duration = std::chrono::seconds(10);
+		out.size = 64;
+		out.protocol = Protocol::kFixed;
+		out.serve = false;
+		out.local = false;
+		char const * address = "127.0.0.1:39700";
+
+		for(int i = 1; i < argc; i++)
+		{
+			char const * value;
+			if(!std::strcmp(argv[i], "--serve"))
+				out.serve = true;
+			else if(!std::strcmp(argv[i], "--local"))
+				out.local = true;
+			else if((value = option(argv[i], "--address")))
+				address = value;
+			else if((value = option(argv[i], "--connections")))
+				out.connections = std::strtoul(value, nullptr, 10);
+			else if((value = option(argv[i], "--rate")))
+				out.rate = std::strtod(value, nullptr);
+			else if((value = option(argv[i], "--duration")))
+				out.duration = std::chrono::seconds(std::strtoul(value, nullptr, 10));
+			else if((value = option(argv[i], "--size")))
+				out.size = std::strtoul(value, nullptr, 10);
+			else if((value = option(argv[i], "--protocol")))
+			{
+				if(!std::strcmp(value, "fixed"))
+					out.protocol = Protocol::kFixed;
+				else if(!std::strcmp(value, "length"))
+					out.protocol = Protocol::kLengthPrefixed;
+				else if(!std::strcmp(value, "line"))
+					out.protocol = Protocol::kLine;
+				else
+					return false;
+			} else
+				return false;
+		}
+
+		if(!netlib::SocketAddress::parse(address, out.address))
+			return false;
+
+		std::size_t const minimum = out.protocol == Protocol::kLengthPrefixed ? 5 : 1;
+		// Faster rates would need request intervals below one nanosecond.
+		return out.connections && out.size >= minimum && out.rate >= 0 && out.rate <= 1e9;
+	}
+}
+
+/** Runs the load generator, the echo server, or both. */
+int main(
+	int argc,
+	char ** argv)
+{
+	Options options;
+	if(!parse(argc, argv, options))
+	{
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	netlib::Runtime runtime;
+
+	if(options.serve)
+	{
+		std::signal(SIGINT, [](int) { interrupted = true; });
+		std::atomic<bool> ready(false);
+		if(!serve(options.address, ready, interrupted))
+		{
+			std::fprintf(stderr, "netlib_loadgen: could not listen\n");
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
+
+	std::atomic<bool> ready(false), stop(false), listening(true);
+	std::thread server;
+	if(options.local)
+	{
+		server = std::thread([&] {
+			listening = serve(options.address, ready, stop);
+			ready = true;
+		});
+		while(!ready)
+			std::this_thread::yield();
+		if(!listening)
+		{
+			server.join();
+			std::fprintf(stderr, "netlib_loadgen: could not listen\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	bool connected = generate(options);
+
+	stop = true;
+	if(server.joinable())
+		server.join();
+
+	if(!connected)
+	{
+		std::fprintf(stderr, "netlib_loadgen: could not connect\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+#include "loadgen.hpp"
+#include "../src/Poller.hpp"
+#include "../src/x/BufferedConnection.hpp"
+#include "../src/x/ConnectionListener.hpp"
+
+#include <memory>
+#include <algorithm>
+
+namespace netlib::loadgen
+{
+	namespace
+	{
+		/** The input and output buffer size of each connection. */
+		constexpr std::size_t kBufferSize = 1 << 16;
+
+		/** How long to wait for events before checking whether to stop, in milliseconds. */
+		constexpr std::size_t kPollTimeout = 10;
+
+		/** Receives a connection's pending input if it is readable, and echoes its buffered input.
+		@return
+			`Status::kNotReady` while the echo waits for the socket's send buffer, or `Status::kError` if the connection was closed. */
+		Status echo(
+			x::BufferedConnection &connection,
+			bool readable)
+		{
+			if(readable)
+			{
+				std::size_t const before = connection.input().size();
+				if(!connection.receive_some())
+					return Status::kError;
+				// Readable, but nothing received: the peer closed the connection.
+				if(!connection.input().full() && connection.input().size() == before)
+					return Status::kError;
+			}
+
+			return connection.forward(connection);
+		}
+	}
+
+	bool serve(
+		SocketAddress const& address,
+		std::atomic<bool> &ready,
+		std::atomic<bool> const& stop)
+	{
+		x::ConnectionListener listener;
+		if(!listener.listen(address, true))
+			return false;
+		ready = true;
+
+		Poller poller;
+		poller.watch(&listener, true, false);
+
+		std::vector<std::unique_ptr<x::BufferedConnection>> connections;
+		std::vector<PollEvent> events;
+		StreamSocket socket;
+
+		while(!stop)
+		{
+			events.clear();
+			poller.poll(events, kPollTimeout);
+			for(PollEvent const& event : events)
+			{
+				if(x::ConnectionListener::cast_from_base(event.entry->socket) == &listener)
+				{
+					while(Status::kSuccess == listener.accept(socket))
+					{
+						connections.emplace_back(new x::BufferedConnection(std::move(socket), kBufferSize));
+						poller.watch(connections.back().get(), true, false);
+					}
+					continue;
+				}
+
+				// Connections whose echo did not fit into the socket's send buffer are only polled for output until it was sent, as no new input event arrives for data that is already buffered.
+				x::BufferedConnection * connection = x::BufferedConnection::cast_from_base(event.entry->socket);
+				bool const waiting = event.can_write;
+				Status const status = event.error ? Status::kError : echo(*connection, event.can_read);
+				if(status == Status::kSuccess && waiting)
+					poller.modify(event.entry, true, false);
+				else if(status == Status::kNotReady && !waiting)
+					poller.modify(event.entry, false, true);
+				if(status != Status::kError)
+					continue;
+
+				poller.unwatch(event.entry);
+				connection->discard();
+				auto it = std::find_if(connections.begin(), connections.end(),
+					[connection](std::unique_ptr<x::BufferedConnection> const& c) { return c.get() == connection; });
+				std::swap(*it, connections.back());
+				connections.pop_back();
+			}
+		}
+
+		for(auto &connection : connections)
+			connection->discard();
+		return true;
+	}
+}
@@ -0,0 +1,165 @@
+#include "Counters.hpp"
+
+#ifdef NETLIB_COUNTERS
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace netlib
+{
+	namespace
+	{
+		/** The registered threads' counters, and the totals of exited threads. */
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<detail::ThreadCounters const *> threads;
+			Counters exited{};
+		};
+
+		Registry &registry()
+		{
+			// Never destroyed, so that threads exiting after static destruction can still unregister.
+			static Registry * instance = new Registry();
+			return *instance;
+		}
+	}
+
+	Counters counters_snapshot()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+
+		Counters total = reg.exited;
+		for(detail::ThreadCounters const * thread : reg.threads)
+			total.merge(thread->load());
+		return total;
+	}
+
+	Counters thread_counters_snapshot()
+	{
+		return detail::thread_counters().load();
+	}
+
+	namespace detail
+	{
+		ThreadCounters::ThreadCounters()
+		{
+			Registry &reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.threads.push_back(this);
+		}
+
+		ThreadCounters::~ThreadCounters()
+		{
+			Registry &reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.exited.merge(load());
+			reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+		}
+
+		Counters ThreadCounters::load() const
+		{
+			Counters counters;
+			counters.io.sends = sends.load();
+			counters.io.bytes_sent = bytes_sent.load();
+			counters.io.partial_sends = partial_sends.load();
+			counters.io.send_not_ready = send_not_ready.load();
+			counters.io.receives = receives.load();
+			counters.io.bytes_received = bytes_received.load();
+			counters.io.receive_not_ready = receive_not_ready.load();
+			counters.io.errors = errors.load();
+			counters.io.send_stalls = send_stalls.load();
+			counters.poll.polls = polls.load();
+			counters.poll.events = poll_events.load();
+			counters.poll.blocked_ns = poll_blocked_ns.load();
+			return counters;
+		}
+
+		ThreadCounters &thread_counters()
+		{
+			static thread_local ThreadCounters counters;
+			return counters;
+		}
+
+		void count_send(
+			IoCounters &socket,
+			bool not_ready,
+			bool error,
+			std::size_t requested,
+			std::size_t sent)
+		{
+			ThreadCounters &thread = thread_counters();
+			++socket.sends;
+			thread.sends.add(1);
+
+			if(not_ready)
+			{
+				++socket.send_not_ready;
+				thread.send_not_ready.add(1);
+			} else if(error)
+			{
+				++socket.errors;
+				thread.errors.add(1);
+			} else
+			{
+				socket.bytes_sent += sent;
+				thread.bytes_sent.add(sent);
+				if(sent < requested)
+				{
+					++socket.partial_sends;
+					thread.partial_sends.add(1);
+				}
+			}
+		}
+
+		void count_receive(
+			IoCounters &socket,
+			bool not_ready,
+			bool error,
+			std::size_t received)
+		{
+			ThreadCounters &thread = thread_counters();
+			++socket.receives;
+			thread.receives.add(1);
+
+			if(not_ready)
+			{
+				++socket.receive_not_ready;
+				thread.receive_not_ready.add(1);
+			} else if(error)
+			{
+				++socket.errors;
+				thread.errors.add(1);
+			} else
+			{
+				socket.bytes_received += received;
+				thread.bytes_received.add(received);
+			}
+		}
+
+		void count_send_stall(
+			IoCounters &socket)
+		{
+			++socket.send_stalls;
+			thread_counters().send_stalls.add(1);
+		}
+
+		void count_poll(
+			PollCounters &poller,
+			std::size_t events,
+			std::uint64_t blocked_ns)
+		{
+			ThreadCounters &thread = thread_counters();
+			++poller.polls;
+			poller.events += events;
+			poller.blocked_ns += blocked_ns;
+			thread.polls.add(1);
+			thread.poll_events.add(events);
+			thread.poll_blocked_ns.add(blocked_ns);
+		}
+	}
+}
+
+#endif
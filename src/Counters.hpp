@@ -0,0 +1,160 @@
+/** @file Counters.hpp
+	Contains the performance counters of sockets, pollers, and threads.
+	The counters only exist if netlib was built with `NETLIB_COUNTERS` defined (CMake option `NETLIB_COUNTERS`). Applications must then also define `NETLIB_COUNTERS`, as it changes the layout of `Socket` and `Poller`. */
+#ifndef __netlib_counters_hpp_defined
+#define __netlib_counters_hpp_defined
+
+#include "defines.hpp"
+
+#ifdef NETLIB_COUNTERS
+
+#include <atomic>
+#include <cstdint>
+
+namespace netlib
+{
+	/** Counters of socket I/O operations. */
+	struct IoCounters
+	{
+		/** How many send operations were performed. */
+		std::uint64_t sends;
+		/** How many bytes were sent. */
+		std::uint64_t bytes_sent;
+		/** How many send operations sent less than requested. */
+		std::uint64_t partial_sends;
+		/** How many send operations returned `Status::kNotReady`. */
+		std::uint64_t send_not_ready;
+		/** How many receive operations were performed. */
+		std::uint64_t receives;
+		/** How many bytes were received. */
+		std::uint64_t bytes_received;
+		/** How many receive operations returned `Status::kNotReady`. */
+		std::uint64_t receive_not_ready;
+		/** How many send or receive operations failed. */
+		std::uint64_t errors;
+		/** How often buffered sends had to wait for space in the output buffer. */
+		std::uint64_t send_stalls;
+
+		/** Adds another set of counters to this one. */
+		NETLIB_INL void merge(
+			IoCounters const& other);
+	};
+
+	/** Counters of polling operations. */
+	struct PollCounters
+	{
+		/** How often `Poller::poll()` was called. */
+		std::uint64_t polls;
+		/** How many events were returned. */
+		std::uint64_t events;
+		/** How long was spent waiting for events, in nanoseconds. */
+		std::uint64_t blocked_ns;
+
+		/** Adds another set of counters to this one. */
+		NETLIB_INL void merge(
+			PollCounters const& other);
+	};
+
+	/** Counters of a thread, or of a whole process. */
+	struct Counters
+	{
+		/** The I/O counters. */
+		IoCounters io;
+		/** The polling counters. */
+		PollCounters poll;
+
+		/** Adds another set of counters to this one. */
+		NETLIB_INL void merge(
+			Counters const& other);
+	};
+
+	/** Retrieves the sum of all threads' counters, including threads that already exited.
+		Can be called from any thread. Counters of other threads may be slightly out of date. */
+	Counters counters_snapshot();
+	/** Retrieves the calling thread's counters. */
+	Counters thread_counters_snapshot();
+
+	namespace detail
+	{
+		/** A counter that is only written by one thread, but may be read by others.
+			Uses relaxed loads and stores, which compile to plain memory accesses. */
+		class Counter
+		{
+			std::atomic<std::uint64_t> m_value;
+		public:
+			NETLIB_INL Counter();
+
+			/** Increases the counter. Must only be called by the owning thread. */
+			NETLIB_INL void add(
+				std::uint64_t amount);
+			/** The counter's value. */
+			NETLIB_INL std::uint64_t load() const;
+		};
+
+		/** The counters of a thread. */
+		struct ThreadCounters
+		{
+			Counter sends;
+			Counter bytes_sent;
+			Counter partial_sends;
+			Counter send_not_ready;
+			Counter receives;
+			Counter bytes_received;
+			Counter receive_not_ready;
+			Counter errors;
+			Counter send_stalls;
+			Counter polls;
+			Counter poll_events;
+			Counter poll_blocked_ns;
+
+			/** Registers the counters, so that they are included in snapshots. */
+			ThreadCounters();
+			/** Adds the counters to the totals of exited threads, and unregisters them. */
+			~ThreadCounters();
+
+			/** Reads the counters. */
+			Counters load() const;
+		};
+
+		/** The calling thread's counters. */
+		ThreadCounters &thread_counters();
+
+		/** Records a send operation on a socket and the calling thread.
+		@param[in,out] socket:
+			The socket's counters.
+		@param[in] not_ready:
+			Whether the operation would have blocked.
+		@param[in] error:
+			Whether the operation failed.
+		@param[in] requested:
+			How many bytes were to be sent.
+		@param[in] sent:
+			How many bytes were sent. */
+		void count_send(
+			IoCounters &socket,
+			bool not_ready,
+			bool error,
+			std::size_t requested,
+			std::size_t sent);
+		/** Records a receive operation on a socket and the calling thread. */
+		void count_receive(
+			IoCounters &socket,
+			bool not_ready,
+			bool error,
+			std::size_t received);
+		/** Records that a buffered send had to wait for buffer space. */
+		void count_send_stall(
+			IoCounters &socket);
+		/** Records a poll operation on a poller and the calling thread. */
+		void count_poll(
+			PollCounters &poller,
+			std::size_t events,
+			std::uint64_t blocked_ns);
+	}
+}
+
+#include "Counters.inl"
+
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef __netlib_counters_inl_defined
+#define __netlib_counters_inl_defined
+
+namespace netlib
+{
+	void IoCounters::merge(
+		IoCounters const& other)
+	{
+		sends += other.sends;
+		bytes_sent += other.bytes_sent;
+		partial_sends += other.partial_sends;
+		send_not_ready += other.send_not_ready;
+		receives += other.receives;
+		bytes_received += other.bytes_received;
+		receive_not_ready += other.receive_not_ready;
+		errors += other.errors;
+		send_stalls += other.send_stalls;
+	}
+
+	void PollCounters::merge(
+		PollCounters const& other)
+	{
+		polls += other.polls;
+		events += other.events;
+		blocked_ns += other.blocked_ns;
+	}
+
+	void Counters::merge(
+		Counters const& other)
+	{
+		io.merge(other.io);
+		poll.merge(other.poll);
+	}
+
+	namespace detail
+	{
+		Counter::Counter():
+			m_value(0)
+		{
+		}
+
+		void Counter::add(
+			std::uint64_t amount)
+		{
+			// Only the owning thread writes, so no read-modify-write is needed.
+			m_value.store(
+				m_value.load(std::memory_order_relaxed) + amount,
+				std::memory_order_relaxed);
+		}
+
+		std::uint64_t Counter::load() const
+		{
+			return m_value.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+#endif
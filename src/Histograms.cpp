@@ -0,0 +1,163 @@
+#include "Histograms.hpp"
+
+#ifdef NETLIB_HISTOGRAMS
+
+#include "Socket.hpp"
+
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+namespace netlib
+{
+	namespace
+	{
+		/** The registered threads' histograms, and the totals of exited threads. */
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<detail::ThreadHistograms const *> threads;
+			OperationHistograms exited;
+		};
+
+		Registry &registry()
+		{
+			// Never destroyed, so that threads exiting after static destruction can still unregister.
+			static Registry * instance = new Registry();
+			return *instance;
+		}
+
+		std::uint64_t nanoseconds(
+			std::chrono::steady_clock::duration duration)
+		{
+			return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+		}
+	}
+
+	char const * operation_name(
+		Operation operation)
+	{
+		static char const * const names[] = {
+			"send", "receive", "flush", "connect", "accept"
+		};
+		static_assert(_countof(names) == NETLIB_COUNT(Operation));
+
+		return names[static_cast<unsigned>(operation)];
+	}
+
+	void OperationHistograms::merge(
+		OperationHistograms const& other)
+	{
+		for(unsigned i = 0; i < NETLIB_COUNT(Operation); i++)
+		{
+			running[i].merge(other.running[i]);
+			suspended[i].merge(other.suspended[i]);
+		}
+		kernel_to_handler.merge(other.kernel_to_handler);
+	}
+
+	std::string OperationHistograms::text() const
+	{
+		std::string out;
+		for(unsigned i = 0; i < NETLIB_COUNT(Operation); i++)
+		{
+			char const * name = operation_name(static_cast<Operation>(i));
+			if(running[i].count())
+				((out += name) += " running ") += running[i].text() += '\n';
+			if(suspended[i].count())
+				((out += name) += " suspended ") += suspended[i].text() += '\n';
+		}
+		if(kernel_to_handler.count())
+			(out += "kernel_to_handler ") += kernel_to_handler.text() += '\n';
+		return out;
+	}
+
+	OperationHistograms histograms_snapshot()
+	{
+		Registry &reg = registry();
+		std::lock_guard<std::mutex> lock(reg.mutex);
+
+		OperationHistograms total = reg.exited;
+		for(detail::ThreadHistograms const * thread : reg.threads)
+			thread->load(total);
+		return total;
+	}
+
+	OperationHistograms thread_histograms_snapshot()
+	{
+		OperationHistograms out;
+		detail::thread_histograms().load(out);
+		return out;
+	}
+
+	namespace detail
+	{
+		AtomicHistogram::AtomicHistogram()
+		{
+			for(std::atomic<std::uint64_t> &bucket : m_buckets)
+				bucket.store(0, std::memory_order_relaxed);
+		}
+
+		void AtomicHistogram::load(
+			util::Histogram &out) const
+		{
+			for(std::size_t i = 0; i < util::Histogram::kBuckets; i++)
+				if(std::uint64_t count = m_buckets[i].load(std::memory_order_relaxed))
+					out.add(i, count);
+		}
+
+		ThreadHistograms::ThreadHistograms()
+		{
+			Registry &reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.threads.push_back(this);
+		}
+
+		ThreadHistograms::~ThreadHistograms()
+		{
+			Registry &reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			load(reg.exited);
+			reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+		}
+
+		void ThreadHistograms::load(
+			OperationHistograms &out) const
+		{
+			for(unsigned i = 0; i < NETLIB_COUNT(Operation); i++)
+			{
+				running[i].load(out.running[i]);
+				suspended[i].load(out.suspended[i]);
+			}
+			kernel_to_handler.load(out.kernel_to_handler);
+		}
+
+		ThreadHistograms &thread_histograms()
+		{
+			static thread_local ThreadHistograms histograms;
+			return histograms;
+		}
+
+		void record_kernel_to_handler(
+			std::uint64_t timestamp)
+		{
+			// The system clock may have been set back since.
+			std::uint64_t const now = Socket::timestamp_now();
+			if(now >= timestamp)
+				thread_histograms().kernel_to_handler.record(now - timestamp);
+		}
+
+		void OperationTimer::finish(
+			Operation operation)
+		{
+			m_running += std::chrono::steady_clock::now() - m_resumed;
+
+			ThreadHistograms &thread = thread_histograms();
+			unsigned const index = static_cast<unsigned>(operation);
+			thread.running[index].record(nanoseconds(m_running));
+			thread.suspended[index].record(nanoseconds(m_suspended));
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,136 @@
+/** @file Histograms.hpp
+	Contains the latency histograms of coroutine I/O operations, and of timestamped received data.
+	The histograms only exist if netlib was built with `NETLIB_HISTOGRAMS` defined (CMake option `NETLIB_HISTOGRAMS`). Applications must then also define `NETLIB_HISTOGRAMS`, as it changes the layout of `x::BufferedConnection` and `x::ConnectionListener`. */
+#ifndef __netlib_histograms_hpp_defined
+#define __netlib_histograms_hpp_defined
+
+#include "defines.hpp"
+
+#ifdef NETLIB_HISTOGRAMS
+
+#include "util/Histogram.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+namespace netlib
+{
+	/** The coroutine operations whose latency is recorded. */
+	enum class Operation
+	{
+		/** `x::BufferedConnection::Send`. */
+		kSend,
+		/** `x::BufferedConnection::Receive`. */
+		kReceive,
+		/** `x::BufferedConnection::Flush`. */
+		kFlush,
+		/** `x::BufferedConnection::Connect`. */
+		kConnect,
+		/** `x::ConnectionListener::Accept`. */
+		NETLIB_LAST(kAccept)
+	};
+
+	/** The name of an operation, as used in `OperationHistograms::text()`. */
+	char const * operation_name(
+		Operation operation);
+
+	/** Latency histograms of all operations, in nanoseconds.
+		For every completed operation, the time the coroutine spent suspended (waiting for the socket) and the time it spent running (between being started or resumed and suspending or completing) are recorded separately. Failed operations are not recorded. */
+	struct OperationHistograms
+	{
+		/** The time spent running, per operation. */
+		util::Histogram running[NETLIB_COUNT(Operation)];
+		/** The time spent suspended, per operation. */
+		util::Histogram suspended[NETLIB_COUNT(Operation)];
+		/** The time received data was queued from when the kernel timestamped it until it was received. Only recorded for sockets with timestamps enabled (see `Socket::enable_timestamps()`). */
+		util::Histogram kernel_to_handler;
+
+		/** Adds another set of histograms to this one. */
+		void merge(
+			OperationHistograms const& other);
+
+		/** Dumps all non-empty histograms, one per line.
+			Format: `<operation> <running|suspended> <util::Histogram::text()>`, or `kernel_to_handler <util::Histogram::text()>`. */
+		std::string text() const;
+	};
+
+	/** Retrieves the sum of all threads' histograms, including threads that already exited.
+		Can be called from any thread, and does not block the recording threads. Histograms of other threads may be slightly out of date. */
+	OperationHistograms histograms_snapshot();
+	/** Retrieves the calling thread's histograms. */
+	OperationHistograms thread_histograms_snapshot();
+
+	namespace detail
+	{
+		/** A histogram that is only written by one thread, but may be read by others.
+			Uses relaxed loads and stores, which compile to plain memory accesses. */
+		class AtomicHistogram
+		{
+			std::atomic<std::uint64_t> m_buckets[util::Histogram::kBuckets];
+		public:
+			AtomicHistogram();
+
+			/** Records a value. Must only be called by the owning thread. */
+			NETLIB_INL void record(
+				std::uint64_t value);
+			/** Adds the recorded values to a histogram. */
+			void load(
+				util::Histogram &out) const;
+		};
+
+		/** The histograms of a thread. */
+		struct ThreadHistograms
+		{
+			AtomicHistogram running[NETLIB_COUNT(Operation)];
+			AtomicHistogram suspended[NETLIB_COUNT(Operation)];
+			AtomicHistogram kernel_to_handler;
+
+			/** Registers the histograms, so that they are included in snapshots. */
+			ThreadHistograms();
+			/** Adds the histograms to the totals of exited threads, and unregisters them. */
+			~ThreadHistograms();
+
+			/** Adds the histograms to `out`. */
+			void load(
+				OperationHistograms &out) const;
+		};
+
+		/** The calling thread's histograms. */
+		ThreadHistograms &thread_histograms();
+
+		/** Records how long received data was queued since the kernel timestamped it in the calling thread's histograms.
+		@param[in] timestamp:
+			The receive timestamp, as returned by `Socket::recv_timestamped()`. */
+		void record_kernel_to_handler(
+			std::uint64_t timestamp);
+
+		/** Measures the running and suspended time of a coroutine operation.
+			Coroutine locals do not survive suspension, so the timer is stored in the object the operation works on. Only one operation may use a timer at a time. */
+		class OperationTimer
+		{
+			/** When the operation started, or was last resumed. */
+			std::chrono::steady_clock::time_point m_resumed;
+			/** The time spent running so far. */
+			std::chrono::steady_clock::duration m_running;
+			/** The time spent suspended so far. */
+			std::chrono::steady_clock::duration m_suspended;
+		public:
+			/** Starts timing an operation. */
+			NETLIB_INL void begin();
+			/** Called before the operation suspends. */
+			NETLIB_INL void suspend();
+			/** Called after the operation was resumed. */
+			NETLIB_INL void resume();
+			/** Records the completed operation in the calling thread's histograms. */
+			void finish(
+				Operation operation);
+		};
+	}
+}
+
+#include "Histograms.inl"
+
+#endif
+
+#endif
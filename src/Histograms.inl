@@ -0,0 +1,37 @@
+#ifndef __netlib_histograms_inl_defined
+#define __netlib_histograms_inl_defined
+
+namespace netlib::detail
+{
+	void AtomicHistogram::record(
+		std::uint64_t value)
+	{
+		std::atomic<std::uint64_t> &bucket = m_buckets[util::Histogram::bucket(value)];
+		// Only the owning thread writes, so no read-modify-write is needed.
+		bucket.store(
+			bucket.load(std::memory_order_relaxed) + 1,
+			std::memory_order_relaxed);
+	}
+
+	void OperationTimer::begin()
+	{
+		m_running = m_suspended = std::chrono::steady_clock::duration::zero();
+		m_resumed = std::chrono::steady_clock::now();
+	}
+
+	void OperationTimer::suspend()
+	{
+		auto const now = std::chrono::steady_clock::now();
+		m_running += now - m_resumed;
+		m_resumed = now;
+	}
+
+	void OperationTimer::resume()
+	{
+		auto const now = std::chrono::steady_clock::now();
+		m_suspended += now - m_resumed;
+		m_resumed = now;
+	}
+}
+
+#endif
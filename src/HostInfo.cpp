@@ -34,7 +34,7 @@ namespace netlib
 			assert(it->ai_addr != nullptr);
 
 			AddressInfo ai;
-			to_socket_address(*it->ai_addr, ai.address);
+			to_socket_address(*it->ai_addr, it->ai_addrlen, ai.address);
 			if(it->ai_canonname)
 				ai.name = it->ai_canonname;
 			ret.push_back(std::move(ai));
@@ -10,6 +10,10 @@
 #include <poll.h>
 #endif
 #include <cassert>
+#include <cstdlib>
+#ifdef NETLIB_COUNTERS
+#include <chrono>
+#endif
 
 namespace netlib
 {
@@ -32,14 +36,18 @@ namespace netlib
 		if(can_write)
 			entry->socket->m_output.notify_one();
 
-		if(error)
+		// Queued transmit timestamps are reported as errors as well.
+		if(error && (!entry->socket->m_tx_timestamps || entry->socket->take_error()))
 		{
 			entry->socket->m_input.fail_one();
 			entry->socket->m_output.fail_one();
 		}
+
+		return true;
 	}
 
 	Poller::Poller():
+		m_sweep(m_watch_list.end()),
 #ifdef NETLIB_EPOLL
 		m_poller(INVALID_POLLER),
 		m_event_list(nullptr),
@@ -48,12 +56,16 @@ namespace netlib
 #else
 		m_poll_list(nullptr),
 		m_poll_list_capacity(0)
+#endif
+#ifdef NETLIB_COUNTERS
+		, m_counters()
 #endif
 	{
 	}
 
 	Poller::Poller(
 		Poller && move):
+		m_sweep(m_watch_list.end()),
 #ifdef NETLIB_EPOLL
 		m_poller(move.m_poller),
 		m_event_list(move.m_event_list),
@@ -64,7 +76,9 @@ namespace netlib
 		m_poll_list(move.m_poll_list),
 		m_poll_list_capacity(move.m_poll_list_capacity)
 #endif
-
+#ifdef NETLIB_COUNTERS
+		, m_counters(move.m_counters)
+#endif
 	{
 		// Reinitialise the other poller to empty.
 		new (&move) Poller();
@@ -88,6 +102,7 @@ namespace netlib
 		m_poll_list = move.m_poll_list;
 		m_poll_list_capacity = move.m_poll_list_capacity;
 #endif
+		NETLIB_STAT(m_counters = move.m_counters);
 		new (&move) Poller();
 
 		return *this;
@@ -169,6 +184,43 @@ namespace netlib
 		return &m_watch_list.front();
 	}
 
+	bool Poller::modify(
+		detail::WatchEntry const * entry,
+		bool read,
+		bool write)
+	{
+		assert(entry != nullptr);
+		assert(entry->socket_handle != -1);
+#ifdef NETLIB_EPOLL
+		::epoll_event event;
+
+		event.events = 0;
+		if(read)
+			event.events |= EPOLLIN;
+		if(write)
+			event.events |= EPOLLOUT;
+		event.data.ptr = const_cast<detail::WatchEntry *>(entry);
+
+		return -1 != epoll_ctl(m_poller, EPOLL_CTL_MOD, entry->socket_handle, &event);
+#else
+		for(std::size_t index = 0; index < m_sockets.size(); index++)
+		{
+			::pollfd & it = static_cast<::pollfd *>(m_poll_list)[index];
+			if(it.fd == entry->socket_handle)
+			{
+				it.events = 0;
+				if(read)
+					it.events |= POLLIN;
+				if(write)
+					it.events |= POLLOUT;
+				return true;
+			}
+		}
+
+		return false;
+#endif
+	}
+
 	bool Poller::unwatch(
 		detail::WatchEntry const * entry)
 	{
@@ -208,6 +260,8 @@ namespace netlib
 #endif
 
 		// Remove the watch list entry.
+		if(m_sweep == entry->iterator)
+			++m_sweep;
 		m_watch_list.erase(entry->iterator);
 		return true;
 	}
@@ -215,6 +269,7 @@ namespace netlib
 	void Poller::unwatch_all()
 	{
 		m_watch_list.clear();
+		m_sweep = m_watch_list.end();
 #ifdef NETLIB_EPOLL
 		if(m_poller != INVALID_POLLER)
 		{
@@ -246,6 +301,7 @@ namespace netlib
 
 		assert(m_poller != INVALID_POLLER);
 
+		NETLIB_STAT(auto const start = std::chrono::steady_clock::now());
 		std::size_t count = ::epoll_wait(
 			m_poller,
 			static_cast<::epoll_event *>(m_event_list),
@@ -255,6 +311,12 @@ namespace netlib
 		if(count == -1)
 			return false;
 
+		NETLIB_STAT(detail::count_poll(
+			m_counters,
+			count,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count()));
+
 		events.reserve(events.size() + count);
 
 		// Find the `count` events that were returned.
@@ -277,6 +339,7 @@ namespace netlib
 		if(m_sockets.empty())
 			return true;
 
+		NETLIB_STAT(auto const start = std::chrono::steady_clock::now());
 		std::size_t count = ::poll(
 			(::pollfd *) m_poll_list,
 			m_sockets.size(),
@@ -285,6 +348,12 @@ namespace netlib
 		if(count == -1)
 			return false;
 
+		NETLIB_STAT(detail::count_poll(
+			m_counters,
+			count,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count()));
+
 		events.reserve(events.size() + count);
 
 		for(std::size_t i = 0; count; i++)
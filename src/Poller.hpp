@@ -3,6 +3,7 @@
 
 #include "defines.hpp"
 #include "Socket.hpp"
+#include "Counters.hpp"
 
 #include <unordered_map>
 #include <vector>
@@ -66,6 +67,8 @@ namespace netlib
 	class Poller
 	{
 		std::list<detail::WatchEntry> m_watch_list;
+		/** The next entry visited by `sweep()`. */
+		std::list<detail::WatchEntry>::iterator m_sweep;
 #ifdef NETLIB_EPOLL
 		/** The poller object. */
 		std::uintptr_t m_poller;
@@ -82,6 +85,10 @@ namespace netlib
 		std::size_t m_poll_list_capacity;
 		/** The watched sockets. */
 		std::unordered_map<detail::socket_t, std::list<detail::WatchEntry>::iterator> m_sockets;
+#endif
+#ifdef NETLIB_COUNTERS
+		/** The poller's performance counters. */
+		PollCounters m_counters;
 #endif
 	public:
 		/** Creates an empty poller. */
@@ -106,6 +113,8 @@ namespace netlib
 		~Poller();
 
 		NETLIB_INL bool empty() const;
+		/** The number of watched sockets. */
+		NETLIB_INL std::size_t size() const;
 
 		/** Watches a single socket.
 		@param[in] socket:
@@ -129,6 +138,21 @@ namespace netlib
 			bool read,
 			bool write);
 
+		/** Changes which events are polled for a watched socket.
+			Used to stop reading from a socket while its data cannot be passed on, and to only poll for output while data is waiting to be sent.
+		@param[in] entry:
+			The socket's watch entry.
+		@param[in] read:
+			Whether to listen for input events.
+		@param[in] write:
+			Whether to listen for output events.
+		@return
+			Whether it succeeded. */
+		bool modify(
+			detail::WatchEntry const * entry,
+			bool read,
+			bool write);
+
 		/** Unwatches a watched object.
 		@param[in] entry:
 			The object to unwatch.
@@ -140,6 +164,19 @@ namespace netlib
 		/** Unwatches all sockets and frees all resources. */
 		void unwatch_all();
 
+		/** Visits watched sockets in round-robin order.
+			Every call continues where the previous call stopped, so that periodic work on all watched sockets can be spread over multiple calls. Sockets watched or unwatched in between are visited or skipped accordingly.
+		@param[in] count:
+			How many sockets to visit at most. No socket is visited twice per call.
+		@param[in] visit:
+			Called as `visit(Socket const&)` for every visited socket. Must not watch or unwatch sockets.
+		@return
+			The number of visited sockets. */
+		template<class Visit>
+		std::size_t sweep(
+			std::size_t count,
+			Visit &&visit);
+
 		/** Polls updated sockets.
 			Waits until at least one event occurs, or until the timeout expires.
 		@param[out] events:
@@ -163,6 +200,11 @@ namespace netlib
 			How many additional sockets to prepare for. */
 		NETLIB_INL void reserve_additional(
 			std::size_t size);
+
+#ifdef NETLIB_COUNTERS
+		/** Returns the poller's performance counters. */
+		NETLIB_INL PollCounters const& counters() const;
+#endif
 	};
 }
 
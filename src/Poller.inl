@@ -5,6 +5,11 @@ namespace netlib
 		return m_watch_list.empty();
 	}
 
+	std::size_t Poller::size() const
+	{
+		return m_watch_list.size();
+	}
+
 	template<class T, class>
 	bool Poller::watch(
 		T * object,
@@ -17,6 +22,25 @@ namespace netlib
 			write);
 	}
 
+	template<class Visit>
+	std::size_t Poller::sweep(
+		std::size_t count,
+		Visit &&visit)
+	{
+		if(count > m_watch_list.size())
+			count = m_watch_list.size();
+
+		for(std::size_t i = 0; i < count; i++)
+		{
+			if(m_sweep == m_watch_list.end())
+				m_sweep = m_watch_list.begin();
+			visit(*static_cast<Socket const *>(m_sweep->socket));
+			++m_sweep;
+		}
+
+		return count;
+	}
+
 	void Poller::reserve_additional(
 		std::size_t size)
 	{
@@ -26,4 +50,11 @@ namespace netlib
 		reserve(m_sockets.size() + size);
 #endif
 	}
+
+#ifdef NETLIB_COUNTERS
+	PollCounters const& Poller::counters() const
+	{
+		return m_counters;
+	}
+#endif
 }
\ No newline at end of file
@@ -2,14 +2,25 @@
 #include "internal/platform.hpp"
 #include "internal/SocketAddress.hpp"
 #include "Runtime.hpp"
+#include "Histograms.hpp"
 
 #include <cassert>
 #include <type_traits>
 #include <cstring>
+#include <cstddef>
 #include <stdexcept>
+#include <chrono>
 
 #include <poll.h>
 #include <fcntl.h>
+#ifdef __linux__
+#include <netinet/tcp.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#endif
+#ifndef NETLIB_WINDOWS
+#include <net/if.h>
+#endif
 #include <cerrno>
 
 #ifndef SOCKET_ERROR
@@ -38,6 +49,63 @@ namespace netlib
 		return k_lookup[(std::size_t) type];
 	}
 
+	static SocketType to_socket_type(
+		int native)
+	{
+		switch(native)
+		{
+		case SOCK_STREAM: return SocketType::kStream;
+		case SOCK_DGRAM: return SocketType::kDatagram;
+		case SOCK_RAW: return SocketType::kRaw;
+		case SOCK_RDM: return SocketType::kRDM;
+		case SOCK_SEQPACKET: return SocketType::kSPS;
+		default:
+			assert(!"Unhandled socket type.");
+			return SocketType::kStream;
+		}
+	}
+
+#ifdef __linux__
+	/** Control data buffer large enough for a receive timestamp. */
+	union TimestampControl
+	{
+		::cmsghdr align;
+		// SO_TIMESTAMPING reports three timestamps, of which only the software timestamp is used.
+		char buffer[CMSG_SPACE(sizeof(::timespec) * 3)];
+	};
+
+	/** Converts a kernel timestamp into nanoseconds. */
+	static std::uint64_t to_nanoseconds(
+		::timespec const& time)
+	{
+		return std::uint64_t(time.tv_sec) * 1000000000 + std::uint64_t(time.tv_nsec);
+	}
+
+	/** Extracts the receive timestamp from a received message's control data.
+	@return
+		The timestamp, or 0 if the message has none. */
+	static std::uint64_t parse_timestamp(
+		::msghdr &msg)
+	{
+		for(::cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg != nullptr;
+			cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if(cmsg->cmsg_level != SOL_SOCKET
+			|| (cmsg->cmsg_type != SCM_TIMESTAMPING && cmsg->cmsg_type != SCM_TIMESTAMPNS))
+				continue;
+
+			// Both start with the software timestamp.
+			::timespec time;
+			std::memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+			std::uint64_t const timestamp = to_nanoseconds(time);
+			NETLIB_TIMED(detail::record_kernel_to_handler(timestamp));
+			return timestamp;
+		}
+		return 0;
+	}
+#endif
+
 	static Status parse_errno()
 	{
 		switch(errno)
@@ -73,7 +141,11 @@ namespace netlib
 		m_address(family),
 		m_type(type),
 		m_protocol(protocol),
-		m_socket()
+		m_socket(),
+		m_tx_timestamps(false)
+#ifdef NETLIB_COUNTERS
+		, m_counters()
+#endif
 	{
 		assert(Runtime::exists());
 
@@ -103,7 +175,11 @@ namespace netlib
 		m_address(),
 		m_type(),
 		m_protocol(),
-		m_socket(-1)
+		m_socket(-1),
+		m_tx_timestamps(false)
+#ifdef NETLIB_COUNTERS
+		, m_counters()
+#endif
 	{
 	}
 
@@ -130,6 +206,7 @@ namespace netlib
 		}
 
 		m_socket = -1;
+		m_tx_timestamps = false;
 	}
 
 	bool Socket::bind(
@@ -153,11 +230,11 @@ namespace netlib
 
 		m_address = address;
 		::sockaddr_storage addr;
-		from_socket_address(m_address, addr);
+		::socklen_t len = from_socket_address(m_address, addr);
 		return SOCKET_ERROR != ::bind(
 			m_socket,
 			reinterpret_cast<::sockaddr const *>(&addr),
-			sizeof(::sockaddr));
+			len);
 	}
 
 	Status Socket::connect(
@@ -168,12 +245,12 @@ namespace netlib
 
 		m_address = serverAddress;
 		::sockaddr_storage addr;
-		from_socket_address(serverAddress, addr);
+		::socklen_t len = from_socket_address(serverAddress, addr);
 
 		if(SOCKET_ERROR == ::connect(
 			m_socket,
 			reinterpret_cast<::sockaddr const *>(&addr),
-			sizeof(::sockaddr)))
+			len))
 			return parse_errno();
 		else
 			return Status::kSuccess;
@@ -220,12 +297,68 @@ namespace netlib
 		if(result == -1)
 		{
 			sent = 0;
-			return parse_errno();
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_send(m_counters, status == Status::kNotReady, true, size, 0));
+			return status;
 		} else
 		{
 			sent = result;
+			NETLIB_STAT(detail::count_send(m_counters, false, false, size, sent));
+			return Status::kSuccess;
+		}
+	}
+
+	Status Socket::send_gathered(
+		DataSlice const * slices,
+		std::size_t count,
+		std::size_t &sent)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+		assert(count <= kMaxSlices);
+
+#ifdef NETLIB_WINDOWS
+		// Send the first non-empty slice only, which is a valid partial send.
+		for(; count && !slices->size; count--)
+			slices++;
+		if(!count)
+		{
+			sent = 0;
 			return Status::kSuccess;
 		}
+		return send(slices->data, slices->size, sent);
+#else
+		::iovec iov[kMaxSlices];
+		std::size_t size = 0;
+		for(std::size_t i = 0; i < count; i++)
+		{
+			iov[i].iov_base = const_cast<void *>(slices[i].data);
+			iov[i].iov_len = slices[i].size;
+			size += slices[i].size;
+		}
+
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+
+		std::size_t result = ::sendmsg(
+			m_socket,
+			&msg,
+			0);
+
+		if(result == -1)
+		{
+			sent = 0;
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_send(m_counters, status == Status::kNotReady, true, size, 0));
+			return status;
+		}
+
+		sent = result;
+		NETLIB_STAT(detail::count_send(m_counters, false, false, size, sent));
+		return Status::kSuccess;
+#endif
 	}
 
 	Status Socket::recv(
@@ -242,10 +375,36 @@ namespace netlib
 			size,
 			0);
 
+		if(result == -1)
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_receive(m_counters, status == Status::kNotReady, true, 0));
+			return status;
+		}
+
+		received = result;
+		NETLIB_STAT(detail::count_receive(m_counters, false, false, received));
+		return Status::kSuccess;
+	}
+
+	Status Socket::peek(
+		void * data,
+		size_t size,
+		std::size_t &received)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+		std::size_t result = ::recv(
+			m_socket,
+			(char*)data,
+			size,
+			MSG_PEEK);
+
 		if(result == -1)
 			return parse_errno();
 
-		received = result;;
+		received = result;
 		return Status::kSuccess;
 	}
 
@@ -259,19 +418,24 @@ namespace netlib
 		assert(exists());
 
 		::sockaddr_storage addr;
-		from_socket_address(m_address, addr);
+		::socklen_t len = from_socket_address(to, addr);
 		std::size_t result = ::sendto(
 			m_socket,
 			(const char*)data,
 			size,
 			0,
 			reinterpret_cast<::sockaddr const *>(&addr),
-			sizeof(::sockaddr));
+			len);
 
 		if(result == -1)
-			return parse_errno();
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_send(m_counters, status == Status::kNotReady, true, size, 0));
+			return status;
+		}
 
 		sent = result;
+		NETLIB_STAT(detail::count_send(m_counters, false, false, size, sent));
 		return Status::kSuccess;
 	}
 
@@ -285,7 +449,7 @@ namespace netlib
 		assert(exists());
 
 		::sockaddr_storage addr;
-		::socklen_t len = sizeof(::sockaddr);
+		::socklen_t len = sizeof(addr);
 
 		std::size_t result = ::recvfrom(
 			m_socket,
@@ -296,21 +460,598 @@ namespace netlib
 			&len);
 
 		if(result == -1)
-			return parse_errno();
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_receive(m_counters, status == Status::kNotReady, true, 0));
+			return status;
+		}
 
 		received = result;
-		to_socket_address(reinterpret_cast<::sockaddr&>(addr), from);
+		NETLIB_STAT(detail::count_receive(m_counters, false, false, received));
+		to_socket_address(reinterpret_cast<::sockaddr&>(addr), len, from);
 		return Status::kSuccess;
 	}
 
+	bool Socket::pair(
+		SocketType type,
+		Socket &first,
+		Socket &second)
+	{
+		assert(Runtime::exists());
+
+#ifdef NETLIB_WINDOWS
+		return false;
+#else
+		detail::socket_t handles[2];
+
+// Create nonblocking sockets atomically, if possible.
+#ifdef __unix__
+		if(SOCKET_ERROR == ::socketpair(
+			AF_UNIX,
+			to_native_api(type) | SOCK_NONBLOCK,
+			0,
+			handles))
+			return false;
+#else
+		if(SOCKET_ERROR == ::socketpair(
+			AF_UNIX,
+			to_native_api(type),
+			0,
+			handles))
+			return false;
+#endif
+
+		first.adopt(handles[0]);
+		second.adopt(handles[1]);
+		return true;
+#endif
+	}
+
+	void Socket::adopt(
+		detail::socket_t handle)
+	{
+		assert(Runtime::exists());
+		assert(handle != -1);
+
+		close();
+		m_socket = handle;
+
+#ifndef NETLIB_WINDOWS
+		int flags = ::fcntl(m_socket, F_GETFL, 0);
+		if(flags != -1 && !(flags & O_NONBLOCK))
+			::fcntl(m_socket, F_SETFL, flags | O_NONBLOCK);
+#endif
+
+		int type;
+		::socklen_t len = sizeof(type);
+		if(SOCKET_ERROR != ::getsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_TYPE,
+			(char *)&type,
+			&len))
+			m_type = to_socket_type(type);
+
+		m_protocol = Protocol::kDefault;
+
+		::sockaddr_storage addr;
+		len = sizeof(addr);
+		if(SOCKET_ERROR == ::getpeername(
+			m_socket,
+			reinterpret_cast<::sockaddr *>(&addr),
+			&len))
+		{
+			len = sizeof(addr);
+			if(SOCKET_ERROR == ::getsockname(
+				m_socket,
+				reinterpret_cast<::sockaddr *>(&addr),
+				&len))
+				return;
+		}
+
+		to_socket_address(
+			reinterpret_cast<::sockaddr const&>(addr),
+			len,
+			m_address);
+	}
+
+	Status Socket::send_sockets(
+		void const * data,
+		std::size_t size,
+		Socket const * const * sockets,
+		std::size_t count,
+		std::size_t &sent)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+		assert(size != 0);
+		assert(count <= kMaxPassedSockets);
+
+#ifdef NETLIB_WINDOWS
+		return Status::kError;
+#else
+		::iovec iov;
+		iov.iov_base = const_cast<void *>(data);
+		iov.iov_len = size;
+
+		union {
+			::cmsghdr align;
+			char buffer[CMSG_SPACE(sizeof(int) * kMaxPassedSockets)];
+		} control;
+
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		if(count)
+		{
+			std::memset(&control, 0, sizeof(control));
+			msg.msg_control = control.buffer;
+			msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+			::cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+
+			for(std::size_t i = 0; i < count; i++)
+			{
+				assert(sockets[i] != nullptr);
+				assert(sockets[i]->exists());
+
+				int handle = sockets[i]->m_socket;
+				std::memcpy(
+					CMSG_DATA(cmsg) + i * sizeof(int),
+					&handle,
+					sizeof(int));
+			}
+		}
+
+		std::size_t result = ::sendmsg(
+			m_socket,
+			&msg,
+			0);
+
+		if(result == -1)
+		{
+			sent = 0;
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_send(m_counters, status == Status::kNotReady, true, size, 0));
+			return status;
+		}
+
+		sent = result;
+		NETLIB_STAT(detail::count_send(m_counters, false, false, size, sent));
+		return Status::kSuccess;
+#endif
+	}
+
+	Status Socket::recv_sockets(
+		void * data,
+		std::size_t size,
+		Socket * const * sockets,
+		std::size_t capacity,
+		std::size_t &received,
+		std::size_t &received_sockets)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#ifdef NETLIB_WINDOWS
+		return Status::kError;
+#else
+		::iovec iov;
+		iov.iov_base = data;
+		iov.iov_len = size;
+
+		// Always leave room for the maximum, so that no handles leak.
+		union {
+			::cmsghdr align;
+			char buffer[CMSG_SPACE(sizeof(int) * kMaxPassedSockets)];
+		} control;
+
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+#ifdef MSG_CMSG_CLOEXEC
+		int const flags = MSG_CMSG_CLOEXEC;
+#else
+		int const flags = 0;
+#endif
+		std::size_t result = ::recvmsg(
+			m_socket,
+			&msg,
+			flags);
+
+		if(result == -1)
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_receive(m_counters, status == Status::kNotReady, true, 0));
+			return status;
+		}
+
+		received = result;
+		NETLIB_STAT(detail::count_receive(m_counters, false, false, received));
+		received_sockets = 0;
+
+		for(::cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+			cmsg != nullptr;
+			cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if(cmsg->cmsg_level != SOL_SOCKET
+			|| cmsg->cmsg_type != SCM_RIGHTS)
+				continue;
+
+			std::size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			for(std::size_t i = 0; i < count; i++)
+			{
+				int handle;
+				std::memcpy(
+					&handle,
+					CMSG_DATA(cmsg) + i * sizeof(int),
+					sizeof(int));
+
+				if(received_sockets < capacity)
+					sockets[received_sockets++]->adopt(handle);
+				else
+					::close(handle);
+			}
+		}
+
+		return Status::kSuccess;
+#endif
+	}
+
+	bool Socket::peer_credentials(
+		PeerCredentials &out) const
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#ifdef SO_PEERCRED
+		::ucred cred;
+		::socklen_t len = sizeof(cred);
+		if(SOCKET_ERROR == ::getsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_PEERCRED,
+			&cred,
+			&len))
+			return false;
+
+		out.pid = cred.pid;
+		out.uid = cred.uid;
+		out.gid = cred.gid;
+		return true;
+#else
+		return false;
+#endif
+	}
+
+#if defined(__linux__) && defined(TCP_INFO)
+	namespace
+	{
+		/** The kernel's `struct tcp_info`.
+			The C library's definition usually lacks the newer fields, so the layout is replicated here. Older kernels fill in only a prefix. */
+		struct KernelTcpInfo
+		{
+			std::uint8_t state;
+			std::uint8_t ca_state;
+			std::uint8_t retransmits;
+			std::uint8_t probes;
+			std::uint8_t backoff;
+			std::uint8_t options;
+			std::uint8_t wscale;
+			std::uint8_t flags;
+
+			std::uint32_t rto;
+			std::uint32_t ato;
+			std::uint32_t snd_mss;
+			std::uint32_t rcv_mss;
+
+			std::uint32_t unacked;
+			std::uint32_t sacked;
+			std::uint32_t lost;
+			std::uint32_t retrans;
+			std::uint32_t fackets;
+
+			std::uint32_t last_data_sent;
+			std::uint32_t last_ack_sent;
+			std::uint32_t last_data_recv;
+			std::uint32_t last_ack_recv;
+
+			std::uint32_t pmtu;
+			std::uint32_t rcv_ssthresh;
+			std::uint32_t rtt;
+			std::uint32_t rttvar;
+			std::uint32_t snd_ssthresh;
+			std::uint32_t snd_cwnd;
+			std::uint32_t advmss;
+			std::uint32_t reordering;
+
+			std::uint32_t rcv_rtt;
+			std::uint32_t rcv_space;
+
+			std::uint32_t total_retrans;
+
+			std::uint64_t pacing_rate;
+			std::uint64_t max_pacing_rate;
+			std::uint64_t bytes_acked;
+			std::uint64_t bytes_received;
+			std::uint32_t segs_out;
+			std::uint32_t segs_in;
+
+			std::uint32_t notsent_bytes;
+			std::uint32_t min_rtt;
+			std::uint32_t data_segs_in;
+			std::uint32_t data_segs_out;
+
+			std::uint64_t delivery_rate;
+		};
+
+		static_assert(offsetof(KernelTcpInfo, pacing_rate) == 104);
+		static_assert(offsetof(KernelTcpInfo, delivery_rate) == 160);
+	}
+#endif
+
+	bool Socket::tcp_info(
+		TcpInfo &out) const
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#if defined(__linux__) && defined(TCP_INFO)
+		if(m_type != SocketType::kStream)
+			return false;
+
+		// Fields the kernel does not know stay 0.
+		KernelTcpInfo info{};
+		::socklen_t len = sizeof(info);
+		if(SOCKET_ERROR == ::getsockopt(
+			m_socket,
+			IPPROTO_TCP,
+			TCP_INFO,
+			&info,
+			&len))
+			return false;
+
+		out.rtt = info.rtt;
+		out.rtt_variation = info.rttvar;
+		out.min_rtt = info.min_rtt;
+		out.congestion_window = info.snd_cwnd;
+		out.slow_start_threshold = info.snd_ssthresh;
+		out.mss = info.snd_mss;
+		out.unacked = info.unacked;
+		out.unsent_bytes = info.notsent_bytes;
+		out.retransmits = info.total_retrans;
+		out.lost = info.lost;
+		out.delivery_rate = info.delivery_rate;
+		out.pacing_rate = info.pacing_rate;
+		out.bytes_acked = info.bytes_acked;
+		out.bytes_received = info.bytes_received;
+		out.state = info.state;
+		return true;
+#else
+		(void) out;
+		return false;
+#endif
+	}
+
+	bool Socket::set_max_pacing_rate(
+		std::uint64_t bytes_per_second)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#if defined(__linux__) && defined(SO_MAX_PACING_RATE)
+		// All bits set means unlimited.
+		std::uint64_t const rate = bytes_per_second ? bytes_per_second : ~std::uint64_t(0);
+		if(SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_MAX_PACING_RATE,
+			&rate,
+			sizeof(rate)))
+			return true;
+
+		// Older kernels only accept 32 bits.
+		std::uint32_t const rate32 = rate > ~std::uint32_t(0) ? ~std::uint32_t(0) : std::uint32_t(rate);
+		return SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_MAX_PACING_RATE,
+			&rate32,
+			sizeof(rate32));
+#else
+		(void) bytes_per_second;
+		return false;
+#endif
+	}
+
+	bool Socket::enable_timestamps(
+		bool transmit)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#ifdef __linux__
+		unsigned flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+		// Without OPT_TSONLY, every timestamp would carry a copy of the sent data.
+		if(transmit)
+			flags |= SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+		if(SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_TIMESTAMPING,
+			&flags,
+			sizeof(flags)))
+		{
+			m_tx_timestamps = transmit;
+			return true;
+		}
+
+		if(transmit)
+			return false;
+
+		// Older kernels only support receive timestamps.
+		int const enable = 1;
+		return SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_TIMESTAMPNS,
+			&enable,
+			sizeof(enable));
+#else
+		(void) transmit;
+		return false;
+#endif
+	}
+
+	Status Socket::recv_timestamped(
+		void * data,
+		std::size_t size,
+		std::size_t &received,
+		std::uint64_t &timestamp)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+#ifdef __linux__
+		::iovec iov;
+		iov.iov_base = data;
+		iov.iov_len = size;
+
+		TimestampControl control;
+		::msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = sizeof(control.buffer);
+
+		std::size_t result = ::recvmsg(
+			m_socket,
+			&msg,
+			0);
+
+		if(result == -1)
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_receive(m_counters, status == Status::kNotReady, true, 0));
+			return status;
+		}
+
+		received = result;
+		NETLIB_STAT(detail::count_receive(m_counters, false, false, received));
+		timestamp = parse_timestamp(msg);
+		return Status::kSuccess;
+#else
+		timestamp = 0;
+		return recv(data, size, received);
+#endif
+	}
+
+	bool Socket::take_error()
+	{
+		int error;
+		::socklen_t len = sizeof(error);
+		return SOCKET_ERROR == ::getsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_ERROR,
+			(char *)&error,
+			&len)
+		|| error;
+	}
+
+	Status Socket::recv_tx_timestamps(
+		TxTimestamp * out,
+		std::size_t capacity,
+		std::size_t &received)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+		assert(capacity);
+
+		received = 0;
+#ifdef __linux__
+		while(received < capacity)
+		{
+			union {
+				::cmsghdr align;
+				char buffer[
+					CMSG_SPACE(sizeof(::timespec) * 3)
+					+ CMSG_SPACE(sizeof(::sock_extended_err) + sizeof(::sockaddr_storage))];
+			} control;
+
+			// With OPT_TSONLY, the queued messages carry no data.
+			::msghdr msg;
+			std::memset(&msg, 0, sizeof(msg));
+			msg.msg_control = control.buffer;
+			msg.msg_controllen = sizeof(control.buffer);
+
+			if(SOCKET_ERROR == ::recvmsg(
+				m_socket,
+				&msg,
+				MSG_ERRQUEUE))
+				return received ? Status::kSuccess : parse_errno();
+
+			TxTimestamp timestamp{};
+			bool has_id = false;
+			for(::cmsghdr * cmsg = CMSG_FIRSTHDR(&msg);
+				cmsg != nullptr;
+				cmsg = CMSG_NXTHDR(&msg, cmsg))
+			{
+				if(cmsg->cmsg_level == SOL_SOCKET
+				&& cmsg->cmsg_type == SCM_TIMESTAMPING)
+				{
+					::timespec time;
+					std::memcpy(&time, CMSG_DATA(cmsg), sizeof(time));
+					timestamp.time = to_nanoseconds(time);
+				} else if((cmsg->cmsg_level == IPPROTO_IP && cmsg->cmsg_type == IP_RECVERR)
+					|| (cmsg->cmsg_level == IPPROTO_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+				{
+					::sock_extended_err error;
+					std::memcpy(&error, CMSG_DATA(cmsg), sizeof(error));
+					if(error.ee_errno == ENOMSG
+					&& error.ee_origin == SO_EE_ORIGIN_TIMESTAMPING)
+					{
+						timestamp.id = error.ee_data;
+						has_id = true;
+					}
+				}
+			}
+
+			// Skip anything else that ended up in the error queue.
+			if(has_id && timestamp.time)
+				out[received++] = timestamp;
+		}
+		return Status::kSuccess;
+#else
+		(void) out;
+		return Status::kError;
+#endif
+	}
+
+	std::uint64_t Socket::timestamp_now()
+	{
+		return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count());
+	}
+
 	Status StreamSocket::accept(
 		StreamSocket &socket)
 	{
 		assert(Runtime::exists());
 		assert(exists());
 
-		sockaddr_in addr;
-		socklen_t len = sizeof(::sockaddr);
+		::sockaddr_storage addr;
+		::socklen_t len = sizeof(addr);
 
 #if defined(__unix__) && defined(_GNU_SOURCE)
 		int sockid = ::accept4(
@@ -331,11 +1072,14 @@ namespace netlib
 
 		to_socket_address(
 			reinterpret_cast<::sockaddr const&>(addr),
+			len,
 			socket.m_address);
 
 		socket.m_protocol = m_protocol;
 		socket.m_type = m_type;
 		socket.m_socket = sockid;
+		// Accepted sockets inherit the listener's timestamping options.
+		socket.m_tx_timestamps = m_tx_timestamps;
 
 #if !defined(__unix__) || !defined(_GNU_SOURCE)
 		unsigned long mode = 1;
@@ -345,6 +1089,56 @@ namespace netlib
 		return Status::kSuccess;
 	}
 
+	void StreamSocket::abort()
+	{
+		if(exists())
+		{
+			assert(Runtime::exists());
+
+			::linger option;
+			option.l_onoff = 1;
+			option.l_linger = 0;
+			::setsockopt(
+				m_socket,
+				SOL_SOCKET,
+				SO_LINGER,
+				reinterpret_cast<char const *>(&option),
+				sizeof(option));
+		}
+
+		close();
+	}
+
+	Status StreamSocket::finish_connect()
+	{
+		assert(Runtime::exists());
+		assert(exists());
+
+		::pollfd fd;
+		fd.fd = m_socket;
+		fd.events = POLLOUT;
+		fd.revents = 0;
+
+		int ready = ::poll(&fd, 1, 0);
+		if(ready == -1)
+			return Status::kError;
+		if(!ready)
+			return Status::kInProgress;
+
+		int error;
+		::socklen_t len = sizeof(error);
+		if(SOCKET_ERROR == ::getsockopt(
+			m_socket,
+			SOL_SOCKET,
+			SO_ERROR,
+			(char *)&error,
+			&len)
+		|| error)
+			return Status::kError;
+
+		return Status::kSuccess;
+	}
+
 	bool StreamSocket::listen()
 	{
 		assert(Runtime::exists());
@@ -358,7 +1152,320 @@ namespace netlib
 		Socket(family, SocketType::kStream)
 	{
 		assert(family == AddressFamily::kIPv4
-			|| family == AddressFamily::kIPv6);
+			|| family == AddressFamily::kIPv6
+			|| family == AddressFamily::kUnix);
+	}
+
+	bool StreamSocket::pair(
+		StreamSocket &first,
+		StreamSocket &second)
+	{
+		return Socket::pair(SocketType::kStream, first, second);
+	}
+
+	DatagramSocket::DatagramSocket(
+		AddressFamily family):
+		Socket(family, SocketType::kDatagram)
+	{
+	}
+
+	bool DatagramSocket::pair(
+		DatagramSocket &first,
+		DatagramSocket &second)
+	{
+		return Socket::pair(SocketType::kDatagram, first, second);
+	}
+
+	Status DatagramSocket::recv_batch(
+		ReceivedDatagram * datagrams,
+		std::size_t count,
+		std::size_t &received)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+		assert(count && count <= kMaxBatch);
+
+		received = 0;
+#ifdef __linux__
+		::mmsghdr messages[kMaxBatch];
+		::iovec vectors[kMaxBatch];
+		::sockaddr_storage addresses[kMaxBatch];
+		TimestampControl controls[kMaxBatch];
+		for(std::size_t i = 0; i < count; i++)
+		{
+			vectors[i].iov_base = datagrams[i].data;
+			vectors[i].iov_len = datagrams[i].capacity;
+			std::memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+			messages[i].msg_hdr.msg_name = &addresses[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(addresses[i]);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_control = controls[i].buffer;
+			messages[i].msg_hdr.msg_controllen = sizeof(controls[i].buffer);
+		}
+
+		int const result = ::recvmmsg(
+			m_socket,
+			messages,
+			unsigned(count),
+			0,
+			nullptr);
+
+		if(result == -1)
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_receive(m_counters, status == Status::kNotReady, true, 0));
+			return status;
+		}
+
+		for(int i = 0; i < result; i++)
+		{
+			ReceivedDatagram &datagram = datagrams[i];
+			datagram.size = messages[i].msg_len;
+			datagram.truncated = messages[i].msg_hdr.msg_flags & MSG_TRUNC;
+			to_socket_address(
+				reinterpret_cast<::sockaddr const&>(addresses[i]),
+				messages[i].msg_hdr.msg_namelen,
+				datagram.from);
+			datagram.timestamp = parse_timestamp(messages[i].msg_hdr);
+			NETLIB_STAT(detail::count_receive(m_counters, false, false, datagram.size));
+		}
+		received = std::size_t(result);
+		return Status::kSuccess;
+#else
+		// Without recvmmsg(), receive until the socket runs dry.
+		for(; received < count; received++)
+		{
+			ReceivedDatagram &datagram = datagrams[received];
+			Status status = recvfrom(
+				datagram.data,
+				datagram.capacity,
+				datagram.from,
+				datagram.size);
+			if(status != Status::kSuccess)
+				return received ? Status::kSuccess : status;
+			datagram.truncated = false;
+			datagram.timestamp = 0;
+		}
+		return Status::kSuccess;
+#endif
+	}
+
+	Status DatagramSocket::send_batch(
+		DataSlice const * datagrams,
+		std::size_t count,
+		std::size_t &sent)
+	{
+		assert(Runtime::exists());
+		assert(exists());
+		assert(count && count <= kMaxBatch);
+
+		sent = 0;
+#ifdef __linux__
+		::mmsghdr messages[kMaxBatch];
+		::iovec vectors[kMaxBatch];
+		for(std::size_t i = 0; i < count; i++)
+		{
+			vectors[i].iov_base = const_cast<void *>(datagrams[i].data);
+			vectors[i].iov_len = datagrams[i].size;
+			std::memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int const result = ::sendmmsg(
+			m_socket,
+			messages,
+			unsigned(count),
+			0);
+
+		if(result == -1)
+		{
+			Status status = parse_errno();
+			NETLIB_STAT(detail::count_send(m_counters, status == Status::kNotReady, true, datagrams[0].size, 0));
+			return status;
+		}
+
+		for(int i = 0; i < result; i++)
+			NETLIB_STAT(detail::count_send(m_counters, false, false, datagrams[i].size, messages[i].msg_len));
+		sent = std::size_t(result);
+		return Status::kSuccess;
+#else
+		// Without sendmmsg(), send until the socket is full.
+		for(; sent < count; sent++)
+		{
+			std::size_t size;
+			Status status = send(
+				datagrams[sent].data,
+				datagrams[sent].size,
+				size);
+			if(status != Status::kSuccess)
+				return sent ? Status::kSuccess : status;
+		}
+		return Status::kSuccess;
+#endif
+	}
+
+	/** Joins or leaves a multicast group with the protocol independent (RFC 3678) socket options. */
+	static bool change_membership(
+		detail::socket_t socket,
+		SocketAddress const& group,
+		SocketAddress const * source,
+		std::uint32_t interface,
+		bool join)
+	{
+		if(group.family != AddressFamily::kIPv4 && group.family != AddressFamily::kIPv6)
+			return false;
+		int const level = group.family == AddressFamily::kIPv4 ? IPPROTO_IP : IPPROTO_IPV6;
+
+		if(!source)
+		{
+			::group_req request;
+			std::memset(&request, 0, sizeof(request));
+			request.gr_interface = interface;
+			from_socket_address(group, request.gr_group);
+			return SOCKET_ERROR != ::setsockopt(
+				socket,
+				level,
+				join ? MCAST_JOIN_GROUP : MCAST_LEAVE_GROUP,
+				reinterpret_cast<char const *>(&request),
+				sizeof(request));
+		}
+
+		if(source->family != group.family)
+			return false;
+
+		::group_source_req request;
+		std::memset(&request, 0, sizeof(request));
+		request.gsr_interface = interface;
+		from_socket_address(group, request.gsr_group);
+		from_socket_address(*source, request.gsr_source);
+		return SOCKET_ERROR != ::setsockopt(
+			socket,
+			level,
+			join ? MCAST_JOIN_SOURCE_GROUP : MCAST_LEAVE_SOURCE_GROUP,
+			reinterpret_cast<char const *>(&request),
+			sizeof(request));
+	}
+
+	bool DatagramSocket::join(
+		SocketAddress const& group,
+		std::uint32_t interface)
+	{
+		assert(exists());
+		return change_membership(m_socket, group, nullptr, interface, true);
+	}
+
+	bool DatagramSocket::join(
+		SocketAddress const& group,
+		SocketAddress const& source,
+		std::uint32_t interface)
+	{
+		assert(exists());
+		return change_membership(m_socket, group, &source, interface, true);
+	}
+
+	bool DatagramSocket::leave(
+		SocketAddress const& group,
+		std::uint32_t interface)
+	{
+		assert(exists());
+		return change_membership(m_socket, group, nullptr, interface, false);
+	}
+
+	bool DatagramSocket::leave(
+		SocketAddress const& group,
+		SocketAddress const& source,
+		std::uint32_t interface)
+	{
+		assert(exists());
+		return change_membership(m_socket, group, &source, interface, false);
+	}
+
+	bool DatagramSocket::set_multicast_interface(
+		std::uint32_t interface)
+	{
+		assert(exists());
+
+		if(m_address.family == AddressFamily::kIPv6)
+		{
+			unsigned const index = interface;
+			return SOCKET_ERROR != ::setsockopt(
+				m_socket,
+				IPPROTO_IPV6,
+				IPV6_MULTICAST_IF,
+				reinterpret_cast<char const *>(&index),
+				sizeof(index));
+		}
+
+#ifdef __linux__
+		::ip_mreqn request;
+		std::memset(&request, 0, sizeof(request));
+		request.imr_ifindex = int(interface);
+#else
+		// Without `ip_mreqn`, IPv4 interfaces are selected by address, so only the default can be restored.
+		if(interface)
+			return false;
+		::in_addr request;
+		request.s_addr = htonl(INADDR_ANY);
+#endif
+		return SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			IPPROTO_IP,
+			IP_MULTICAST_IF,
+			reinterpret_cast<char const *>(&request),
+			sizeof(request));
+	}
+
+	bool DatagramSocket::set_multicast_hops(
+		unsigned hops)
+	{
+		assert(exists());
+
+		int const value = int(hops);
+		bool const ipv6 = m_address.family == AddressFamily::kIPv6;
+		return SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			ipv6 ? IPPROTO_IPV6 : IPPROTO_IP,
+			ipv6 ? IPV6_MULTICAST_HOPS : IP_MULTICAST_TTL,
+			reinterpret_cast<char const *>(&value),
+			sizeof(value));
+	}
+
+	bool DatagramSocket::set_multicast_loopback(
+		bool enable)
+	{
+		assert(exists());
+
+		bool const ipv6 = m_address.family == AddressFamily::kIPv6;
+		if(ipv6)
+		{
+			unsigned const value = enable;
+			return SOCKET_ERROR != ::setsockopt(
+				m_socket,
+				IPPROTO_IPV6,
+				IPV6_MULTICAST_LOOP,
+				reinterpret_cast<char const *>(&value),
+				sizeof(value));
+		}
+
+		int const value = enable;
+		return SOCKET_ERROR != ::setsockopt(
+			m_socket,
+			IPPROTO_IP,
+			IP_MULTICAST_LOOP,
+			reinterpret_cast<char const *>(&value),
+			sizeof(value));
+	}
+
+	std::uint32_t DatagramSocket::interface_index(
+		char const * name)
+	{
+#ifdef NETLIB_WINDOWS
+		return 0;
+#else
+		return ::if_nametoindex(name);
+#endif
 	}
 
 	Socket::Socket(
@@ -366,7 +1473,11 @@ namespace netlib
 		m_address(move.m_address),
 		m_protocol(move.m_protocol),
 		m_type(move.m_type),
-		m_socket(move.m_socket)
+		m_socket(move.m_socket),
+		m_tx_timestamps(move.m_tx_timestamps)
+#ifdef NETLIB_COUNTERS
+		, m_counters(move.m_counters)
+#endif
 	{
 		assert(&move != this);
 
@@ -385,9 +1496,11 @@ namespace netlib
 		assert(!m_output.fail_all());
 		close();
 		m_socket = move.m_socket;
+		m_tx_timestamps = move.m_tx_timestamps;
 		m_type = move.m_type;
 		m_protocol = move.m_protocol;
 		m_address = move.m_address;
+		NETLIB_STAT(m_counters = move.m_counters);
 		move.m_socket = -1;
 
 		assert(!move.m_input.fail_all());
@@ -6,6 +6,7 @@
 #include "defines.hpp"
 #include "Protocol.hpp"
 #include "SocketAddress.hpp"
+#include "Counters.hpp"
 
 #include <libcr/mt/ConditionVariable.hpp>
 
@@ -59,6 +60,88 @@ namespace netlib
 		typedef int socket_t;
 	}
 
+	/** A piece of data to be sent by `Socket::send_gathered()`. */
+	struct DataSlice
+	{
+		/** The data. */
+		void const * data;
+		/** The data's size, in bytes. */
+		std::size_t size;
+	};
+
+	/** A datagram received by `DatagramSocket::recv_batch()`. */
+	struct ReceivedDatagram
+	{
+		/** Where to receive the datagram into. */
+		void * data;
+		/** The size of `data`, in bytes. */
+		std::size_t capacity;
+		/** On success, the datagram's size, in bytes. */
+		std::size_t size;
+		/** On success, where the datagram was received from. */
+		SocketAddress from;
+		/** On success, whether the datagram was larger than `capacity`, and was cut off. */
+		bool truncated;
+		/** On success, when the kernel received the datagram, in nanoseconds since the Unix epoch, or 0 if receive timestamps are not enabled (see `Socket::enable_timestamps()`). */
+		std::uint64_t timestamp;
+	};
+
+	/** When the kernel sent some data, as retrieved by `Socket::recv_tx_timestamps()`. */
+	struct TxTimestamp
+	{
+		/** Identifies the send call the data belongs to. On stream sockets, the offset of the call's last byte within all bytes sent since transmit timestamps were enabled. On datagram sockets, the number of datagrams sent before it since transmit timestamps were enabled. Wraps around at 2^32. */
+		std::uint32_t id;
+		/** When the data was passed to the network device, in nanoseconds since the Unix epoch. */
+		std::uint64_t time;
+	};
+
+	/** Credentials of the process on the other end of a Unix domain socket. */
+	struct PeerCredentials
+	{
+		/** The peer's process ID. */
+		std::int32_t pid;
+		/** The peer's user ID. */
+		std::uint32_t uid;
+		/** The peer's group ID. */
+		std::uint32_t gid;
+	};
+
+	/** Kernel statistics of a TCP connection, as retrieved by `Socket::tcp_info()`.
+		Fields that the running kernel does not report are 0. */
+	struct TcpInfo
+	{
+		/** The smoothed round-trip time, in microseconds. */
+		std::uint32_t rtt;
+		/** The round-trip time variation, in microseconds. */
+		std::uint32_t rtt_variation;
+		/** The minimal observed round-trip time, in microseconds. */
+		std::uint32_t min_rtt;
+		/** The congestion window, in segments. */
+		std::uint32_t congestion_window;
+		/** The slow start threshold, in segments. */
+		std::uint32_t slow_start_threshold;
+		/** The maximum segment size for sending, in bytes. */
+		std::uint32_t mss;
+		/** How many sent segments are not acknowledged yet. */
+		std::uint32_t unacked;
+		/** How many bytes are in the send buffer, but were not sent yet. */
+		std::uint32_t unsent_bytes;
+		/** How many segments were retransmitted in total. */
+		std::uint32_t retransmits;
+		/** How many sent segments are currently considered lost. */
+		std::uint32_t lost;
+		/** The most recent estimate of the delivery rate, in bytes per second. */
+		std::uint64_t delivery_rate;
+		/** The pacing rate, in bytes per second. */
+		std::uint64_t pacing_rate;
+		/** How many bytes were acknowledged by the peer. */
+		std::uint64_t bytes_acked;
+		/** How many bytes were received from the peer. */
+		std::uint64_t bytes_received;
+		/** The connection's state, as defined by the kernel (1 = established). */
+		std::uint8_t state;
+	};
+
 	/** Basic Socket class.
 		Represents a generic Socket and contains functions that all types of Sockets have. */
 	class Socket
@@ -74,11 +157,49 @@ namespace netlib
 		SocketType m_type;
 		/** The socket handle. */
 		detail::socket_t m_socket;
+		/** Whether transmit timestamps are enabled, which are queued as errors. */
+		bool m_tx_timestamps;
 		/** Notified when input is pending. */
 		cr::mt::ConditionVariable m_input;
 		/** Notified when output is possible. */
 		cr::mt::ConditionVariable m_output;
+#ifdef NETLIB_COUNTERS
+		/** The socket's performance counters. */
+		IoCounters m_counters;
+#endif
+
+		/** Creates a pair of connected, unnamed Unix domain sockets.
+		@param[in] type:
+			The type of both sockets.
+		@param[out] first:
+			The first socket.
+		@param[out] second:
+			The second socket.
+		@return
+			Whether it succeeded. */
+		static bool pair(
+			SocketType type,
+			Socket &first,
+			Socket &second);
+
+		/** Takes ownership of a native socket handle.
+			Makes the handle nonblocking, and queries its type and address. If the socket is connected, its peer's address is used, otherwise, its own address.
+		@param[in] handle:
+			The handle to adopt. */
+		void adopt(
+			detail::socket_t handle);
+
+		/** Retrieves and clears the socket's pending error.
+			Polling also reports an error while transmit timestamps are queued, which this tells apart from an actual failure. Only used with transmit timestamps enabled, as clearing the error hides it from `StreamSocket::finish_connect()`.
+		@return
+			Whether an error was pending. */
+		bool take_error();
 	public:
+		/** The maximum number of sockets that can be passed in a single message. */
+		static constexpr std::size_t kMaxPassedSockets = 32;
+		/** The maximum number of slices that can be sent by a single gathered send. */
+		static constexpr std::size_t kMaxSlices = 16;
+
 		/** Creates an empty socket. */
 		Socket();
 		/** Creates and allocates a socket of the given characteristics.
@@ -175,6 +296,34 @@ namespace netlib
 			std::size_t size,
 			std::size_t &received);
 
+		/** Sends the concatenation of several pieces of data in a single system call, without copying them together first.
+		@param[in] slices:
+			The pieces of data to send, in order.
+		@param[in] count:
+			The number of slices. At most `kMaxSlices`.
+		@param[out] sent:
+			On success, the number of bytes sent. Like with `send()`, this can be less than the slices' total size.
+		@return
+			Whether the operation succeeded. */
+		Status send_gathered(
+			DataSlice const * slices,
+			std::size_t count,
+			std::size_t &sent);
+
+		/** Receives at most `size` bytes into `data`, without removing them from the socket's input queue.
+		@param[out] data:
+			Where to copy the pending data to.
+		@param[in] size:
+			How many bytes to copy at most.
+		@param[out] received:
+			On success, the number of bytes copied. On stream sockets, 0 means that the peer closed the connection.
+		@return
+			Whether the operation succeeded. */
+		Status peek(
+			void * data,
+			std::size_t size,
+			std::size_t &received);
+
 		/** Sends at most `size` bytes of `data` to the given address.
 		@param[in] data:
 			The data to send.
@@ -209,6 +358,121 @@ namespace netlib
 			SocketAddress &from,
 			std::size_t &received);
 
+		/** Sends data together with copies of other sockets over a Unix domain socket.
+			The receiving process obtains its own handles to the passed sockets, which refer to the same underlying connections or listeners. The local sockets are left untouched.
+		@param[in] data:
+			The data to send. Must not be empty.
+		@param[in] size:
+			How many bytes to send at most.
+		@param[in] sockets:
+			The sockets to pass.
+		@param[in] count:
+			The number of sockets to pass. At most `kMaxPassedSockets`.
+		@param[out] sent:
+			On success, the number of bytes sent. If any data was sent, then all sockets were passed.
+		@return
+			Whether the operation succeeded. */
+		Status send_sockets(
+			void const * data,
+			std::size_t size,
+			Socket const * const * sockets,
+			std::size_t count,
+			std::size_t &sent);
+
+		/** Receives data together with sockets passed via `send_sockets()`.
+		@param[out] data:
+			Where to receive the incoming data into.
+		@param[in] size:
+			How many bytes to receive at most.
+		@param[in] sockets:
+			The sockets that receive the passed handles. Any previously held handles are closed.
+		@param[in] capacity:
+			The number of entries in `sockets`. Passed sockets that do not fit are closed.
+		@param[out] received:
+			On success, the number of bytes received.
+		@param[out] received_sockets:
+			On success, the number of sockets received.
+		@return
+			Whether the operation succeeded. */
+		Status recv_sockets(
+			void * data,
+			std::size_t size,
+			Socket * const * sockets,
+			std::size_t capacity,
+			std::size_t &received,
+			std::size_t &received_sockets);
+
+		/** Retrieves the credentials of a Unix domain socket's peer.
+			The credentials are those of the peer at the time it called `connect()` or `Socket::pair()`.
+		@param[out] out:
+			The peer's credentials.
+		@return
+			Whether the credentials could be retrieved. */
+		bool peer_credentials(
+			PeerCredentials &out) const;
+
+		/** Retrieves the kernel's statistics of a TCP connection.
+			Costs a single system call, and is only supported on GNU/Linux.
+		@param[out] out:
+			The connection's statistics.
+		@return
+			Whether the statistics could be retrieved. Fails for sockets that are not TCP sockets. */
+		bool tcp_info(
+			TcpInfo &out) const;
+
+		/** Limits the rate at which the kernel sends the socket's data, by spacing out its packets.
+			Uses `SO_MAX_PACING_RATE`, and is only supported on GNU/Linux. TCP sockets are paced by TCP itself, other sockets only if the outgoing interface uses the fq queueing discipline. Where neither applies, see `x::BufferedConnection::set_rate_limit()`.
+		@param[in] bytes_per_second:
+			The maximum rate, or 0 to remove the limit.
+		@return
+			Whether the limit was set. */
+		bool set_max_pacing_rate(
+			std::uint64_t bytes_per_second);
+
+		/** Makes the kernel record when data is received, and optionally, when it is sent.
+			Timestamps are taken in software, when the kernel handles a packet, and are nanoseconds since the Unix epoch, so that subtracting them from `timestamp_now()` yields the time data spent queued in the kernel and in the application. Only supported on GNU/Linux. If the kernel lacks `SO_TIMESTAMPING`, only receive timestamps are available.
+		@param[in] transmit:
+			Whether to also record transmit timestamps, which have to be retrieved via `recv_tx_timestamps()`.
+		@return
+			Whether timestamps are enabled. */
+		bool enable_timestamps(
+			bool transmit = false);
+
+		/** Like `recv()`, but also retrieves the receive timestamp.
+		@param[out] data:
+			Where to receive the incoming data into.
+		@param[in] size:
+			How many bytes to receive at most.
+		@param[out] received:
+			On success, the number of bytes received.
+		@param[out] timestamp:
+			On success, when the kernel received the data in nanoseconds since the Unix epoch, or 0 if timestamps are not enabled. On stream sockets, this is the time of the most recent packet that contributed to the received data.
+		@return
+			Whether the operation succeeded. */
+		Status recv_timestamped(
+			void * data,
+			std::size_t size,
+			std::size_t &received,
+			std::uint64_t &timestamp);
+
+		/** Retrieves the transmit timestamps recorded since the last call.
+			Pending timestamps make the socket report an error when polled (`PollEvent::error`), so they should be retrieved whenever that happens. Such events do not fail the socket's waiting coroutines, but are reported by every poll until the timestamps are retrieved.
+		@param[out] out:
+			Receives the timestamps, in the order they were recorded.
+		@param[in] capacity:
+			The number of entries in `out`.
+		@param[out] received:
+			On success, the number of timestamps retrieved, at least 1.
+		@return
+			Whether the operation succeeded. `Status::kNotReady` if no timestamp was pending. */
+		Status recv_tx_timestamps(
+			TxTimestamp * out,
+			std::size_t capacity,
+			std::size_t &received);
+
+		/** The current time in nanoseconds since the Unix epoch, on the clock that timestamps are recorded with. */
+		static std::uint64_t timestamp_now();
+
 		/** Whether this Socket exists. */
 		NETLIB_INL bool exists() const;
 		/** Same as `exists()`. */
@@ -220,6 +484,10 @@ namespace netlib
 		NETLIB_INL Protocol protocol() const;
 		/** Returns the type of this Socket. */
 		NETLIB_INL SocketType type() const;
+#ifdef NETLIB_COUNTERS
+		/** Returns the performance counters of this Socket. */
+		NETLIB_INL IoCounters const& counters() const;
+#endif
 	};
 
 	/** Represents a stream socket. */
@@ -229,7 +497,7 @@ namespace netlib
 		/** Creates a stream socket for the requested address family.
 		@param[in] family:
 			The requested address family.
-			Must be either IPv4 and IPv6. */
+			Must be either IPv4, IPv6, or Unix. */
 		explicit StreamSocket(
 			AddressFamily family);
 
@@ -251,6 +519,26 @@ namespace netlib
 			Whether the operation succeeded. */
 		Status accept(
 			StreamSocket &out);
+
+		/** Checks whether a nonblocking `connect()` completed, without blocking.
+		@return
+			`Status::kSuccess` if the connection was established, `Status::kInProgress` if it is still being established, and `Status::kError` if it failed. */
+		Status finish_connect();
+
+		/** Closes the socket abortively.
+			Discards unsent data and resets the connection (sends a TCP RST) instead of shutting it down gracefully, so no resources are held in `TIME_WAIT`. */
+		void abort();
+
+		/** Creates a pair of connected, unnamed Unix domain stream sockets.
+		@param[out] first:
+			The first socket.
+		@param[out] second:
+			The second socket.
+		@return
+			Whether it succeeded. */
+		static bool pair(
+			StreamSocket &first,
+			StreamSocket &second);
 	};
 
 	/** Represents a datagram socket. */
@@ -260,11 +548,105 @@ namespace netlib
 		/** Creates a datagram socket for the requested address family. */
 		DatagramSocket(
 			AddressFamily);
+		DatagramSocket() = default;
 		DatagramSocket &operator=(DatagramSocket &&) = default;
 		DatagramSocket(DatagramSocket &&) = default;
 
 		DatagramSocket &operator=(DatagramSocket const&) = delete;
 		DatagramSocket(DatagramSocket const&) = delete;
+
+		/** The maximum number of datagrams received by a single `recv_batch()`. */
+		static constexpr std::size_t kMaxBatch = 64;
+
+		/** Receives several datagrams in a single system call, where supported (`recvmmsg()` on GNU/Linux).
+		@param[in,out] datagrams:
+			The datagrams' buffers, which receive the datagrams in order.
+		@param[in] count:
+			The number of buffers. At most `kMaxBatch`.
+		@param[out] received:
+			On success, the number of datagrams received, at least 1.
+		@return
+			Whether the operation succeeded. `Status::kNotReady` if no datagram was pending. */
+		Status recv_batch(
+			ReceivedDatagram * datagrams,
+			std::size_t count,
+			std::size_t &received);
+
+		/** Sends several datagrams to the connected peer in a single system call, where supported (`sendmmsg()` on GNU/Linux).
+		@param[in] datagrams:
+			The datagrams to send, in order.
+		@param[in] count:
+			The number of datagrams. At most `kMaxBatch`.
+		@param[out] sent:
+			On success, the number of datagrams sent, at least 1. The rest did not fit into the socket's send buffer.
+		@return
+			Whether the operation succeeded. `Status::kNotReady` if no datagram could be sent. */
+		Status send_batch(
+			DataSlice const * datagrams,
+			std::size_t count,
+			std::size_t &sent);
+
+		/** Joins a multicast group, receiving from any source (any-source multicast).
+			To receive the group's datagrams, the socket must also be bound to the group's port, usually on the 'any' address, so that several sockets can share it via `reuse_address`.
+		@param[in] group:
+			The group's IPv4 or IPv6 address. The port is ignored.
+		@param[in] interface:
+			The index of the interface to join on, see `interface_index()`. 0 lets the system choose.
+		@return
+			Whether it succeeded. */
+		bool join(
+			SocketAddress const& group,
+			std::uint32_t interface = 0);
+		/** Joins a multicast group, only receiving from a single source (source-specific multicast).
+			Can be called repeatedly to receive from several sources.
+		@param[in] group:
+			The group's address, usually in 232.0.0.0/8 or ff3x::/32.
+		@param[in] source:
+			The source's address. Must have the same family as `group`.
+		@param[in] interface:
+			The index of the interface to join on, or 0. */
+		bool join(
+			SocketAddress const& group,
+			SocketAddress const& source,
+			std::uint32_t interface = 0);
+		/** Leaves a multicast group joined via `join(group, interface)`. */
+		bool leave(
+			SocketAddress const& group,
+			std::uint32_t interface = 0);
+		/** Stops receiving from a source joined via `join(group, source, interface)`. */
+		bool leave(
+			SocketAddress const& group,
+			SocketAddress const& source,
+			std::uint32_t interface = 0);
+
+		/** Selects the interface that multicast datagrams are sent from.
+		@param[in] interface:
+			The interface's index, or 0 to let the system choose. */
+		bool set_multicast_interface(
+			std::uint32_t interface);
+		/** Sets how many routers sent multicast datagrams may pass (the IPv4 TTL or IPv6 hop limit). The default of 1 keeps them in the local network. */
+		bool set_multicast_hops(
+			unsigned hops);
+		/** Sets whether sent multicast datagrams are also delivered to sockets of this host that joined the group. Enabled by default. */
+		bool set_multicast_loopback(
+			bool enable);
+
+		/** Looks up an interface's index by its name, such as "eth0".
+		@return
+			The interface's index, or 0 if there is no such interface. */
+		static std::uint32_t interface_index(
+			char const * name);
+
+		/** Creates a pair of connected, unnamed Unix domain datagram sockets.
+		@param[out] first:
+			The first socket.
+		@param[out] second:
+			The second socket.
+		@return
+			Whether it succeeded. */
+		static bool pair(
+			DatagramSocket &first,
+			DatagramSocket &second);
 	};
 }
 
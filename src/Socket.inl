@@ -8,6 +8,9 @@ namespace netlib
 	NETLIB_INL SocketAddress const& Socket::address() const { return m_address; }
 	NETLIB_INL Protocol Socket::protocol() const { return m_protocol; }
 	NETLIB_INL SocketType Socket::type() const { return m_type; }
+#ifdef NETLIB_COUNTERS
+	NETLIB_INL IoCounters const& Socket::counters() const { return m_counters; }
+#endif
 }
 
 #endif
\ No newline at end of file
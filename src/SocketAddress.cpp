@@ -1,14 +1,144 @@
 #include "SocketAddress.hpp"
-#include <cstdio>
 #include "HostInfo.hpp"
 #include "netlib.hpp"
 
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
 
 namespace netlib
 {
 	IPv4Address const IPv4Address::kAny = IPv4Address(0,0,0,0);
 
+	constexpr std::size_t IPv4Address::kMaxChars;
+	constexpr std::size_t IPv6Address::kMaxChars;
+	constexpr std::size_t IPv4SocketAddress::kMaxChars;
+	constexpr std::size_t IPv6SocketAddress::kMaxChars;
+	constexpr std::size_t SocketAddress::kMaxChars;
+
+	namespace
+	{
+		/** Parses a decimal number without leading zeros.
+		@param[in,out] p:
+			The current position, advanced past the number.
+		@param[in] end:
+			The end of the input.
+		@param[in] max_digits:
+			The maximum number of digits.
+		@param[out] out:
+			The parsed number.
+		@return
+			Whether a number was parsed. */
+		bool parse_decimal(
+			char const *&p,
+			char const * end,
+			std::size_t max_digits,
+			std::uint32_t &out)
+		{
+			char const * const start = p;
+			std::uint64_t value = 0;
+			while(p != end
+			&& std::size_t(p - start) < max_digits
+			&& unsigned(*p - '0') < 10)
+				value = value * 10 + unsigned(*p++ - '0');
+
+			if(p == start
+			|| (p - start > 1 && *start == '0')
+			|| value > 0xffffffff)
+				return false;
+
+			out = std::uint32_t(value);
+			return true;
+		}
+
+		/** Parses a port number.
+		@return
+			Whether the whole range was a valid port. */
+		bool parse_port(
+			char const * begin,
+			char const * end,
+			port_t &out)
+		{
+			std::uint32_t value;
+			if(!parse_decimal(begin, end, 5, value)
+			|| begin != end
+			|| value > 0xffff)
+				return false;
+
+			out = port_t(value);
+			return true;
+		}
+
+		/** The value of a hexadecimal digit, or -1. */
+		inline int hex_digit(
+			char c)
+		{
+			if(unsigned(c - '0') < 10)
+				return c - '0';
+			c |= 0x20;
+			if(unsigned(c - 'a') < 6)
+				return c - 'a' + 10;
+			return -1;
+		}
+
+		/** Writes a decimal number. */
+		char * write_decimal(
+			char * out,
+			std::uint32_t value)
+		{
+			char digits[10];
+			std::size_t count = 0;
+			do {
+				digits[count++] = char('0' + value % 10);
+				value /= 10;
+			} while(value);
+
+			while(count)
+				*out++ = digits[--count];
+			return out;
+		}
+
+		/** Writes a hexadecimal number in lowercase, without leading zeros. */
+		char * write_hex(
+			char * out,
+			std::uint16_t value)
+		{
+			static char const kDigits[] = "0123456789abcdef";
+			int shift = 12;
+			while(shift && !(value >> shift))
+				shift -= 4;
+			for(; shift >= 0; shift -= 4)
+				*out++ = kDigits[(value >> shift) & 0xf];
+			return out;
+		}
+
+		/** Copies formatted characters into the output buffer, if they fit. */
+		char * copy_chars(
+			char const * begin,
+			char const * end,
+			char * first,
+			char * last)
+		{
+			std::size_t size = end - begin;
+			if(std::size_t(last - first) < size)
+				return nullptr;
+			std::memcpy(first, begin, size);
+			return first + size;
+		}
+
+		/** Finds the last occurrence of a character. */
+		char const * find_last(
+			char const * begin,
+			char const * end,
+			char c)
+		{
+			while(end != begin)
+				if(*--end == c)
+					return end;
+			return nullptr;
+		}
+	}
 
 	IPv4Address::IPv4Address(char const * data)
 	{
@@ -17,31 +147,193 @@ namespace netlib
 
 	bool IPv4Address::parse(char const * data, IPv4Address &out)
 	{
-		unsigned u0, u1, u2, u3;
-		if(std::sscanf(data, "%u.%u.%u.%u", &u0, &u1, &u2, &u3) == 4
-			&& (((u0|u1|u2|u3) & ~0xff) == 0))
+		return parse(data, data + std::strlen(data), out);
+	}
+
+	bool IPv4Address::parse(
+		char const * begin,
+		char const * end,
+		IPv4Address &out)
+	{
+		ubyte_t fields[4];
+		for(std::size_t i = 0; i < 4; i++)
 		{
-			out = IPv4Address(u0, u1, u2, u3);
-			return true;
+			if(i && (begin == end || *begin++ != '.'))
+				return false;
+
+			std::uint32_t value;
+			if(!parse_decimal(begin, end, 3, value) || value > 0xff)
+				return false;
+			fields[i] = ubyte_t(value);
 		}
-		else
+
+		if(begin != end)
 			return false;
+
+		out = IPv4Address(fields[0], fields[1], fields[2], fields[3]);
+		return true;
+	}
+
+	char * IPv4Address::to_chars(
+		char * first,
+		char * last) const
+	{
+		char buffer[kMaxChars];
+		char * p = write_decimal(buffer, d0);
+		*p++ = '.';
+		p = write_decimal(p, d1);
+		*p++ = '.';
+		p = write_decimal(p, d2);
+		*p++ = '.';
+		p = write_decimal(p, d3);
+		return copy_chars(buffer, p, first, last);
 	}
 
 	IPv6Address::IPv6Address(char const * data) { parse(data, *this); }
 
 	bool IPv6Address::parse(char const * data, IPv6Address &out)
 	{
-		unsigned u0, u1, u2, u3, u4, u5, u6, u7;
-		if((std::sscanf(data, "%x:%x:%x:%x:%x:%x:%x:%x",
-			&u0, &u1, &u2, &u3, &u4, &u5, &u6, &u7) == 8) &&
-			(((u0|u1|u2|u3|u4|u5|u6|u7) & ~0xffff) == 0))
+		return parse(data, data + std::strlen(data), out);
+	}
+
+	bool IPv6Address::parse(
+		char const * begin,
+		char const * end,
+		IPv6Address &out)
+	{
+		std::uint16_t fields[8];
+		std::size_t count = 0;
+		// Whether there is a `::`, and the number of fields before it.
+		bool compressed = false;
+		std::size_t gap = 0;
+
+		char const * p = begin;
+		if(p != end && *p == ':')
 		{
-			out = IPv6Address(u0, u1, u2, u3, u4, u5, u6, u7);
-			return true;
+			if(end - p < 2 || p[1] != ':')
+				return false;
+			p += 2;
+			compressed = true;
 		}
-		else
+
+		while(p != end)
+		{
+			if(count == 8)
+				return false;
+
+			char const * const start = p;
+			std::uint32_t value = 0;
+			int digit;
+			while(p != end && p - start < 4 && (digit = hex_digit(*p)) >= 0)
+			{
+				value = (value << 4) | unsigned(digit);
+				++p;
+			}
+
+			if(p == start)
+				return false;
+
+			// Embedded IPv4 address in the last two fields.
+			if(p != end && *p == '.')
+			{
+				IPv4Address ipv4;
+				if(count > 6 || !IPv4Address::parse(start, end, ipv4))
+					return false;
+				fields[count++] = std::uint16_t((ipv4.d0 << 8) | ipv4.d1);
+				fields[count++] = std::uint16_t((ipv4.d2 << 8) | ipv4.d3);
+				p = end;
+				break;
+			}
+
+			fields[count++] = std::uint16_t(value);
+
+			if(p == end)
+				break;
+			if(*p++ != ':' || p == end)
+				return false;
+			if(*p == ':')
+			{
+				if(compressed)
+					return false;
+				compressed = true;
+				gap = count;
+				++p;
+			}
+		}
+
+		// A `::` stands for at least one zero field.
+		if(compressed ? count > 7 : count != 8)
 			return false;
+
+		// Move the fields after the `::` to the end, and zero the gap.
+		std::size_t const tail = compressed ? count - gap : 0;
+		std::uint16_t result[8] = {};
+		for(std::size_t i = 0; i < count - tail; i++)
+			result[i] = fields[i];
+		for(std::size_t i = 0; i < tail; i++)
+			result[8 - tail + i] = fields[count - tail + i];
+
+		out = IPv6Address(
+			result[0], result[1], result[2], result[3],
+			result[4], result[5], result[6], result[7]);
+		return true;
+	}
+
+	char * IPv6Address::to_chars(
+		char * first,
+		char * last) const
+	{
+		std::uint16_t const fields[8] = { d0, d1, d2, d3, d4, d5, d6, d7 };
+
+		char buffer[kMaxChars];
+		char * p = buffer;
+
+		// IPv4-mapped addresses (::ffff:d0.d1.d2.d3).
+		if(!(d0 | d1 | d2 | d3 | d4) && d5 == 0xffff)
+		{
+			std::memcpy(p, "::ffff:", 7);
+			p += 7;
+			p = IPv4Address(d6 >> 8, d6 & 0xff, d7 >> 8, d7 & 0xff).to_chars(
+				p,
+				buffer + kMaxChars);
+			return copy_chars(buffer, p, first, last);
+		}
+
+		// Find the longest run of at least two zero fields.
+		std::size_t best = 8, best_length = 1;
+		for(std::size_t i = 0; i < 8;)
+		{
+			if(fields[i])
+			{
+				++i;
+				continue;
+			}
+			std::size_t j = i;
+			while(j < 8 && !fields[j])
+				++j;
+			if(j - i > best_length)
+			{
+				best = i;
+				best_length = j - i;
+			}
+			i = j;
+		}
+
+		for(std::size_t i = 0; i < 8; i++)
+		{
+			if(i == best)
+			{
+				*p++ = ':';
+				*p++ = ':';
+				i += best_length - 1;
+				continue;
+			}
+			if(i && i != best + best_length)
+				*p++ = ':';
+			p = write_hex(p, fields[i]);
+		}
+
+		return copy_chars(buffer, p, first, last);
 	}
 
 	IPv4SocketAddress::IPv4SocketAddress(char const * addr)
@@ -51,19 +343,92 @@ namespace netlib
 
 	bool IPv4SocketAddress::parse(char const * data, IPv4SocketAddress &out)
 	{
-		unsigned int d0, d1, d2, d3, port;
-		if((sscanf(data, "%u.%u.%u.%u:%u", &d0, &d1, &d2, &d3, &port)==5)
-			&&(((d0|d1|d2|d3) & ~0xff) == 0) && ((port & ~0xffff) == 0))
+		return parse(data, data + std::strlen(data), out);
+	}
+
+	bool IPv4SocketAddress::parse(
+		char const * begin,
+		char const * end,
+		IPv4SocketAddress &out)
+	{
+		char const * colon = find_last(begin, end, ':');
+		IPv4SocketAddress result;
+		if(!colon
+		|| !IPv4Address::parse(begin, colon, result.address)
+		|| !parse_port(colon + 1, end, result.port))
+			return false;
+
+		out = result;
+		return true;
+	}
+
+	char * IPv4SocketAddress::to_chars(
+		char * first,
+		char * last) const
+	{
+		char buffer[kMaxChars];
+		char * p = address.to_chars(buffer, buffer + kMaxChars);
+		*p++ = ':';
+		p = write_decimal(p, port);
+		return copy_chars(buffer, p, first, last);
+	}
+
+	bool IPv6SocketAddress::parse(char const * data, IPv6SocketAddress &out)
+	{
+		return parse(data, data + std::strlen(data), out);
+	}
+
+	bool IPv6SocketAddress::parse(
+		char const * begin,
+		char const * end,
+		IPv6SocketAddress &out)
+	{
+		if(begin == end || *begin != '[')
+			return false;
+
+		char const * const bracket = find_last(begin, end, ']');
+		if(!bracket || end - bracket < 2 || bracket[1] != ':')
+			return false;
+
+		IPv6SocketAddress result;
+		result.field = 0;
+		result.scope = 0;
+
+		char const * address_end = bracket;
+		if(char const * percent = find_last(begin + 1, bracket, '%'))
 		{
-			out.address.d0 = ubyte_t(d0);
-			out.address.d1 = ubyte_t(d1);
-			out.address.d2 = ubyte_t(d2);
-			out.address.d3 = ubyte_t(d3);
-			out.port = std::uint16_t(port);
-			return true;
+			char const * scope = percent + 1;
+			if(!parse_decimal(scope, bracket, 10, result.scope)
+			|| scope != bracket)
+				return false;
+			address_end = percent;
 		}
-		else
+
+		if(!IPv6Address::parse(begin + 1, address_end, result.address)
+		|| !parse_port(bracket + 2, end, result.port))
 			return false;
+
+		out = result;
+		return true;
+	}
+
+	char * IPv6SocketAddress::to_chars(
+		char * first,
+		char * last) const
+	{
+		char buffer[kMaxChars];
+		char * p = buffer;
+		*p++ = '[';
+		p = address.to_chars(p, buffer + kMaxChars);
+		if(scope)
+		{
+			*p++ = '%';
+			p = write_decimal(p, scope);
+		}
+		*p++ = ']';
+		*p++ = ':';
+		p = write_decimal(p, port);
+		return copy_chars(buffer, p, first, last);
 	}
 
 	bool IPv6SocketAddress::operator==(IPv6SocketAddress const& other) const
@@ -82,6 +447,50 @@ namespace netlib
 			|| scope != other.scope;
 	}
 
+	bool UnixSocketAddress::from_path(
+		char const * path,
+		UnixSocketAddress &out)
+	{
+		assert(path != nullptr);
+
+		std::size_t length = std::strlen(path);
+		if(!length || length > kMaxPath)
+			return false;
+
+		std::memcpy(out.path, path, length + 1);
+		out.length = length;
+		return true;
+	}
+
+	bool UnixSocketAddress::from_abstract(
+		void const * name,
+		std::size_t size,
+		UnixSocketAddress &out)
+	{
+		assert(name != nullptr || !size);
+
+		// Reserve one byte for the leading null byte.
+		if(size >= kMaxPath)
+			return false;
+
+		out.path[0] = '\0';
+		std::memcpy(out.path + 1, name, size);
+		out.path[size + 1] = '\0';
+		out.length = size + 1;
+		return true;
+	}
+
+	bool UnixSocketAddress::operator==(UnixSocketAddress const& other) const
+	{
+		return length == other.length
+			&& !std::memcmp(path, other.path, length);
+	}
+
+	bool UnixSocketAddress::operator!=(UnixSocketAddress const& other) const
+	{
+		return !(*this == other);
+	}
+
 	SocketAddress::SocketAddress(AddressFamily family):
 		family(family) { }
 	SocketAddress::SocketAddress(IPv4SocketAddress const& ipv4):
@@ -94,45 +503,73 @@ namespace netlib
 	{
 		address.ipv6 = ipv6;
 	}
+	SocketAddress::SocketAddress(UnixSocketAddress const& local):
+		family(AddressFamily::kUnix)
+	{
+		address.local = local;
+	}
 	SocketAddress::SocketAddress(const char * str)
 	{
 		parse(str, *this);
 	}
 	bool SocketAddress::parse(const char * str, SocketAddress &out)
+	{
+		return parse(str, str + std::strlen(str), out);
+	}
+
+	bool SocketAddress::parse(
+		char const * begin,
+		char const * end,
+		SocketAddress &out)
 	{
 		SocketAddress sa;
-		if(IPv4SocketAddress::parse(str, sa.address.ipv4))
+		if(end - begin >= 5 && !std::memcmp(begin, "unix:", 5))
+		{
+			begin += 5;
+			UnixSocketAddress &local = sa.address.local;
+			std::size_t size = end - begin;
+			if(size && *begin == '@')
+			{
+				if(!UnixSocketAddress::from_abstract(begin + 1, size - 1, local))
+					return false;
+			} else
+			{
+				if(!size || size > UnixSocketAddress::kMaxPath)
+					return false;
+				std::memcpy(local.path, begin, size);
+				local.path[size] = '\0';
+				local.length = size;
+			}
+
+			out = local;
+			return true;
+		}
+		else if(IPv4SocketAddress::parse(begin, end, sa.address.ipv4))
 		{
 			out = sa.address.ipv4;
 			return true;
 		}
-#ifndef NETLIB_IPV6_WIP
-		else if(IPv6SocketAddress::parse(str, sa.address.ipv6))
+		else if(IPv6SocketAddress::parse(begin, end, sa.address.ipv6))
 		{
 			out = sa.address.ipv6;
 			return true;
 		}
-#endif
 		else
 		{
-			std::string _str(str);
-			unsigned l = _str.length();
-
-			unsigned last_colon;
-			for(last_colon = l; last_colon--;)
-				if(str[last_colon] == ':')
-					break;
-
-			if(!last_colon || last_colon == l-1)
-				return false;
-
-			port_t port = atoi(&str[last_colon+1]);
-			if(port & ~0xffff != 0)
+			// Host names are at most 253 characters long.
+			char name[256];
+			char const * colon = find_last(begin, end, ':');
+			port_t port;
+			if(!colon
+			|| colon == begin
+			|| std::size_t(colon - begin) >= sizeof(name)
+			|| !parse_port(colon + 1, end, port))
 				return false;
 
-			_str[last_colon] = '\0';
+			std::memcpy(name, begin, colon - begin);
+			name[colon - begin] = '\0';
 
-			std::vector<AddressInfo> info = resolve_name(_str.c_str());
+			std::vector<AddressInfo> info = resolve_name(name);
 
 			if(!info.empty())
 			{
@@ -152,12 +589,49 @@ namespace netlib
 						assert(!"Address family not supported.");
 					} break;
 				}
+				return true;
 			}
 			else
 				return false;
 		}
 	}
 
+	char * SocketAddress::to_chars(
+		char * first,
+		char * last) const
+	{
+		switch(family)
+		{
+		case AddressFamily::kIPv4:
+			return address.ipv4.to_chars(first, last);
+		case AddressFamily::kIPv6:
+			return address.ipv6.to_chars(first, last);
+		case AddressFamily::kUnix:
+			{
+				UnixSocketAddress const& local = address.local;
+				char buffer[kMaxChars];
+				std::memcpy(buffer, "unix:", 5);
+				char * p = buffer + 5;
+				if(local.abstract())
+				{
+					*p++ = '@';
+					std::memcpy(p, local.path + 1, local.length - 1);
+					p += local.length - 1;
+				} else
+				{
+					std::memcpy(p, local.path, local.length);
+					p += local.length;
+				}
+				return copy_chars(buffer, p, first, last);
+			}
+		default:
+			{
+				assert(!"Address family not supported.");
+				return nullptr;
+			}
+		}
+	}
+
 
 	bool SocketAddress::operator==(SocketAddress const& other) const
 	{
@@ -169,6 +643,9 @@ namespace netlib
 		} else if(family == AddressFamily::kIPv6)
 		{
 			return address.ipv6 == other.address.ipv6;
+		} else if(family == AddressFamily::kUnix)
+		{
+			return address.local == other.address.local;
 		} else
 		{
 			assert(!"Address family not supported.");
@@ -180,4 +657,78 @@ namespace netlib
 		return !(*this == other);
 	}
 
+	bool SocketAddress::operator<(SocketAddress const& other) const
+	{
+		if(family != other.family)
+			return family < other.family;
+
+		if(family == AddressFamily::kUnix)
+		{
+			UnixSocketAddress const& a = address.local;
+			UnixSocketAddress const& b = other.address.local;
+			int order = std::memcmp(a.path, b.path, std::min(a.length, b.length));
+			return order ? order < 0 : a.length < b.length;
+		}
+
+		AddressKey a, b;
+		bool valid = AddressKey::from_address(*this, a)
+			&& AddressKey::from_address(other, b);
+		assert(valid && "Address family not supported.");
+		(void) valid;
+		return a < b;
+	}
+
+	bool AddressKey::from_address(
+		SocketAddress const& address,
+		AddressKey &out)
+	{
+		switch(address.family)
+		{
+		case AddressFamily::kIPv4:
+			{
+				out = AddressKey(address.address.ipv4);
+				return true;
+			}
+		case AddressFamily::kIPv6:
+			{
+				out = AddressKey(address.address.ipv6);
+				return true;
+			}
+		default:
+			return false;
+		}
+	}
+
+	SocketAddress AddressKey::to_address() const
+	{
+		if(family == std::uint8_t(AddressFamily::kIPv4))
+			return IPv4SocketAddress(
+				IPv4Address(low >> 24, low >> 16, low >> 8, low),
+				port);
+
+		assert(family == std::uint8_t(AddressFamily::kIPv6));
+		IPv6SocketAddress ipv6;
+		ipv6.address = IPv6Address(
+			high >> 48, high >> 32, high >> 16, high,
+			low >> 48, low >> 32, low >> 16, low);
+		ipv6.field = 0;
+		ipv6.scope = scope;
+		ipv6.port = port;
+		return ipv6;
+	}
+}
+
+namespace std
+{
+	std::size_t hash<::netlib::SocketAddress>::operator()(
+		::netlib::SocketAddress const& address) const
+	{
+		::netlib::AddressKey key;
+		if(::netlib::AddressKey::from_address(address, key))
+			return std::size_t(key.hash());
+
+		::netlib::UnixSocketAddress const& local = address.address.local;
+		return std::hash<std::string_view>()(
+			std::string_view(local.path, local.length));
+	}
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "defines.hpp"
 #include "AddressFamily.hpp"
 #include <cstdint>
+#include <cstddef>
+#include <functional>
 
 namespace netlib
 {
@@ -26,6 +28,9 @@ namespace netlib
 			ubyte_t d2,
 			ubyte_t d3);
 
+		/** The maximum length of a formatted address. */
+		static constexpr std::size_t kMaxChars = 15;
+
 		/** format: d0.d1.d2.d3*/
 		IPv4Address(
 			char const * data);
@@ -34,6 +39,32 @@ namespace netlib
 		static bool parse(
 			char const * data,
 			IPv4Address &out);
+		/** Parses an address in dotted decimal notation.
+			Leading zeros are rejected, as they are ambiguous (octal).
+		@param[in] begin:
+			The beginning of the address string.
+		@param[in] end:
+			The end of the address string.
+		@param[out] out:
+			The parsed result.
+		@return
+			Whether the whole range was a valid address. */
+		static bool parse(
+			char const * begin,
+			char const * end,
+			IPv4Address &out);
+
+		/** Formats the address in dotted decimal notation.
+			Does not write a null-terminator.
+		@param[in] first:
+			The beginning of the output buffer.
+		@param[in] last:
+			The end of the output buffer.
+		@return
+			The end of the written characters, or null if the buffer was too small. */
+		char * to_chars(
+			char * first,
+			char * last) const;
 
 		/** The 'any' ip address. */
 		static IPv4Address const kAny;
@@ -63,18 +94,21 @@ namespace netlib
 			std::uint16_t d5,
 			std::uint16_t d6,
 			std::uint16_t d7);
+		/** The maximum length of a formatted address. */
+		static constexpr std::size_t kMaxChars = 45;
+
 		/** Parses an ipv6 address.
 			Does not throw on failure, so it is not as safe as ```parse()```.
 		@param[in] data:
 			The address.
-			Format: d0:d1:d2:d3:d4:d5:d6:d7 */
+			Format: see ```parse()```. */
 		IPv6Address(
 			char const * data);
 
 		/** Parses an ipv6 address.
 		@param[in] data:
 			The address.
-			Format: d0:d1:d2:d3:d4:d5:d6:d7
+			Format: d0:d1:d2:d3:d4:d5:d6:d7, as described in RFC 4291. A run of zero fields may be compressed to `::`, and the last two fields may be written as an embedded IPv4 address (`::ffff:1.2.3.4`).
 		@param[out] out:
 			The parsed result.
 		@return
@@ -82,6 +116,32 @@ namespace netlib
 		static bool parse(
 			char const * data,
 			IPv6Address &out);
+		/** Parses an ipv6 address.
+			Accepts the same format as ```parse(char const *, IPv6Address &)```.
+		@param[in] begin:
+			The beginning of the address string.
+		@param[in] end:
+			The end of the address string.
+		@param[out] out:
+			The parsed result.
+		@return
+			Whether the whole range was a valid address. */
+		static bool parse(
+			char const * begin,
+			char const * end,
+			IPv6Address &out);
+
+		/** Formats the address in the canonical form of RFC 5952.
+			Fields are written in lowercase without leading zeros, the longest run of zero fields is compressed to `::`, and IPv4-mapped addresses are written with an embedded IPv4 address. Does not write a null-terminator.
+		@param[in] first:
+			The beginning of the output buffer.
+		@param[in] last:
+			The end of the output buffer.
+		@return
+			The end of the written characters, or null if the buffer was too small. */
+		char * to_chars(
+			char * first,
+			char * last) const;
 
 		/** Tests for equality of two IP addresses. */
 		constexpr bool operator==(IPv6Address const& other) const;
@@ -102,6 +162,9 @@ namespace netlib
 		constexpr IPv4SocketAddress(
 			IPv4Address const& address,
 			port_t port);
+		/** The maximum length of a formatted address. */
+		static constexpr std::size_t kMaxChars = IPv4Address::kMaxChars + 6;
+
 		/*format: ipv4:port (%u.%u.%u.%u:%u)
 		ex.: "127.0.0.1:80"*/
 		IPv4SocketAddress(char const * data);
@@ -109,6 +172,21 @@ namespace netlib
 		static bool parse(
 			char const * data,
 			IPv4SocketAddress &out);
+		/** Parses an address of the form `d0.d1.d2.d3:port`.
+		@return
+			Whether the whole range was a valid address. */
+		static bool parse(
+			char const * begin,
+			char const * end,
+			IPv4SocketAddress &out);
+
+		/** Formats the address as `d0.d1.d2.d3:port`.
+			Does not write a null-terminator.
+		@return
+			The end of the written characters, or null if the buffer was too small. */
+		char * to_chars(
+			char * first,
+			char * last) const;
 
 		constexpr bool operator==(IPv4SocketAddress const& other) const;
 		constexpr bool operator!=(IPv4SocketAddress const& other) const;
@@ -122,11 +200,86 @@ namespace netlib
 		std::uint32_t scope;
 		port_t port;
 
+		/** The maximum length of a formatted address. */
+		static constexpr std::size_t kMaxChars = IPv6Address::kMaxChars + 18;
+
+		/** Parses an address of the form `[address]:port` or `[address%scope]:port`.
+			The scope must be a numeric interface index. The flow information is set to 0.
+		@return
+			Whether the string was a valid address. */
+		static bool parse(
+			char const * data,
+			IPv6SocketAddress &out);
+		/** Parses an address of the form `[address]:port` or `[address%scope]:port`.
+		@return
+			Whether the whole range was a valid address. */
+		static bool parse(
+			char const * begin,
+			char const * end,
+			IPv6SocketAddress &out);
+
+		/** Formats the address as `[address]:port`, or `[address%scope]:port` if it has a scope.
+			Does not write a null-terminator.
+		@return
+			The end of the written characters, or null if the buffer was too small. */
+		char * to_chars(
+			char * first,
+			char * last) const;
+
 		bool operator==(IPv6SocketAddress const& other) const;
 		bool operator!=(IPv6SocketAddress const& other) const;
 	};
 
 
+	/** Unix domain socket address.
+		Holds either a file system path, or a name in the abstract namespace (Linux only). Abstract names start with a null byte and are not null-terminated, so `length` is always needed to interpret `path`. An address of length 0 is unnamed, as is the case for sockets created via `Socket::pair()`. */
+	struct UnixSocketAddress
+	{
+		/** The maximum length of a path or abstract name, in bytes. */
+		static constexpr std::size_t kMaxPath = 107;
+
+		/** The path or abstract name.
+			Paths are null-terminated, abstract names start with a null byte. */
+		char path[kMaxPath + 1];
+		/** The length of `path` in bytes, excluding the null-terminator. */
+		std::uint8_t length;
+
+		UnixSocketAddress() = default;
+
+		/** Creates a file system path address.
+		@param[in] path:
+			The null-terminated path of the socket file.
+		@param[out] out:
+			The created address.
+		@return
+			Whether the path was not too long. */
+		static bool from_path(
+			char const * path,
+			UnixSocketAddress &out);
+
+		/** Creates an address in the abstract namespace.
+		@param[in] name:
+			The name, without the leading null byte. May contain null bytes.
+		@param[in] size:
+			The name's length in bytes.
+		@param[out] out:
+			The created address.
+		@return
+			Whether the name was not too long. */
+		static bool from_abstract(
+			void const * name,
+			std::size_t size,
+			UnixSocketAddress &out);
+
+		/** Whether the address is in the abstract namespace. */
+		NETLIB_INL bool abstract() const;
+		/** Whether the address is unnamed. */
+		NETLIB_INL bool unnamed() const;
+
+		bool operator==(UnixSocketAddress const& other) const;
+		bool operator!=(UnixSocketAddress const& other) const;
+	};
+
 	/** Generic socket address. */
 	struct SocketAddress
 	{
@@ -134,22 +287,129 @@ namespace netlib
 		SocketAddress(AddressFamily family);
 		SocketAddress(IPv4SocketAddress const& address);
 		SocketAddress(IPv6SocketAddress const& address);
+		SocketAddress(UnixSocketAddress const& address);
 		SocketAddress(char const * str);
 
+		/** The maximum length of a formatted address. */
+		static constexpr std::size_t kMaxChars = 6 + UnixSocketAddress::kMaxPath;
+
+		/** Parses a socket address.
+			Accepts IPv4 socket addresses, IPv6 socket addresses in the form `[address]:port`, `host:port` pairs (which are resolved), and Unix domain socket addresses in the forms `unix:/path/to/socket` and `unix:@abstract-name`. */
+
 		static bool parse(
 			char const * str,
 			SocketAddress &out);
+		/** Parses a socket address.
+			Accepts the same formats as ```parse(char const *, SocketAddress &)```. Numeric addresses are parsed without allocating.
+		@return
+			Whether the whole range was a valid address. */
+		static bool parse(
+			char const * begin,
+			char const * end,
+			SocketAddress &out);
+
+		/** Formats the address in the format accepted by ```parse()```.
+			Unnamed Unix domain socket addresses are written as `unix:`. Does not write a null-terminator.
+		@return
+			The end of the written characters, or null if the buffer was too small. */
+		char * to_chars(
+			char * first,
+			char * last) const;
 
 		bool operator==(SocketAddress const& other) const;
 		bool operator!=(SocketAddress const& other) const;
+		/** Orders addresses by family, address, port, and scope. */
+		bool operator<(SocketAddress const& other) const;
 
 		AddressFamily family;
 		union
 		{
 			IPv4SocketAddress ipv4;
 			IPv6SocketAddress ipv6;
+			UnixSocketAddress local;
 		} address;
 	};
+
+	/** Canonical, compact form of an IP socket address, for use as a lookup key.
+		Unlike `SocketAddress`, a key has no padding or unused union bytes, so it can be hashed and compared as a whole. IPv4 addresses are stored as IPv4-mapped IPv6 addresses, but keep their address family, so an IPv4 address and its mapped IPv6 address are different keys. The IPv6 flow information is not part of the key, as it does not identify a peer. */
+	struct AddressKey
+	{
+		/** The upper 64 bits of the address, in host byte order. */
+		std::uint64_t high;
+		/** The lower 64 bits of the address, in host byte order. */
+		std::uint64_t low;
+		/** The IPv6 scope, 0 for IPv4. */
+		std::uint32_t scope;
+		/** The port. */
+		port_t port;
+		/** The address family. */
+		std::uint8_t family;
+		/** Always 0. */
+		std::uint8_t reserved;
+
+		AddressKey() = default;
+		/** Creates the key of an IPv4 socket address. */
+		constexpr AddressKey(
+			IPv4SocketAddress const& address);
+		/** Creates the key of an IPv6 socket address. */
+		constexpr AddressKey(
+			IPv6SocketAddress const& address);
+
+		/** Creates the key of a socket address.
+		@param[in] address:
+			The socket address.
+		@param[out] out:
+			The key.
+		@return
+			Whether the address is an IP address. Unix domain socket addresses have no key. */
+		static bool from_address(
+			SocketAddress const& address,
+			AddressKey &out);
+
+		/** Converts the key back into a socket address.
+			The flow information of IPv6 addresses is 0. */
+		SocketAddress to_address() const;
+
+		/** A well-distributed 64-bit hash of the key. */
+		NETLIB_INL std::uint64_t hash() const;
+
+		constexpr bool operator==(AddressKey const& other) const;
+		constexpr bool operator!=(AddressKey const& other) const;
+		/** Orders keys by family, address, port, and scope. */
+		constexpr bool operator<(AddressKey const& other) const;
+	};
+}
+
+namespace std
+{
+	template<>
+	struct hash<::netlib::AddressKey>
+	{
+		NETLIB_INL std::size_t operator()(
+			::netlib::AddressKey const& key) const;
+	};
+
+	template<>
+	struct hash<::netlib::IPv4SocketAddress>
+	{
+		NETLIB_INL std::size_t operator()(
+			::netlib::IPv4SocketAddress const& address) const;
+	};
+
+	/** Ignores the flow information, like `netlib::AddressKey`. */
+	template<>
+	struct hash<::netlib::IPv6SocketAddress>
+	{
+		NETLIB_INL std::size_t operator()(
+			::netlib::IPv6SocketAddress const& address) const;
+	};
+
+	template<>
+	struct hash<::netlib::SocketAddress>
+	{
+		std::size_t operator()(
+			::netlib::SocketAddress const& address) const;
+	};
 }
 
 #include "SocketAddress.inl"
@@ -74,10 +74,117 @@ namespace netlib
 
 	constexpr bool IPv6Address::operator!=(IPv6Address const& other) const
 	{
-		return ((reinterpret_cast<std::uint64_t const *>(this)[0]
-				^ reinterpret_cast<std::uint64_t const *>(&other)[0])
-			| (reinterpret_cast<std::uint64_t const *>(this)[1]
-				^ reinterpret_cast<std::uint64_t const *>(&other)[1]));
+		return ((d0 ^ other.d0) | (d1 ^ other.d1)
+			| (d2 ^ other.d2) | (d3 ^ other.d3)
+			| (d4 ^ other.d4) | (d5 ^ other.d5)
+			| (d6 ^ other.d6) | (d7 ^ other.d7));
+	}
+
+	bool UnixSocketAddress::abstract() const
+	{
+		return length && !path[0];
+	}
+
+	bool UnixSocketAddress::unnamed() const
+	{
+		return !length;
+	}
+
+	constexpr AddressKey::AddressKey(
+		IPv4SocketAddress const& address):
+		high(0),
+		low(0xffff00000000
+			| (std::uint64_t(address.address.d0) << 24)
+			| (std::uint64_t(address.address.d1) << 16)
+			| (std::uint64_t(address.address.d2) << 8)
+			| std::uint64_t(address.address.d3)),
+		scope(0),
+		port(address.port),
+		family(std::uint8_t(AddressFamily::kIPv4)),
+		reserved(0)
+	{
+	}
+
+	constexpr AddressKey::AddressKey(
+		IPv6SocketAddress const& address):
+		high((std::uint64_t(address.address.d0) << 48)
+			| (std::uint64_t(address.address.d1) << 32)
+			| (std::uint64_t(address.address.d2) << 16)
+			| std::uint64_t(address.address.d3)),
+		low((std::uint64_t(address.address.d4) << 48)
+			| (std::uint64_t(address.address.d5) << 32)
+			| (std::uint64_t(address.address.d6) << 16)
+			| std::uint64_t(address.address.d7)),
+		scope(address.scope),
+		port(address.port),
+		family(std::uint8_t(AddressFamily::kIPv6)),
+		reserved(0)
+	{
+	}
+
+	std::uint64_t AddressKey::hash() const
+	{
+		// Multiply-xorshift mixing, finalised like MurmurHash3's fmix64.
+		std::uint64_t h = high * 0x9e3779b97f4a7c15ull;
+		h ^= (low * 0xc2b2ae3d27d4eb4full) + (h >> 29);
+		h ^= ((std::uint64_t(scope) << 32)
+			| (std::uint64_t(port) << 8)
+			| family) * 0x165667b19e3779f9ull;
+
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	constexpr bool AddressKey::operator==(AddressKey const& other) const
+	{
+		return high == other.high
+			&& low == other.low
+			&& port == other.port
+			&& scope == other.scope
+			&& family == other.family;
+	}
+
+	constexpr bool AddressKey::operator!=(AddressKey const& other) const
+	{
+		return !(*this == other);
+	}
+
+	constexpr bool AddressKey::operator<(AddressKey const& other) const
+	{
+		if(family != other.family)
+			return family < other.family;
+		if(high != other.high)
+			return high < other.high;
+		if(low != other.low)
+			return low < other.low;
+		if(port != other.port)
+			return port < other.port;
+		return scope < other.scope;
+	}
+}
+
+namespace std
+{
+	std::size_t hash<::netlib::AddressKey>::operator()(
+		::netlib::AddressKey const& key) const
+	{
+		return std::size_t(key.hash());
+	}
+
+	std::size_t hash<::netlib::IPv4SocketAddress>::operator()(
+		::netlib::IPv4SocketAddress const& address) const
+	{
+		return std::size_t(::netlib::AddressKey(address).hash());
+	}
+
+	std::size_t hash<::netlib::IPv6SocketAddress>::operator()(
+		::netlib::IPv6SocketAddress const& address) const
+	{
+		return std::size_t(::netlib::AddressKey(address).hash());
 	}
 }
 
@@ -21,6 +21,22 @@
 #define NETLIB_COUNT(Enum) (static_cast<unsigned>(Enum::k_netlib_last_enum_value)+1)
 
 
+/** @def NETLIB_STAT(...)
+	Only compiles its argument if performance counters are enabled via `NETLIB_COUNTERS`. */
+#ifdef NETLIB_COUNTERS
+#define NETLIB_STAT(...) __VA_ARGS__
+#else
+#define NETLIB_STAT(...)
+#endif
+
+/** @def NETLIB_TIMED(...)
+	Only compiles its argument if latency histograms are enabled via `NETLIB_HISTOGRAMS`. */
+#ifdef NETLIB_HISTOGRAMS
+#define NETLIB_TIMED(...) __VA_ARGS__
+#else
+#define NETLIB_TIMED(...)
+#endif
+
 /** @def _countof(x)
 	Retrieves the element count of a C-style array. */
 #ifndef _countof
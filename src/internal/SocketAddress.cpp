@@ -3,13 +3,24 @@
 #include <cstdlib>
 #include <cstring>
 #include <cassert>
+#include <cstddef>
 
 namespace netlib
 {
 	void to_socket_address(
 		::sockaddr const& addr,
+		::socklen_t length,
 		SocketAddress &ret)
 	{
+		// Unnamed Unix domain sockets may report an empty address.
+		if(length < sizeof(addr.sa_family))
+		{
+			ret.family = AddressFamily::kUnix;
+			ret.address.local.path[0] = '\0';
+			ret.address.local.length = 0;
+			return;
+		}
+
 		ret.family = to_address_family(addr.sa_family);
 		switch(ret.family)
 		{
@@ -35,7 +46,34 @@ namespace netlib
 
 				for(size_t i = 8; i--;)
 					(&ret.address.ipv6.address.d0)[i] = TO_HOST_IPV6DATA(data[i]);
+
+				ret.address.ipv6.field = TO_HOST_FLOWINFO(in6.sin6_flowinfo);
+				ret.address.ipv6.scope = TO_HOST_SCOPEID(in6.sin6_scope_id);
+			} break;
+#ifndef NETLIB_WINDOWS
+		case AddressFamily::kUnix:
+			{
+				::sockaddr_un const& un =
+					reinterpret_cast<::sockaddr_un const&>(
+						addr);
+				UnixSocketAddress &local = ret.address.local;
+
+				std::size_t size = 0;
+				if(length > offsetof(::sockaddr_un, sun_path))
+					size = length - offsetof(::sockaddr_un, sun_path);
+				if(size > UnixSocketAddress::kMaxPath)
+					size = UnixSocketAddress::kMaxPath;
+
+				std::memcpy(local.path, un.sun_path, size);
+
+				// Paths may or may not include their null-terminator.
+				if(size && un.sun_path[0])
+					size = strnlen(local.path, size);
+
+				local.path[size] = '\0';
+				local.length = size;
 			} break;
+#endif
 		default:
 			{
 				std::cerr << "to_socket_address: Address family not supported: " << (int) ret.family << "\naborting.\n";
@@ -44,7 +82,7 @@ namespace netlib
 		};
 	}
 
-	void from_socket_address(
+	::socklen_t from_socket_address(
 		SocketAddress const& addr,
 		::sockaddr_storage &ret)
 	{
@@ -63,7 +101,9 @@ namespace netlib
 				sin.sin_port = TO_NET_PORT(ipv4.port);
 				// no need to cast, since the byte array is in the right order already.
 				sin.sin_addr.s_addr = reinterpret_cast<std::uint32_t const&>(ipv4.address);
-			} break;
+
+				return sizeof(::sockaddr_in);
+			}
 		case AddressFamily::kIPv6:
 			{
 				::sockaddr_in6 & sin6 = reinterpret_cast<::sockaddr_in6 &>(ret);
@@ -81,11 +121,31 @@ namespace netlib
 					words[i] = TO_NET_IPV6DATA((&ipv6.address.d0)[i]);
 
 				sin6.sin6_scope_id = TO_NET_SCOPEID(ipv6.scope);
-			} break;
+
+				return sizeof(::sockaddr_in6);
+			}
+#ifndef NETLIB_WINDOWS
+		case AddressFamily::kUnix:
+			{
+				::sockaddr_un & sun = reinterpret_cast<::sockaddr_un &>(ret);
+				UnixSocketAddress const& local = addr.address.local;
+
+				// Some platforms have shorter paths than Linux.
+				assert(local.length < sizeof(sun.sun_path));
+
+				std::memcpy(sun.sun_path, local.path, local.length);
+
+				// Abstract names must not include a null-terminator.
+				return offsetof(::sockaddr_un, sun_path)
+					+ local.length
+					+ !local.abstract();
+			}
+#endif
 		default:
 			{
 				assert(!"invalid address family");
-			} break;
+				return 0;
+			}
 		};
 	}
 }
\ No newline at end of file
@@ -6,13 +6,26 @@
 
 namespace netlib
 {
-	/** Converts a native socket address to a socket address. */
+	/** Converts a native socket address to a socket address.
+	@param[in] addr:
+		The native address.
+	@param[in] length:
+		The native address' size, in bytes. Only needed for Unix domain addresses.
+	@param[out] out:
+		The converted address. */
 	void to_socket_address(
 		::sockaddr const& addr,
+		::socklen_t length,
 		SocketAddress &out);
 
-	/** Converts a socket address to a native socket address. */
-	void from_socket_address(
+	/** Converts a socket address to a native socket address.
+	@param[in] addr:
+		The address to convert.
+	@param[out] out:
+		The native address.
+	@return
+		The size of the native address, to be passed to the socket functions. */
+	::socklen_t from_socket_address(
 		SocketAddress const& addr,
 		::sockaddr_storage &out);
 }
@@ -0,0 +1,140 @@
+/** @file AddressMap.hpp
+	Contains the netlib::util::AddressMap class, a flat hash map keyed by addresses. */
+#ifndef __netlib_util_addressmap_hpp_defined
+#define __netlib_util_addressmap_hpp_defined
+
+#include "../SocketAddress.hpp"
+
+#include <memory>
+#include <utility>
+#include <cstddef>
+
+namespace netlib::util
+{
+	/** Open-addressing hash map from `AddressKey` to `T`.
+		Entries are stored inline in a single array and found via linear probing, so inserting does not allocate unless the map grows, and lookups touch few cache lines. Erasing moves later entries of the same probe sequence back instead of leaving tombstones, so the map does not degrade under churn.
+
+		Pointers to values are invalidated by any insertion or erasure. */
+	template<class T>
+	class AddressMap
+	{
+		/** A slot of the table. */
+		struct Slot
+		{
+			/** The key, if the slot is used. */
+			AddressKey key;
+			/** Whether the slot holds an entry. */
+			bool used;
+			/** The value's storage, if the slot is used. */
+			alignas(T) unsigned char storage[sizeof(T)];
+
+			/** The stored value. */
+			inline T &value();
+		};
+
+		/** The table, of a power of two size. */
+		std::unique_ptr<Slot[]> m_slots;
+		/** The table size minus 1, or 0 if there is no table. */
+		std::size_t m_mask;
+		/** The number of entries. */
+		std::size_t m_size;
+
+		/** The number of slots in the table. */
+		inline std::size_t slots() const;
+		/** The slot a key is placed in if there are no collisions. */
+		inline std::size_t home(
+			AddressKey const& key) const;
+		/** Finds the slot of a key.
+		@return
+			The slot's index, or `slots()` if the key is not in the map. */
+		std::size_t locate(
+			AddressKey const& key) const;
+		/** Removes the entry in the given slot. */
+		void erase_at(
+			std::size_t index);
+		/** Moves all entries into a table of the given size. */
+		void rehash(
+			std::size_t slots);
+	public:
+		/** Creates an empty map. */
+		AddressMap();
+		/** Creates an empty map that can hold `capacity` entries without growing. */
+		explicit AddressMap(
+			std::size_t capacity);
+		AddressMap(AddressMap &&move);
+		AddressMap &operator=(AddressMap &&move);
+		AddressMap(AddressMap const&) = delete;
+		AddressMap &operator=(AddressMap const&) = delete;
+		~AddressMap();
+
+		/** The number of entries. */
+		inline std::size_t size() const;
+		/** Whether the map has no entries. */
+		inline bool empty() const;
+		/** How many entries the map can hold without growing. */
+		inline std::size_t capacity() const;
+
+		/** Makes sure the map can hold `capacity` entries without growing. */
+		void reserve(
+			std::size_t capacity);
+
+		/** Looks up a key.
+		@return
+			The key's value, or null if the key is not in the map. */
+		T * find(
+			AddressKey const& key);
+		/** Looks up a key.
+		@return
+			The key's value, or null if the key is not in the map. */
+		T const * find(
+			AddressKey const& key) const;
+
+		/** Inserts an entry, unless the key is already in the map.
+		@param[in] key:
+			The key.
+		@param[in] args:
+			The arguments to construct the value with.
+		@return
+			The key's value, and whether it was inserted. */
+		template<class ...Args>
+		std::pair<T *, bool> try_emplace(
+			AddressKey const& key,
+			Args &&... args);
+
+		/** Looks up a key, inserting a default constructed value if it is not in the map. */
+		T &operator[](
+			AddressKey const& key);
+
+		/** Removes a key.
+		@return
+			Whether the key was in the map. */
+		bool erase(
+			AddressKey const& key);
+
+		/** Removes all entries matching a predicate.
+			As entries are moved during erasure, the predicate may be called more than once for the same entry.
+		@param[in] predicate:
+			Called as `predicate(AddressKey const&, T&)`, returns whether to remove the entry.
+		@return
+			How many entries were removed. */
+		template<class Predicate>
+		std::size_t erase_if(
+			Predicate &&predicate);
+
+		/** Calls `function(AddressKey const&, T&)` for every entry. */
+		template<class Function>
+		void for_each(
+			Function &&function);
+		/** Calls `function(AddressKey const&, T const&)` for every entry. */
+		template<class Function>
+		void for_each(
+			Function &&function) const;
+
+		/** Removes all entries, keeping the table. */
+		void clear();
+	};
+}
+
+#include "AddressMap.inl"
+
+#endif
@@ -0,0 +1,289 @@
+#include <new>
+#include <cassert>
+
+namespace netlib::util
+{
+	template<class T>
+	T &AddressMap<T>::Slot::value()
+	{
+		return *std::launder(reinterpret_cast<T *>(storage));
+	}
+
+	template<class T>
+	std::size_t AddressMap<T>::slots() const
+	{
+		return m_slots ? m_mask + 1 : 0;
+	}
+
+	template<class T>
+	std::size_t AddressMap<T>::home(
+		AddressKey const& key) const
+	{
+		return std::size_t(key.hash()) & m_mask;
+	}
+
+	template<class T>
+	std::size_t AddressMap<T>::locate(
+		AddressKey const& key) const
+	{
+		if(!m_size)
+			return slots();
+
+		for(std::size_t i = home(key);; i = (i + 1) & m_mask)
+		{
+			Slot const& slot = m_slots[i];
+			if(!slot.used)
+				return slots();
+			if(slot.key == key)
+				return i;
+		}
+	}
+
+	template<class T>
+	void AddressMap<T>::erase_at(
+		std::size_t index)
+	{
+		assert(m_slots[index].used);
+		m_slots[index].value().~T();
+
+		// Move back later entries that would no longer be found.
+		for(std::size_t j = (index + 1) & m_mask;
+			m_slots[j].used;
+			j = (j + 1) & m_mask)
+		{
+			Slot &slot = m_slots[j];
+			std::size_t const distance = (j - home(slot.key)) & m_mask;
+			if(distance < ((j - index) & m_mask))
+				continue;
+
+			Slot &hole = m_slots[index];
+			hole.key = slot.key;
+			new (hole.storage) T(std::move(slot.value()));
+			slot.value().~T();
+			index = j;
+		}
+
+		m_slots[index].used = false;
+		--m_size;
+	}
+
+	template<class T>
+	void AddressMap<T>::rehash(
+		std::size_t slots)
+	{
+		assert(slots && !(slots & (slots - 1)));
+
+		std::unique_ptr<Slot[]> old(new Slot[slots]());
+		std::size_t const old_slots = this->slots();
+		m_slots.swap(old);
+		m_mask = slots - 1;
+
+		for(std::size_t i = 0; i < old_slots; i++)
+		{
+			Slot &slot = old[i];
+			if(!slot.used)
+				continue;
+
+			std::size_t j = home(slot.key);
+			while(m_slots[j].used)
+				j = (j + 1) & m_mask;
+
+			m_slots[j].key = slot.key;
+			m_slots[j].used = true;
+			new (m_slots[j].storage) T(std::move(slot.value()));
+			slot.value().~T();
+		}
+	}
+
+	template<class T>
+	AddressMap<T>::AddressMap():
+		m_slots(),
+		m_mask(0),
+		m_size(0)
+	{
+	}
+
+	template<class T>
+	AddressMap<T>::AddressMap(
+		std::size_t capacity):
+		AddressMap()
+	{
+		reserve(capacity);
+	}
+
+	template<class T>
+	AddressMap<T>::AddressMap(
+		AddressMap &&move):
+		m_slots(std::move(move.m_slots)),
+		m_mask(move.m_mask),
+		m_size(move.m_size)
+	{
+		move.m_mask = 0;
+		move.m_size = 0;
+	}
+
+	template<class T>
+	AddressMap<T> &AddressMap<T>::operator=(
+		AddressMap &&move)
+	{
+		if(this != &move)
+		{
+			clear();
+			m_slots = std::move(move.m_slots);
+			m_mask = move.m_mask;
+			m_size = move.m_size;
+			move.m_mask = 0;
+			move.m_size = 0;
+		}
+		return *this;
+	}
+
+	template<class T>
+	AddressMap<T>::~AddressMap()
+	{
+		clear();
+	}
+
+	template<class T>
+	std::size_t AddressMap<T>::size() const
+	{
+		return m_size;
+	}
+
+	template<class T>
+	bool AddressMap<T>::empty() const
+	{
+		return !m_size;
+	}
+
+	template<class T>
+	std::size_t AddressMap<T>::capacity() const
+	{
+		// Keep the load factor at or below 3/4.
+		return slots() / 4 * 3;
+	}
+
+	template<class T>
+	void AddressMap<T>::reserve(
+		std::size_t capacity)
+	{
+		if(capacity <= this->capacity())
+			return;
+
+		std::size_t slots = 8;
+		while(slots / 4 * 3 < capacity)
+			slots <<= 1;
+		rehash(slots);
+	}
+
+	template<class T>
+	T * AddressMap<T>::find(
+		AddressKey const& key)
+	{
+		std::size_t i = locate(key);
+		return i == slots() ? nullptr : &m_slots[i].value();
+	}
+
+	template<class T>
+	T const * AddressMap<T>::find(
+		AddressKey const& key) const
+	{
+		std::size_t i = locate(key);
+		return i == slots() ? nullptr : &m_slots[i].value();
+	}
+
+	template<class T>
+	template<class ...Args>
+	std::pair<T *, bool> AddressMap<T>::try_emplace(
+		AddressKey const& key,
+		Args &&... args)
+	{
+		if(m_size == capacity())
+			reserve(m_size + 1);
+
+		std::size_t i = home(key);
+		for(; m_slots[i].used; i = (i + 1) & m_mask)
+			if(m_slots[i].key == key)
+				return std::make_pair(&m_slots[i].value(), false);
+
+		Slot &slot = m_slots[i];
+		new (slot.storage) T(std::forward<Args>(args)...);
+		slot.key = key;
+		slot.used = true;
+		++m_size;
+		return std::make_pair(&slot.value(), true);
+	}
+
+	template<class T>
+	T &AddressMap<T>::operator[](
+		AddressKey const& key)
+	{
+		return *try_emplace(key).first;
+	}
+
+	template<class T>
+	bool AddressMap<T>::erase(
+		AddressKey const& key)
+	{
+		std::size_t i = locate(key);
+		if(i == slots())
+			return false;
+
+		erase_at(i);
+		return true;
+	}
+
+	template<class T>
+	template<class Predicate>
+	std::size_t AddressMap<T>::erase_if(
+		Predicate &&predicate)
+	{
+		std::size_t erased = 0;
+		for(std::size_t i = 0, n = slots(); i < n && m_size;)
+		{
+			Slot &slot = m_slots[i];
+			if(slot.used && predicate(static_cast<AddressKey const&>(slot.key), slot.value()))
+			{
+				// Check the entry that moved into this slot next.
+				erase_at(i);
+				++erased;
+			} else
+				++i;
+		}
+		return erased;
+	}
+
+	template<class T>
+	template<class Function>
+	void AddressMap<T>::for_each(
+		Function &&function)
+	{
+		for(std::size_t i = 0, n = slots(); i < n; i++)
+			if(m_slots[i].used)
+				function(static_cast<AddressKey const&>(m_slots[i].key), m_slots[i].value());
+	}
+
+	template<class T>
+	template<class Function>
+	void AddressMap<T>::for_each(
+		Function &&function) const
+	{
+		for(std::size_t i = 0, n = slots(); i < n; i++)
+			if(m_slots[i].used)
+				function(
+					static_cast<AddressKey const&>(m_slots[i].key),
+					static_cast<T const&>(m_slots[i].value()));
+	}
+
+	template<class T>
+	void AddressMap<T>::clear()
+	{
+		for(std::size_t i = 0, n = slots(); i < n && m_size; i++)
+			if(m_slots[i].used)
+			{
+				m_slots[i].value().~T();
+				m_slots[i].used = false;
+				--m_size;
+			}
+	}
+}
@@ -1,6 +1,7 @@
 #include "Buffer.hpp"
 
 #include <cstring>
+#include <algorithm>
 
 namespace netlib::util
 {
@@ -85,9 +86,9 @@ namespace netlib::util
 		return size;
 	}
 
-	std::size_t Buffer::consume(
+	std::size_t Buffer::peek(
 		void * data,
-		std::size_t size) noexcept
+		std::size_t size) const noexcept
 	{
 		if(size > m_size)
 			size = m_size;
@@ -108,6 +109,14 @@ namespace netlib::util
 				m_buffer.data(),
 				size - first);
 
+		return size;
+	}
+
+	std::size_t Buffer::consume(
+		void * data,
+		std::size_t size) noexcept
+	{
+		size = peek(data, size);
 		remove(size);
 
 		return size;
@@ -119,9 +128,21 @@ namespace netlib::util
 		m_size = 0;
 	}
 
+	void Buffer::linearize() noexcept
+	{
+		if(!wrapping())
+			return;
+
+		std::rotate(
+			m_buffer.begin(),
+			m_buffer.begin() + m_begin,
+			m_buffer.end());
+		m_begin = 0;
+	}
+
 	void * Buffer::end() noexcept
 	{
-		if(wrapping())
+		if(m_begin + m_size >= capacity())
 			return m_buffer.data() + (m_begin + m_size - capacity());
 		else
 			return m_buffer.data() + (m_begin + m_size);
@@ -129,7 +150,7 @@ namespace netlib::util
 
 	void const * Buffer::end() const noexcept
 	{
-		if(wrapping())
+		if(m_begin + m_size >= capacity())
 			return m_buffer.data() + (m_begin + m_size - capacity());
 		else
 			return m_buffer.data() + (m_begin + m_size);
@@ -45,6 +45,9 @@ namespace netlib::util
 		@return
 			If the buffer is wrapping around its edge, only the data size until the edge is returned. */
 		inline std::size_t continuous_data() const noexcept;
+		/** The part of the contents that wrapped around the buffer's edge.
+			It starts at the beginning of the buffer's memory, and holds `size() - continuous_data()` bytes. */
+		inline void const * wrapped_data() const noexcept;
 
 		/** Adds up to `size` bytes to the end of the buffer.
 			This method does not actually modify the buffer's contents.
@@ -74,6 +77,17 @@ namespace netlib::util
 		std::size_t remove(
 			std::size_t size) noexcept;
 
+		/** Copies up to `size` bytes from the beginning of the buffer, without removing them.
+		@param[out] data:
+			Where to copy the data to.
+		@param[in] size:
+			How many bytes to copy.
+		@return
+			How many bytes were actually copied. */
+		std::size_t peek(
+			void * data,
+			std::size_t size) const noexcept;
+
 		/** Copies and removes up to `size` bytes from the beginning of the buffer.
 		@param[out] data:
 			The data to copy from the buffer.
@@ -88,6 +102,10 @@ namespace netlib::util
 		/** Empties the buffer. */
 		void clear() noexcept;
 
+		/** Moves the contents to the beginning of the buffer's memory if they wrap around its edge, so that they are continuous.
+			This invalidates pointers into the buffer, and costs time proportional to the buffer's capacity. */
+		void linearize() noexcept;
+
 		/** The end of the buffer contents, and beginning of the free space. */
 		void * end() noexcept;
 		/** The end of the buffer contents, and beginning of the free space. */
@@ -39,11 +39,16 @@ namespace netlib::util
 	{
 		std::size_t to_edge = capacity() - m_begin;
 		if(m_size > to_edge)
-			return m_size - to_edge;
+			return to_edge;
 		else
 			return m_size;
 	}
 
+	void const * Buffer::wrapped_data() const noexcept
+	{
+		return m_buffer.data();
+	}
+
 	std::size_t Buffer::continuous_free_space() const noexcept
 	{
 		std::size_t end = m_begin + m_size;
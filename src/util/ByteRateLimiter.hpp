@@ -0,0 +1,57 @@
+/** @file ByteRateLimiter.hpp
+	Contains the netlib::util::ByteRateLimiter class used for limiting the bandwidth of byte streams. */
+#ifndef __netlib_util_byteratelimiter_hpp_defined
+#define __netlib_util_byteratelimiter_hpp_defined
+
+#include "TokenBucket.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace netlib::util
+{
+	/** Limits the rate of a byte stream with a token bucket.
+		At high rates, a token per byte would need an interval below the clock's resolution, and rounding it would distort the rate. Instead, a token stands for as many bytes as needed to keep the interval at 100ns or above, so that the achieved rate is within 1% of the requested rate. */
+	class ByteRateLimiter
+	{
+	public:
+		typedef TokenBucket::clock clock;
+	private:
+		/** The bucket. */
+		TokenBucket m_bucket;
+		/** The bucket's rate, in tokens. */
+		TokenBucket::Rate m_rate;
+		/** The number of bytes per token. */
+		std::size_t m_unit;
+	public:
+		/** Creates a limiter with a full bucket.
+		@param[in] bytes_per_second:
+			The sustained rate. Must be positive.
+		@param[in] burst:
+			How many bytes can be sent at once after being idle. Should be at least the size of a typical send. */
+		inline ByteRateLimiter(
+			double bytes_per_second,
+			std::size_t burst);
+
+		/** How many bytes may be sent now. */
+		inline std::size_t available(
+			clock::time_point now) const;
+		/** Accounts for sent bytes.
+		@param[in] bytes:
+			The number of sent bytes, at most `available(now)`.
+		@param[in] now:
+			The current time. */
+		inline void consume(
+			std::size_t bytes,
+			clock::time_point now);
+		/** How long until more bytes may be sent.
+		@return
+			Zero, if bytes may be sent now. */
+		inline clock::duration delay(
+			clock::time_point now) const;
+	};
+}
+
+#include "ByteRateLimiter.inl"
+
+#endif
@@ -0,0 +1,41 @@
+namespace netlib::util
+{
+	ByteRateLimiter::ByteRateLimiter(
+		double bytes_per_second,
+		std::size_t burst):
+		m_bucket(),
+		m_unit(1)
+	{
+		// Keep at least 100ns per token.
+		double const max_tokens_per_second = 1e7;
+		if(bytes_per_second > max_tokens_per_second)
+			m_unit = std::size_t(bytes_per_second / max_tokens_per_second + 0.5);
+
+		double tokens = double(burst / m_unit);
+		if(tokens < 1)
+			tokens = 1;
+		m_rate = TokenBucket::Rate::per_second(bytes_per_second / double(m_unit), tokens);
+	}
+
+	std::size_t ByteRateLimiter::available(
+		clock::time_point now) const
+	{
+		return std::size_t(m_bucket.available(m_rate, now)) * m_unit;
+	}
+
+	void ByteRateLimiter::consume(
+		std::size_t bytes,
+		clock::time_point now)
+	{
+		// Partial tokens are rounded up, so the rate is never exceeded.
+		std::size_t const tokens = (bytes + m_unit - 1) / m_unit;
+		if(tokens)
+			m_bucket.take(m_rate, now, unsigned(tokens));
+	}
+
+	ByteRateLimiter::clock::duration ByteRateLimiter::delay(
+		clock::time_point now) const
+	{
+		return m_bucket.delay(m_rate, now);
+	}
+}
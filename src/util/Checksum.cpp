@@ -0,0 +1,534 @@
+#include "Checksum.hpp"
+#include "Buffer.hpp"
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NETLIB_CHECKSUM_X86
+#include <immintrin.h>
+#endif
+
+namespace netlib::util
+{
+	namespace
+	{
+		/** The reflected CRC-32C polynomial. */
+		constexpr std::uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+		constexpr bool kLittleEndian = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+
+		/** Loads a little-endian 64-bit integer. */
+		inline std::uint64_t load64(
+			std::uint8_t const * data)
+		{
+			std::uint64_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return kLittleEndian ? value : __builtin_bswap64(value);
+		}
+
+		/** Loads a little-endian 32-bit integer. */
+		inline std::uint32_t load32(
+			std::uint8_t const * data)
+		{
+			std::uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return kLittleEndian ? value : __builtin_bswap32(value);
+		}
+
+		/** Tables for the slicing-by-8 CRC-32C implementation. */
+		struct Crc32cTables
+		{
+			std::uint32_t table[8][256];
+
+			Crc32cTables()
+			{
+				for(std::uint32_t n = 0; n < 256; n++)
+				{
+					std::uint32_t crc = n;
+					for(int k = 0; k < 8; k++)
+						crc = (crc >> 1) ^ (kCrc32cPolynomial & (0 - (crc & 1)));
+					table[0][n] = crc;
+				}
+
+				for(std::uint32_t n = 0; n < 256; n++)
+					for(int k = 1; k < 8; k++)
+						table[k][n] = (table[k-1][n] >> 8) ^ table[0][table[k-1][n] & 0xff];
+			}
+		};
+
+		Crc32cTables const& crc32c_tables()
+		{
+			static Crc32cTables const tables;
+			return tables;
+		}
+
+		/** Folds a one's complement sum to 16 bits. */
+		inline std::uint16_t fold(
+			std::uint64_t sum)
+		{
+			sum = (sum & 0xffffffff) + (sum >> 32);
+			sum = (sum & 0xffffffff) + (sum >> 32);
+			sum = (sum & 0xffff) + (sum >> 16);
+			sum = (sum & 0xffff) + (sum >> 16);
+			return std::uint16_t(sum);
+		}
+
+#ifdef NETLIB_CHECKSUM_X86
+		/** Operators that shift a CRC-32C over a fixed number of zero bytes, so that CRCs of independently computed consecutive blocks can be combined. */
+		struct Crc32cShift
+		{
+			std::uint32_t table[4][256];
+
+			/** Multiplies a GF(2) 32x32 matrix with a vector. */
+			static std::uint32_t times(
+				std::uint32_t const * matrix,
+				std::uint32_t vector)
+			{
+				std::uint32_t sum = 0;
+				for(; vector; vector >>= 1, matrix++)
+					if(vector & 1)
+						sum ^= *matrix;
+				return sum;
+			}
+
+			static void square(
+				std::uint32_t * out,
+				std::uint32_t const * matrix)
+			{
+				for(int n = 0; n < 32; n++)
+					out[n] = times(matrix, matrix[n]);
+			}
+
+			/** Creates the operator for `size` zero bytes. `size` must be a power of two. */
+			explicit Crc32cShift(
+				std::size_t size)
+			{
+				// The operator for a single zero bit.
+				std::uint32_t odd[32], even[32];
+				odd[0] = kCrc32cPolynomial;
+				for(int n = 1; n < 32; n++)
+					odd[n] = std::uint32_t(1) << (n - 1);
+
+				// Square up to the operator for a single zero byte, then once per further power of two.
+				square(even, odd);
+				square(odd, even);
+				square(even, odd);
+				for(; size > 1; size >>= 1)
+				{
+					square(odd, even);
+					std::memcpy(even, odd, sizeof(even));
+				}
+
+				for(std::uint32_t n = 0; n < 256; n++)
+					for(int k = 0; k < 4; k++)
+						table[k][n] = times(even, n << (8 * k));
+			}
+
+			/** Shifts a CRC over the operator's number of zero bytes. */
+			std::uint32_t operator()(
+				std::uint32_t crc) const
+			{
+				return table[0][crc & 0xff]
+					^ table[1][(crc >> 8) & 0xff]
+					^ table[2][(crc >> 16) & 0xff]
+					^ table[3][crc >> 24];
+			}
+		};
+
+		/** The block sizes of the three-way interleaved CRC computation. */
+		constexpr std::size_t kLongBlock = 8192;
+		constexpr std::size_t kShortBlock = 256;
+
+		/** Computes a CRC over three consecutive blocks at once, to hide the CRC instruction's latency. */
+		__attribute__((target("sse4.2")))
+		inline std::uint64_t crc32c_blocks(
+			std::uint64_t crc,
+			std::uint8_t const * &data,
+			std::size_t &size,
+			std::size_t block,
+			Crc32cShift const& shift)
+		{
+			while(size >= 3 * block)
+			{
+				std::uint64_t crc1 = 0, crc2 = 0;
+				for(std::uint8_t const * end = data + block; data < end; data += 8)
+				{
+					std::uint64_t word0, word1, word2;
+					std::memcpy(&word0, data, 8);
+					std::memcpy(&word1, data + block, 8);
+					std::memcpy(&word2, data + 2 * block, 8);
+					crc = _mm_crc32_u64(crc, word0);
+					crc1 = _mm_crc32_u64(crc1, word1);
+					crc2 = _mm_crc32_u64(crc2, word2);
+				}
+				crc = shift(std::uint32_t(crc)) ^ crc1;
+				crc = shift(std::uint32_t(crc)) ^ crc2;
+				data += 2 * block;
+				size -= 3 * block;
+			}
+			return crc;
+		}
+
+		__attribute__((target("sse4.2")))
+		std::uint32_t crc32c_sse42(
+			void const * data,
+			std::size_t size,
+			std::uint32_t crc)
+		{
+			static Crc32cShift const long_shift(kLongBlock), short_shift(kShortBlock);
+
+			std::uint8_t const * bytes = static_cast<std::uint8_t const *>(data);
+			std::uint64_t state = ~crc;
+
+			for(; size && (reinterpret_cast<std::uintptr_t>(bytes) & 7); size--)
+				state = _mm_crc32_u8(std::uint32_t(state), *bytes++);
+
+			state = crc32c_blocks(state, bytes, size, kLongBlock, long_shift);
+			state = crc32c_blocks(state, bytes, size, kShortBlock, short_shift);
+
+			for(; size >= 8; size -= 8, bytes += 8)
+			{
+				std::uint64_t word;
+				std::memcpy(&word, bytes, 8);
+				state = _mm_crc32_u64(state, word);
+			}
+			for(; size; size--)
+				state = _mm_crc32_u8(std::uint32_t(state), *bytes++);
+
+			return ~std::uint32_t(state);
+		}
+
+		__attribute__((target("avx2")))
+		std::uint64_t ones_sum_avx2(
+			void const * data,
+			std::size_t size,
+			std::uint64_t sum)
+		{
+			// Every 32-bit lane receives two 16-bit words per vector, so 8192 vectors cannot overflow it.
+			constexpr std::size_t kMaxVectors = 8192;
+
+			std::uint8_t const * bytes = static_cast<std::uint8_t const *>(data);
+			__m256i const zero = _mm256_setzero_si256();
+			while(size >= 32)
+			{
+				std::size_t vectors = size / 32;
+				if(vectors > kMaxVectors)
+					vectors = kMaxVectors;
+				size -= 32 * vectors;
+
+				__m256i accumulator = zero;
+				for(; vectors--; bytes += 32)
+				{
+					__m256i const words = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(bytes));
+					accumulator = _mm256_add_epi32(accumulator, _mm256_unpacklo_epi16(words, zero));
+					accumulator = _mm256_add_epi32(accumulator, _mm256_unpackhi_epi16(words, zero));
+				}
+
+				__m256i const wide = _mm256_add_epi64(
+					_mm256_unpacklo_epi32(accumulator, zero),
+					_mm256_unpackhi_epi32(accumulator, zero));
+				std::uint64_t lanes[4];
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), wide);
+				sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+			}
+
+			return detail::ones_sum_portable(bytes, size, sum);
+		}
+#endif
+
+		typedef std::uint32_t (*Crc32cFunction)(void const *, std::size_t, std::uint32_t);
+		typedef std::uint64_t (*OnesSumFunction)(void const *, std::size_t, std::uint64_t);
+
+		/** Selects the fastest CRC-32C implementation the processor supports. */
+		Crc32cFunction select_crc32c()
+		{
+#ifdef NETLIB_CHECKSUM_X86
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("sse4.2"))
+				return &crc32c_sse42;
+#endif
+			return &detail::crc32c_portable;
+		}
+
+		/** Selects the fastest one's complement sum implementation the processor supports. */
+		OnesSumFunction select_ones_sum()
+		{
+#ifdef NETLIB_CHECKSUM_X86
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2"))
+				return &ones_sum_avx2;
+#endif
+			return &detail::ones_sum_portable;
+		}
+
+		std::uint64_t ones_sum(
+			void const * data,
+			std::size_t size,
+			std::uint64_t sum)
+		{
+			static OnesSumFunction const function = select_ones_sum();
+			return function(data, size, sum);
+		}
+
+		constexpr std::uint64_t kPrime1 = 11400714785074694791ull;
+		constexpr std::uint64_t kPrime2 = 14029467366897019727ull;
+		constexpr std::uint64_t kPrime3 = 1609587929392839161ull;
+		constexpr std::uint64_t kPrime4 = 9650029242287828579ull;
+		constexpr std::uint64_t kPrime5 = 2870177450012600261ull;
+
+		inline std::uint64_t rotate_left(
+			std::uint64_t value,
+			unsigned bits)
+		{
+			return (value << bits) | (value >> (64 - bits));
+		}
+
+		inline std::uint64_t xxh64_round(
+			std::uint64_t lane,
+			std::uint64_t input)
+		{
+			return rotate_left(lane + input * kPrime2, 31) * kPrime1;
+		}
+
+		inline std::uint64_t xxh64_merge(
+			std::uint64_t hash,
+			std::uint64_t lane)
+		{
+			return (hash ^ xxh64_round(0, lane)) * kPrime1 + kPrime4;
+		}
+	}
+
+	namespace detail
+	{
+		std::uint32_t crc32c_portable(
+			void const * data,
+			std::size_t size,
+			std::uint32_t crc)
+		{
+			auto const& table = crc32c_tables().table;
+			std::uint8_t const * bytes = static_cast<std::uint8_t const *>(data);
+			crc = ~crc;
+
+			if(kLittleEndian)
+				for(; size >= 8; size -= 8, bytes += 8)
+				{
+					std::uint64_t word = load64(bytes) ^ crc;
+					crc = table[7][word & 0xff]
+						^ table[6][(word >> 8) & 0xff]
+						^ table[5][(word >> 16) & 0xff]
+						^ table[4][(word >> 24) & 0xff]
+						^ table[3][(word >> 32) & 0xff]
+						^ table[2][(word >> 40) & 0xff]
+						^ table[1][(word >> 48) & 0xff]
+						^ table[0][word >> 56];
+				}
+
+			for(; size; size--)
+				crc = table[0][(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+
+			return ~crc;
+		}
+
+		std::uint64_t ones_sum_portable(
+			void const * data,
+			std::size_t size,
+			std::uint64_t sum)
+		{
+			// Sums 32-bit words, which is equivalent to summing 16-bit words, as 2^16 = 1 in one's complement arithmetic.
+			constexpr std::size_t kMaxChunk = std::size_t(1) << 30;
+
+			std::uint8_t const * bytes = static_cast<std::uint8_t const *>(data);
+			while(size >= 8)
+			{
+				std::size_t chunk = size < kMaxChunk ? size : kMaxChunk;
+				chunk &= ~std::size_t(7);
+				size -= chunk;
+
+				sum = fold(sum);
+				for(; chunk; chunk -= 8, bytes += 8)
+				{
+					std::uint64_t word;
+					std::memcpy(&word, bytes, 8);
+					sum += (word & 0xffffffff) + (word >> 32);
+				}
+			}
+
+			for(; size >= 2; size -= 2, bytes += 2)
+			{
+				std::uint16_t word;
+				std::memcpy(&word, bytes, 2);
+				sum += word;
+			}
+
+			// An odd last byte is padded with a zero byte.
+			if(size)
+			{
+				std::uint16_t word = 0;
+				std::memcpy(&word, bytes, 1);
+				sum += word;
+			}
+
+			return sum;
+		}
+	}
+
+	std::uint32_t crc32c(
+		void const * data,
+		std::size_t size,
+		std::uint32_t crc)
+	{
+		static Crc32cFunction const function = select_crc32c();
+		return function(data, size, crc);
+	}
+
+	std::uint32_t crc32c(
+		Buffer const& buffer,
+		std::uint32_t crc)
+	{
+		crc = crc32c(buffer.data(), buffer.continuous_data(), crc);
+		return crc32c(buffer.wrapped_data(), buffer.size() - buffer.continuous_data(), crc);
+	}
+
+	void InternetChecksum::add(
+		void const * data,
+		std::size_t size)
+	{
+		std::uint16_t sum = fold(ones_sum(data, size, 0));
+		// After an odd number of bytes, every byte is in the other half of its 16-bit word.
+		if(m_odd)
+			sum = std::uint16_t((sum << 8) | (sum >> 8));
+
+		m_sum += sum;
+		m_odd ^= size & 1;
+	}
+
+	void InternetChecksum::add(
+		Buffer const& buffer)
+	{
+		add(buffer.data(), buffer.continuous_data());
+		add(buffer.wrapped_data(), buffer.size() - buffer.continuous_data());
+	}
+
+	std::uint16_t InternetChecksum::finish() const
+	{
+		return std::uint16_t(~fold(m_sum));
+	}
+
+	std::uint16_t internet_checksum(
+		void const * data,
+		std::size_t size)
+	{
+		return std::uint16_t(~fold(ones_sum(data, size, 0)));
+	}
+
+	Xxh64::Xxh64(
+		std::uint64_t seed):
+		m_lanes{
+			seed + kPrime1 + kPrime2,
+			seed + kPrime2,
+			seed,
+			seed - kPrime1 },
+		m_seed(seed),
+		m_size(0),
+		m_pending(),
+		m_pending_size(0)
+	{
+	}
+
+	void Xxh64::add(
+		void const * data,
+		std::size_t size)
+	{
+		std::uint8_t const * bytes = static_cast<std::uint8_t const *>(data);
+		m_size += size;
+
+		if(m_pending_size + size < sizeof(m_pending))
+		{
+			std::memcpy(m_pending + m_pending_size, bytes, size);
+			m_pending_size += size;
+			return;
+		}
+
+		// Complete the pending stripe.
+		if(m_pending_size)
+		{
+			std::size_t fill = sizeof(m_pending) - m_pending_size;
+			std::memcpy(m_pending + m_pending_size, bytes, fill);
+			bytes += fill;
+			size -= fill;
+			for(int i = 0; i < 4; i++)
+				m_lanes[i] = xxh64_round(m_lanes[i], load64(m_pending + 8 * i));
+		}
+
+		// Local copies let the compiler keep the lanes in registers.
+		std::uint64_t lane0 = m_lanes[0], lane1 = m_lanes[1], lane2 = m_lanes[2], lane3 = m_lanes[3];
+		for(; size >= 32; size -= 32, bytes += 32)
+		{
+			lane0 = xxh64_round(lane0, load64(bytes));
+			lane1 = xxh64_round(lane1, load64(bytes + 8));
+			lane2 = xxh64_round(lane2, load64(bytes + 16));
+			lane3 = xxh64_round(lane3, load64(bytes + 24));
+		}
+		m_lanes[0] = lane0;
+		m_lanes[1] = lane1;
+		m_lanes[2] = lane2;
+		m_lanes[3] = lane3;
+
+		std::memcpy(m_pending, bytes, size);
+		m_pending_size = size;
+	}
+
+	void Xxh64::add(
+		Buffer const& buffer)
+	{
+		add(buffer.data(), buffer.continuous_data());
+		add(buffer.wrapped_data(), buffer.size() - buffer.continuous_data());
+	}
+
+	std::uint64_t Xxh64::finish() const
+	{
+		std::uint64_t hash;
+		if(m_size >= 32)
+		{
+			hash = rotate_left(m_lanes[0], 1)
+				+ rotate_left(m_lanes[1], 7)
+				+ rotate_left(m_lanes[2], 12)
+				+ rotate_left(m_lanes[3], 18);
+			for(std::uint64_t lane : m_lanes)
+				hash = xxh64_merge(hash, lane);
+		} else
+			hash = m_seed + kPrime5;
+
+		hash += m_size;
+
+		std::uint8_t const * bytes = m_pending;
+		std::size_t size = m_pending_size;
+		for(; size >= 8; size -= 8, bytes += 8)
+			hash = rotate_left(hash ^ xxh64_round(0, load64(bytes)), 27) * kPrime1 + kPrime4;
+		if(size >= 4)
+		{
+			hash = rotate_left(hash ^ (load32(bytes) * kPrime1), 23) * kPrime2 + kPrime3;
+			size -= 4;
+			bytes += 4;
+		}
+		for(; size; size--)
+			hash = rotate_left(hash ^ (*bytes++ * kPrime5), 11) * kPrime1;
+
+		hash ^= hash >> 33;
+		hash *= kPrime2;
+		hash ^= hash >> 29;
+		hash *= kPrime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	std::uint64_t xxh64(
+		void const * data,
+		std::size_t size,
+		std::uint64_t seed)
+	{
+		Xxh64 hash(seed);
+		hash.add(data, size);
+		return hash.finish();
+	}
+}
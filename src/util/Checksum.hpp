@@ -0,0 +1,126 @@
+/** @file Checksum.hpp
+	Contains checksum and hash functions for packet payloads. */
+#ifndef __netlib_util_checksum_hpp_defined
+#define __netlib_util_checksum_hpp_defined
+
+#include <cstdint>
+#include <cstddef>
+
+namespace netlib::util
+{
+	class Buffer;
+
+	/** Computes the CRC-32C (Castagnoli) checksum of data, as used by iSCSI, SCTP, and many UDP protocols.
+		Uses the SSE4.2 CRC instruction if the processor supports it, and a table-driven implementation otherwise.
+	@param[in] data:
+		The data.
+	@param[in] size:
+		The data's size, in bytes.
+	@param[in] crc:
+		The checksum of the preceding data, to continue a checksum over multiple pieces. 0 to start a new checksum.
+	@return
+		The checksum. */
+	std::uint32_t crc32c(
+		void const * data,
+		std::size_t size,
+		std::uint32_t crc = 0);
+	/** Computes the CRC-32C checksum of a buffer's contents, including the part that wrapped around its edge. */
+	std::uint32_t crc32c(
+		Buffer const& buffer,
+		std::uint32_t crc = 0);
+
+	/** Computes the Internet checksum (RFC 1071), the 16-bit one's complement of the one's complement sum, as used by IPv4, ICMP, UDP, and TCP headers.
+		The data can be added in pieces of any size. Uses AVX2 if the processor supports it. */
+	class InternetChecksum
+	{
+		/** The sum so far, not yet folded to 16 bits. */
+		std::uint64_t m_sum;
+		/** Whether an odd number of bytes was added so far. */
+		bool m_odd;
+	public:
+		/** Starts a new checksum. */
+		inline InternetChecksum();
+
+		/** Adds data to the checksum.
+		@param[in] data:
+			The data.
+		@param[in] size:
+			The data's size, in bytes. */
+		void add(
+			void const * data,
+			std::size_t size);
+		/** Adds a buffer's contents to the checksum, including the part that wrapped around its edge. */
+		void add(
+			Buffer const& buffer);
+
+		/** The checksum of all data added so far.
+		@return
+			The checksum, in network byte order: it can be copied into a header as is. A packet whose checksum field is included in the data is valid if the checksum is 0. */
+		std::uint16_t finish() const;
+	};
+
+	/** Computes the Internet checksum of data.
+	@return
+		The checksum, in network byte order. */
+	std::uint16_t internet_checksum(
+		void const * data,
+		std::size_t size);
+
+	/** Computes the 64-bit xxHash (XXH64) of data, a fast non-cryptographic hash.
+		Not suitable where an attacker chooses the data and can observe collisions; use a secret seed there.
+		The data can be added in pieces of any size, and the result is the same as hashing all data at once. */
+	class Xxh64
+	{
+		/** The four accumulators. */
+		std::uint64_t m_lanes[4];
+		/** The seed. */
+		std::uint64_t m_seed;
+		/** The total number of bytes added. */
+		std::uint64_t m_size;
+		/** Bytes that did not fill a whole 32-byte stripe yet. */
+		std::uint8_t m_pending[32];
+		/** The number of pending bytes. */
+		std::size_t m_pending_size;
+	public:
+		/** Starts a new hash.
+		@param[in] seed:
+			The seed. */
+		explicit Xxh64(
+			std::uint64_t seed = 0);
+
+		/** Adds data to the hash. */
+		void add(
+			void const * data,
+			std::size_t size);
+		/** Adds a buffer's contents to the hash, including the part that wrapped around its edge. */
+		void add(
+			Buffer const& buffer);
+
+		/** The hash of all data added so far. */
+		std::uint64_t finish() const;
+	};
+
+	/** Computes the XXH64 hash of data. */
+	std::uint64_t xxh64(
+		void const * data,
+		std::size_t size,
+		std::uint64_t seed = 0);
+
+	namespace detail
+	{
+		/** The portable CRC-32C implementation, which is also used if the processor lacks SSE4.2. */
+		std::uint32_t crc32c_portable(
+			void const * data,
+			std::size_t size,
+			std::uint32_t crc);
+		/** The portable one's complement sum of 16-bit words, which is also used if the processor lacks AVX2. An odd last byte is padded with a zero byte. */
+		std::uint64_t ones_sum_portable(
+			void const * data,
+			std::size_t size,
+			std::uint64_t sum);
+	}
+}
+
+#include "Checksum.inl"
+
+#endif
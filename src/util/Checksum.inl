@@ -0,0 +1,8 @@
+namespace netlib::util
+{
+	InternetChecksum::InternetChecksum():
+		m_sum(0),
+		m_odd(false)
+	{
+	}
+}
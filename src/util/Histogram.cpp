@@ -0,0 +1,98 @@
+#include "Histogram.hpp"
+
+#include <cstring>
+#include <cstdio>
+
+namespace netlib::util
+{
+	Histogram::Histogram():
+		m_buckets{},
+		m_count(0)
+	{
+	}
+
+	void Histogram::merge(
+		Histogram const& other)
+	{
+		for(std::size_t i = 0; i < kBuckets; i++)
+			m_buckets[i] += other.m_buckets[i];
+		m_count += other.m_count;
+	}
+
+	void Histogram::clear()
+	{
+		std::memset(m_buckets, 0, sizeof(m_buckets));
+		m_count = 0;
+	}
+
+	std::uint64_t Histogram::percentile(
+		double percentile) const
+	{
+		if(!m_count)
+			return 0;
+
+		if(percentile < 0)
+			percentile = 0;
+		else if(percentile > 100)
+			percentile = 100;
+
+		// The rank of the requested value, counting from 1.
+		std::uint64_t rank = std::uint64_t(percentile / 100 * double(m_count) + 0.5);
+		if(rank < 1)
+			rank = 1;
+		else if(rank > m_count)
+			rank = m_count;
+
+		std::uint64_t seen = 0;
+		for(std::size_t i = 0; i < kBuckets; i++)
+			if((seen += m_buckets[i]) >= rank)
+				return highest(i);
+		return max();
+	}
+
+	std::uint64_t Histogram::min() const
+	{
+		if(m_count)
+			for(std::size_t i = 0; i < kBuckets; i++)
+				if(m_buckets[i])
+					return lowest(i);
+		return 0;
+	}
+
+	std::uint64_t Histogram::max() const
+	{
+		if(m_count)
+			for(std::size_t i = kBuckets; i--;)
+				if(m_buckets[i])
+					return highest(i);
+		return 0;
+	}
+
+	double Histogram::mean() const
+	{
+		if(!m_count)
+			return 0;
+
+		double sum = 0;
+		for(std::size_t i = 0; i < kBuckets; i++)
+			if(m_buckets[i])
+				sum += double(m_buckets[i]) * (double(lowest(i)) + double(highest(i) - lowest(i)) / 2);
+		return sum / double(m_count);
+	}
+
+	std::string Histogram::text() const
+	{
+		char line[256];
+		std::snprintf(line, sizeof(line),
+			"count=%llu mean=%.0f p50=%llu p90=%llu p99=%llu p99.9=%llu p99.99=%llu max=%llu",
+			(unsigned long long) m_count,
+			mean(),
+			(unsigned long long) percentile(50),
+			(unsigned long long) percentile(90),
+			(unsigned long long) percentile(99),
+			(unsigned long long) percentile(99.9),
+			(unsigned long long) percentile(99.99),
+			(unsigned long long) max());
+		return line;
+	}
+}
@@ -0,0 +1,95 @@
+/** @file Histogram.hpp
+	Contains the netlib::util::Histogram class used for recording value distributions. */
+#ifndef __netlib_util_histogram_hpp_defined
+#define __netlib_util_histogram_hpp_defined
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace netlib::util
+{
+	/** Log-linear histogram of 64-bit values, in the style of HdrHistogram.
+		Values below `kSubBuckets` are counted exactly. Larger values are grouped by their power of two, and each power of two is split into `kSubBuckets` linear buckets, so every recorded value is known with a relative error of at most 1/`kSubBuckets` (about 3%), over the whole 64-bit range. Recording is a few instructions and never allocates, and histograms can be merged by adding their buckets. */
+	class Histogram
+	{
+	public:
+		/** The number of bits of precision of a bucket. */
+		static constexpr unsigned kSubBucketBits = 5;
+		/** The number of buckets per power of two. */
+		static constexpr std::size_t kSubBuckets = std::size_t(1) << kSubBucketBits;
+		/** The total number of buckets. */
+		static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+	private:
+		/** The number of values per bucket. */
+		std::uint64_t m_buckets[kBuckets];
+		/** The number of recorded values. */
+		std::uint64_t m_count;
+	public:
+		/** Creates an empty histogram. */
+		Histogram();
+
+		/** The bucket a value is counted in. */
+		static inline std::size_t bucket(
+			std::uint64_t value);
+		/** The lowest value counted in a bucket. */
+		static inline std::uint64_t lowest(
+			std::size_t bucket);
+		/** The highest value counted in a bucket. */
+		static inline std::uint64_t highest(
+			std::size_t bucket);
+
+		/** Records a value.
+		@param[in] value:
+			The value to record.
+		@param[in] count:
+			How often to record the value. */
+		inline void record(
+			std::uint64_t value,
+			std::uint64_t count = 1);
+		/** Adds to a bucket directly, for example when combining externally stored buckets.
+		@param[in] bucket:
+			The bucket index, below `kBuckets`.
+		@param[in] count:
+			How many values to add. */
+		inline void add(
+			std::size_t bucket,
+			std::uint64_t count);
+
+		/** Adds another histogram's values to this histogram. */
+		void merge(
+			Histogram const& other);
+		/** Removes all values. */
+		void clear();
+
+		/** The number of recorded values. */
+		inline std::uint64_t count() const;
+		/** The number of values in a bucket. */
+		inline std::uint64_t count(
+			std::size_t bucket) const;
+
+		/** The value below or at which the given percentage of values lie.
+			Returns the highest value equivalent to the actual value, so the result is never too low.
+		@param[in] percentile:
+			The percentile, between 0 and 100.
+		@return
+			The value, or 0 if the histogram is empty. */
+		std::uint64_t percentile(
+			double percentile) const;
+		/** The lowest recorded value, rounded down to its bucket. */
+		std::uint64_t min() const;
+		/** The highest recorded value, rounded up to its bucket. */
+		std::uint64_t max() const;
+		/** The mean of all recorded values, using the middle of every bucket. */
+		double mean() const;
+
+		/** Summarises the histogram in a single line.
+			Format: `count=N mean=M p50=A p90=B p99=C p99.9=D p99.99=E max=F`. */
+		std::string text() const;
+	};
+}
+
+#include "Histogram.inl"
+
+#endif
@@ -0,0 +1,71 @@
+#include <cassert>
+
+namespace netlib::util
+{
+	std::size_t Histogram::bucket(
+		std::uint64_t value)
+	{
+		if(value < kSubBuckets)
+			return std::size_t(value);
+
+#ifdef __GNUC__
+		unsigned magnitude = 63 - unsigned(__builtin_clzll(value));
+#else
+		unsigned magnitude = 63;
+		while(!(value >> magnitude))
+			--magnitude;
+#endif
+
+		unsigned shift = magnitude - kSubBucketBits;
+		return (shift + 1) * kSubBuckets + std::size_t((value >> shift) - kSubBuckets);
+	}
+
+	std::uint64_t Histogram::lowest(
+		std::size_t bucket)
+	{
+		if(bucket < kSubBuckets)
+			return bucket;
+
+		unsigned shift = unsigned(bucket / kSubBuckets - 1);
+		return std::uint64_t(bucket % kSubBuckets + kSubBuckets) << shift;
+	}
+
+	std::uint64_t Histogram::highest(
+		std::size_t bucket)
+	{
+		if(bucket < kSubBuckets)
+			return bucket;
+
+		unsigned shift = unsigned(bucket / kSubBuckets - 1);
+		return lowest(bucket) + ((std::uint64_t(1) << shift) - 1);
+	}
+
+	void Histogram::record(
+		std::uint64_t value,
+		std::uint64_t count)
+	{
+		m_buckets[bucket(value)] += count;
+		m_count += count;
+	}
+
+	void Histogram::add(
+		std::size_t bucket,
+		std::uint64_t count)
+	{
+		assert(bucket < kBuckets);
+		m_buckets[bucket] += count;
+		m_count += count;
+	}
+
+	std::uint64_t Histogram::count() const
+	{
+		return m_count;
+	}
+
+	std::uint64_t Histogram::count(
+		std::size_t bucket) const
+	{
+		assert(bucket < kBuckets);
+		return m_buckets[bucket];
+	}
+}
@@ -0,0 +1,78 @@
+/** @file TokenBucket.hpp
+	Contains the netlib::util::TokenBucket class used for rate limiting. */
+#ifndef __netlib_util_tokenbucket_hpp_defined
+#define __netlib_util_tokenbucket_hpp_defined
+
+#include <chrono>
+#include <cstdint>
+
+namespace netlib::util
+{
+	/** Token bucket rate limiter.
+		The bucket is stored as the time at which it will be full again (the generic cell rate algorithm), instead of a token count and a refill timestamp. This makes a bucket a single 8-byte value that needs no periodic refilling, so large numbers of buckets (for example, one per peer address) are cheap. The rate is not stored in the bucket, as it is usually shared by many buckets. */
+	class TokenBucket
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		/** The rate and burst size of a bucket. */
+		struct Rate
+		{
+			/** The time it takes to gain one token. */
+			clock::duration interval;
+			/** The time it takes to refill an empty bucket, i.e. the burst size times `interval`. */
+			clock::duration capacity;
+
+			/** Creates a rate.
+			@param[in] per_second:
+				How many tokens are gained per second. Must be positive.
+			@param[in] burst:
+				How many tokens the bucket holds at most. Must be at least 1. */
+			static inline Rate per_second(
+				double per_second,
+				double burst);
+		};
+
+	private:
+		/** When the bucket is full again. */
+		clock::time_point m_full;
+	public:
+		/** Creates a full bucket. */
+		inline TokenBucket();
+
+		/** Takes tokens from the bucket, if enough tokens are available.
+		@param[in] rate:
+			The bucket's rate.
+		@param[in] now:
+			The current time.
+		@param[in] tokens:
+			How many tokens to take.
+		@return
+			Whether the tokens were available and taken. */
+		inline bool take(
+			Rate const& rate,
+			clock::time_point now,
+			unsigned tokens = 1);
+
+		/** How long to wait until the requested tokens are available.
+		@return
+			Zero, if the tokens are available now. */
+		inline clock::duration delay(
+			Rate const& rate,
+			clock::time_point now,
+			unsigned tokens = 1) const;
+
+		/** How many tokens are available now. */
+		inline std::uint64_t available(
+			Rate const& rate,
+			clock::time_point now) const;
+
+		/** Whether the bucket is full, i.e. carries no state and can be discarded. */
+		inline bool full(
+			clock::time_point now) const;
+	};
+}
+
+#include "TokenBucket.inl"
+
+#endif
@@ -0,0 +1,62 @@
+namespace netlib::util
+{
+	TokenBucket::Rate TokenBucket::Rate::per_second(
+		double per_second,
+		double burst)
+	{
+		std::chrono::duration<double> interval(1.0 / per_second);
+
+		Rate rate;
+		rate.interval = std::chrono::duration_cast<clock::duration>(interval);
+		if(rate.interval.count() < 1)
+			rate.interval = clock::duration(1);
+		rate.capacity = std::chrono::duration_cast<clock::duration>(interval * burst);
+		if(rate.capacity < rate.interval)
+			rate.capacity = rate.interval;
+		return rate;
+	}
+
+	TokenBucket::TokenBucket():
+		m_full()
+	{
+	}
+
+	bool TokenBucket::take(
+		Rate const& rate,
+		clock::time_point now,
+		unsigned tokens)
+	{
+		clock::time_point full = (m_full > now ? m_full : now) + rate.interval * tokens;
+		if(full - now > rate.capacity)
+			return false;
+
+		m_full = full;
+		return true;
+	}
+
+	TokenBucket::clock::duration TokenBucket::delay(
+		Rate const& rate,
+		clock::time_point now,
+		unsigned tokens) const
+	{
+		clock::time_point full = (m_full > now ? m_full : now) + rate.interval * tokens;
+		clock::duration excess = (full - now) - rate.capacity;
+		return excess.count() > 0 ? excess : clock::duration::zero();
+	}
+
+	std::uint64_t TokenBucket::available(
+		Rate const& rate,
+		clock::time_point now) const
+	{
+		clock::duration const used = m_full > now ? m_full - now : clock::duration::zero();
+		if(used >= rate.capacity)
+			return 0;
+		return std::uint64_t((rate.capacity - used) / rate.interval);
+	}
+
+	bool TokenBucket::full(
+		clock::time_point now) const
+	{
+		return m_full <= now;
+	}
+}
@@ -0,0 +1,124 @@
+#include "AdmissionControl.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	AdmissionControl::AdmissionControl(
+		Limits const& limits):
+		m_limits(limits),
+		m_accept_rate(),
+		m_source_rate(),
+		m_global(),
+		m_sources(),
+		m_next_prune(),
+		m_connections(0),
+		m_statistics()
+	{
+		assert(limits.ipv6_source_prefix <= 128);
+
+		if(limits.accept_rate > 0)
+			m_accept_rate = util::TokenBucket::Rate::per_second(
+				limits.accept_rate,
+				limits.accept_burst);
+		if(limits.source_rate > 0)
+			m_source_rate = util::TokenBucket::Rate::per_second(
+				limits.source_rate,
+				limits.source_burst);
+	}
+
+	bool AdmissionControl::source_key(
+		SocketAddress const& source,
+		AddressKey &out) const
+	{
+		if(!AddressKey::from_address(source, out))
+			return false;
+
+		out.port = 0;
+		// IPv4 peers of dual-stack sockets are limited like plain IPv4 peers, instead of sharing the bucket of ::ffff:0:0/96.
+		if(source.family == AddressFamily::kIPv6
+		&& !out.high
+		&& (out.low >> 32) == 0xffff)
+		{
+			out.family = std::uint8_t(AddressFamily::kIPv4);
+			out.scope = 0;
+		} else if(source.family == AddressFamily::kIPv6)
+		{
+			unsigned prefix = m_limits.ipv6_source_prefix;
+			if(prefix < 64)
+			{
+				out.high &= prefix ? ~std::uint64_t(0) << (64 - prefix) : 0;
+				out.low = 0;
+			} else if(prefix < 128)
+				out.low &= prefix > 64 ? ~std::uint64_t(0) << (128 - prefix) : 0;
+		}
+		return true;
+	}
+
+	ConnectionListener::Verdict AdmissionControl::admit(
+		SocketAddress const& peer,
+		clock::time_point now)
+	{
+		// Cheapest check first, so that overload is handled with minimal work.
+		if(m_limits.max_connections && m_connections >= m_limits.max_connections)
+		{
+			++m_statistics.over_capacity;
+			return m_limits.reject;
+		}
+
+		// Check the source before the global rate, so that a flooding source does not use up the global rate.
+		AddressKey key;
+		if(m_limits.source_rate > 0 && source_key(peer, key))
+		{
+			util::TokenBucket * bucket = m_sources.find(key);
+			if(!bucket)
+			{
+				// Pruning scans all sources, so a flood of new sources must not trigger it on every accept. Sources only become prunable once their bucket refilled completely, so every source kept by this prune can be pruned after the time it takes to refill an empty bucket, unless it connects again.
+				if(m_sources.size() >= m_limits.max_sources && now >= m_next_prune)
+				{
+					prune(now);
+					m_next_prune = now + m_source_rate.capacity;
+				}
+				if(m_sources.size() < m_limits.max_sources)
+					bucket = m_sources.try_emplace(key).first;
+			}
+
+			if(bucket && !bucket->take(m_source_rate, now))
+			{
+				++m_statistics.source_limited;
+				return m_limits.reject;
+			}
+		}
+
+		if(m_limits.accept_rate > 0 && !m_global.take(m_accept_rate, now))
+		{
+			++m_statistics.rate_limited;
+			return m_limits.reject;
+		}
+
+		++m_connections;
+		++m_statistics.admitted;
+		return ConnectionListener::Verdict::kAccept;
+	}
+
+	void AdmissionControl::release()
+	{
+		assert(m_connections != 0);
+		--m_connections;
+	}
+
+	void AdmissionControl::prune(
+		clock::time_point now)
+	{
+		m_sources.erase_if([now](AddressKey const&, util::TokenBucket const& bucket) {
+			return bucket.full(now);
+		});
+	}
+
+	ConnectionListener::Verdict AdmissionControl::filter(
+		void * admission,
+		SocketAddress const& peer)
+	{
+		return static_cast<AdmissionControl *>(admission)->admit(peer);
+	}
+}
@@ -0,0 +1,131 @@
+/** @file AdmissionControl.hpp
+	Contains the netlib::x::AdmissionControl class used for limiting incoming connections. */
+#ifndef __netlib_x_admissioncontrol_hpp_defined
+#define __netlib_x_admissioncontrol_hpp_defined
+
+#include "ConnectionListener.hpp"
+#include "../SocketAddress.hpp"
+#include "../util/TokenBucket.hpp"
+#include "../util/AddressMap.hpp"
+#include "../defines.hpp"
+
+#include <cstdint>
+#include <cstddef>
+
+namespace netlib::x
+{
+	/** Limits the rate and number of accepted connections.
+		Install it as a `ConnectionListener` filter (see `filter()`), so that excess connections are rejected right after being accepted, before the application allocates anything for them. A connection is admitted if:
+		- fewer than the maximum number of connections are open,
+		- the source address has not exceeded its accept rate, and
+		- the global accept rate was not exceeded.
+
+		Per-source state is a single token bucket in a flat hash map, and sources whose bucket refilled completely are pruned, so tracking many sources stays cheap. IPv6 sources are grouped by prefix (by default /64), as a single host usually controls a whole subnet. IPv4-mapped IPv6 sources are treated as IPv4 sources.
+
+		An admission control object must only be used by a single thread. The application must call `release()` whenever an admitted connection is closed. */
+	class AdmissionControl
+	{
+	public:
+		typedef util::TokenBucket::clock clock;
+
+		/** The limits of an admission control. */
+		struct Limits
+		{
+			/** The global accept rate per second, or 0 for no limit. */
+			double accept_rate = 0;
+			/** How many connections may be accepted at once when under the global rate. */
+			double accept_burst = 1;
+			/** The accept rate per source per second, or 0 for no limit. */
+			double source_rate = 0;
+			/** How many connections a source may open at once when under its rate. */
+			double source_burst = 1;
+			/** The maximum number of open connections, or 0 for no limit. */
+			std::size_t max_connections = 0;
+			/** The maximum number of tracked sources. When exceeded, new sources are only limited by the global rate. */
+			std::size_t max_sources = 1 << 20;
+			/** The prefix length by which IPv6 sources are grouped. */
+			unsigned ipv6_source_prefix = 64;
+			/** What to do with rejected connections. */
+			ConnectionListener::Verdict reject = ConnectionListener::Verdict::kReset;
+		};
+
+		/** Usage statistics of an admission control. */
+		struct Statistics
+		{
+			/** How many connections were admitted. */
+			std::uint64_t admitted;
+			/** How many connections were rejected because the maximum number of connections was reached. */
+			std::uint64_t over_capacity;
+			/** How many connections were rejected by the global rate. */
+			std::uint64_t rate_limited;
+			/** How many connections were rejected by their source's rate. */
+			std::uint64_t source_limited;
+		};
+
+	private:
+		/** The limits. */
+		Limits m_limits;
+		/** The global accept rate. */
+		util::TokenBucket::Rate m_accept_rate;
+		/** The accept rate per source. */
+		util::TokenBucket::Rate m_source_rate;
+		/** The global token bucket. */
+		util::TokenBucket m_global;
+		/** The token bucket per source. */
+		util::AddressMap<util::TokenBucket> m_sources;
+		/** When the sources may be pruned again because the map is full. */
+		clock::time_point m_next_prune;
+		/** The number of open admitted connections. */
+		std::size_t m_connections;
+		/** The usage statistics. */
+		Statistics m_statistics;
+
+		/** Converts a source address into its key, without port and with IPv6 addresses reduced to their prefix. */
+		bool source_key(
+			SocketAddress const& source,
+			AddressKey &out) const;
+	public:
+		/** Creates an admission control with the given limits. */
+		explicit AdmissionControl(
+			Limits const& limits);
+
+		/** Decides whether to admit a connection.
+			If the connection is admitted, it counts as open until `release()` is called.
+		@param[in] peer:
+			The connection's remote address.
+		@param[in] now:
+			The current time.
+		@return
+			`ConnectionListener::Verdict::kAccept`, or the configured rejection. */
+		ConnectionListener::Verdict admit(
+			SocketAddress const& peer,
+			clock::time_point now = clock::now());
+
+		/** Marks an admitted connection as closed. */
+		void release();
+
+		/** Removes sources whose rate limit has fully recovered.
+		@param[in] now:
+			The current time. */
+		void prune(
+			clock::time_point now = clock::now());
+
+		/** Connection filter for `ConnectionListener::filter()`.
+		@param[in] admission:
+			The admission control to use. */
+		static ConnectionListener::Verdict filter(
+			void * admission,
+			SocketAddress const& peer);
+
+		/** The number of open admitted connections. */
+		NETLIB_INL std::size_t connections() const;
+		/** The number of tracked sources. */
+		NETLIB_INL std::size_t sources() const;
+		/** The usage statistics. */
+		NETLIB_INL Statistics const& statistics() const;
+	};
+}
+
+#include "AdmissionControl.inl"
+
+#endif
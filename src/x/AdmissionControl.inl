@@ -0,0 +1,17 @@
+namespace netlib::x
+{
+	std::size_t AdmissionControl::connections() const
+	{
+		return m_connections;
+	}
+
+	std::size_t AdmissionControl::sources() const
+	{
+		return m_sources.size();
+	}
+
+	AdmissionControl::Statistics const& AdmissionControl::statistics() const
+	{
+		return m_statistics;
+	}
+}
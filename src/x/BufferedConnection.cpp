@@ -1,5 +1,6 @@
 #include "BufferedConnection.hpp"
 #include <cassert>
+#include <algorithm>
 
 namespace netlib::x
 {
@@ -47,6 +48,12 @@ namespace netlib::x
 		if(m_output.empty())
 			return true;
 
+		if(m_limiter)
+		{
+			std::size_t sent;
+			return flush_some(m_output.continuous_data(), sent);
+		}
+
 		std::size_t received;
 		if(Status::kSuccess == StreamSocket::send(
 			m_output.data(),
@@ -60,6 +67,51 @@ namespace netlib::x
 		return false;
 	}
 
+	bool BufferedConnection::flush_some(
+		std::size_t limit,
+		std::size_t &sent)
+	{
+		return Status::kSuccess == flush(limit, sent);
+	}
+
+	Status BufferedConnection::flush(
+		std::size_t limit,
+		std::size_t &sent)
+	{
+		sent = 0;
+
+		util::ByteRateLimiter::clock::time_point now;
+		if(m_limiter)
+		{
+			now = util::ByteRateLimiter::clock::now();
+			std::size_t const available = m_limiter->available(now);
+			if(available < limit)
+				limit = available;
+		}
+
+		Status status = Status::kSuccess;
+		while(!m_output.empty() && sent < limit)
+		{
+			std::size_t const size = std::min(m_output.continuous_data(), limit - sent);
+			std::size_t chunk;
+			if(Status::kSuccess != (status = StreamSocket::send(
+				m_output.data(),
+				size,
+				chunk)))
+				break;
+
+			m_output.remove(chunk);
+			sent += chunk;
+			// The socket's send buffer is full.
+			if(chunk < size)
+				break;
+		}
+
+		if(m_limiter && sent)
+			m_limiter->consume(sent, now);
+		return status;
+	}
+
 	bool BufferedConnection::receive_some()
 	{
 		if(m_input.full())
@@ -78,23 +130,170 @@ namespace netlib::x
 		return false;
 	}
 
+	bool BufferedConnection::write_gathered(
+		DataSlice const * slices,
+		std::size_t count,
+		std::size_t &accepted)
+	{
+		assert(count <= kMaxSlices - 2);
+		accepted = 0;
+
+		// Sending directly would bypass the rate limit.
+		if(m_limiter)
+		{
+			for(std::size_t i = 0; i < count; i++)
+			{
+				std::size_t const appended = m_output.append(slices[i].data, slices[i].size);
+				accepted += appended;
+				if(appended < slices[i].size)
+					break;
+			}
+
+			std::size_t sent;
+			if(Status::kError == flush(m_output.size(), sent))
+			{
+				accepted = 0;
+				return false;
+			}
+			return true;
+		}
+
+		// Buffered output has to be sent first, and may wrap around the buffer's edge.
+		DataSlice all[kMaxSlices];
+		std::size_t const buffered = m_output.size();
+		std::size_t used = 0;
+		if(buffered)
+		{
+			all[used++] = DataSlice{ m_output.data(), m_output.continuous_data() };
+			if(m_output.wrapping())
+				all[used++] = DataSlice{ m_output.wrapped_data(), buffered - m_output.continuous_data() };
+		}
+		for(std::size_t i = 0; i < count; i++)
+			all[used++] = slices[i];
+
+		std::size_t sent;
+		switch(StreamSocket::send_gathered(all, used, sent))
+		{
+		case Status::kSuccess:
+			break;
+		case Status::kNotReady:
+			sent = 0;
+			break;
+		default:
+			return false;
+		}
+
+		if(sent <= buffered)
+		{
+			m_output.remove(sent);
+			sent = 0;
+		} else
+		{
+			m_output.clear();
+			sent -= buffered;
+		}
+
+		// Buffer the rest of the slices.
+		for(std::size_t i = 0; i < count; i++)
+		{
+			if(sent >= slices[i].size)
+			{
+				sent -= slices[i].size;
+				accepted += slices[i].size;
+				continue;
+			}
+
+			std::size_t const rest = slices[i].size - sent;
+			std::size_t const appended = m_output.append(
+				static_cast<std::uint8_t const *>(slices[i].data) + sent,
+				rest);
+			accepted += sent + appended;
+			sent = 0;
+			if(appended < rest)
+				break;
+		}
+
+		return true;
+	}
+
+	Status BufferedConnection::forward(
+		BufferedConnection &to)
+	{
+		for(;;)
+		{
+			// The input may wrap around the buffer's edge.
+			while(!m_input.empty() && !to.m_output.full())
+				m_input.remove(to.m_output.append(m_input.data(), m_input.continuous_data()));
+
+			std::size_t sent;
+			if(Status::kError == to.flush(to.m_output.size(), sent))
+				return Status::kError;
+			if(m_input.empty() && to.m_output.empty())
+				return Status::kSuccess;
+			if(!sent)
+				return Status::kNotReady;
+		}
+	}
+
+	void BufferedConnection::set_rate_limit(
+		double bytes_per_second,
+		std::size_t burst)
+	{
+		assert(bytes_per_second > 0);
+		m_limiter.reset(new util::ByteRateLimiter(bytes_per_second, burst));
+	}
+
+	void BufferedConnection::remove_rate_limit()
+	{
+		m_limiter.reset();
+	}
+
+	util::ByteRateLimiter::clock::duration BufferedConnection::send_delay() const
+	{
+		if(!m_limiter)
+			return util::ByteRateLimiter::clock::duration::zero();
+		return m_limiter->delay(util::ByteRateLimiter::clock::now());
+	}
+
 	void BufferedConnection::discard()
 	{
 		m_input.clear();
 		m_output.clear();
 	}
 
+	bool BufferedConnection::reusable()
+	{
+		if(!exists() || !m_input.empty() || !m_output.empty())
+			return false;
+
+		// Pending data and an orderly shutdown both make the connection unusable.
+		std::uint8_t byte;
+		std::size_t received;
+		return Status::kNotReady == StreamSocket::peek(&byte, 1, received);
+	}
+
 	CR_IMPL(BufferedConnection::Flush)
 	CR_FINALLY
+		// A throttled connection stays writable, and would be flushed in a busy loop.
+		if(conn->m_limiter)
+			CR_THROW;
+		NETLIB_TIMED(conn->m_output_timer.begin());
 		while(!conn->m_output.empty())
 		{
+			NETLIB_TIMED(conn->m_output_timer.suspend());
 			CR_AWAIT(conn->Socket::m_output.wait());
+			NETLIB_TIMED(conn->m_output_timer.resume());
 			if(!conn->flush_some())
 				CR_THROW;
 		}
+		NETLIB_TIMED(conn->m_output_timer.finish(Operation::kFlush));
 	CR_IMPL_END
 
 	CR_IMPL(BufferedConnection::Send)
+		// A throttled connection stays writable, and would be flushed in a busy loop.
+		if(conn->m_limiter)
+			CR_THROW;
+		NETLIB_TIMED(conn->m_output_timer.begin());
 		while(size)
 		{
 			if(!conn->m_output.full())
@@ -103,15 +302,20 @@ namespace netlib::x
 				reinterpret_cast<std::uintptr_t &>(data) += sent;
 				size -= sent;
 			} else {
+				NETLIB_STAT(detail::count_send_stall(conn->m_counters));
+				NETLIB_TIMED(conn->m_output_timer.suspend());
 				CR_AWAIT(conn->Socket::m_output.wait());
+				NETLIB_TIMED(conn->m_output_timer.resume());
 				if(!conn->flush_some())
 					CR_THROW;
 			}
 		}
+		NETLIB_TIMED(conn->m_output_timer.finish(Operation::kSend));
 	CR_FINALLY
 	CR_IMPL_END
 
 	CR_IMPL(BufferedConnection::Receive)
+		NETLIB_TIMED(conn->m_input_timer.begin());
 		while(size)
 		{
 			if(!conn->m_input.empty())
@@ -120,11 +324,14 @@ namespace netlib::x
 				reinterpret_cast<std::uintptr_t &>(data) += received;
 				size -= received;
 			} else {
+				NETLIB_TIMED(conn->m_input_timer.suspend());
 				CR_AWAIT(conn->Socket::m_input.wait());
+				NETLIB_TIMED(conn->m_input_timer.resume());
 				if(!conn->receive_some())
 					CR_THROW;
 			}
 		}
+		NETLIB_TIMED(conn->m_input_timer.finish(Operation::kReceive));
 	CR_FINALLY
 	CR_IMPL_END
 
@@ -140,6 +347,7 @@ namespace netlib::x
 
 	CR_IMPL(BufferedConnection::Connect)
 		assert(!conn->exists());
+		NETLIB_TIMED(conn->m_output_timer.begin());
 
 		new (conn) StreamSocket(
 			address.family);
@@ -147,13 +355,17 @@ namespace netlib::x
 		switch(conn->StreamSocket::connect(address))
 		{
 		case Status::kSuccess:
+			NETLIB_TIMED(conn->m_output_timer.finish(Operation::kConnect));
 			CR_RETURN;
 		default:
 			CR_THROW;
 		case Status::kInProgress:;
 		}
 
+		NETLIB_TIMED(conn->m_output_timer.suspend());
 		CR_AWAIT(conn->Socket::m_output.wait());
+		NETLIB_TIMED(conn->m_output_timer.resume());
+		NETLIB_TIMED(conn->m_output_timer.finish(Operation::kConnect));
 		CR_RETURN;
 	CR_FINALLY
 	CR_IMPL_END
@@ -3,10 +3,13 @@
 
 #include "../Socket.hpp"
 #include "../util/Buffer.hpp"
+#include "../util/ByteRateLimiter.hpp"
+#include "../Histograms.hpp"
 
 #include <libcr/primitives.hpp>
 
 #include <vector>
+#include <memory>
 #include <cinttypes>
 
 namespace netlib::x
@@ -18,14 +21,27 @@ namespace netlib::x
 	class BufferedConnection : protected StreamSocket
 	{
 		friend class ::netlib::Poller;
+		friend class Handoff;
 		/** The input buffer. */
 		util::Buffer m_input;
 		/** The output buffer. */
 		util::Buffer m_output;
+		/** Limits the rate at which the output is sent, or null. */
+		std::unique_ptr<util::ByteRateLimiter> m_limiter;
+#ifdef NETLIB_HISTOGRAMS
+		/** Times `Send`, `Flush`, and `Connect`. */
+		detail::OperationTimer m_output_timer;
+		/** Times `Receive`. */
+		detail::OperationTimer m_input_timer;
+#endif
+
 	public:
 		using StreamSocket::operator bool;
 		using StreamSocket::exists;
 		using StreamSocket::connect;
+#ifdef NETLIB_COUNTERS
+		using StreamSocket::counters;
+#endif
 
 		BufferedConnection(BufferedConnection&&) = default;
 		BufferedConnection &operator=(
@@ -80,26 +96,133 @@ namespace netlib::x
 		inline util::Buffer const& input() const noexcept;
 		/** Returns the output buffer. */
 		inline util::Buffer const& output() const noexcept;
+		/** Returns the beginning of the buffered input, so that it can be modified in place (for example, decoded) before it is consumed.
+			Holds `input().continuous_data()` bytes. */
+		inline void * input_data() noexcept;
 
 		/** Flushes the output buffer / or part of it.
 		@return
 			Whether the operation succeeded. */
 		bool flush_some();
+		/** Flushes at most `limit` bytes of the output buffer, including data that wraps around the buffer's edge.
+		@param[in] limit:
+			How many bytes to send at most.
+		@param[out] sent:
+			The number of bytes sent, even if the operation failed.
+		@return
+			Whether the operation succeeded. */
+		bool flush_some(
+			std::size_t limit,
+			std::size_t &sent);
+		/** Implements `flush_some()`, but tells a full send buffer apart from a failed socket.
+		@param[in] limit:
+			How many bytes to send at most.
+		@param[out] sent:
+			The number of bytes sent, even if the operation failed.
+		@return
+			`Status::kNotReady` if the socket's send buffer was full before everything was sent. */
+		Status flush(
+			std::size_t limit,
+			std::size_t &sent);
 		/** Attempts to fill the input buffer.
 		@return
 			Whether the operation succeeded. */
 		bool receive_some();
 
+		/** Buffers data to be sent, without flushing it.
+			Together with `flush_some()`, this allows using the connection without coroutines.
+		@param[in] data:
+			The data to send.
+		@param[in] size:
+			The data's size, in bytes.
+		@return
+			How many bytes fit into the output buffer. */
+		inline std::size_t write(
+			void const * data,
+			std::size_t size);
+		/** Takes data from the input buffer, without receiving more.
+			Together with `receive_some()`, this allows using the connection without coroutines.
+		@param[out] data:
+			Where to copy the data to.
+		@param[in] size:
+			How many bytes to take at most.
+		@return
+			How many bytes were taken. */
+		inline std::size_t read(
+			void * data,
+			std::size_t size);
+
+		/** Removes data from the input buffer without copying it, after it was processed in place via `input()`.
+		@param[in] size:
+			How many bytes to remove at most.
+		@return
+			How many bytes were removed. */
+		inline std::size_t skip(
+			std::size_t size);
+		/** Makes the buffered input continuous, so that it can be parsed in place.
+			Invalidates pointers into the input buffer. */
+		inline void linearize_input();
+
+		/** Sends data together with any buffered output in a single gathered system call, and buffers what the socket did not take.
+			Unlike `write()` followed by `flush_some()`, the data is not copied unless the socket's send buffer is full.
+		@param[in] slices:
+			The pieces of data to send, in order.
+		@param[in] count:
+			The number of slices. At most `Socket::kMaxSlices - 2`.
+		@param[out] accepted:
+			How many bytes of the slices were sent or buffered. Less than their total size if the output buffer is full. 0 if the operation failed.
+		@return
+			Whether the operation succeeded. Fails if the socket failed, after which the connection has to be closed. */
+		bool write_gathered(
+			DataSlice const * slices,
+			std::size_t count,
+			std::size_t &accepted);
+
+		/** Moves the buffered input into a connection's output buffer, and flushes it, as far as the output buffer and the socket's send buffer allow. Input that does not fit stays buffered for the next call.
+		@param[in] to:
+			The connection to send the input on. Echoes the input if it is this connection.
+		@return
+			`Status::kSuccess` if all input was sent, `Status::kNotReady` if data is left because the socket's send buffer is full or the output is throttled, or `Status::kError` if the socket failed. */
+		Status forward(
+			BufferedConnection &to);
+
+		/** Limits the rate at which `flush_some()` sends, with a token bucket in user space.
+			Use this where the kernel cannot pace the connection (`Socket::set_max_pacing_rate()` needs the fq queueing discipline, or TCP's internal pacing). Once the limit is reached, `flush_some()` succeeds without sending, so a throttled connection has to be flushed again after `send_delay()`. Gathered writes are buffered, so that they are limited as well.
+			Only supported without coroutines: `Flush` and `Send` wait for the socket to become writable, which it stays while throttled, so they would spin instead of waiting for the limit. They fail while a rate limit is set.
+		@param[in] bytes_per_second:
+			The sustained rate. Must be positive.
+		@param[in] burst:
+			How many bytes may be sent at once after being idle. Usually the output buffer's size. */
+		void set_rate_limit(
+			double bytes_per_second,
+			std::size_t burst);
+		/** Removes the rate limit. */
+		void remove_rate_limit();
+		/** Whether the output is rate limited. */
+		inline bool rate_limited() const noexcept;
+		/** How long until the rate limit allows sending again.
+		@return
+			Zero, if the output is not rate limited, or data can be sent now. */
+		util::ByteRateLimiter::clock::duration send_delay() const;
+
 		/** Discards all buffered input and output. */
 		void discard();
 
-		/** Flushes all buffered data to be sent. */
+		/** Checks whether an idle connection can be reused, without blocking.
+			A connection can be reused if it has no buffered data, and its peer neither closed the connection nor sent any unexpected data.
+		@return
+			Whether the connection can be reused. */
+		bool reusable();
+
+		/** Flushes all buffered data to be sent.
+			Fails if the output is rate limited. */
 		COROUTINE(Flush, void)
 		CR_STATE(
 			(BufferedConnection *) conn)
 		CR_EXTERNAL
 
-		/** Buffers, and potentially flushes, data to be sent. */
+		/** Buffers, and potentially flushes, data to be sent.
+			Fails if the output is rate limited. */
 		COROUTINE(Send, void)
 		CR_STATE(
 			(BufferedConnection *) conn,
@@ -21,4 +21,39 @@ namespace netlib::x
 	{
 		return m_output;
 	}
+
+	bool BufferedConnection::rate_limited() const noexcept
+	{
+		return m_limiter != nullptr;
+	}
+
+	void * BufferedConnection::input_data() noexcept
+	{
+		return m_input.data();
+	}
+
+	std::size_t BufferedConnection::write(
+		void const * data,
+		std::size_t size)
+	{
+		return m_output.append(data, size);
+	}
+
+	std::size_t BufferedConnection::read(
+		void * data,
+		std::size_t size)
+	{
+		return m_input.consume(data, size);
+	}
+
+	std::size_t BufferedConnection::skip(
+		std::size_t size)
+	{
+		return m_input.remove(size);
+	}
+
+	void BufferedConnection::linearize_input()
+	{
+		m_input.linearize();
+	}
 }
\ No newline at end of file
@@ -8,14 +8,18 @@ namespace netlib
 	{
 		ConnectionListener::ConnectionListener():
 			StreamSocket(),
-			m_listening(false)
+			m_listening(false),
+			m_filter(nullptr),
+			m_filter_context(nullptr)
 		{
 		}
 
 		ConnectionListener::ConnectionListener(
 			SocketAddress const& listen_addr):
 			StreamSocket(),
-			m_listening(false)
+			m_listening(false),
+			m_filter(nullptr),
+			m_filter_context(nullptr)
 		{
 			listen(listen_addr);
 		}
@@ -23,7 +27,9 @@ namespace netlib
 		ConnectionListener::ConnectionListener(
 			ConnectionListener && move):
 			StreamSocket(std::move(move)),
-			m_listening(move.m_listening)
+			m_listening(move.m_listening),
+			m_filter(move.m_filter),
+			m_filter_context(move.m_filter_context)
 		{
 			move.m_listening = false;
 		}
@@ -40,6 +46,8 @@ namespace netlib
 
 			m_listening = move.m_listening;
 			move.m_listening = false;
+			m_filter = move.m_filter;
+			m_filter_context = move.m_filter_context;
 
 			return *this;
 		}
@@ -68,11 +76,53 @@ namespace netlib
 			m_listening = false;
 		}
 
+		void ConnectionListener::filter(
+			Filter filter,
+			void * context)
+		{
+			m_filter = filter;
+			m_filter_context = context;
+		}
+
+		Status ConnectionListener::accept(
+			StreamSocket &out)
+		{
+			out.close();
+
+			for(;;)
+			{
+				Status status = StreamSocket::accept(out);
+				if(status != Status::kSuccess)
+					return status;
+
+				switch(m_filter
+					? m_filter(m_filter_context, out.address())
+					: Verdict::kAccept)
+				{
+				case Verdict::kAccept:
+					return Status::kSuccess;
+				case Verdict::kReset:
+					out.abort();
+					break;
+				default:
+					out.close();
+					break;
+				}
+			}
+		}
+
 		CR_IMPL(ConnectionListener::Accept)
-			CR_AWAIT(listener->Socket::m_input.wait());
+			NETLIB_TIMED(listener->m_accept_timer.begin());
+			while(Status::kNotReady == listener->accept(out))
+			{
+				NETLIB_TIMED(listener->m_accept_timer.suspend());
+				CR_AWAIT(listener->Socket::m_input.wait());
+				NETLIB_TIMED(listener->m_accept_timer.resume());
+			}
 
-			if(Status::kSuccess != listener->StreamSocket::accept(*out))
+			if(!out.exists())
 				CR_THROW;
+			NETLIB_TIMED(listener->m_accept_timer.finish(Operation::kAccept));
 		CR_FINALLY
 		CR_IMPL_END
 	}
@@ -4,6 +4,7 @@
 #define __netlib_x_connectionlistener_hpp_defined
 
 #include "../Socket.hpp"
+#include "../Histograms.hpp"
 #include "../defines.hpp"
 
 #include <libcr/primitives.hpp>
@@ -15,8 +16,40 @@ namespace netlib::x
 	class ConnectionListener : private StreamSocket
 	{
 		friend class ::netlib::Poller;
+		friend class Handoff;
+	public:
+		/** What to do with an accepted connection. */
+		enum class Verdict
+		{
+			/** Hand the connection to the application. */
+			kAccept,
+			/** Close the connection gracefully. */
+			kClose,
+			/** Reset the connection, which is cheaper than closing it gracefully. */
+			kReset
+		};
+
+		/** Decides whether to keep an accepted connection.
+		@param[in] context:
+			The context passed to `filter()`.
+		@param[in] peer:
+			The connection's remote address.
+		@return
+			What to do with the connection. */
+		typedef Verdict (*Filter)(
+			void * context,
+			SocketAddress const& peer);
+	private:
 		/** Whether the connection listener is currently listening for connections. */
 		bool m_listening;
+		/** The filter applied to accepted connections, if any. */
+		Filter m_filter;
+		/** The filter's context. */
+		void * m_filter_context;
+#ifdef NETLIB_HISTOGRAMS
+		/** Times `Accept`. */
+		detail::OperationTimer m_accept_timer;
+#endif
 	public:
 		/** Creates an empty connection listener. */
 		ConnectionListener();
@@ -55,9 +88,27 @@ namespace netlib::x
 		/** Stops listening for incoming connections. */
 		void unlisten();
 
+		/** Sets a filter for incoming connections.
+			Connections rejected by the filter are closed or reset right after being accepted, before they are handed to the application. As `accept()` keeps accepting until a connection passes the filter, rejected connections are drained from the backlog without involving the application.
+		@param[in] filter:
+			The filter, or null to accept all connections.
+		@param[in] context:
+			Passed to the filter. */
+		void filter(
+			Filter filter,
+			void * context);
+
+		/** Accepts a pending incoming connection, if any.
+			Connections rejected by the filter are skipped.
+		@param[out] out:
+			The accepted connection. Closed, unless a connection was accepted.
+		@return
+			`Status::kSuccess` if a connection was accepted, `Status::kNotReady` if no connection is pending, or `Status::kError`. */
+		Status accept(
+			StreamSocket &out);
 
 		/** Accepts an incoming connection.
-			Prerequesite is that the listener must be listening. */
+			Prerequesite is that the listener must be listening. Connections rejected by the filter are skipped. */
 		COROUTINE(Accept, void)
 		CR_STATE(
 			(ConnectionListener *) listener,
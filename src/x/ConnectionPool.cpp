@@ -0,0 +1,151 @@
+#include "ConnectionPool.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	double ConnectionPool::Statistics::hit_rate() const
+	{
+		std::uint64_t total = hits + misses;
+		return total ? double(hits) / double(total) : 0.0;
+	}
+
+	void ConnectionPool::close(
+		BufferedConnection &connection)
+	{
+		connection.discard();
+		connection.close();
+	}
+
+	ConnectionPool::ConnectionPool(
+		std::size_t max_idle,
+		std::size_t max_per_host,
+		std::chrono::steady_clock::duration idle_timeout,
+		std::size_t input_buffer,
+		std::size_t output_buffer):
+		m_hosts(),
+		m_max_idle(max_idle),
+		m_max_per_host(max_per_host),
+		m_idle_timeout(idle_timeout),
+		m_input_buffer(input_buffer),
+		m_output_buffer(output_buffer),
+		m_statistics()
+	{
+		assert(max_idle <= max_per_host);
+	}
+
+	ConnectionPool::~ConnectionPool()
+	{
+		for(auto &host : m_hosts)
+			for(Idle &idle : host.second.idle)
+				close(*idle.connection);
+	}
+
+	std::unique_ptr<BufferedConnection> ConnectionPool::acquire(
+		SocketAddress const& address,
+		bool &reused)
+	{
+		Host &host = m_hosts[address];
+		auto const now = std::chrono::steady_clock::now();
+
+		// Prefer the most recently used connection, as it is the least likely to have been closed.
+		while(!host.idle.empty())
+		{
+			Idle idle = std::move(host.idle.back());
+			host.idle.pop_back();
+
+			if(now - idle.since > m_idle_timeout
+			|| !idle.connection->reusable())
+			{
+				close(*idle.connection);
+				++m_statistics.stale;
+				continue;
+			}
+
+			++host.active;
+			++m_statistics.hits;
+			reused = true;
+			return std::move(idle.connection);
+		}
+
+		++m_statistics.misses;
+
+		if(host.active >= m_max_per_host)
+			return nullptr;
+
+		++host.active;
+		reused = false;
+		return std::make_unique<BufferedConnection>(
+			m_input_buffer,
+			m_output_buffer);
+	}
+
+	void ConnectionPool::release(
+		SocketAddress const& address,
+		std::unique_ptr<BufferedConnection> connection)
+	{
+		auto it = m_hosts.find(address);
+		assert(it != m_hosts.end());
+		Host &host = it->second;
+
+		assert(host.active != 0);
+		--host.active;
+
+		if(connection)
+		{
+			if(!connection->reusable())
+				close(*connection);
+			else if(host.idle.size() >= m_max_idle)
+			{
+				close(*connection);
+				++m_statistics.evicted;
+			} else
+			{
+				host.idle.push_back(Idle{
+					std::move(connection),
+					std::chrono::steady_clock::now()});
+			}
+		}
+
+		if(!host.active && host.idle.empty())
+			m_hosts.erase(it);
+	}
+
+	void ConnectionPool::prune()
+	{
+		auto const now = std::chrono::steady_clock::now();
+
+		for(auto it = m_hosts.begin(); it != m_hosts.end();)
+		{
+			Host &host = it->second;
+
+			// The oldest connections are at the front.
+			while(!host.idle.empty()
+			&& now - host.idle.front().since > m_idle_timeout)
+			{
+				close(*host.idle.front().connection);
+				host.idle.pop_front();
+				++m_statistics.stale;
+			}
+
+			if(!host.active && host.idle.empty())
+				it = m_hosts.erase(it);
+			else
+				++it;
+		}
+	}
+
+	std::size_t ConnectionPool::idle(
+		SocketAddress const& address) const
+	{
+		auto it = m_hosts.find(address);
+		return it == m_hosts.end() ? 0 : it->second.idle.size();
+	}
+
+	std::size_t ConnectionPool::active(
+		SocketAddress const& address) const
+	{
+		auto it = m_hosts.find(address);
+		return it == m_hosts.end() ? 0 : it->second.active;
+	}
+}
@@ -0,0 +1,142 @@
+/** @file ConnectionPool.hpp
+	Contains the netlib::x::ConnectionPool class used for reusing outbound connections. */
+#ifndef __netlib_x_connectionpool_hpp_defined
+#define __netlib_x_connectionpool_hpp_defined
+
+#include "../SocketAddress.hpp"
+#include "../defines.hpp"
+#include "BufferedConnection.hpp"
+
+#include <unordered_map>
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Keeps idle outbound connections open for reuse.
+		Connections are pooled per destination address. Acquiring a connection returns an idle, already connected connection if one is available, which saves the socket creation, handshake, and buffer allocation of a new connection. Otherwise, a new, unconnected connection is returned, which the caller has to connect via `BufferedConnection::Connect`.
+
+		Every acquired connection must be released again, even if it failed, so that the pool can keep track of the connections per host. Idle connections must not be watched by a poller: unwatch connections before releasing them, and watch them again after acquiring them. */
+	class ConnectionPool
+	{
+	public:
+		/** Usage statistics of a connection pool. */
+		struct Statistics
+		{
+			/** How many acquisitions returned an idle connection. */
+			std::uint64_t hits;
+			/** How many acquisitions had no idle connection available. */
+			std::uint64_t misses;
+			/** How many idle connections were closed because they were no longer usable or expired. */
+			std::uint64_t stale;
+			/** How many reusable connections were closed because the idle limit was reached. */
+			std::uint64_t evicted;
+
+			/** The ratio of acquisitions that returned an idle connection. */
+			double hit_rate() const;
+		};
+
+	private:
+		/** An idle connection. */
+		struct Idle
+		{
+			/** The connection. */
+			std::unique_ptr<BufferedConnection> connection;
+			/** When the connection was released. */
+			std::chrono::steady_clock::time_point since;
+		};
+
+		/** The connections to a single destination. */
+		struct Host
+		{
+			/** The idle connections, the most recently released one last. */
+			std::deque<Idle> idle;
+			/** How many connections are currently acquired. */
+			std::size_t active;
+		};
+
+		/** The pooled connections, per destination. */
+		std::unordered_map<SocketAddress, Host> m_hosts;
+		/** The maximum number of idle connections per destination. */
+		std::size_t m_max_idle;
+		/** The maximum number of connections per destination. */
+		std::size_t m_max_per_host;
+		/** How long connections may stay idle. */
+		std::chrono::steady_clock::duration m_idle_timeout;
+		/** The input buffer size of new connections. */
+		std::size_t m_input_buffer;
+		/** The output buffer size of new connections. */
+		std::size_t m_output_buffer;
+		/** The usage statistics. */
+		Statistics m_statistics;
+
+		/** Closes a pooled connection. */
+		static void close(
+			BufferedConnection &connection);
+	public:
+		/** Creates an empty connection pool.
+		@param[in] max_idle:
+			The maximum number of idle connections kept per destination.
+		@param[in] max_per_host:
+			The maximum number of connections per destination, idle or acquired.
+		@param[in] idle_timeout:
+			How long a connection may stay idle before it is closed.
+		@param[in] input_buffer:
+			The input buffer size of new connections, in bytes.
+		@param[in] output_buffer:
+			The output buffer size of new connections, in bytes. */
+		ConnectionPool(
+			std::size_t max_idle,
+			std::size_t max_per_host,
+			std::chrono::steady_clock::duration idle_timeout,
+			std::size_t input_buffer,
+			std::size_t output_buffer);
+
+		ConnectionPool(ConnectionPool const&) = delete;
+		ConnectionPool &operator=(ConnectionPool const&) = delete;
+
+		/** Closes all idle connections. */
+		~ConnectionPool();
+
+		/** Acquires a connection to the given address.
+			Idle connections are checked for liveness before they are returned, which detects connections closed by the peer without blocking.
+		@param[in] address:
+			The destination address.
+		@param[out] reused:
+			Whether the returned connection is an idle, already connected connection. Otherwise, it still has to be connected to `address`.
+		@return
+			The acquired connection, or null if the connection limit for `address` was reached. */
+		std::unique_ptr<BufferedConnection> acquire(
+			SocketAddress const& address,
+			bool &reused);
+
+		/** Releases an acquired connection.
+			If the connection is still usable and the idle limit was not reached, it is kept for reuse, otherwise, it is closed.
+		@param[in] address:
+			The address the connection was acquired for.
+		@param[in] connection:
+			The connection to release. May be null or closed, if the connection was lost. */
+		void release(
+			SocketAddress const& address,
+			std::unique_ptr<BufferedConnection> connection);
+
+		/** Closes all idle connections that exceeded the idle timeout. */
+		void prune();
+
+		/** The number of idle connections to the given address. */
+		std::size_t idle(
+			SocketAddress const& address) const;
+		/** The number of acquired connections to the given address. */
+		std::size_t active(
+			SocketAddress const& address) const;
+
+		/** The pool's usage statistics. */
+		NETLIB_INL Statistics const& statistics() const;
+	};
+}
+
+#include "ConnectionPool.inl"
+
+#endif
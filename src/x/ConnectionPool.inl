@@ -0,0 +1,7 @@
+namespace netlib::x
+{
+	ConnectionPool::Statistics const& ConnectionPool::statistics() const
+	{
+		return m_statistics;
+	}
+}
@@ -0,0 +1,170 @@
+#include "Connector.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	constexpr std::chrono::milliseconds Connector::kDefaultDelay;
+
+	Connector::Connector(
+		std::chrono::steady_clock::duration delay):
+		m_addresses(),
+		m_next(0),
+		m_attempts(),
+		m_winner(),
+		m_last_attempt(),
+		m_delay(delay),
+		m_status(Status::kError)
+	{
+	}
+
+	void Connector::start(
+		std::vector<AddressInfo> const& addresses,
+		port_t port)
+	{
+		cancel();
+		m_winner.close();
+
+		// Split the addresses by family, keeping their order.
+		std::vector<SocketAddress> first, second;
+		for(AddressInfo const& info : addresses)
+		{
+			SocketAddress address = info.address;
+			switch(address.family)
+			{
+			case AddressFamily::kIPv4:
+				address.address.ipv4.port = port;
+				break;
+			case AddressFamily::kIPv6:
+				address.address.ipv6.port = port;
+				break;
+			default:
+				continue;
+			}
+
+			if(first.empty() || first.front().family == address.family)
+				first.push_back(address);
+			else
+				second.push_back(address);
+		}
+
+		// Alternate between the families, starting with the preferred one.
+		m_addresses.clear();
+		for(std::size_t i = 0; i < first.size() || i < second.size(); i++)
+		{
+			if(i < first.size())
+				m_addresses.push_back(first[i]);
+			if(i < second.size())
+				m_addresses.push_back(second[i]);
+		}
+
+		m_next = 0;
+		m_attempts.reserve(m_addresses.size());
+		m_status = Status::kInProgress;
+
+		if(!start_next())
+			m_status = Status::kError;
+		else
+			update();
+	}
+
+	bool Connector::start_next()
+	{
+		while(m_next < m_addresses.size())
+		{
+			SocketAddress const& address = m_addresses[m_next++];
+			StreamSocket socket(address.family);
+
+			m_last_attempt = std::chrono::steady_clock::now();
+
+			switch(socket.connect(address))
+			{
+			case Status::kSuccess:
+			case Status::kInProgress:
+				m_attempts.push_back(std::move(socket));
+				return true;
+			default:
+				// Try the next address immediately.
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	Status Connector::update()
+	{
+		if(m_status != Status::kInProgress)
+			return m_status;
+
+		for(std::size_t i = 0; i < m_attempts.size();)
+		{
+			switch(m_attempts[i].finish_connect())
+			{
+			case Status::kSuccess:
+				{
+					m_winner = std::move(m_attempts[i]);
+					m_attempts.clear();
+					m_next = m_addresses.size();
+					m_status = Status::kSuccess;
+					m_finished.notify_one();
+					return m_status;
+				}
+			case Status::kInProgress:
+				{
+					++i;
+				} break;
+			default:
+				{
+					m_attempts.erase(m_attempts.begin() + i);
+				} break;
+			}
+		}
+
+		// Start the next attempt if all attempts failed, or the last one is taking too long.
+		if(m_attempts.empty()
+		|| std::chrono::steady_clock::now() - m_last_attempt >= m_delay)
+			start_next();
+
+		if(m_attempts.empty())
+		{
+			m_status = Status::kError;
+			m_finished.notify_one();
+		}
+
+		return m_status;
+	}
+
+	void Connector::cancel()
+	{
+		m_attempts.clear();
+		m_next = m_addresses.size();
+		if(m_status == Status::kInProgress)
+		{
+			m_status = Status::kError;
+			m_finished.notify_one();
+		}
+	}
+
+	bool Connector::take(
+		StreamSocket &out)
+	{
+		if(m_status != Status::kSuccess)
+			return false;
+
+		out = std::move(m_winner);
+		m_status = Status::kError;
+		return true;
+	}
+
+	CR_IMPL(Connector::Connect)
+		connector->start(addresses, port);
+
+		while(connector->status() == Status::kInProgress)
+			CR_AWAIT(connector->m_finished.wait());
+
+		if(!connector->take(out))
+			CR_THROW;
+	CR_FINALLY
+	CR_IMPL_END
+}
@@ -0,0 +1,107 @@
+/** @file Connector.hpp
+	Contains the netlib::x::Connector class used for racing connection attempts to multiple addresses. */
+#ifndef __netlib_x_connector_hpp_defined
+#define __netlib_x_connector_hpp_defined
+
+#include "../Socket.hpp"
+#include "../HostInfo.hpp"
+#include "../defines.hpp"
+
+#include <libcr/primitives.hpp>
+#include <libcr/mt/ConditionVariable.hpp>
+
+#include <vector>
+#include <chrono>
+
+namespace netlib::x
+{
+	/** Connects to a host that has multiple addresses, as described by RFC 8305 ("Happy Eyeballs").
+		The addresses are interleaved by address family, starting with the family of the first address. Connection attempts are started one after another: whenever the previous attempt failed, or did not succeed within the attempt delay, the next attempt is started, while the earlier attempts keep running. The first attempt that succeeds wins, and all other attempts are cancelled. This way, an unreachable address or address family only delays the connection by the attempt delay, instead of a full connection timeout.
+
+		The attempts are not watched by a poller. Instead, `update()` has to be called regularly while a connection is being established (for example, after every `Poller::poll()`, with a poll timeout below the attempt delay). It starts new attempts and wakes the `Connect` coroutine once the connection was established or all attempts failed. */
+	class Connector
+	{
+		/** The addresses to connect to, in the order of the attempts. */
+		std::vector<SocketAddress> m_addresses;
+		/** The index of the next address to try. */
+		std::size_t m_next;
+		/** The running attempts. */
+		std::vector<StreamSocket> m_attempts;
+		/** The established connection. */
+		StreamSocket m_winner;
+		/** When the last attempt was started. */
+		std::chrono::steady_clock::time_point m_last_attempt;
+		/** How long to wait for an attempt before starting the next one. */
+		std::chrono::steady_clock::duration m_delay;
+		/** The state of the connection process. */
+		Status m_status;
+		/** Notified when the connection process finished. */
+		cr::mt::ConditionVariable m_finished;
+
+		/** Starts the next attempt.
+		@return
+			Whether there was an address left to try. */
+		bool start_next();
+	public:
+		/** The recommended attempt delay. */
+		static constexpr std::chrono::milliseconds kDefaultDelay{250};
+
+		/** Creates an idle connector.
+		@param[in] delay:
+			How long to wait for an attempt before starting the next one. */
+		explicit Connector(
+			std::chrono::steady_clock::duration delay = kDefaultDelay);
+
+		Connector(Connector const&) = delete;
+		Connector &operator=(Connector const&) = delete;
+
+		/** Starts connecting to the given addresses.
+			Cancels any running attempts.
+		@param[in] addresses:
+			The addresses of the host, as returned by `resolve_name()` or `Resolver`.
+		@param[in] port:
+			The port to connect to. */
+		void start(
+			std::vector<AddressInfo> const& addresses,
+			port_t port);
+
+		/** Checks the running attempts and starts new attempts.
+			Wakes the `Connect` coroutine when the connection process finished.
+		@return
+			`Status::kSuccess` if a connection was established, `Status::kInProgress` while attempts are running, and `Status::kError` if all attempts failed. */
+		Status update();
+
+		/** Cancels all running attempts. */
+		void cancel();
+
+		/** Retrieves the established connection.
+		@param[out] out:
+			The established connection.
+		@return
+			Whether a connection was established. */
+		bool take(
+			StreamSocket &out);
+
+		/** The state of the connection process. */
+		NETLIB_INL Status status() const;
+
+		/** Connects to the first reachable address.
+		@param[in] addresses:
+			The addresses of the host. Must stay valid until the coroutine finished.
+		@param[in] port:
+			The port to connect to.
+		@param[out] out:
+			The established connection. */
+		COROUTINE(Connect, void)
+		CR_STATE(
+			(Connector *) connector,
+			(std::vector<AddressInfo> const&) addresses,
+			(port_t) port,
+			(StreamSocket &) out)
+		CR_EXTERNAL
+	};
+}
+
+#include "Connector.inl"
+
+#endif
@@ -0,0 +1,7 @@
+namespace netlib::x
+{
+	Status Connector::status() const
+	{
+		return m_status;
+	}
+}
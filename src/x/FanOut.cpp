@@ -0,0 +1,255 @@
+#include "FanOut.hpp"
+
+#include <new>
+#include <cstring>
+#include <cassert>
+
+namespace netlib::x
+{
+	SharedMessage::SharedMessage(
+		void const * data,
+		std::size_t size,
+		std::uint64_t key):
+		m_block(new (::operator new(sizeof(Block) + size)) Block{ {1}, key, size })
+	{
+		std::memcpy(reinterpret_cast<std::uint8_t *>(m_block + 1), data, size);
+	}
+
+	void SharedMessage::release() noexcept
+	{
+		if(m_block && m_block->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			m_block->~Block();
+			::operator delete(m_block);
+		}
+		m_block = nullptr;
+	}
+
+	SharedMessage &SharedMessage::operator=(
+		SharedMessage const& other) noexcept
+	{
+		Block * const block = other.m_block;
+		if(block)
+			block->references.fetch_add(1, std::memory_order_relaxed);
+		release();
+		m_block = block;
+		return *this;
+	}
+
+	SharedMessage &SharedMessage::operator=(
+		SharedMessage && other) noexcept
+	{
+		if(this != &other)
+		{
+			release();
+			m_block = other.m_block;
+			other.m_block = nullptr;
+		}
+		return *this;
+	}
+
+	FanOut::Subscriber::Subscriber(
+		BufferedConnection &connection,
+		std::size_t queue_limit):
+		m_connection(&connection),
+		m_queue(queue_limit),
+		m_first(0),
+		m_count(0),
+		m_offset(0),
+		m_index(0),
+		m_dropped(0),
+		m_pending(false),
+		m_overflowed(false)
+	{
+	}
+
+	void FanOut::Subscriber::remove(
+		std::size_t position)
+	{
+		assert(position < m_count);
+
+		// Shift the older messages up by one, which is cheap as only the front is ever removed while it is partially sent.
+		for(std::size_t i = position; i; i--)
+			at(i) = std::move(at(i - 1));
+		at(0) = SharedMessage();
+		m_first = (m_first + 1) % m_queue.size();
+		--m_count;
+	}
+
+	FanOut::FanOut(
+		std::size_t queue_limit,
+		SlowPolicy policy):
+		m_queue_limit(queue_limit),
+		m_policy(policy),
+		m_subscribers(),
+		m_pending(),
+		m_overflowed()
+	{
+		assert(queue_limit >= 2);
+	}
+
+	FanOut::Subscriber * FanOut::subscribe(
+		BufferedConnection &connection)
+	{
+		m_subscribers.emplace_back(new Subscriber(connection, m_queue_limit));
+		Subscriber * subscriber = m_subscribers.back().get();
+		subscriber->m_index = m_subscribers.size() - 1;
+		return subscriber;
+	}
+
+	void FanOut::unsubscribe(
+		Subscriber * subscriber)
+	{
+		if(subscriber->m_pending)
+			for(Subscriber *& pending : m_pending)
+				if(pending == subscriber)
+				{
+					pending = m_pending.back();
+					m_pending.pop_back();
+					break;
+				}
+
+		if(subscriber->m_overflowed)
+			for(Subscriber *& overflowed : m_overflowed)
+				if(overflowed == subscriber)
+				{
+					overflowed = m_overflowed.back();
+					m_overflowed.pop_back();
+					break;
+				}
+
+		std::size_t const index = subscriber->m_index;
+		if(index != m_subscribers.size() - 1)
+		{
+			m_subscribers[index] = std::move(m_subscribers.back());
+			m_subscribers[index]->m_index = index;
+		}
+		m_subscribers.pop_back();
+	}
+
+	void FanOut::enqueue(
+		Subscriber &subscriber,
+		SharedMessage const& message)
+	{
+		// Empty messages carry nothing to send.
+		if(subscriber.m_overflowed || !message.size())
+			return;
+
+		// A partially sent message must be completed, or the stream would be corrupted.
+		std::size_t const replaceable = subscriber.m_offset ? 1 : 0;
+
+		if(m_policy == SlowPolicy::kCoalesce && message.key())
+			for(std::size_t i = replaceable; i < subscriber.m_count; i++)
+				if(subscriber.at(i).key() == message.key())
+				{
+					subscriber.at(i) = message;
+					++subscriber.m_dropped;
+					return;
+				}
+
+		if(subscriber.m_count == subscriber.m_queue.size())
+		{
+			if(m_policy == SlowPolicy::kDisconnect)
+			{
+				subscriber.m_overflowed = true;
+				m_overflowed.push_back(&subscriber);
+				return;
+			}
+
+			subscriber.remove(replaceable);
+			++subscriber.m_dropped;
+		}
+
+		subscriber.at(subscriber.m_count++) = message;
+		if(!subscriber.m_pending)
+		{
+			subscriber.m_pending = true;
+			m_pending.push_back(&subscriber);
+		}
+	}
+
+	void FanOut::publish(
+		SharedMessage const& message)
+	{
+		for(std::unique_ptr<Subscriber> const& subscriber : m_subscribers)
+			enqueue(*subscriber, message);
+	}
+
+	void FanOut::publish(
+		Subscriber &subscriber,
+		SharedMessage const& message)
+	{
+		enqueue(subscriber, message);
+	}
+
+	bool FanOut::flush(
+		Subscriber &subscriber)
+	{
+		BufferedConnection &connection = *subscriber.m_connection;
+		for(;;)
+		{
+			DataSlice slices[Socket::kMaxSlices - 2];
+			std::size_t count = 0;
+			for(; count < subscriber.m_count && count < Socket::kMaxSlices - 2; count++)
+			{
+				SharedMessage const& message = subscriber.at(count);
+				std::size_t const offset = count ? 0 : subscriber.m_offset;
+				slices[count] = DataSlice{ message.data() + offset, message.size() - offset };
+			}
+
+			if(!count && connection.output().empty())
+				break;
+
+			std::size_t accepted;
+			if(!connection.write_gathered(slices, count, accepted))
+			{
+				if(!subscriber.m_overflowed)
+				{
+					subscriber.m_overflowed = true;
+					m_overflowed.push_back(&subscriber);
+				}
+				return false;
+			}
+			// Trying again would not make progress.
+			if(!accepted)
+				break;
+
+			// Release the messages that were sent or buffered completely.
+			while(accepted)
+			{
+				std::size_t const rest = subscriber.at(0).size() - subscriber.m_offset;
+				if(accepted < rest)
+				{
+					subscriber.m_offset += accepted;
+					break;
+				}
+				accepted -= rest;
+				subscriber.m_offset = 0;
+				subscriber.remove(0);
+			}
+
+			// Stop once the socket stops taking data, which leaves the rest in the output buffer.
+			if(!subscriber.m_count || !connection.output().empty())
+				break;
+		}
+
+		return !subscriber.m_count && connection.output().empty();
+	}
+
+	void FanOut::flush(
+		std::vector<Subscriber *> &disconnect)
+	{
+		std::size_t kept = 0;
+		for(Subscriber * subscriber : m_pending)
+		{
+			if(subscriber->m_overflowed || flush(*subscriber))
+				subscriber->m_pending = false;
+			else
+				m_pending[kept++] = subscriber;
+		}
+		m_pending.resize(kept);
+
+		disconnect.insert(disconnect.end(), m_overflowed.begin(), m_overflowed.end());
+		m_overflowed.clear();
+	}
+}
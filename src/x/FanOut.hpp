@@ -0,0 +1,197 @@
+/** @file FanOut.hpp
+	Contains the netlib::x::FanOut class used for broadcasting messages to many connections without copying them per connection. */
+#ifndef __netlib_x_fanout_hpp_defined
+#define __netlib_x_fanout_hpp_defined
+
+#include "BufferedConnection.hpp"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** An immutable, reference counted message.
+		Copies share the same memory, so a message can be queued on any number of connections after it was encoded once. The reference count is atomic, so copies can be released by different threads. */
+	class SharedMessage
+	{
+		/** The shared header, which is directly followed by the message. */
+		struct Block
+		{
+			/** How many `SharedMessage`s refer to the block. */
+			std::atomic<std::size_t> references;
+			/** The message's coalescing key. */
+			std::uint64_t key;
+			/** The message's size, in bytes. */
+			std::size_t size;
+		};
+
+		/** The shared block, or null. */
+		Block * m_block;
+
+		/** Releases the reference to the block. */
+		void release() noexcept;
+	public:
+		/** Creates an empty handle. */
+		inline SharedMessage() noexcept;
+		/** Copies a message into a new shared block.
+		@param[in] data:
+			The encoded message, as it is sent over the wire.
+		@param[in] size:
+			The message's size, in bytes.
+		@param[in] key:
+			The message's coalescing key for `SlowPolicy::kCoalesce`, or 0. Queued messages are replaced by newer messages with the same key. */
+		SharedMessage(
+			void const * data,
+			std::size_t size,
+			std::uint64_t key = 0);
+
+		inline SharedMessage(
+			SharedMessage const& other) noexcept;
+		inline SharedMessage(
+			SharedMessage && other) noexcept;
+		SharedMessage &operator=(
+			SharedMessage const& other) noexcept;
+		SharedMessage &operator=(
+			SharedMessage && other) noexcept;
+		inline ~SharedMessage();
+
+		/** Whether the handle refers to a message. */
+		inline explicit operator bool() const noexcept;
+		/** The message. */
+		inline std::uint8_t const * data() const noexcept;
+		/** The message's size, in bytes. */
+		inline std::size_t size() const noexcept;
+		/** The message's coalescing key. */
+		inline std::uint64_t key() const noexcept;
+	};
+
+	/** How to treat subscribers whose queue is full because they do not read fast enough. */
+	enum class SlowPolicy
+	{
+		/** Drop the oldest queued message. */
+		kDropOldest,
+		/** Report the subscriber, so that it can be disconnected. */
+		kDisconnect,
+		/** Replace queued messages by newer messages with the same key, so that only the latest state per key is delivered. Drops the oldest message if the queue is full of distinct keys. */
+		kCoalesce
+	};
+
+	/** Broadcasts messages to many connections.
+		A message is encoded once into a `SharedMessage`, and a reference to it is queued for every subscriber. Queues are sent with a single gathered write per subscriber and flush, and a message is only copied into a connection's output buffer if the socket did not take all of it. Subscribers that do not keep up are handled according to a `SlowPolicy`, so that slow readers neither block the publisher nor make memory grow without bounds.
+
+		The fan-out does not own the connections, and must only be used by one thread at a time. Call `flush()` after every `Poller::poll()`. */
+	class FanOut
+	{
+	public:
+		/** A subscribed connection and its queue. */
+		class Subscriber
+		{
+			friend class FanOut;
+			/** The connection. */
+			BufferedConnection * m_connection;
+			/** The ring of queued messages. */
+			std::vector<SharedMessage> m_queue;
+			/** The index of the oldest queued message. */
+			std::size_t m_first;
+			/** The number of queued messages. */
+			std::size_t m_count;
+			/** How many bytes of the oldest queued message were already sent or buffered. */
+			std::size_t m_offset;
+			/** The subscriber's index in the fan-out's subscriber list. */
+			std::size_t m_index;
+			/** How many messages were dropped or replaced. */
+			std::uint64_t m_dropped;
+			/** Whether the subscriber is in the list of subscribers with data to send. */
+			bool m_pending;
+			/** Whether the subscriber's queue overflowed under `SlowPolicy::kDisconnect`, or its connection failed. */
+			bool m_overflowed;
+
+			/** The queued message at the given position, counted from the oldest. */
+			inline SharedMessage &at(
+				std::size_t position);
+			/** Removes the queued message at the given position, counted from the oldest, keeping the others in order. */
+			void remove(
+				std::size_t position);
+		public:
+			Subscriber(
+				BufferedConnection &connection,
+				std::size_t queue_limit);
+
+			/** The connection. */
+			inline BufferedConnection &connection() const noexcept;
+			/** The number of queued messages, excluding data already in the connection's output buffer. */
+			inline std::size_t queued() const noexcept;
+			/** How many messages were dropped or replaced by the slow subscriber policy. */
+			inline std::uint64_t dropped() const noexcept;
+		};
+	private:
+		/** The maximum number of queued messages per subscriber. */
+		std::size_t m_queue_limit;
+		/** How slow subscribers are treated. */
+		SlowPolicy m_policy;
+		/** All subscribers. */
+		std::vector<std::unique_ptr<Subscriber>> m_subscribers;
+		/** The subscribers with queued messages or buffered output. */
+		std::vector<Subscriber *> m_pending;
+		/** The subscribers whose queue overflowed or whose connection failed, which were not reported yet. */
+		std::vector<Subscriber *> m_overflowed;
+
+		/** Queues a message for a subscriber, applying the slow subscriber policy. */
+		void enqueue(
+			Subscriber &subscriber,
+			SharedMessage const& message);
+	public:
+		/** Creates a fan-out.
+		@param[in] queue_limit:
+			The maximum number of queued messages per subscriber. At least 2.
+		@param[in] policy:
+			How to treat subscribers whose queue is full. */
+		FanOut(
+			std::size_t queue_limit,
+			SlowPolicy policy);
+
+		FanOut(FanOut const&) = delete;
+		FanOut &operator=(FanOut const&) = delete;
+
+		/** Adds a subscriber.
+		@param[in] connection:
+			The subscriber's connection, which must stay valid until it is unsubscribed. A small output buffer keeps slow subscribers from holding copies of many messages.
+		@return
+			The subscriber, which stays valid until it is unsubscribed. */
+		Subscriber * subscribe(
+			BufferedConnection &connection);
+		/** Removes a subscriber, and drops its queued messages.
+			Data that is already in the connection's output buffer is kept. */
+		void unsubscribe(
+			Subscriber * subscriber);
+
+		/** Queues a message for all subscribers. It is sent by the next `flush()`. Empty messages are ignored. */
+		void publish(
+			SharedMessage const& message);
+		/** Queues a message for a single subscriber. It is sent by the next `flush()`. Empty messages are ignored. */
+		void publish(
+			Subscriber &subscriber,
+			SharedMessage const& message);
+
+		/** Sends the queued messages of all subscribers that have any.
+		@param[out] disconnect:
+			Receives the subscribers whose queue overflowed under `SlowPolicy::kDisconnect`, or whose connection failed. Each is reported once, and has to be unsubscribed and closed by the caller. */
+		void flush(
+			std::vector<Subscriber *> &disconnect);
+		/** Sends a subscriber's queued messages, for example, when its connection became writable.
+			If the connection failed, the subscriber is reported by the next `flush()` of all subscribers.
+		@return
+			Whether all queued messages and buffered output were sent. */
+		bool flush(
+			Subscriber &subscriber);
+
+		/** The number of subscribers. */
+		inline std::size_t subscribers() const noexcept;
+	};
+}
+
+#include "FanOut.inl"
+
+#endif
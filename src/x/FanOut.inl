@@ -0,0 +1,73 @@
+namespace netlib::x
+{
+	SharedMessage::SharedMessage() noexcept:
+		m_block(nullptr)
+	{
+	}
+
+	SharedMessage::SharedMessage(
+		SharedMessage const& other) noexcept:
+		m_block(other.m_block)
+	{
+		if(m_block)
+			m_block->references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	SharedMessage::SharedMessage(
+		SharedMessage && other) noexcept:
+		m_block(other.m_block)
+	{
+		other.m_block = nullptr;
+	}
+
+	SharedMessage::~SharedMessage()
+	{
+		release();
+	}
+
+	SharedMessage::operator bool() const noexcept
+	{
+		return m_block != nullptr;
+	}
+
+	std::uint8_t const * SharedMessage::data() const noexcept
+	{
+		return reinterpret_cast<std::uint8_t const *>(m_block + 1);
+	}
+
+	std::size_t SharedMessage::size() const noexcept
+	{
+		return m_block ? m_block->size : 0;
+	}
+
+	std::uint64_t SharedMessage::key() const noexcept
+	{
+		return m_block ? m_block->key : 0;
+	}
+
+	SharedMessage &FanOut::Subscriber::at(
+		std::size_t position)
+	{
+		return m_queue[(m_first + position) % m_queue.size()];
+	}
+
+	BufferedConnection &FanOut::Subscriber::connection() const noexcept
+	{
+		return *m_connection;
+	}
+
+	std::size_t FanOut::Subscriber::queued() const noexcept
+	{
+		return m_count;
+	}
+
+	std::uint64_t FanOut::Subscriber::dropped() const noexcept
+	{
+		return m_dropped;
+	}
+
+	std::size_t FanOut::subscribers() const noexcept
+	{
+		return m_subscribers.size();
+	}
+}
@@ -0,0 +1,199 @@
+#include "Handoff.hpp"
+
+#include <vector>
+#include <cstring>
+#include <cassert>
+
+namespace netlib::x
+{
+	/** The header preceding every handoff message. */
+	struct HandoffHeader
+	{
+		/** Identifies handoff messages. */
+		std::uint32_t magic;
+		/** The kind of message. */
+		Handoff::Kind kind;
+		/** Whether a listener was listening. */
+		std::uint8_t listening;
+		/** The input buffer capacity of a connection. */
+		std::uint32_t input_buffer;
+		/** The output buffer capacity of a connection. */
+		std::uint32_t output_buffer;
+		/** The amount of buffered input following the header. */
+		std::uint32_t buffered;
+	};
+
+	static constexpr std::uint32_t kHandoffMagic = 0x6e6c6831; // "nlh1"
+
+	static Status send_message(
+		Socket &channel,
+		HandoffHeader const& header,
+		void const * payload,
+		Socket const * socket)
+	{
+		std::vector<std::uint8_t> message(sizeof(header) + header.buffered);
+		std::memcpy(message.data(), &header, sizeof(header));
+		if(header.buffered)
+			std::memcpy(message.data() + sizeof(header), payload, header.buffered);
+
+		std::size_t sent;
+		Status status = channel.send_sockets(
+			message.data(),
+			message.size(),
+			&socket,
+			socket ? 1 : 0,
+			sent);
+
+		// Message based channels never send partially.
+		if(status == Status::kSuccess && sent != message.size())
+			return Status::kError;
+
+		return status;
+	}
+
+	Status Handoff::send(
+		Socket &channel,
+		ConnectionListener &listener)
+	{
+		assert(channel.type() != SocketType::kStream);
+		assert(listener.exists());
+
+		HandoffHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = kHandoffMagic;
+		header.kind = Kind::kListener;
+		header.listening = listener.listening();
+
+		Status status = send_message(
+			channel,
+			header,
+			nullptr,
+			static_cast<Socket const *>(&listener));
+
+		if(status == Status::kSuccess)
+		{
+			// Do not shut down, the other process now owns the socket.
+			listener.StreamSocket::close();
+			listener.m_listening = false;
+		}
+
+		return status;
+	}
+
+	Status Handoff::send(
+		Socket &channel,
+		BufferedConnection &connection)
+	{
+		assert(channel.type() != SocketType::kStream);
+		assert(connection.exists());
+
+		if(!connection.m_output.empty()
+		|| connection.m_input.size() > kMaxBufferedInput)
+			return Status::kError;
+
+		HandoffHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = kHandoffMagic;
+		header.kind = Kind::kConnection;
+		header.input_buffer = connection.m_input.capacity();
+		header.output_buffer = connection.m_output.capacity();
+		header.buffered = connection.m_input.size();
+
+		std::vector<std::uint8_t> input(header.buffered);
+		connection.m_input.peek(input.data(), input.size());
+
+		Status status = send_message(
+			channel,
+			header,
+			input.data(),
+			static_cast<Socket const *>(&connection));
+
+		if(status == Status::kSuccess)
+		{
+			// Do not shut down, the other process now owns the socket.
+			connection.discard();
+			connection.StreamSocket::close();
+		}
+
+		return status;
+	}
+
+	Status Handoff::finish(
+		Socket &channel)
+	{
+		assert(channel.type() != SocketType::kStream);
+
+		HandoffHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = kHandoffMagic;
+		header.kind = Kind::kDone;
+
+		return send_message(channel, header, nullptr, nullptr);
+	}
+
+	Status Handoff::receive(
+		Socket &channel,
+		Kind &kind,
+		ConnectionListener &listener,
+		std::unique_ptr<BufferedConnection> &connection)
+	{
+		assert(channel.type() != SocketType::kStream);
+
+		std::vector<std::uint8_t> message(sizeof(HandoffHeader) + kMaxBufferedInput);
+		StreamSocket socket;
+		Socket * sockets[] = { &socket };
+
+		std::size_t received, received_sockets;
+		Status status = channel.recv_sockets(
+			message.data(),
+			message.size(),
+			sockets,
+			_countof(sockets),
+			received,
+			received_sockets);
+
+		if(status != Status::kSuccess)
+			return status;
+
+		HandoffHeader header;
+		if(received < sizeof(header))
+			return Status::kError;
+		std::memcpy(&header, message.data(), sizeof(header));
+
+		if(header.magic != kHandoffMagic
+		|| received != sizeof(header) + header.buffered
+		|| received_sockets != (header.kind != Kind::kDone))
+			return Status::kError;
+
+		switch(header.kind)
+		{
+		case Kind::kListener:
+			{
+				listener.unlisten();
+				static_cast<StreamSocket &>(listener) = std::move(socket);
+				listener.m_listening = header.listening;
+			} break;
+		case Kind::kConnection:
+			{
+				if(header.buffered > header.input_buffer)
+					return Status::kError;
+
+				connection.reset(new BufferedConnection(
+					std::move(socket),
+					header.input_buffer,
+					header.output_buffer));
+
+				connection->m_input.append(
+					message.data() + sizeof(header),
+					header.buffered);
+			} break;
+		case Kind::kDone:
+			break;
+		default:
+			return Status::kError;
+		}
+
+		kind = header.kind;
+		return Status::kSuccess;
+	}
+}
@@ -0,0 +1,88 @@
+/** @file Handoff.hpp
+	Contains the netlib::x::Handoff class used for passing listeners and connections to another process. */
+#ifndef __netlib_x_handoff_hpp_defined
+#define __netlib_x_handoff_hpp_defined
+
+#include "../Socket.hpp"
+#include "../defines.hpp"
+#include "BufferedConnection.hpp"
+#include "ConnectionListener.hpp"
+
+#include <memory>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Passes listeners and connections to another process.
+		This is used for restarting a server without dropping connections: the old process sends its listeners and idle connections over a Unix domain channel to the new process, which adopts them and continues serving them. The channel must preserve message boundaries, i.e., it must be a datagram or sequenced packet socket, such as those created by `DatagramSocket::pair()`.
+
+		Every listener or connection is sent as a single message that carries its socket handle. Connections also carry their unconsumed buffered input, so that no received data is lost. Once an object was sent, it is closed locally, without shutting down the underlying socket, which is now owned by the receiving process. */
+	class Handoff
+	{
+	public:
+		/** The kinds of objects that can be handed off. */
+		enum class Kind : std::uint8_t
+		{
+			/** A connection listener. */
+			kListener,
+			/** A buffered connection. */
+			kConnection,
+			/** Marks the end of the handoff. */
+			kDone
+		};
+
+		/** The maximum amount of buffered input a connection may have to be handed off. */
+		static constexpr std::size_t kMaxBufferedInput = 128 * 1024;
+
+		/** Sends a listener to the other process.
+			On success, the listener is closed locally, but keeps listening in the receiving process.
+		@param[in] channel:
+			The channel to send the listener over.
+		@param[in,out] listener:
+			The listener to send.
+		@return
+			Whether the operation succeeded. */
+		static Status send(
+			Socket &channel,
+			ConnectionListener &listener);
+
+		/** Sends a connection to the other process.
+			The connection must not have any buffered output, and at most `kMaxBufferedInput` bytes of buffered input. On success, the connection is closed locally, but stays open in the receiving process.
+		@param[in] channel:
+			The channel to send the connection over.
+		@param[in,out] connection:
+			The connection to send.
+		@return
+			Whether the operation succeeded. */
+		static Status send(
+			Socket &channel,
+			BufferedConnection &connection);
+
+		/** Tells the other process that all objects were sent.
+		@param[in] channel:
+			The channel to send the notification over.
+		@return
+			Whether the operation succeeded. */
+		static Status finish(
+			Socket &channel);
+
+		/** Receives the next handed off object.
+		@param[in] channel:
+			The channel to receive from.
+		@param[out] kind:
+			On success, what kind of message was received.
+		@param[out] listener:
+			If `kind` is `Kind::kListener`, receives the listener. Any previously held socket is closed.
+		@param[out] connection:
+			If `kind` is `Kind::kConnection`, receives the connection, including its buffered input.
+		@return
+			Whether the operation succeeded. Returns `Status::kNotReady` if no message is pending. */
+		static Status receive(
+			Socket &channel,
+			Kind &kind,
+			ConnectionListener &listener,
+			std::unique_ptr<BufferedConnection> &connection);
+	};
+}
+
+#endif
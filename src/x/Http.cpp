@@ -0,0 +1,665 @@
+#include "Http.hpp"
+
+#include <cstring>
+#include <cassert>
+
+namespace netlib::x::http
+{
+	namespace
+	{
+		/** Whether a character may appear in a token (RFC 7230, section 3.2.6). */
+		struct TokenTable
+		{
+			bool table[256];
+
+			constexpr TokenTable():
+				table()
+			{
+				for(unsigned c = '0'; c <= '9'; c++)
+					table[c] = true;
+				for(unsigned c = 'a'; c <= 'z'; c++)
+					table[c] = table[c - 'a' + 'A'] = true;
+				for(char c : std::string_view("!#$%&'*+-.^_`|~"))
+					table[static_cast<unsigned char>(c)] = true;
+			}
+		};
+
+		constexpr TokenTable kToken;
+
+		inline bool is_token(
+			char c)
+		{
+			return kToken.table[static_cast<unsigned char>(c)];
+		}
+
+		/** Whether a character may appear in a header field value: visible characters, whitespace, and obsolete text. */
+		inline bool is_value(
+			char c)
+		{
+			unsigned char const u = static_cast<unsigned char>(c);
+			return u >= 0x20 ? u != 0x7f : u == '\t';
+		}
+
+		/** Compares with a lowercase name, ignoring case. Only correct for names consisting of letters, digits, and '-'. */
+		inline bool equals(
+			std::string_view text,
+			std::string_view lowercase)
+		{
+			if(text.size() != lowercase.size())
+				return false;
+			for(std::size_t i = 0; i < text.size(); i++)
+				if((text[i] | 0x20) != lowercase[i])
+					return false;
+			return true;
+		}
+
+		/** Checks whether a comma-separated list contains a token, ignoring case. */
+		inline bool contains(
+			std::string_view list,
+			std::string_view lowercase)
+		{
+			while(!list.empty())
+			{
+				std::size_t const comma = list.find(',');
+				std::string_view element = list.substr(0, comma);
+				while(!element.empty() && (element.front() == ' ' || element.front() == '\t'))
+					element.remove_prefix(1);
+				while(!element.empty() && (element.back() == ' ' || element.back() == '\t'))
+					element.remove_suffix(1);
+				if(equals(element, lowercase))
+					return true;
+				if(comma == std::string_view::npos)
+					break;
+				list.remove_prefix(comma + 1);
+			}
+			return false;
+		}
+
+		/** Checks whether the last element of a comma-separated list is a token, ignoring case. */
+		inline bool ends_with(
+			std::string_view list,
+			std::string_view lowercase)
+		{
+			std::size_t const comma = list.rfind(',');
+			if(comma != std::string_view::npos)
+				list.remove_prefix(comma + 1);
+			while(!list.empty() && (list.front() == ' ' || list.front() == '\t'))
+				list.remove_prefix(1);
+			return equals(list, lowercase);
+		}
+
+		/** Consumes a line break. */
+		inline bool line_break(
+			char const * &p)
+		{
+			if(*p == '\r')
+				++p;
+			return *p++ == '\n';
+		}
+
+		/** Parses "HTTP/1.x".
+		@return
+			Whether the version was valid. */
+		bool parse_version(
+			char const * &p,
+			char const * end,
+			unsigned &minor_version)
+		{
+			if(end - p < 8 || std::memcmp(p, "HTTP/1.", 7) || p[7] < '0' || p[7] > '9')
+				return false;
+			minor_version = unsigned(p[7] - '0');
+			p += 8;
+			return true;
+		}
+
+		/** Parses the header fields up to and including the empty line that ends the head.
+			The head is known to end with an empty line before `end`, so lookahead is bounded by it. */
+		ParseStatus parse_headers(
+			char const * p,
+			char const * end,
+			Message &out,
+			bool request)
+		{
+			out.header_count = 0;
+			out.content_length = kNoLength;
+			out.chunked = false;
+			out.keep_alive = out.minor_version >= 1;
+			bool encoded = false;
+
+			while(*p != '\r' && *p != '\n')
+			{
+				if(out.header_count == kMaxHeaders)
+					return ParseStatus::kTooLarge;
+
+				// Obsolete line folding and whitespace before the colon are rejected.
+				char const * const name = p;
+				while(is_token(*p))
+					++p;
+				if(p == name || *p != ':')
+					return ParseStatus::kInvalid;
+				Header &header = out.headers[out.header_count++];
+				header.name = std::string_view(name, std::size_t(p - name));
+
+				++p;
+				while(*p == ' ' || *p == '\t')
+					++p;
+				char const * const value = p;
+				while(is_value(*p))
+					++p;
+				char const * value_end = p;
+				while(value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+					--value_end;
+				header.value = std::string_view(value, std::size_t(value_end - value));
+				if(!line_break(p) || p > end)
+					return ParseStatus::kInvalid;
+
+				if(equals(header.name, "content-length"))
+				{
+					if(header.value.empty())
+						return ParseStatus::kInvalid;
+					std::uint64_t length = 0;
+					for(char c : header.value)
+					{
+						if(c < '0' || c > '9' || length > (kNoLength - 10) / 10)
+							return ParseStatus::kInvalid;
+						length = length * 10 + std::uint64_t(c - '0');
+					}
+					// Conflicting lengths allow request smuggling.
+					if(out.content_length != kNoLength && out.content_length != length)
+						return ParseStatus::kInvalid;
+					out.content_length = length;
+				} else if(equals(header.name, "transfer-encoding"))
+				{
+					encoded = true;
+					out.chunked = ends_with(header.value, "chunked");
+				} else if(equals(header.name, "connection"))
+				{
+					if(contains(header.value, "close"))
+						out.keep_alive = false;
+					else if(contains(header.value, "keep-alive"))
+						out.keep_alive = true;
+				}
+			}
+
+			if(request && encoded)
+			{
+				// A request body whose length cannot be determined, or that has two lengths, is rejected (RFC 7230, section 3.3.3).
+				if(!out.chunked || out.content_length != kNoLength)
+					return ParseStatus::kInvalid;
+			}
+			if(out.chunked)
+				out.content_length = kNoLength;
+
+			return line_break(p) && p == end
+				? ParseStatus::kComplete
+				: ParseStatus::kInvalid;
+		}
+	}
+
+	Header const * Message::find(
+		std::string_view name) const
+	{
+		for(std::size_t i = 0; i < header_count; i++)
+			if(equals(headers[i].name, name))
+				return &headers[i];
+		return nullptr;
+	}
+
+	bool Message::has_token(
+		std::string_view name,
+		std::string_view token) const
+	{
+		for(std::size_t i = 0; i < header_count; i++)
+			if(equals(headers[i].name, name) && contains(headers[i].value, token))
+				return true;
+		return false;
+	}
+
+	HeadParser::HeadParser(
+		std::size_t max_head_size):
+		m_scanned(0),
+		m_max_head_size(max_head_size)
+	{
+	}
+
+	ParseStatus HeadParser::scan(
+		char const * data,
+		std::size_t size,
+		std::size_t &head_size,
+		std::size_t &start)
+	{
+		// Empty lines before a head are ignored (RFC 7230, section 3.5).
+		head_size = 0;
+		start = 0;
+		while(start < size && (data[start] == '\r' || data[start] == '\n'))
+			++start;
+		if(m_scanned < start)
+			m_scanned = start;
+
+		// The head ends with an empty line: "\n\n" or "\n\r\n".
+		char const * const end = data + size;
+		for(char const * p = data + m_scanned;
+			(p = static_cast<char const *>(std::memchr(p, '\n', std::size_t(end - p))));
+			++p)
+		{
+			if(end - p >= 2 && p[1] == '\n')
+			{
+				head_size = std::size_t(p + 2 - data);
+				break;
+			}
+			if(end - p >= 3 && p[1] == '\r' && p[2] == '\n')
+			{
+				head_size = std::size_t(p + 3 - data);
+				break;
+			}
+			if(end - p < 3)
+				break;
+		}
+
+		if(!head_size)
+		{
+			if(size - start > m_max_head_size)
+				return ParseStatus::kTooLarge;
+			// A terminator starting in the last two bytes may not be complete yet.
+			m_scanned = size >= 2 ? size - 2 : 0;
+			return ParseStatus::kIncomplete;
+		}
+
+		m_scanned = 0;
+		if(head_size - start > m_max_head_size)
+			return ParseStatus::kTooLarge;
+		return ParseStatus::kComplete;
+	}
+
+	ParseStatus HeadParser::parse(
+		char const * data,
+		std::size_t size,
+		Request &out)
+	{
+		std::size_t head_size, start;
+		ParseStatus status = scan(data, size, head_size, start);
+		if(status != ParseStatus::kComplete)
+			return status;
+
+		char const * const end = data + head_size;
+		char const * p = data + start;
+
+		char const * const method = p;
+		while(is_token(*p))
+			++p;
+		if(p == method || *p != ' ')
+			return ParseStatus::kInvalid;
+		out.method = std::string_view(method, std::size_t(p - method));
+
+		char const * const target = ++p;
+		while(static_cast<unsigned char>(*p) > ' ' && *p != 0x7f)
+			++p;
+		if(p == target || *p != ' ')
+			return ParseStatus::kInvalid;
+		out.target = std::string_view(target, std::size_t(p - target));
+
+		++p;
+		if(!parse_version(p, end, out.minor_version) || !line_break(p))
+			return ParseStatus::kInvalid;
+
+		out.head_size = head_size;
+		return parse_headers(p, end, out, true);
+	}
+
+	ParseStatus HeadParser::parse(
+		char const * data,
+		std::size_t size,
+		Response &out)
+	{
+		std::size_t head_size, start;
+		ParseStatus status = scan(data, size, head_size, start);
+		if(status != ParseStatus::kComplete)
+			return status;
+
+		char const * const end = data + head_size;
+		char const * p = data + start;
+
+		if(!parse_version(p, end, out.minor_version) || *p++ != ' ')
+			return ParseStatus::kInvalid;
+
+		out.status = 0;
+		for(int i = 0; i < 3; i++, p++)
+		{
+			if(*p < '0' || *p > '9')
+				return ParseStatus::kInvalid;
+			out.status = out.status * 10 + unsigned(*p - '0');
+		}
+
+		// The reason phrase may be empty, and some servers omit the space before it.
+		if(*p == ' ')
+			++p;
+		char const * const reason = p;
+		while(is_value(*p))
+			++p;
+		out.reason = std::string_view(reason, std::size_t(p - reason));
+		if(!line_break(p))
+			return ParseStatus::kInvalid;
+
+		out.head_size = head_size;
+		return parse_headers(p, end, out, false);
+	}
+
+	/** Parses a head at the beginning of a connection's input buffer, linearizing the buffer only if the head wraps around its edge. */
+	template<class Head>
+	static ParseStatus parse_input(
+		HeadParser &parser,
+		BufferedConnection &connection,
+		Head &out)
+	{
+		util::Buffer const& input = connection.input();
+		ParseStatus status = parser.parse(
+			static_cast<char const *>(input.data()),
+			input.continuous_data(),
+			out);
+
+		if(status == ParseStatus::kIncomplete && input.wrapping())
+		{
+			connection.linearize_input();
+			status = parser.parse(
+				static_cast<char const *>(input.data()),
+				input.size(),
+				out);
+		}
+
+		return status;
+	}
+
+	ParseStatus HeadParser::parse(
+		BufferedConnection &connection,
+		Request &out)
+	{
+		return parse_input(*this, connection, out);
+	}
+
+	ParseStatus HeadParser::parse(
+		BufferedConnection &connection,
+		Response &out)
+	{
+		return parse_input(*this, connection, out);
+	}
+
+	BodyReader::BodyReader():
+		m_state(State::kDone),
+		m_remaining(0),
+		m_digits(0)
+	{
+	}
+
+	void BodyReader::begin(
+		Request const& request)
+	{
+		if(request.chunked)
+		{
+			m_state = State::kChunkSize;
+			m_digits = 0;
+			m_remaining = 0;
+		} else if(request.content_length != kNoLength && request.content_length)
+		{
+			m_state = State::kLength;
+			m_remaining = request.content_length;
+		} else
+			m_state = State::kDone;
+	}
+
+	void BodyReader::begin(
+		Response const& response,
+		std::string_view method)
+	{
+		// Responses to HEAD requests, informational responses, "204 No Content", and "304 Not Modified" never have a body.
+		if(method == "HEAD"
+		|| response.status < 200
+		|| response.status == 204
+		|| response.status == 304)
+			m_state = State::kDone;
+		else if(response.chunked)
+		{
+			m_state = State::kChunkSize;
+			m_digits = 0;
+			m_remaining = 0;
+		} else if(response.content_length != kNoLength)
+		{
+			m_remaining = response.content_length;
+			m_state = m_remaining ? State::kLength : State::kDone;
+		} else
+			m_state = State::kUntilClose;
+	}
+
+	bool BodyReader::frame(
+		char c)
+	{
+		switch(m_state)
+		{
+		case State::kChunkSize:
+			{
+				unsigned digit;
+				if(c >= '0' && c <= '9')
+					digit = unsigned(c - '0');
+				else if((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+					digit = unsigned((c | 0x20) - 'a' + 10);
+				else
+				{
+					if(!m_digits)
+						return false;
+					if(c == ';' || c == ' ' || c == '\t')
+						m_state = State::kChunkExtension;
+					else if(c == '\r')
+						m_state = State::kChunkSizeEnd;
+					else if(c == '\n')
+						m_state = m_remaining ? State::kChunkData : State::kTrailerStart;
+					else
+						return false;
+					return true;
+				}
+
+				// Limit chunks to 2^60 bytes, so that the size cannot overflow.
+				if(++m_digits > 15)
+					return false;
+				m_remaining = (m_remaining << 4) | digit;
+			} return true;
+		case State::kChunkExtension:
+			if(c == '\n')
+				m_state = m_remaining ? State::kChunkData : State::kTrailerStart;
+			else if(c == '\r')
+				m_state = State::kChunkSizeEnd;
+			else if(!is_value(c))
+				return false;
+			return true;
+		case State::kChunkSizeEnd:
+			if(c != '\n')
+				return false;
+			m_state = m_remaining ? State::kChunkData : State::kTrailerStart;
+			return true;
+		case State::kChunkDataEnd:
+			if(c == '\r')
+				m_state = State::kChunkDataLineFeed;
+			else if(c != '\n')
+				return false;
+			else
+			{
+				m_state = State::kChunkSize;
+				m_digits = 0;
+			}
+			return true;
+		case State::kChunkDataLineFeed:
+			if(c != '\n')
+				return false;
+			m_state = State::kChunkSize;
+			m_digits = 0;
+			return true;
+		case State::kTrailerStart:
+			if(c == '\n')
+				m_state = State::kDone;
+			else if(c == '\r')
+				m_state = State::kTrailerEnd;
+			else
+				m_state = State::kTrailer;
+			return true;
+		case State::kTrailer:
+			if(c == '\n')
+				m_state = State::kTrailerStart;
+			return true;
+		case State::kTrailerEnd:
+			if(c != '\n')
+				return false;
+			m_state = State::kDone;
+			return true;
+		default:
+			assert(!"not a framing state");
+			return false;
+		}
+	}
+
+	ParseStatus BodyReader::read(
+		char const * data,
+		std::size_t size,
+		std::string_view &piece,
+		std::size_t &consumed)
+	{
+		piece = std::string_view();
+		consumed = 0;
+
+		switch(m_state)
+		{
+		case State::kDone:
+			return ParseStatus::kComplete;
+		case State::kUntilClose:
+			piece = std::string_view(data, size);
+			consumed = size;
+			return ParseStatus::kIncomplete;
+		case State::kLength:
+			{
+				std::size_t const length = m_remaining < size ? std::size_t(m_remaining) : size;
+				piece = std::string_view(data, length);
+				consumed = length;
+				if(!(m_remaining -= length))
+				{
+					m_state = State::kDone;
+					return ParseStatus::kComplete;
+				}
+			} return ParseStatus::kIncomplete;
+		default:;
+		}
+
+		// Chunked: consume framing up to the next chunk data, and return that data.
+		while(consumed < size)
+		{
+			if(m_state == State::kChunkData)
+			{
+				std::size_t const available = size - consumed;
+				std::size_t const length = m_remaining < available ? std::size_t(m_remaining) : available;
+				piece = std::string_view(data + consumed, length);
+				consumed += length;
+				if(!(m_remaining -= length))
+					m_state = State::kChunkDataEnd;
+				return ParseStatus::kIncomplete;
+			}
+
+			if(!frame(data[consumed++]))
+				return ParseStatus::kInvalid;
+			if(m_state == State::kDone)
+				return ParseStatus::kComplete;
+		}
+
+		return ParseStatus::kIncomplete;
+	}
+
+	ResponseWriter::ResponseWriter(
+		unsigned status,
+		std::string_view reason,
+		unsigned minor_version):
+		m_size(0),
+		m_overflow(false)
+	{
+		assert(status >= 100 && status <= 999);
+		assert(minor_version <= 9);
+
+		char line[13] = { 'H', 'T', 'T', 'P', '/', '1', '.', char('0' + minor_version), ' ',
+			char('0' + status / 100), char('0' + status / 10 % 10), char('0' + status % 10), ' ' };
+		append(std::string_view(line, sizeof(line)));
+		append(reason);
+		append("\r\n");
+	}
+
+	void ResponseWriter::append(
+		std::string_view text)
+	{
+		if(text.size() > kCapacity - m_size)
+		{
+			m_overflow = true;
+			return;
+		}
+		std::memcpy(m_head + m_size, text.data(), text.size());
+		m_size += text.size();
+	}
+
+	void ResponseWriter::append(
+		std::uint64_t number)
+	{
+		char digits[20];
+		std::size_t i = sizeof(digits);
+		do {
+			digits[--i] = char('0' + number % 10);
+		} while(number /= 10);
+		append(std::string_view(digits + i, sizeof(digits) - i));
+	}
+
+	bool ResponseWriter::header(
+		std::string_view name,
+		std::string_view value)
+	{
+		append(name);
+		append(": ");
+		append(value);
+		append("\r\n");
+		return !m_overflow;
+	}
+
+	bool ResponseWriter::header(
+		std::string_view name,
+		std::uint64_t value)
+	{
+		append(name);
+		append(": ");
+		append(value);
+		append("\r\n");
+		return !m_overflow;
+	}
+
+	bool ResponseWriter::send(
+		BufferedConnection &connection,
+		void const * body,
+		std::size_t size,
+		std::size_t &sent)
+	{
+		sent = 0;
+		if(!header("Content-Length", std::uint64_t(size)))
+			return false;
+		append("\r\n");
+		if(m_overflow)
+			return false;
+
+		DataSlice const slices[] = {
+			{ m_head, m_size },
+			{ body, size }
+		};
+		return connection.write_gathered(slices, size ? 2 : 1, sent);
+	}
+
+	bool ResponseWriter::send_head(
+		BufferedConnection &connection,
+		std::size_t &sent)
+	{
+		sent = 0;
+		append("\r\n");
+		if(m_overflow)
+			return false;
+
+		DataSlice const slice = { m_head, m_size };
+		return connection.write_gathered(&slice, 1, sent);
+	}
+}
@@ -0,0 +1,325 @@
+/** @file Http.hpp
+	Contains the netlib::x::http module, an incremental HTTP/1.1 parser and response writer working in place on `BufferedConnection` buffers. */
+#ifndef __netlib_x_http_hpp_defined
+#define __netlib_x_http_hpp_defined
+
+#include "BufferedConnection.hpp"
+
+#include <string_view>
+#include <cinttypes>
+
+/** HTTP/1.1 on top of `BufferedConnection`.
+	The parsers never allocate or copy: parsed heads consist of views into the parsed data, which usually is the connection's input buffer. Pipelined messages are parsed one after another from the same buffer, and message bodies are returned piece by piece, with chunked transfer coding removed. */
+namespace netlib::x::http
+{
+	/** The result of parsing (part of) a message. */
+	enum class ParseStatus
+	{
+		/** The message (part) is complete. */
+		kComplete,
+		/** More data is needed. */
+		kIncomplete,
+		/** The message is malformed. The connection should be closed. */
+		kInvalid,
+		/** The message head exceeds the parser's limits. The connection should be closed. */
+		kTooLarge
+	};
+
+	/** A header field. */
+	struct Header
+	{
+		/** The field name, as sent. */
+		std::string_view name;
+		/** The field value, without surrounding whitespace. */
+		std::string_view value;
+	};
+
+	/** The maximum number of header fields a message can have. */
+	constexpr std::size_t kMaxHeaders = 64;
+	/** The content length of messages without a `Content-Length` header field. */
+	constexpr std::uint64_t kNoLength = ~std::uint64_t(0);
+
+	/** The parts of a message head that requests and responses share.
+		All views point into the parsed data, so they are only valid until that data is removed from the input buffer, or moved by `BufferedConnection::linearize_input()`. */
+	struct Message
+	{
+		/** The minor HTTP version: 1 for HTTP/1.1, 0 for HTTP/1.0. */
+		unsigned minor_version;
+		/** The header fields, in order. */
+		Header headers[kMaxHeaders];
+		/** The number of header fields. */
+		std::size_t header_count;
+		/** The size of the head, in bytes, including the empty line that ends it. The body starts right after the head. */
+		std::size_t head_size;
+		/** The `Content-Length`, or `kNoLength`. */
+		std::uint64_t content_length;
+		/** Whether the body uses the chunked transfer coding. */
+		bool chunked;
+		/** Whether the connection stays open after the message, according to the HTTP version and the `Connection` header field. */
+		bool keep_alive;
+
+		/** Finds a header field by name, ignoring case.
+		@param[in] name:
+			The lowercase field name.
+		@return
+			The first matching header field, or null. */
+		Header const * find(
+			std::string_view name) const;
+		/** Checks whether any header field of the given name contains a token in its comma-separated list, ignoring case.
+		@param[in] name:
+			The lowercase field name.
+		@param[in] token:
+			The lowercase token, consisting of letters, digits, and '-'. */
+		bool has_token(
+			std::string_view name,
+			std::string_view token) const;
+	};
+
+	/** A parsed request head. */
+	struct Request : Message
+	{
+		/** The request method. */
+		std::string_view method;
+		/** The request target, usually an absolute path and query. */
+		std::string_view target;
+	};
+
+	/** A parsed response head. */
+	struct Response : Message
+	{
+		/** The status code. */
+		unsigned status;
+		/** The reason phrase. */
+		std::string_view reason;
+	};
+
+	/** Incrementally parses message heads.
+		Can be called again whenever more data arrived, and only scans the new data for the end of the head. After a head was parsed, the parser is ready for the next message. */
+	class HeadParser
+	{
+		/** How many bytes were already scanned for the end of the head. */
+		std::size_t m_scanned;
+		/** The maximum head size, in bytes. */
+		std::size_t m_max_head_size;
+
+		/** Scans for the end of the head.
+		@param[out] head_size:
+			On success, the size of the head.
+		@param[out] start:
+			On success, how many empty lines precede the head, in bytes. */
+		ParseStatus scan(
+			char const * data,
+			std::size_t size,
+			std::size_t &head_size,
+			std::size_t &start);
+	public:
+		/** Creates a parser.
+		@param[in] max_head_size:
+			The maximum head size, in bytes. Larger heads are rejected with `ParseStatus::kTooLarge`. */
+		explicit HeadParser(
+			std::size_t max_head_size = 8192);
+
+		/** Parses a request head at the beginning of `data`.
+		@param[in] data:
+			The received data. On repeated calls for the same message, it must start at the same message, and contain at least the data passed before.
+		@param[in] size:
+			The data's size, in bytes.
+		@param[out] out:
+			On success, the parsed request.
+		@return
+			`ParseStatus::kComplete` if the head was parsed, `ParseStatus::kIncomplete` if it did not end yet, and an error otherwise. */
+		ParseStatus parse(
+			char const * data,
+			std::size_t size,
+			Request &out);
+		/** Parses a response head at the beginning of `data`.
+			Works like parsing a request. */
+		ParseStatus parse(
+			char const * data,
+			std::size_t size,
+			Response &out);
+
+		/** Parses a request head at the beginning of a connection's input buffer.
+			Linearizes the input buffer if the head wraps around its edge. The head stays in the input buffer: remove it via `BufferedConnection::skip()` once it is no longer used. */
+		ParseStatus parse(
+			BufferedConnection &connection,
+			Request &out);
+		/** Parses a response head at the beginning of a connection's input buffer.
+			Works like parsing a request. */
+		ParseStatus parse(
+			BufferedConnection &connection,
+			Response &out);
+
+		/** Forgets a partially parsed head. */
+		inline void reset();
+	};
+
+	/** Incrementally reads a message body, removing the chunked transfer coding. */
+	class BodyReader
+	{
+		/** The body's framing and parse state. */
+		enum class State
+		{
+			/** Reading a body of known length. */
+			kLength,
+			/** Reading a body that ends when the connection is closed. */
+			kUntilClose,
+			/** Reading a chunk size. */
+			kChunkSize,
+			/** Skipping a chunk extension. */
+			kChunkExtension,
+			/** Expecting the line feed after a chunk size. */
+			kChunkSizeEnd,
+			/** Reading chunk data. */
+			kChunkData,
+			/** Expecting the line break after chunk data. */
+			kChunkDataEnd,
+			/** Expecting the line feed after chunk data. */
+			kChunkDataLineFeed,
+			/** At the beginning of a trailer line. */
+			kTrailerStart,
+			/** Skipping a trailer line. */
+			kTrailer,
+			/** Expecting the line feed that ends the trailer. */
+			kTrailerEnd,
+			/** The body ended. */
+			kDone
+		};
+
+		/** The current state. */
+		State m_state;
+		/** The remaining size of the body or current chunk, in bytes. */
+		std::uint64_t m_remaining;
+		/** The number of digits of the current chunk size. */
+		unsigned m_digits;
+
+		/** Consumes a byte of chunked framing.
+		@return
+			Whether the byte was valid. */
+		bool frame(
+			char c);
+	public:
+		/** Creates a reader for an empty body. */
+		BodyReader();
+
+		/** Starts reading a request's body. */
+		void begin(
+			Request const& request);
+		/** Starts reading a response's body.
+		@param[in] response:
+			The response.
+		@param[in] method:
+			The method of the request the response belongs to. Responses to `HEAD` requests have no body. */
+		void begin(
+			Response const& response,
+			std::string_view method);
+
+		/** Reads the next piece of the body.
+		@param[in] data:
+			The received data following what was consumed so far.
+		@param[in] size:
+			The data's size, in bytes.
+		@param[out] piece:
+			The body data that was found, a view into `data`. Can be empty.
+		@param[out] consumed:
+			How many bytes of `data` were consumed, including chunked framing.
+		@return
+			`ParseStatus::kComplete` once the body ended, `ParseStatus::kIncomplete` if more of it follows, or `ParseStatus::kInvalid`. Bodies that end when the connection closes never complete. */
+		ParseStatus read(
+			char const * data,
+			std::size_t size,
+			std::string_view &piece,
+			std::size_t &consumed);
+		/** Reads the next piece of the body from a connection's input buffer.
+			The piece stays in the input buffer: remove `consumed` bytes via `BufferedConnection::skip()` once it is no longer used. */
+		inline ParseStatus read(
+			BufferedConnection const& connection,
+			std::string_view &piece,
+			std::size_t &consumed);
+
+		/** Whether the body ended. */
+		inline bool complete() const;
+	};
+
+	/** Builds a response head without allocating, and sends it together with the body in a single gathered write. */
+	class ResponseWriter
+	{
+	public:
+		/** The maximum head size, in bytes. */
+		static constexpr std::size_t kCapacity = 2048;
+	private:
+		/** The head built so far. */
+		char m_head[kCapacity];
+		/** The head's size. */
+		std::size_t m_size;
+		/** Whether the head did not fit. */
+		bool m_overflow;
+
+		/** Appends text to the head. */
+		void append(
+			std::string_view text);
+		/** Appends a decimal number to the head. */
+		void append(
+			std::uint64_t number);
+	public:
+		/** Starts a response head.
+		@param[in] status:
+			The status code.
+		@param[in] reason:
+			The reason phrase.
+		@param[in] minor_version:
+			The minor HTTP version, usually that of the request. */
+		ResponseWriter(
+			unsigned status,
+			std::string_view reason,
+			unsigned minor_version = 1);
+
+		/** Adds a header field.
+		@return
+			Whether the field still fit into the head. */
+		bool header(
+			std::string_view name,
+			std::string_view value);
+		/** Adds a header field with a numeric value.
+		@return
+			Whether the field still fit into the head. */
+		bool header(
+			std::string_view name,
+			std::uint64_t value);
+
+		/** Completes the head with a `Content-Length` field, and sends or buffers the head and body.
+			Pipelined responses that are still buffered are sent in the same system call.
+		@param[in] connection:
+			The connection to send the response over.
+		@param[in] body:
+			The body.
+		@param[in] size:
+			The body's size, in bytes.
+		@param[out] sent:
+			How many bytes of the response (head and body) were sent or buffered. If less than `head_size() + size`, the output buffer is full: flush it and send the rest of the body.
+		@return
+			Whether the operation succeeded. Fails if the head did not fit, or the socket failed. */
+		bool send(
+			BufferedConnection &connection,
+			void const * body,
+			std::size_t size,
+			std::size_t &sent);
+
+		/** Completes the head without a body length, and sends or buffers it.
+			For responses that cannot have a body, such as "101 Switching Protocols", or whose headers already define the body's framing.
+		@param[out] sent:
+			How many bytes of the head were sent or buffered.
+		@return
+			Whether the operation succeeded. Fails if the head did not fit, or the socket failed. */
+		bool send_head(
+			BufferedConnection &connection,
+			std::size_t &sent);
+
+		/** The size of the head, in bytes. Only final after `send()` or `send_head()`. */
+		inline std::size_t head_size() const;
+	};
+}
+
+#include "Http.inl"
+
+#endif
@@ -0,0 +1,29 @@
+namespace netlib::x::http
+{
+	void HeadParser::reset()
+	{
+		m_scanned = 0;
+	}
+
+	ParseStatus BodyReader::read(
+		BufferedConnection const& connection,
+		std::string_view &piece,
+		std::size_t &consumed)
+	{
+		return read(
+			static_cast<char const *>(connection.input().data()),
+			connection.input().continuous_data(),
+			piece,
+			consumed);
+	}
+
+	bool BodyReader::complete() const
+	{
+		return m_state == State::kDone;
+	}
+
+	std::size_t ResponseWriter::head_size() const
+	{
+		return m_size;
+	}
+}
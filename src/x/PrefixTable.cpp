@@ -0,0 +1,448 @@
+#include "PrefixTable.hpp"
+
+#include <algorithm>
+#include <initializer_list>
+#include <cstring>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace netlib::x
+{
+	constexpr std::uint32_t PrefixTable::kNone;
+
+	namespace
+	{
+		/** The number of address bits covered by the direct table. */
+		constexpr unsigned kRootBits = 16;
+		/** The number of address bits covered by a node. */
+		constexpr unsigned kStride = 6;
+		/** The number of slots of a node. */
+		constexpr unsigned kSlots = 1u << kStride;
+
+		inline unsigned popcount(
+			std::uint64_t x)
+		{
+#ifdef _MSC_VER
+			return unsigned(__popcnt64(x));
+#else
+			return unsigned(__builtin_popcountll(x));
+#endif
+		}
+
+		/** The 64 address bits starting at `offset`, padded with zeros beyond the address. */
+		inline std::uint64_t bits_at(
+			std::uint64_t high,
+			std::uint64_t low,
+			unsigned offset)
+		{
+			if(offset == 0)
+				return high;
+			if(offset < 64)
+				return (high << offset) | (low >> (64 - offset));
+			if(offset < 128)
+				return low << (offset - 64);
+			return 0;
+		}
+
+		/** A mask of the upper `length` bits of a 64-bit word. */
+		inline std::uint64_t upper_mask(
+			unsigned length)
+		{
+			if(!length)
+				return 0;
+			if(length >= 64)
+				return ~std::uint64_t(0);
+			return ~std::uint64_t(0) << (64 - length);
+		}
+	}
+
+	/** Converts sorted prefixes into a trie. */
+	class PrefixTable::Build
+	{
+		typedef Builder::Prefix Prefix;
+
+		/** The sorted prefixes. */
+		std::vector<Prefix> const& m_prefixes;
+		/** The trie being built. */
+		Trie &m_trie;
+
+		/** The slot of a prefix within a node. */
+		static unsigned slot(
+			Prefix const& prefix,
+			unsigned offset,
+			unsigned stride)
+		{
+			return unsigned(bits_at(prefix.high, prefix.low, offset) >> (64 - stride));
+		}
+
+		/** Determines the best value of every slot of a node from the prefixes ending within it.
+		@param[in] begin:
+			The first prefix below the node.
+		@param[in] end:
+			The end of the prefixes below the node.
+		@param[in] offset:
+			The first address bit covered by the node.
+		@param[in] stride:
+			The number of address bits covered by the node.
+		@param[in,out] values:
+			The best value per slot, initialised to the inherited value.
+		@param[in,out] lengths:
+			The prefix length of the best value per slot. */
+		void expand(
+			std::size_t begin,
+			std::size_t end,
+			unsigned offset,
+			unsigned stride,
+			std::uint32_t * values,
+			std::uint8_t * lengths) const
+		{
+			for(std::size_t i = begin; i < end; i++)
+			{
+				Prefix const& prefix = m_prefixes[i];
+				if(prefix.length > offset + stride
+				|| (offset && prefix.length <= offset))
+					continue;
+
+				unsigned first = slot(prefix, offset, stride);
+				unsigned count = 1u << (offset + stride - prefix.length);
+				for(unsigned k = first; k < first + count; k++)
+					// Later duplicates replace earlier ones.
+					if(prefix.length >= lengths[k])
+					{
+						values[k] = prefix.value;
+						lengths[k] = prefix.length;
+					}
+			}
+		}
+
+		/** Finds the end of the prefixes within a slot. */
+		std::size_t slot_end(
+			std::size_t begin,
+			std::size_t end,
+			unsigned offset,
+			unsigned stride,
+			unsigned index) const
+		{
+			while(begin < end && slot(m_prefixes[begin], offset, stride) == index)
+				++begin;
+			return begin;
+		}
+
+		/** Whether any prefix in a range continues below a node. */
+		bool continues(
+			std::size_t begin,
+			std::size_t end,
+			unsigned bits) const
+		{
+			for(; begin < end; begin++)
+				if(m_prefixes[begin].length > bits)
+					return true;
+			return false;
+		}
+
+		/** Builds a node and its children.
+		@param[in] index:
+			The node's index.
+		@param[in] begin:
+			The first prefix below the node.
+		@param[in] end:
+			The end of the prefixes below the node.
+		@param[in] offset:
+			The first address bit covered by the node.
+		@param[in] inherited:
+			The value of the longest prefix ending above the node. */
+		void node(
+			std::uint32_t index,
+			std::size_t begin,
+			std::size_t end,
+			unsigned offset,
+			std::uint32_t inherited)
+		{
+			std::uint32_t values[kSlots];
+			std::uint8_t lengths[kSlots];
+			std::fill_n(values, kSlots, inherited);
+			std::fill_n(lengths, kSlots, std::uint8_t(0));
+			expand(begin, end, offset, kStride, values, lengths);
+
+			// Find the prefix range of every slot that has a child.
+			std::size_t ranges[kSlots][2];
+			std::uint64_t children = 0;
+			for(std::size_t i = begin; i < end;)
+			{
+				unsigned k = slot(m_prefixes[i], offset, kStride);
+				std::size_t next = slot_end(i, end, offset, kStride, k);
+				if(continues(i, next, offset + kStride))
+				{
+					children |= std::uint64_t(1) << k;
+					ranges[k][0] = i;
+					ranges[k][1] = next;
+				}
+				i = next;
+			}
+
+			// Store the leaf values, one per run of equal values.
+			std::uint64_t leaves = 0;
+			std::uint32_t const leaf_base = std::uint32_t(m_trie.leaves.size());
+			bool first = true;
+			std::uint32_t last = 0;
+			for(unsigned k = 0; k < kSlots; k++)
+			{
+				if(children & (std::uint64_t(1) << k))
+					continue;
+				if(first || values[k] != last)
+				{
+					leaves |= std::uint64_t(1) << k;
+					m_trie.leaves.push_back(values[k]);
+					last = values[k];
+					first = false;
+				}
+			}
+
+			std::uint32_t const child_base = std::uint32_t(m_trie.nodes.size());
+			m_trie.nodes.resize(m_trie.nodes.size() + popcount(children));
+
+			Node &node = m_trie.nodes[index];
+			node.children = children;
+			node.leaves = leaves;
+			node.child_base = child_base;
+			node.leaf_base = leaf_base;
+
+			std::uint32_t child = child_base;
+			for(unsigned k = 0; k < kSlots; k++)
+				if(children & (std::uint64_t(1) << k))
+					this->node(
+						child++,
+						ranges[k][0],
+						ranges[k][1],
+						offset + kStride,
+						values[k]);
+		}
+
+	public:
+		Build(
+			std::vector<Prefix> const& prefixes,
+			Trie &trie):
+			m_prefixes(prefixes),
+			m_trie(trie)
+		{
+		}
+
+		/** Builds the direct table and all nodes. */
+		void root()
+		{
+			if(m_prefixes.empty())
+				return;
+
+			constexpr std::size_t kRootSlots = std::size_t(1) << kRootBits;
+			std::vector<std::uint32_t> values(kRootSlots, kNone);
+			std::vector<std::uint8_t> lengths(kRootSlots, 0);
+			expand(0, m_prefixes.size(), 0, kRootBits, values.data(), lengths.data());
+
+			m_trie.root.resize(kRootSlots);
+			for(std::size_t k = 0; k < kRootSlots; k++)
+			{
+				m_trie.root[k].child = kNone;
+				m_trie.root[k].value = values[k];
+			}
+
+			for(std::size_t i = 0, end = m_prefixes.size(); i < end;)
+			{
+				unsigned k = slot(m_prefixes[i], 0, kRootBits);
+				std::size_t next = slot_end(i, end, 0, kRootBits, k);
+				if(continues(i, next, kRootBits))
+				{
+					std::uint32_t index = std::uint32_t(m_trie.nodes.size());
+					m_trie.nodes.emplace_back();
+					m_trie.root[k].child = index;
+					node(index, i, next, kRootBits, values[k]);
+				}
+				i = next;
+			}
+		}
+	};
+
+	bool PrefixTable::Builder::add(
+		IPv4Address const& address,
+		unsigned length,
+		std::uint32_t value)
+	{
+		if(length > 32 || value == kNone)
+			return false;
+
+		Prefix prefix;
+		prefix.high = ((std::uint64_t(address.d0) << 56)
+			| (std::uint64_t(address.d1) << 48)
+			| (std::uint64_t(address.d2) << 40)
+			| (std::uint64_t(address.d3) << 32)) & upper_mask(length);
+		prefix.low = 0;
+		prefix.length = std::uint8_t(length);
+		prefix.value = value;
+		m_ipv4.push_back(prefix);
+		return true;
+	}
+
+	bool PrefixTable::Builder::add(
+		IPv6Address const& address,
+		unsigned length,
+		std::uint32_t value)
+	{
+		if(length > 128 || value == kNone)
+			return false;
+
+		Prefix prefix;
+		prefix.high = ((std::uint64_t(address.d0) << 48)
+			| (std::uint64_t(address.d1) << 32)
+			| (std::uint64_t(address.d2) << 16)
+			| std::uint64_t(address.d3)) & upper_mask(length);
+		prefix.low = ((std::uint64_t(address.d4) << 48)
+			| (std::uint64_t(address.d5) << 32)
+			| (std::uint64_t(address.d6) << 16)
+			| std::uint64_t(address.d7)) & upper_mask(length > 64 ? length - 64 : 0);
+		prefix.length = std::uint8_t(length);
+		prefix.value = value;
+		m_ipv6.push_back(prefix);
+		return true;
+	}
+
+	bool PrefixTable::Builder::add(
+		char const * cidr,
+		std::uint32_t value)
+	{
+		assert(cidr != nullptr);
+
+		char const * end = cidr + std::strlen(cidr);
+		char const * slash = std::find(cidr, end, '/');
+
+		int length = -1;
+		if(slash != end)
+		{
+			char const * digits = slash + 1;
+			if(digits == end || end - digits > 3)
+				return false;
+			length = 0;
+			for(; digits != end; digits++)
+			{
+				if(unsigned(*digits - '0') >= 10)
+					return false;
+				length = length * 10 + (*digits - '0');
+			}
+		}
+
+		IPv4Address ipv4;
+		IPv6Address ipv6;
+		if(IPv4Address::parse(cidr, slash, ipv4))
+			return add(ipv4, length < 0 ? 32 : unsigned(length), value);
+		else if(IPv6Address::parse(cidr, slash, ipv6))
+			return add(ipv6, length < 0 ? 128 : unsigned(length), value);
+		else
+			return false;
+	}
+
+	PrefixTable PrefixTable::Builder::build() const
+	{
+		PrefixTable table;
+
+		auto order = [](Prefix const& a, Prefix const& b) {
+			if(a.high != b.high)
+				return a.high < b.high;
+			if(a.low != b.low)
+				return a.low < b.low;
+			return a.length < b.length;
+		};
+
+		std::vector<Prefix> sorted = m_ipv4;
+		std::stable_sort(sorted.begin(), sorted.end(), order);
+		Build(sorted, table.m_ipv4).root();
+
+		sorted = m_ipv6;
+		std::stable_sort(sorted.begin(), sorted.end(), order);
+		Build(sorted, table.m_ipv6).root();
+
+		return table;
+	}
+
+	std::uint32_t PrefixTable::Trie::lookup(
+		std::uint64_t high,
+		std::uint64_t low) const
+	{
+		if(root.empty())
+			return kNone;
+
+		Root const& entry = root[high >> (64 - kRootBits)];
+		if(entry.child == kNone)
+			return entry.value;
+
+		std::uint32_t index = entry.child;
+		for(unsigned offset = kRootBits;; offset += kStride)
+		{
+			Node const& node = nodes[index];
+			unsigned slot = unsigned(bits_at(high, low, offset) >> (64 - kStride));
+			// The slots up to and including this slot.
+			std::uint64_t upto = (std::uint64_t(2) << slot) - 1;
+
+			if(node.children & (std::uint64_t(1) << slot))
+				index = node.child_base + popcount(node.children & upto) - 1;
+			else
+				return leaves[node.leaf_base + popcount(node.leaves & upto) - 1];
+		}
+	}
+
+	std::uint32_t PrefixTable::lookup(
+		IPv4Address const& address) const
+	{
+		std::uint64_t high = (std::uint64_t(address.d0) << 56)
+			| (std::uint64_t(address.d1) << 48)
+			| (std::uint64_t(address.d2) << 40)
+			| (std::uint64_t(address.d3) << 32);
+		return m_ipv4.lookup(high, 0);
+	}
+
+	std::uint32_t PrefixTable::lookup(
+		IPv6Address const& address) const
+	{
+		std::uint64_t high = (std::uint64_t(address.d0) << 48)
+			| (std::uint64_t(address.d1) << 32)
+			| (std::uint64_t(address.d2) << 16)
+			| std::uint64_t(address.d3);
+		std::uint64_t low = (std::uint64_t(address.d4) << 48)
+			| (std::uint64_t(address.d5) << 32)
+			| (std::uint64_t(address.d6) << 16)
+			| std::uint64_t(address.d7);
+		return m_ipv6.lookup(high, low);
+	}
+
+	std::uint32_t PrefixTable::lookup(
+		SocketAddress const& address) const
+	{
+		switch(address.family)
+		{
+		case AddressFamily::kIPv4:
+			return lookup(address.address.ipv4.address);
+		case AddressFamily::kIPv6:
+			{
+				IPv6Address const& ipv6 = address.address.ipv6.address;
+				if(!(ipv6.d0 | ipv6.d1 | ipv6.d2 | ipv6.d3 | ipv6.d4)
+				&& ipv6.d5 == 0xffff)
+					return lookup(IPv4Address(
+						ipv6.d6 >> 8, ipv6.d6 & 0xff,
+						ipv6.d7 >> 8, ipv6.d7 & 0xff));
+				return lookup(ipv6);
+			}
+		default:
+			return kNone;
+		}
+	}
+
+	std::size_t PrefixTable::memory() const
+	{
+		std::size_t total = 0;
+		for(Trie const * trie : { &m_ipv4, &m_ipv6 })
+			total += trie->root.size() * sizeof(Root)
+				+ trie->nodes.size() * sizeof(Node)
+				+ trie->leaves.size() * sizeof(std::uint32_t);
+		return total;
+	}
+}
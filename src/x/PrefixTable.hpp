@@ -0,0 +1,170 @@
+/** @file PrefixTable.hpp
+	Contains the netlib::x::PrefixTable class used for longest prefix matching of IP addresses. */
+#ifndef __netlib_x_prefixtable_hpp_defined
+#define __netlib_x_prefixtable_hpp_defined
+
+#include "../SocketAddress.hpp"
+#include "../defines.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace netlib::x
+{
+	/** Immutable longest prefix match table for IPv4 and IPv6 addresses.
+		Maps CIDR prefixes (such as `10.0.0.0/8` or `2001:db8::/32`) to 32-bit values, for example allow/deny verdicts or indices into a routing table. A lookup returns the value of the longest prefix containing the address.
+
+		The table is a compressed multibit trie (poptrie): the first 16 bits of an address index a direct table, the remaining bits are consumed 6 at a time by nodes which store which of their 64 slots have children and where their leaf values change as bitmaps, and find children and leaves via population count. A lookup therefore needs one memory access per level, and the table stays compact even with millions of prefixes.
+
+		Tables are built in bulk via `PrefixTable::Builder` and never modified afterwards, so they can be read concurrently without locking. Use `SharedPrefixTable` to replace a table while it is being read. */
+	class PrefixTable
+	{
+	public:
+		/** The value returned for addresses that match no prefix. */
+		static constexpr std::uint32_t kNone = 0xffffffff;
+
+		/** Collects prefixes and builds a table from them. */
+		class Builder
+		{
+			friend class PrefixTable;
+
+			/** A prefix and its value. */
+			struct Prefix
+			{
+				/** The upper 64 bits of the address. IPv4 addresses are stored in the upper 32 bits. */
+				std::uint64_t high;
+				/** The lower 64 bits of the address. */
+				std::uint64_t low;
+				/** The prefix length in bits. */
+				std::uint8_t length;
+				/** The value. */
+				std::uint32_t value;
+			};
+
+			/** The IPv4 prefixes. */
+			std::vector<Prefix> m_ipv4;
+			/** The IPv6 prefixes. */
+			std::vector<Prefix> m_ipv6;
+		public:
+			/** Adds an IPv4 prefix.
+				Bits of the address beyond the prefix length are ignored. If the same prefix is added more than once, the last value is used.
+			@param[in] address:
+				The prefix address.
+			@param[in] length:
+				The prefix length in bits, at most 32.
+			@param[in] value:
+				The prefix's value. Must not be `kNone`.
+			@return
+				Whether the prefix was valid. */
+			bool add(
+				IPv4Address const& address,
+				unsigned length,
+				std::uint32_t value);
+			/** Adds an IPv6 prefix.
+			@param[in] address:
+				The prefix address.
+			@param[in] length:
+				The prefix length in bits, at most 128.
+			@param[in] value:
+				The prefix's value. Must not be `kNone`.
+			@return
+				Whether the prefix was valid. */
+			bool add(
+				IPv6Address const& address,
+				unsigned length,
+				std::uint32_t value);
+			/** Adds a prefix in CIDR notation.
+				Accepts `address/length` and plain addresses, which are treated as full-length prefixes.
+			@param[in] cidr:
+				The prefix, for example `192.168.0.0/16` or `fe80::/10`.
+			@param[in] value:
+				The prefix's value. Must not be `kNone`.
+			@return
+				Whether the prefix was valid. */
+			bool add(
+				char const * cidr,
+				std::uint32_t value);
+
+			/** The number of prefixes added. */
+			NETLIB_INL std::size_t size() const;
+
+			/** Builds a table from the added prefixes.
+				The builder keeps its prefixes, so it can be extended and built again. */
+			PrefixTable build() const;
+		};
+
+	private:
+		/** An entry of the direct table, covering the first 16 bits of an address. */
+		struct Root
+		{
+			/** The child node, or `kNone` if the entry is a leaf. */
+			std::uint32_t child;
+			/** The leaf value, if there is no child. */
+			std::uint32_t value;
+		};
+
+		/** A node, covering 6 bits of an address. */
+		struct Node
+		{
+			/** Which of the 64 slots have a child node. */
+			std::uint64_t children;
+			/** Which of the leaf slots start a new leaf value. */
+			std::uint64_t leaves;
+			/** The index of the first child node. Children are stored contiguously. */
+			std::uint32_t child_base;
+			/** The index of the first leaf value. Leaves are stored contiguously. */
+			std::uint32_t leaf_base;
+		};
+
+		/** The table for a single address family. */
+		struct Trie
+		{
+			/** The direct table. Empty if there are no prefixes. */
+			std::vector<Root> root;
+			/** The nodes below the direct table. */
+			std::vector<Node> nodes;
+			/** The leaf values of all nodes. */
+			std::vector<std::uint32_t> leaves;
+
+			/** Looks up an address. */
+			std::uint32_t lookup(
+				std::uint64_t high,
+				std::uint64_t low) const;
+		};
+
+		/** The IPv4 table. */
+		Trie m_ipv4;
+		/** The IPv6 table. */
+		Trie m_ipv6;
+
+		class Build;
+	public:
+		/** Creates an empty table. */
+		PrefixTable() = default;
+
+		/** Looks up the longest prefix containing an IPv4 address.
+		@return
+			The prefix's value, or `kNone` if no prefix contains the address. */
+		std::uint32_t lookup(
+			IPv4Address const& address) const;
+		/** Looks up the longest prefix containing an IPv6 address.
+		@return
+			The prefix's value, or `kNone` if no prefix contains the address. */
+		std::uint32_t lookup(
+			IPv6Address const& address) const;
+		/** Looks up the longest prefix containing a socket address.
+			IPv4-mapped IPv6 addresses (`::ffff:a.b.c.d`) are looked up as IPv4 addresses, so that IPv4 prefixes also apply to dual-stack sockets.
+		@return
+			The prefix's value, or `kNone` if no prefix contains the address or the address is not an IP address. */
+		std::uint32_t lookup(
+			SocketAddress const& address) const;
+
+		/** The approximate memory used by the table, in bytes. */
+		std::size_t memory() const;
+	};
+}
+
+#include "PrefixTable.inl"
+
+#endif
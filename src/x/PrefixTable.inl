@@ -0,0 +1,7 @@
+namespace netlib::x
+{
+	std::size_t PrefixTable::Builder::size() const
+	{
+		return m_ipv4.size() + m_ipv6.size();
+	}
+}
@@ -0,0 +1,283 @@
+#include "Proxy.hpp"
+#include "../internal/platform.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace netlib::x
+{
+	/** How many times a direction alternates between receiving and sending per event, so that a busy connection does not starve the others. */
+	static constexpr std::size_t kMaxPumpRounds = 8;
+
+	Proxy::Endpoint::Endpoint(
+		StreamSocket && socket,
+		Proxy * proxy):
+		StreamSocket(std::move(socket)),
+		m_proxy(proxy),
+		m_entry(nullptr),
+		m_read(false),
+		m_write(false)
+	{
+	}
+
+	Proxy::Direction::Direction(
+		std::size_t capacity,
+		bool zero_copy):
+		pipe{ -1, -1 },
+		buffer(0),
+		capacity(capacity),
+		staged(0),
+		forwarded(0),
+		blocked(false),
+		eof(false),
+		shut(false)
+	{
+#ifdef __linux__
+		if(zero_copy && !::pipe2(pipe, O_NONBLOCK | O_CLOEXEC))
+		{
+			// The kernel rounds the size up, or refuses sizes above its limit, in which case the default size is kept.
+			::fcntl(pipe[1], F_SETPIPE_SZ, int(capacity));
+			int const size = ::fcntl(pipe[1], F_GETPIPE_SZ);
+			if(size > 0)
+			{
+				this->capacity = std::size_t(size);
+				return;
+			}
+
+			::close(pipe[0]);
+			::close(pipe[1]);
+			pipe[0] = pipe[1] = -1;
+		}
+#endif
+		buffer = util::Buffer(capacity);
+	}
+
+	Proxy::Direction::~Direction()
+	{
+#ifdef __linux__
+		if(pipe[0] != -1)
+		{
+			::close(pipe[0]);
+			::close(pipe[1]);
+		}
+#endif
+	}
+
+	Proxy::Proxy(
+		StreamSocket && first,
+		StreamSocket && second,
+		std::size_t buffer_size,
+		bool zero_copy):
+		m_endpoints{
+			Endpoint(std::move(first), this),
+			Endpoint(std::move(second), this) },
+		m_directions{
+			Direction(buffer_size, zero_copy),
+			Direction(buffer_size, zero_copy) },
+		m_poller(nullptr),
+		m_failed(false)
+	{
+	}
+
+	Proxy::~Proxy()
+	{
+		detach();
+	}
+
+	bool Proxy::attach(
+		Poller &poller)
+	{
+		detach();
+		m_poller = &poller;
+		for(Endpoint &endpoint : m_endpoints)
+		{
+			endpoint.m_read = true;
+			endpoint.m_write = false;
+			if(!(endpoint.m_entry = poller.watch(static_cast<Socket *>(&endpoint), true, false)))
+			{
+				detach();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void Proxy::detach()
+	{
+		if(!m_poller)
+			return;
+
+		for(Endpoint &endpoint : m_endpoints)
+			if(endpoint.m_entry)
+			{
+				m_poller->unwatch(endpoint.m_entry);
+				endpoint.m_entry = nullptr;
+			}
+		m_poller = nullptr;
+	}
+
+	Status Proxy::fill(
+		std::size_t direction,
+		std::size_t &moved)
+	{
+		Direction &dir = m_directions[direction];
+		Endpoint &source = m_endpoints[direction];
+#ifdef __linux__
+		if(dir.pipe[0] != -1)
+		{
+			ssize_t const result = ::splice(
+				source.m_socket, nullptr,
+				dir.pipe[1], nullptr,
+				dir.capacity - dir.staged,
+				SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if(result == -1)
+				return errno == EAGAIN ? Status::kNotReady : Status::kError;
+			moved = std::size_t(result);
+			return Status::kSuccess;
+		}
+#endif
+		Status const status = source.recv(
+			dir.buffer.end(),
+			dir.buffer.continuous_free_space(),
+			moved);
+		if(status == Status::kSuccess)
+			dir.buffer.add(moved);
+		return status;
+	}
+
+	Status Proxy::drain(
+		std::size_t direction,
+		std::size_t &moved)
+	{
+		Direction &dir = m_directions[direction];
+		Endpoint &destination = m_endpoints[1 - direction];
+#ifdef __linux__
+		if(dir.pipe[0] != -1)
+		{
+			ssize_t const result = ::splice(
+				dir.pipe[0], nullptr,
+				destination.m_socket, nullptr,
+				dir.staged,
+				SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if(result == -1)
+				return errno == EAGAIN ? Status::kNotReady : Status::kError;
+			moved = std::size_t(result);
+			return Status::kSuccess;
+		}
+#endif
+		Status const status = destination.send(
+			dir.buffer.data(),
+			dir.buffer.continuous_data(),
+			moved);
+		if(status == Status::kSuccess)
+			dir.buffer.remove(moved);
+		return status;
+	}
+
+	void Proxy::pump(
+		std::size_t direction)
+	{
+		Direction &dir = m_directions[direction];
+		for(std::size_t round = 0; round < kMaxPumpRounds && !m_failed; round++)
+		{
+			bool progress = false;
+			std::size_t moved;
+
+			if(!dir.eof && !dir.blocked && dir.staged < dir.capacity)
+				switch(fill(direction, moved))
+				{
+				case Status::kSuccess:
+					// Receiving nothing means that the source shut down sending.
+					if(!moved)
+						dir.eof = true;
+					dir.staged += moved;
+					progress = true;
+					break;
+				case Status::kNotReady:
+					// The source may be readable while the pipe is full, which would make level-triggered polling spin.
+					if(dir.staged && dir.pipe[0] != -1)
+						dir.blocked = true;
+					break;
+				default:
+					m_failed = true;
+					return;
+				}
+
+			if(dir.staged)
+				switch(drain(direction, moved))
+				{
+				case Status::kSuccess:
+					dir.staged -= moved;
+					dir.forwarded += moved;
+					if(moved)
+					{
+						dir.blocked = false;
+						progress = true;
+					}
+					break;
+				case Status::kNotReady:
+					break;
+				default:
+					m_failed = true;
+					return;
+				}
+
+			if(!progress)
+				break;
+		}
+
+		// Pass on the half-close once everything was forwarded.
+		if(dir.eof && !dir.staged && !dir.shut)
+		{
+			dir.shut = true;
+			if(Status::kSuccess != m_endpoints[1 - direction].shutdown(Shutdown::kSend))
+				m_failed = true;
+		}
+	}
+
+	void Proxy::update_interest()
+	{
+		if(!m_poller)
+			return;
+
+		for(std::size_t i = 0; i < 2; i++)
+		{
+			Endpoint &endpoint = m_endpoints[i];
+			Direction const& outgoing = m_directions[i];
+			Direction const& incoming = m_directions[1 - i];
+
+			bool const read = !outgoing.eof && !outgoing.blocked && outgoing.staged < outgoing.capacity;
+			bool const write = incoming.staged != 0;
+			if(read != endpoint.m_read || write != endpoint.m_write)
+			{
+				endpoint.m_read = read;
+				endpoint.m_write = write;
+				if(!m_poller->modify(endpoint.m_entry, read, write))
+					m_failed = true;
+			}
+		}
+	}
+
+	bool Proxy::handle(
+		PollEvent const& event)
+	{
+		if(finished())
+			return false;
+
+		std::size_t const index = static_cast<Endpoint *>(event.entry->socket) == &m_endpoints[0] ? 0 : 1;
+
+		// Errors are detected by the next system call on the socket.
+		if(event.can_read || event.error)
+			pump(index);
+		if(event.can_write || event.error)
+			pump(1 - index);
+
+		if(!m_failed)
+			update_interest();
+
+		return !finished();
+	}
+}
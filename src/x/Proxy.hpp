@@ -0,0 +1,157 @@
+/** @file Proxy.hpp
+	Contains the netlib::x::Proxy class used for forwarding data between two connections. */
+#ifndef __netlib_x_proxy_hpp_defined
+#define __netlib_x_proxy_hpp_defined
+
+#include "../Socket.hpp"
+#include "../Poller.hpp"
+#include "../util/Buffer.hpp"
+
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Forwards data between two stream sockets in both directions, as layer 4 proxies do.
+		On GNU/Linux, data is moved through a pipe with `splice()`, so it never enters user space. Elsewhere, or if `zero_copy` is disabled or no pipe can be created, it is received into and sent from a buffer.
+
+		Each direction stops reading while its pipe or buffer is full, and only polls for output while it holds data, so that a slow receiver throttles its sender instead of making memory grow. When one side shuts down sending, the other side's sending is shut down once all data was forwarded, and the opposite direction keeps working until it finishes as well.
+
+		Both sockets are watched by a poller passed to `attach()`. Pass every event of either socket to `handle()`, and destroy the proxy once it returns false. */
+	class Proxy
+	{
+	public:
+		/** One of the proxy's sockets. */
+		class Endpoint : public StreamSocket
+		{
+			friend class Proxy;
+			/** The proxy the socket belongs to. */
+			Proxy * m_proxy;
+			/** The socket's watch entry, or null. */
+			detail::WatchEntry const * m_entry;
+			/** Whether input events are polled. */
+			bool m_read;
+			/** Whether output events are polled. */
+			bool m_write;
+		public:
+			Endpoint(
+				StreamSocket && socket,
+				Proxy * proxy);
+
+			/** Casts a polled socket that is known to be a proxy endpoint. */
+			static inline Endpoint * cast_from_base(
+				Socket * socket);
+
+			/** The proxy the socket belongs to. */
+			inline Proxy &proxy() const noexcept;
+		};
+	private:
+		/** The state of forwarding in one direction. */
+		struct Direction
+		{
+			/** The pipe's read and write ends, or -1 when buffering. */
+			int pipe[2];
+			/** The fallback buffer. */
+			util::Buffer buffer;
+			/** How many bytes may be held at once. */
+			std::size_t capacity;
+			/** How many bytes are held in the pipe or buffer. */
+			std::size_t staged;
+			/** How many bytes were forwarded in total. */
+			std::uint64_t forwarded;
+			/** Whether receiving stalled although the pipe has room, which happens when partially filled pages use up its slots. Cleared once data was sent. */
+			bool blocked;
+			/** Whether the source shut down sending. */
+			bool eof;
+			/** Whether the destination was shut down for sending. */
+			bool shut;
+
+			Direction(
+				std::size_t capacity,
+				bool zero_copy);
+			/** The pipe is owned, and closed on destruction. */
+			Direction(Direction const&) = delete;
+			Direction &operator=(Direction const&) = delete;
+			~Direction();
+		};
+
+		/** The two sockets. */
+		Endpoint m_endpoints[2];
+		/** The directions, indexed by their source endpoint. */
+		Direction m_directions[2];
+		/** The poller watching the sockets, or null. */
+		Poller * m_poller;
+		/** Whether forwarding failed. */
+		bool m_failed;
+
+		/** Moves as much data as possible in one direction.
+		@param[in] direction:
+			The index of the source endpoint. */
+		void pump(
+			std::size_t direction);
+		/** Receives data into a direction's pipe or buffer. */
+		Status fill(
+			std::size_t direction,
+			std::size_t &moved);
+		/** Sends data from a direction's pipe or buffer. */
+		Status drain(
+			std::size_t direction,
+			std::size_t &moved);
+		/** Adjusts which events are polled for the sockets. */
+		void update_interest();
+	public:
+		/** Creates a proxy.
+		@param[in] first:
+			The first connection.
+		@param[in] second:
+			The second connection.
+		@param[in] buffer_size:
+			How many bytes each direction holds at most, in its pipe or buffer.
+		@param[in] zero_copy:
+			Whether to use `splice()` where it is available. */
+		Proxy(
+			StreamSocket && first,
+			StreamSocket && second,
+			std::size_t buffer_size = 1 << 16,
+			bool zero_copy = true);
+
+		Proxy(Proxy const&) = delete;
+		Proxy &operator=(Proxy const&) = delete;
+
+		/** Stops watching the sockets, and closes them. */
+		~Proxy();
+
+		/** Starts watching both sockets.
+		@param[in] poller:
+			The poller, which must outlive the proxy, or until `detach()`.
+		@return
+			Whether both sockets are watched. */
+		bool attach(
+			Poller &poller);
+		/** Stops watching the sockets. */
+		void detach();
+
+		/** Forwards data after a socket was polled.
+		@param[in] event:
+			An event of one of the proxy's sockets.
+		@return
+			Whether the proxy is still forwarding. Otherwise, it finished or failed, and can be destroyed. */
+		bool handle(
+			PollEvent const& event);
+
+		/** Whether both directions were shut down, or forwarding failed. */
+		inline bool finished() const noexcept;
+		/** Whether forwarding failed, for example, because a socket was reset. */
+		inline bool failed() const noexcept;
+		/** Whether data is forwarded with `splice()`. */
+		inline bool zero_copy() const noexcept;
+		/** How many bytes were forwarded from one socket to the other.
+		@param[in] from_first:
+			Whether to count the data sent by the first socket, or by the second socket. */
+		inline std::uint64_t forwarded(
+			bool from_first) const noexcept;
+	};
+}
+
+#include "Proxy.inl"
+
+#endif
@@ -0,0 +1,34 @@
+namespace netlib::x
+{
+	Proxy::Endpoint * Proxy::Endpoint::cast_from_base(
+		Socket * socket)
+	{
+		return static_cast<Endpoint *>(socket);
+	}
+
+	Proxy &Proxy::Endpoint::proxy() const noexcept
+	{
+		return *m_proxy;
+	}
+
+	bool Proxy::finished() const noexcept
+	{
+		return m_failed || (m_directions[0].shut && m_directions[1].shut);
+	}
+
+	bool Proxy::failed() const noexcept
+	{
+		return m_failed;
+	}
+
+	bool Proxy::zero_copy() const noexcept
+	{
+		return m_directions[0].pipe[0] != -1 && m_directions[1].pipe[0] != -1;
+	}
+
+	std::uint64_t Proxy::forwarded(
+		bool from_first) const noexcept
+	{
+		return m_directions[from_first ? 0 : 1].forwarded;
+	}
+}
@@ -0,0 +1,656 @@
+#include "ReliableChannel.hpp"
+#include "../internal/platform.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+
+namespace netlib::x
+{
+	/** The datagram types. */
+	static constexpr std::uint8_t kData = 0, kAck = 1;
+	/** The flags of data packets. */
+	static constexpr std::uint8_t kFirst = 1, kLast = 2;
+	/** How many packets sent after a packet have to be acknowledged before it is considered lost. */
+	static constexpr std::uint64_t kReorderThreshold = 3;
+	/** After how many data packets the receiver acknowledges, and at the end of every received batch. Acknowledging only once per batch would make every lost acknowledgement stall a small window until the timeout. */
+	static constexpr std::size_t kAckFrequency = 2;
+	/** The upper bound of the retransmission timeout. */
+	static constexpr std::chrono::seconds kMaxTimeout(60);
+	/** How soon to try again when the socket took no packets while none were in flight, so that no timeout is running. */
+	static constexpr std::chrono::milliseconds kRetryDelay(1);
+
+	/** Whether a failed send or receive only reported an ICMP error caused by an earlier datagram, such as "port unreachable" while the peer restarts. Such errors are treated like losses, so that the retransmission timeout decides whether the peer is gone. */
+	static bool refused()
+	{
+#ifdef NETLIB_WINDOWS
+		return ::WSAGetLastError() == WSAECONNRESET;
+#else
+		return errno == ECONNREFUSED;
+#endif
+	}
+
+	static void store_u16(
+		std::uint8_t * out,
+		std::uint16_t value)
+	{
+		out[0] = std::uint8_t(value >> 8);
+		out[1] = std::uint8_t(value);
+	}
+
+	static void store_u32(
+		std::uint8_t * out,
+		std::uint32_t value)
+	{
+		out[0] = std::uint8_t(value >> 24);
+		out[1] = std::uint8_t(value >> 16);
+		out[2] = std::uint8_t(value >> 8);
+		out[3] = std::uint8_t(value);
+	}
+
+	static std::uint16_t load_u16(
+		std::uint8_t const * in)
+	{
+		return std::uint16_t((in[0] << 8) | in[1]);
+	}
+
+	static std::uint32_t load_u32(
+		std::uint8_t const * in)
+	{
+		return (std::uint32_t(in[0]) << 24)
+			| (std::uint32_t(in[1]) << 16)
+			| (std::uint32_t(in[2]) << 8)
+			| std::uint32_t(in[3]);
+	}
+
+	/** How far `b` is ahead of packet number `a`, which may be negative. Packet numbers wrap around. */
+	static std::int32_t distance(
+		std::uint32_t a,
+		std::uint32_t b)
+	{
+		return std::int32_t(b - a);
+	}
+
+	ReliableChannel::ReliableChannel(
+		DatagramSocket &socket,
+		std::size_t send_limit,
+		std::size_t max_message_size,
+		std::size_t receive_limit):
+		m_socket(&socket),
+		m_send_limit(send_limit),
+		m_receive_limit(receive_limit),
+		m_max_message_size(max_message_size),
+		m_send_base(0),
+		m_unsent(0),
+		m_queued(0),
+		m_in_flight(0),
+		m_lost(0),
+		m_transmissions(0),
+		m_acked_transmission(0),
+		m_congestion_window(10),
+		m_slow_start_threshold(kWindow),
+		m_recovery_end(0),
+		m_smoothed_rtt(0),
+		m_rtt_variation(0),
+		m_timeout(kInitialTimeout),
+		m_loss_timer(clock::time_point::max()),
+		m_timeouts(0),
+		m_retransmissions(0),
+		m_receive_base(0),
+		m_received(kWindow, false),
+		m_receive_end(0),
+		m_buffered(0),
+		m_receive_buffer(DatagramSocket::kMaxBatch * kMaxDatagramSize),
+		m_loss_rate(0),
+		m_failed(false)
+	{
+	}
+
+	std::size_t ReliableChannel::datagram_size(
+		std::size_t size)
+	{
+		// Empty messages still take a packet.
+		std::size_t const fragments = std::max<std::size_t>(1, (size + kMaxFragmentSize - 1) / kMaxFragmentSize);
+		return size + fragments * kHeaderSize;
+	}
+
+	bool ReliableChannel::send(
+		std::uint16_t stream,
+		void const * data,
+		std::size_t size)
+	{
+		if(m_failed
+		|| size > m_max_message_size
+		|| m_queued + datagram_size(size) > m_send_limit)
+			return false;
+
+		std::uint32_t &stream_next = m_out_streams[stream];
+		std::uint8_t const * payload = static_cast<std::uint8_t const *>(data);
+		std::size_t offset = 0;
+		// Empty messages still take a packet.
+		do {
+			std::size_t const fragment = std::min(kMaxFragmentSize, size - offset);
+
+			Packet packet {};
+			packet.datagram.resize(kHeaderSize + fragment);
+			std::uint8_t * out = packet.datagram.data();
+			out[0] = kData;
+			out[1] = std::uint8_t((offset ? 0 : kFirst) | (offset + fragment == size ? kLast : 0));
+			store_u16(out + 2, stream);
+			store_u32(out + 4, m_send_base + std::uint32_t(m_packets.size()));
+			store_u32(out + 8, stream_next++);
+			if(fragment)
+				std::memcpy(out + kHeaderSize, payload + offset, fragment);
+
+			m_packets.push_back(std::move(packet));
+			offset += fragment;
+		} while(offset < size);
+
+		m_queued += datagram_size(size);
+
+		// An idle channel has no acknowledgement or timeout coming that would send the message.
+		if(!m_in_flight)
+			send_packets(clock::now());
+		return true;
+	}
+
+	bool ReliableChannel::receive(
+		std::uint16_t &stream,
+		std::vector<std::uint8_t> &message)
+	{
+		if(m_messages.empty())
+			return false;
+
+		stream = m_messages.front().stream;
+		m_buffered -= m_messages.front().data.size();
+		message = std::move(m_messages.front().data);
+		m_messages.pop_front();
+		return true;
+	}
+
+	Status ReliableChannel::transmit(
+		DataSlice const * datagrams,
+		std::size_t count,
+		std::size_t &sent)
+	{
+		if(m_loss_rate <= 0)
+			return m_socket->send_batch(datagrams, count, sent);
+
+		DataSlice kept[DatagramSocket::kMaxBatch];
+		std::size_t original[DatagramSocket::kMaxBatch];
+		std::size_t kept_count = 0;
+		std::uniform_real_distribution<double> chance(0, 1);
+		for(std::size_t i = 0; i < count; i++)
+			if(chance(m_loss_random) >= m_loss_rate)
+			{
+				original[kept_count] = i;
+				kept[kept_count++] = datagrams[i];
+			}
+
+		if(!kept_count)
+		{
+			sent = count;
+			return Status::kSuccess;
+		}
+
+		std::size_t kept_sent;
+		Status const status = m_socket->send_batch(kept, kept_count, kept_sent);
+		if(status != Status::kSuccess)
+			return status;
+		// Datagrams dropped after the last one that fit are retried.
+		sent = kept_sent == kept_count ? count : original[kept_sent];
+		return Status::kSuccess;
+	}
+
+	void ReliableChannel::send_packets(
+		clock::time_point now)
+	{
+		while(!m_failed)
+		{
+			std::size_t const window = std::max<std::size_t>(1, std::size_t(m_congestion_window));
+			DataSlice batch[DatagramSocket::kMaxBatch];
+			Packet * packets[DatagramSocket::kMaxBatch];
+			std::size_t count = 0;
+
+			// Retransmissions go first, and new packets must stay within the receiver's window.
+			if(m_lost)
+				for(std::size_t i = 0; i < m_unsent && count < DatagramSocket::kMaxBatch && m_in_flight + count < window; i++)
+					if(m_packets[i].lost)
+						packets[count++] = &m_packets[i];
+			for(std::size_t i = m_unsent;
+				i < m_packets.size() && i < kWindow && count < DatagramSocket::kMaxBatch && m_in_flight + count < window;
+				i++)
+				packets[count++] = &m_packets[i];
+
+			if(!count)
+				return;
+			for(std::size_t i = 0; i < count; i++)
+				batch[i] = DataSlice{packets[i]->datagram.data(), packets[i]->datagram.size()};
+
+			std::size_t sent;
+			// Refused packets were not sent, and are sent again like after a full send buffer.
+			Status const status = transmit(batch, count, sent);
+			if(status == Status::kError && !refused())
+			{
+				fail();
+				return;
+			}
+			if(status != Status::kSuccess)
+				return;
+
+			if(!m_in_flight)
+				m_timer = now + m_timeout;
+			for(std::size_t i = 0; i < sent; i++)
+			{
+				Packet &packet = *packets[i];
+				if(packet.lost)
+				{
+					packet.lost = false;
+					packet.retransmitted = true;
+					--m_lost;
+					++m_retransmissions;
+				} else
+					++m_unsent;
+				packet.sent_at = now;
+				packet.transmission = ++m_transmissions;
+				packet.in_flight = true;
+				++m_in_flight;
+			}
+
+			if(sent < count)
+				return;
+		}
+	}
+
+	void ReliableChannel::send_ack()
+	{
+		std::uint8_t ack[kHeaderSize + 8 * kMaxAckRanges];
+		ack[0] = kAck;
+		ack[2] = ack[3] = 0;
+		store_u32(ack + 4, m_receive_base);
+		store_u32(ack + 8, 0);
+
+		// The packet at the base is missing, otherwise the base would have advanced.
+		std::size_t ranges = 0;
+		std::uint32_t number = m_receive_base + 1;
+		while(ranges < kMaxAckRanges && distance(number, m_receive_end) > 0)
+		{
+			if(!m_received[number % kWindow])
+			{
+				++number;
+				continue;
+			}
+
+			std::uint32_t const first = number;
+			while(distance(number, m_receive_end) > 0 && m_received[number % kWindow])
+				++number;
+			store_u32(ack + kHeaderSize + 8 * ranges, first);
+			store_u32(ack + kHeaderSize + 8 * ranges + 4, number);
+			++ranges;
+		}
+		ack[1] = std::uint8_t(ranges);
+
+		// A lost acknowledgement is covered by the next one.
+		DataSlice const datagram{ack, kHeaderSize + 8 * ranges};
+		std::size_t sent;
+		if(transmit(&datagram, 1, sent) == Status::kError && !refused())
+			fail();
+	}
+
+	void ReliableChannel::on_data(
+		std::uint8_t const * datagram,
+		std::size_t size)
+	{
+		std::uint8_t const flags = datagram[1];
+		std::uint16_t const stream = load_u16(datagram + 2);
+		std::uint32_t const number = load_u32(datagram + 4);
+		std::uint32_t const stream_number = load_u32(datagram + 8);
+
+		// Duplicates and packets beyond the window are dropped, but still acknowledged.
+		std::int32_t const offset = distance(m_receive_base, number);
+		if(offset < 0
+		|| std::uint32_t(offset) >= kWindow
+		|| m_received[number % kWindow])
+			return;
+
+		// Packets beyond the receive limit are not acknowledged, so that they are sent again. Early fragments could fill the limit while their streams wait for the packet at the base, which is therefore accepted unless complete messages can free space.
+		if(m_buffered + (size - kHeaderSize) > m_receive_limit
+		&& (offset || !m_messages.empty()))
+			return;
+
+		m_received[number % kWindow] = true;
+		m_buffered += size - kHeaderSize;
+		if(distance(m_receive_end, number + 1) > 0)
+			m_receive_end = number + 1;
+		while(m_received[m_receive_base % kWindow])
+			m_received[m_receive_base++ % kWindow] = false;
+
+		InStream &in = m_in_streams[stream];
+		if(stream_number != in.next)
+		{
+			in.early.emplace(
+				stream_number,
+				Fragment{flags, std::vector<std::uint8_t>(datagram + kHeaderSize, datagram + size)});
+			return;
+		}
+
+		deliver(in, stream, flags, datagram + kHeaderSize, size - kHeaderSize);
+		for(auto it = in.early.begin(); it != in.early.end() && it->first == in.next; it = in.early.erase(it))
+			deliver(in, stream, it->second.flags, it->second.payload.data(), it->second.payload.size());
+	}
+
+	void ReliableChannel::deliver(
+		InStream &in,
+		std::uint16_t stream,
+		std::uint8_t flags,
+		std::uint8_t const * payload,
+		std::size_t size)
+	{
+		if(flags & kFirst)
+		{
+			m_buffered -= in.message.size();
+			in.message.clear();
+		}
+		in.message.insert(in.message.end(), payload, payload + size);
+		++in.next;
+
+		if(flags & kLast)
+		{
+			m_messages.push_back(Message{stream, std::move(in.message)});
+			in.message.clear();
+		}
+	}
+
+	bool ReliableChannel::acknowledge(
+		Packet &packet)
+	{
+		if(packet.acked)
+			return false;
+
+		packet.acked = true;
+		if(packet.in_flight)
+		{
+			packet.in_flight = false;
+			--m_in_flight;
+		} else if(packet.lost)
+		{
+			// The packet was only late.
+			packet.lost = false;
+			--m_lost;
+		}
+		m_acked_transmission = std::max(m_acked_transmission, packet.transmission);
+		return true;
+	}
+
+	void ReliableChannel::on_ack(
+		std::uint8_t const * datagram,
+		std::size_t size,
+		clock::time_point now)
+	{
+		std::size_t const ranges = datagram[1];
+		if(size < kHeaderSize + 8 * ranges)
+			return;
+
+		std::size_t acked = 0;
+		Packet * newest = nullptr;
+		auto const acknowledge_range = [&](std::uint32_t first, std::uint32_t end) {
+			// Ignores what was never sent.
+			std::int64_t const begin_index = std::max<std::int64_t>(0, distance(m_send_base, first));
+			std::int64_t const end_index = std::min<std::int64_t>(std::int64_t(m_unsent), distance(m_send_base, end));
+			for(std::int64_t i = begin_index; i < end_index; i++)
+			{
+				Packet &packet = m_packets[std::size_t(i)];
+				bool const in_flight = packet.in_flight;
+				if(!acknowledge(packet))
+					continue;
+				++acked;
+				// Karn's rule: retransmitted packets yield no round-trip time, and neither do packets already considered lost.
+				if(in_flight && !packet.retransmitted && (!newest || packet.transmission > newest->transmission))
+					newest = &packet;
+			}
+		};
+
+		acknowledge_range(m_send_base, load_u32(datagram + 4));
+		for(std::size_t i = 0; i < ranges; i++)
+			acknowledge_range(
+				load_u32(datagram + kHeaderSize + 8 * i),
+				load_u32(datagram + kHeaderSize + 8 * i + 4));
+
+		if(!acked)
+			return;
+
+		if(newest)
+			measure_rtt(now - newest->sent_at);
+		m_timeouts = 0;
+		m_timer = now + m_timeout;
+
+		if(m_congestion_window < m_slow_start_threshold)
+			m_congestion_window += double(acked);
+		else
+			m_congestion_window += double(acked) / m_congestion_window;
+		m_congestion_window = std::min(m_congestion_window, double(kWindow));
+
+		detect_losses(now);
+
+		bool freed = false;
+		while(!m_packets.empty() && m_packets.front().acked)
+		{
+			m_queued -= m_packets.front().datagram.size();
+			m_packets.pop_front();
+			++m_send_base;
+			--m_unsent;
+			freed = true;
+		}
+		if(freed)
+			m_sendable.notify_all();
+	}
+
+	void ReliableChannel::detect_losses(
+		clock::time_point now)
+	{
+		// Reordering of less than a quarter round trip is tolerated.
+		clock::duration const reorder_window = m_smoothed_rtt + m_smoothed_rtt / 4;
+		m_loss_timer = clock::time_point::max();
+
+		bool lost = false;
+		std::uint32_t const next = m_send_base + std::uint32_t(m_unsent);
+		for(std::size_t i = 0; i < m_unsent; i++)
+		{
+			Packet &packet = m_packets[i];
+			if(!packet.in_flight || packet.transmission >= m_acked_transmission)
+				continue;
+
+			// Packets sent well before an acknowledged packet are lost.
+			if(packet.transmission + kReorderThreshold > m_acked_transmission
+			&& (m_smoothed_rtt == clock::duration::zero() || now - packet.sent_at < reorder_window))
+			{
+				if(m_smoothed_rtt != clock::duration::zero())
+					m_loss_timer = std::min(m_loss_timer, packet.sent_at + reorder_window);
+				continue;
+			}
+
+			packet.in_flight = false;
+			packet.lost = true;
+			--m_in_flight;
+			++m_lost;
+			lost = lost || distance(m_recovery_end, m_send_base + std::uint32_t(i)) >= 0;
+		}
+
+		// Only the first loss of a window shrinks it.
+		if(lost)
+		{
+			m_slow_start_threshold = std::max(m_congestion_window / 2, 2.0);
+			m_congestion_window = m_slow_start_threshold;
+			m_recovery_end = next;
+		}
+	}
+
+	void ReliableChannel::measure_rtt(
+		clock::duration sample)
+	{
+		if(m_smoothed_rtt == clock::duration::zero())
+		{
+			m_smoothed_rtt = sample;
+			m_rtt_variation = sample / 2;
+		} else
+		{
+			clock::duration const deviation = sample > m_smoothed_rtt
+				? sample - m_smoothed_rtt
+				: m_smoothed_rtt - sample;
+			m_rtt_variation = (3 * m_rtt_variation + deviation) / 4;
+			m_smoothed_rtt = (7 * m_smoothed_rtt + sample) / 8;
+		}
+
+		m_timeout = std::clamp<clock::duration>(
+			m_smoothed_rtt + 4 * m_rtt_variation,
+			kMinTimeout,
+			kMaxTimeout);
+	}
+
+	void ReliableChannel::on_timeout()
+	{
+		if(++m_timeouts > kMaxTimeouts)
+		{
+			fail();
+			return;
+		}
+
+		for(std::size_t i = 0; i < m_unsent; i++)
+		{
+			Packet &packet = m_packets[i];
+			if(packet.in_flight)
+			{
+				packet.in_flight = false;
+				packet.lost = true;
+				++m_lost;
+			}
+		}
+		m_in_flight = 0;
+		m_loss_timer = clock::time_point::max();
+
+		m_slow_start_threshold = std::max(m_congestion_window / 2, 2.0);
+		m_congestion_window = 1;
+		m_recovery_end = m_send_base + std::uint32_t(m_unsent);
+		m_timeout = std::min<clock::duration>(2 * m_timeout, kMaxTimeout);
+	}
+
+	bool ReliableChannel::receive_packets()
+	{
+		if(m_failed)
+			return false;
+
+		ReceivedDatagram datagrams[DatagramSocket::kMaxBatch];
+		for(std::size_t i = 0; i < DatagramSocket::kMaxBatch; i++)
+		{
+			datagrams[i].data = m_receive_buffer.data() + i * kMaxDatagramSize;
+			datagrams[i].capacity = kMaxDatagramSize;
+		}
+
+		std::size_t const messages = m_messages.size();
+		bool acked = false;
+		while(!m_failed)
+		{
+			std::size_t received;
+			Status const status = m_socket->recv_batch(datagrams, DatagramSocket::kMaxBatch, received);
+			if(status == Status::kNotReady)
+				break;
+			if(status == Status::kError)
+			{
+				if(refused())
+					continue;
+				fail();
+				break;
+			}
+
+			auto const now = clock::now();
+			std::size_t unacknowledged = 0;
+			for(std::size_t i = 0; i < received; i++)
+			{
+				std::uint8_t const * datagram = static_cast<std::uint8_t const *>(datagrams[i].data);
+				if(datagrams[i].truncated || datagrams[i].size < kHeaderSize)
+					continue;
+
+				if(datagram[0] == kData)
+				{
+					on_data(datagram, datagrams[i].size);
+					if(++unacknowledged == kAckFrequency)
+					{
+						send_ack();
+						unacknowledged = 0;
+					}
+				} else if(datagram[0] == kAck)
+				{
+					on_ack(datagram, datagrams[i].size, now);
+					acked = true;
+				}
+			}
+
+			if(unacknowledged)
+				send_ack();
+		}
+
+		// Acknowledgements open the congestion window.
+		if(acked)
+			send_packets(clock::now());
+		if(m_messages.size() != messages)
+			m_receivable.notify_all();
+		return !m_failed;
+	}
+
+	ReliableChannel::clock::duration ReliableChannel::update()
+	{
+		if(m_failed)
+			return clock::duration::max();
+
+		auto const now = clock::now();
+		if(m_in_flight && now >= m_loss_timer)
+			detect_losses(now);
+		if(m_in_flight && now >= m_timer)
+			on_timeout();
+		send_packets(now);
+
+		if(m_failed)
+			return clock::duration::max();
+		if(!m_in_flight)
+			return m_lost || m_unsent < m_packets.size() ? clock::duration(kRetryDelay) : clock::duration::max();
+		return std::max(std::min(m_timer, m_loss_timer) - now, clock::duration::zero());
+	}
+
+	void ReliableChannel::simulate_loss(
+		double rate,
+		std::uint32_t seed)
+	{
+		m_loss_rate = rate;
+		m_loss_random.seed(seed);
+	}
+
+	void ReliableChannel::fail()
+	{
+		m_failed = true;
+		m_sendable.notify_all();
+		m_receivable.notify_all();
+	}
+
+	CR_IMPL(ReliableChannel::Send)
+		while(!channel->send(stream, data, size))
+		{
+			// Waiting would not help.
+			if(channel->failed()
+			|| size > channel->m_max_message_size
+			|| datagram_size(size) > channel->m_send_limit)
+				CR_THROW;
+			CR_AWAIT(channel->m_sendable.wait());
+		}
+	CR_FINALLY
+	CR_IMPL_END
+
+	CR_IMPL(ReliableChannel::Receive)
+		while(!channel->receive(stream, message))
+		{
+			if(channel->failed())
+				CR_THROW;
+			CR_AWAIT(channel->m_receivable.wait());
+		}
+	CR_FINALLY
+	CR_IMPL_END
+}
@@ -0,0 +1,321 @@
+/** @file ReliableChannel.hpp
+	Contains the netlib::x::ReliableChannel class used for reliable, ordered messaging over UDP. */
+#ifndef __netlib_x_reliablechannel_hpp_defined
+#define __netlib_x_reliablechannel_hpp_defined
+
+#include "../Socket.hpp"
+
+#include <libcr/primitives.hpp>
+#include <libcr/mt/ConditionVariable.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <deque>
+#include <map>
+#include <chrono>
+#include <random>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Reliable, message-oriented transport over a connected datagram socket, for links where TCP's single ordered byte stream suffers from loss.
+		Messages are sent on numbered streams, and are delivered in order per stream, but a lost packet only delays the messages of its own stream. Messages larger than a datagram are split into fragments, and reassembled by the receiver.
+
+		Every datagram carries a channel-wide packet number. The receiver acknowledges every second data packet and the end of every batch of received datagrams, with the number below which all packets arrived and up to `kMaxAckRanges` ranges of packets that arrived beyond it (selective acknowledgements). The sender retransmits packets once three packets sent after them were acknowledged, or a later packet was acknowledged and 5/4 of the round-trip time passed (tolerating some reordering), or after the retransmission timeout (RFC 6298), which doubles on every expiry. Congestion control is additive increase, multiplicative decrease: the congestion window grows by one packet per acknowledged packet in slow start, and by one packet per window afterwards, and is halved once per window of lost packets, or reset to one packet on timeouts.
+
+		Datagrams consist of a 12-byte header followed by the payload. Data packets: type (0), flags (1 = first fragment, 2 = last fragment), the 16-bit stream, the 32-bit packet number, and the 32-bit packet number within the stream. Acknowledgements: type (1), the number of ranges, 2 unused bytes, the 32-bit cumulative packet number, and 4 unused bytes, followed by each range's first and end packet number. All integers are big-endian.
+
+		Both directions are limited: the sender queues at most `send_limit` bytes of unacknowledged datagrams, including their headers, and the receiver drops data packets without acknowledging them while more than `receive_limit` bytes of received payload wait to be taken or reassembled, so that the sender retransmits them later. Only the packet at the receive base is still accepted while no complete message waits, so that streams blocked on it can always continue. A receiver that stops taking messages for long makes the sender time out as if the peer was gone.
+
+		The channel does not own the socket, which has to be connected to the peer (`Socket::connect()`) and watched by a poller. Call `receive_packets()` whenever the socket is readable, and `update()` after every `Poller::poll()`, with a poll timeout of at most the returned delay. */
+	class ReliableChannel
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		/** The maximum size of a datagram, in bytes, which fits into the minimum IPv6 MTU. */
+		static constexpr std::size_t kMaxDatagramSize = 1200;
+		/** The size of a datagram's header, in bytes. */
+		static constexpr std::size_t kHeaderSize = 12;
+		/** The maximum payload of a data packet, in bytes. */
+		static constexpr std::size_t kMaxFragmentSize = kMaxDatagramSize - kHeaderSize;
+		/** How many packets beyond the first unacknowledged packet can be in flight. */
+		static constexpr std::uint32_t kWindow = 4096;
+		/** The maximum number of ranges in an acknowledgement. */
+		static constexpr std::size_t kMaxAckRanges = 32;
+		/** The lower bound of the retransmission timeout. */
+		static constexpr std::chrono::milliseconds kMinTimeout{20};
+		/** The retransmission timeout before the round-trip time was measured. */
+		static constexpr std::chrono::milliseconds kInitialTimeout{200};
+		/** After how many consecutive timeouts the peer is considered gone. */
+		static constexpr unsigned kMaxTimeouts = 10;
+	private:
+		/** A sent data packet that was not acknowledged yet. */
+		struct Packet
+		{
+			/** The datagram, including the header. */
+			std::vector<std::uint8_t> datagram;
+			/** When the packet was last sent. */
+			clock::time_point sent_at;
+			/** The number of the packet's last transmission, counting all transmissions. */
+			std::uint64_t transmission;
+			/** Whether the packet was received by the peer. */
+			bool acked;
+			/** Whether the packet is sent, and neither acknowledged nor considered lost. */
+			bool in_flight;
+			/** Whether the packet was considered lost, and waits to be retransmitted. */
+			bool lost;
+			/** Whether the packet was sent more than once, so that its acknowledgement yields no round-trip time. */
+			bool retransmitted;
+		};
+
+		/** A received fragment that arrived before earlier fragments of its stream. */
+		struct Fragment
+		{
+			/** The fragment's flags. */
+			std::uint8_t flags;
+			/** The fragment's payload. */
+			std::vector<std::uint8_t> payload;
+		};
+
+		/** The receiving state of a stream. */
+		struct InStream
+		{
+			/** The stream's next expected packet number. */
+			std::uint32_t next;
+			/** Fragments that arrived early, by their number within the stream. */
+			std::map<std::uint32_t, Fragment> early;
+			/** The message being reassembled. */
+			std::vector<std::uint8_t> message;
+		};
+
+		/** A received message. */
+		struct Message
+		{
+			/** The stream the message was sent on. */
+			std::uint16_t stream;
+			/** The message. */
+			std::vector<std::uint8_t> data;
+		};
+
+		/** The socket. */
+		DatagramSocket * m_socket;
+		/** The maximum size of queued but unacknowledged datagrams, including their headers, in bytes. */
+		std::size_t m_send_limit;
+		/** The maximum size of received payloads that were not taken yet, in bytes. */
+		std::size_t m_receive_limit;
+		/** The maximum size of a message, in bytes. */
+		std::size_t m_max_message_size;
+
+		/** The packets that were not acknowledged yet, starting at `m_send_base`. */
+		std::deque<Packet> m_packets;
+		/** The number of the first packet in `m_packets`. */
+		std::uint32_t m_send_base;
+		/** The index of the first packet in `m_packets` that was never sent. */
+		std::size_t m_unsent;
+		/** The next number of each stream's outgoing packets. */
+		std::unordered_map<std::uint16_t, std::uint32_t> m_out_streams;
+		/** The size of the datagrams in `m_packets`, including their headers, in bytes. */
+		std::size_t m_queued;
+		/** The number of packets in flight. */
+		std::size_t m_in_flight;
+		/** The number of packets that wait to be retransmitted. */
+		std::size_t m_lost;
+		/** The number of transmissions so far. */
+		std::uint64_t m_transmissions;
+		/** The highest transmission number that was acknowledged. */
+		std::uint64_t m_acked_transmission;
+
+		/** The congestion window, in packets. Starts at 10 packets (RFC 6928). */
+		double m_congestion_window;
+		/** The slow start threshold, in packets. */
+		double m_slow_start_threshold;
+		/** Losses of packets before this packet number do not shrink the congestion window again. */
+		std::uint32_t m_recovery_end;
+		/** The smoothed round-trip time, or zero before the first measurement. */
+		clock::duration m_smoothed_rtt;
+		/** The round-trip time variation. */
+		clock::duration m_rtt_variation;
+		/** The retransmission timeout. */
+		clock::duration m_timeout;
+		/** When the retransmission timer expires, while packets are in flight. */
+		clock::time_point m_timer;
+		/** When the next packet in flight exceeds the reordering window, if a later packet was acknowledged. */
+		clock::time_point m_loss_timer;
+		/** The number of consecutive timeouts. */
+		unsigned m_timeouts;
+		/** How many packets were retransmitted. */
+		std::uint64_t m_retransmissions;
+
+		/** The next packet number expected from the peer. All packets before it were received. */
+		std::uint32_t m_receive_base;
+		/** Which packets in the window starting at `m_receive_base` were received, indexed by packet number modulo `kWindow`. */
+		std::vector<bool> m_received;
+		/** One past the highest packet number received so far. */
+		std::uint32_t m_receive_end;
+		/** The receiving state of all streams that received data. */
+		std::unordered_map<std::uint16_t, InStream> m_in_streams;
+		/** The received, complete messages. */
+		std::deque<Message> m_messages;
+		/** The size of the received payloads in `m_messages`, incomplete messages, and early fragments, in bytes. */
+		std::size_t m_buffered;
+		/** Holds a batch of received datagrams. */
+		std::vector<std::uint8_t> m_receive_buffer;
+
+		/** Drops outgoing datagrams, for testing. */
+		std::minstd_rand m_loss_random;
+		/** The probability of dropping an outgoing datagram. */
+		double m_loss_rate;
+		/** Whether the socket failed, or the peer stopped responding. */
+		bool m_failed;
+
+		/** Notified when queued data was acknowledged. */
+		cr::mt::ConditionVariable m_sendable;
+		/** Notified when messages were received. */
+		cr::mt::ConditionVariable m_receivable;
+
+		/** How many bytes of datagrams a message of the given size takes, including the headers of its fragments. */
+		static std::size_t datagram_size(
+			std::size_t size);
+		/** Sends datagrams like `DatagramSocket::send_batch()`, but drops some of them if loss is simulated. Dropped datagrams count as sent. */
+		Status transmit(
+			DataSlice const * datagrams,
+			std::size_t count,
+			std::size_t &sent);
+		/** Sends lost and new packets, as far as the congestion window allows. */
+		void send_packets(
+			clock::time_point now);
+		/** Sends an acknowledgement of the received packets. */
+		void send_ack();
+		/** Handles a received data packet. */
+		void on_data(
+			std::uint8_t const * datagram,
+			std::size_t size);
+		/** Handles a received acknowledgement. */
+		void on_ack(
+			std::uint8_t const * datagram,
+			std::size_t size,
+			clock::time_point now);
+		/** Marks a packet as acknowledged.
+		@return
+			Whether the packet was not acknowledged before. */
+		bool acknowledge(
+			Packet &packet);
+		/** Considers packets lost that were sent at least three transmissions, or more than 5/4 of the round-trip time, before an acknowledged packet, and shrinks the congestion window once per window of losses. */
+		void detect_losses(
+			clock::time_point now);
+		/** Updates the round-trip time estimate and timeout. */
+		void measure_rtt(
+			clock::duration sample);
+		/** Considers all packets in flight lost, and shrinks the congestion window to one packet. */
+		void on_timeout();
+		/** Appends an in-order fragment to its stream's message, and completes the message at its last fragment. */
+		void deliver(
+			InStream &in,
+			std::uint16_t stream,
+			std::uint8_t flags,
+			std::uint8_t const * payload,
+			std::size_t size);
+	public:
+		/** Creates a channel.
+		@param[in] socket:
+			The socket, which must be connected to the peer, and must outlive the channel.
+		@param[in] send_limit:
+			How many bytes of datagrams, including their headers, can be queued until they are acknowledged.
+		@param[in] max_message_size:
+			The maximum size of a sent message, in bytes. Received messages are not limited.
+		@param[in] receive_limit:
+			How many bytes of received payload can wait to be taken or reassembled, before further data packets are dropped. Should be at least the peer's maximum message size, as larger messages are only reassembled one packet per retransmission. */
+		ReliableChannel(
+			DatagramSocket &socket,
+			std::size_t send_limit = 1 << 20,
+			std::size_t max_message_size = 1 << 16,
+			std::size_t receive_limit = 1 << 20);
+
+		ReliableChannel(ReliableChannel const&) = delete;
+		ReliableChannel &operator=(ReliableChannel const&) = delete;
+
+		/** Queues a message. If no packets are in flight, it is sent right away, otherwise, once acknowledgements open the congestion window, or by the next `update()`.
+		@param[in] stream:
+			The stream to send the message on. Messages of the same stream are delivered in order.
+		@param[in] data:
+			The message.
+		@param[in] size:
+			The message's size, in bytes. At most the maximum message size.
+		@return
+			Whether the message was queued. Fails if the send limit was reached, or the channel failed. */
+		bool send(
+			std::uint16_t stream,
+			void const * data,
+			std::size_t size);
+		/** Takes the next received message.
+		@param[out] stream:
+			The stream the message was sent on.
+		@param[out] message:
+			The message.
+		@return
+			Whether a message was received. */
+		bool receive(
+			std::uint16_t &stream,
+			std::vector<std::uint8_t> &message);
+
+		/** Receives and handles all pending datagrams in batches, and acknowledges them.
+		@return
+			Whether the channel is still usable. */
+		bool receive_packets();
+		/** Retransmits packets whose timeout expired, and sends as many packets as the congestion window allows.
+		@return
+			How long until the next timeout, a short delay if the socket did not take any packets although none are in flight, or `clock::duration::max()` if there is nothing to send. */
+		clock::duration update();
+
+		/** Drops outgoing datagrams at random, to test behaviour under packet loss.
+		@param[in] rate:
+			The probability of dropping a datagram, between 0 and 1.
+		@param[in] seed:
+			The seed of the random number generator, so that runs are reproducible. */
+		void simulate_loss(
+			double rate,
+			std::uint32_t seed = 1);
+
+		/** Fails the channel, for example, when the peer is shut down. Wakes all waiting coroutines. */
+		void fail();
+
+		/** Whether the socket failed, or the peer stopped responding. */
+		inline bool failed() const noexcept;
+		/** The size of all queued datagrams that were not acknowledged yet, including their headers, in bytes. */
+		inline std::size_t queued() const noexcept;
+		/** The number of received messages that were not taken yet. */
+		inline std::size_t received() const noexcept;
+		/** The size of received payloads that were not taken yet, including incomplete messages, in bytes. */
+		inline std::size_t buffered() const noexcept;
+		/** The number of packets in flight. */
+		inline std::size_t in_flight() const noexcept;
+		/** The congestion window, in packets. */
+		inline double congestion_window() const noexcept;
+		/** The smoothed round-trip time, or zero before the first measurement. */
+		inline clock::duration smoothed_rtt() const noexcept;
+		/** How many packets were retransmitted. */
+		inline std::uint64_t retransmissions() const noexcept;
+
+		/** Queues a message, waiting while the send limit is reached. */
+		COROUTINE(Send, void)
+		CR_STATE(
+			(ReliableChannel *) channel,
+			(std::uint16_t) stream,
+			(void const *) data,
+			(std::size_t) size)
+		CR_EXTERNAL
+
+		/** Waits for the next received message. */
+		COROUTINE(Receive, void)
+		CR_STATE(
+			(ReliableChannel *) channel,
+			(std::uint16_t &) stream,
+			(std::vector<std::uint8_t> &) message)
+		CR_EXTERNAL
+	};
+}
+
+#include "ReliableChannel.inl"
+
+#endif
@@ -0,0 +1,42 @@
+namespace netlib::x
+{
+	bool ReliableChannel::failed() const noexcept
+	{
+		return m_failed;
+	}
+
+	std::size_t ReliableChannel::queued() const noexcept
+	{
+		return m_queued;
+	}
+
+	std::size_t ReliableChannel::received() const noexcept
+	{
+		return m_messages.size();
+	}
+
+	std::size_t ReliableChannel::buffered() const noexcept
+	{
+		return m_buffered;
+	}
+
+	std::size_t ReliableChannel::in_flight() const noexcept
+	{
+		return m_in_flight;
+	}
+
+	double ReliableChannel::congestion_window() const noexcept
+	{
+		return m_congestion_window;
+	}
+
+	ReliableChannel::clock::duration ReliableChannel::smoothed_rtt() const noexcept
+	{
+		return m_smoothed_rtt;
+	}
+
+	std::uint64_t ReliableChannel::retransmissions() const noexcept
+	{
+		return m_retransmissions;
+	}
+}
@@ -0,0 +1,812 @@
+#include "Resolver.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cassert>
+
+namespace netlib::x
+{
+	/** DNS record types. */
+	static constexpr std::uint16_t kTypeA = 1;
+	static constexpr std::uint16_t kTypeSoa = 6;
+	static constexpr std::uint16_t kTypeAaaa = 28;
+	/** The internet record class. */
+	static constexpr std::uint16_t kClassIn = 1;
+
+	/** DNS header flags. */
+	static constexpr std::uint16_t kFlagResponse = 0x8000;
+	static constexpr std::uint16_t kFlagTruncated = 0x0200;
+	static constexpr std::uint16_t kFlagRecursion = 0x0100;
+	static constexpr std::uint16_t kRcodeMask = 0x000f;
+	static constexpr std::uint16_t kRcodeNxdomain = 3;
+
+	/** The size of a DNS header. */
+	static constexpr std::size_t kHeaderSize = 12;
+	/** The maximum size of a UDP DNS message without EDNS. */
+	static constexpr std::size_t kMaxUdpMessage = 512;
+	/** How long to cache negative answers without SOA record, in seconds. */
+	static constexpr std::uint32_t kNegativeTtl = 30;
+	/** The maximum time to cache answers, in seconds. */
+	static constexpr std::uint32_t kMaxTtl = 24 * 60 * 60;
+
+	static std::uint16_t read16(
+		std::uint8_t const * data)
+	{
+		return (std::uint16_t(data[0]) << 8) | data[1];
+	}
+
+	static std::uint32_t read32(
+		std::uint8_t const * data)
+	{
+		return (std::uint32_t(read16(data)) << 16) | read16(data + 2);
+	}
+
+	static void write16(
+		std::vector<std::uint8_t> &out,
+		std::uint16_t value)
+	{
+		out.push_back(value >> 8);
+		out.push_back(value & 0xff);
+	}
+
+	/** Skips a possibly compressed domain name.
+	@return
+		Whether the name was well-formed. */
+	static bool skip_name(
+		std::uint8_t const * message,
+		std::size_t size,
+		std::size_t &offset)
+	{
+		while(offset < size)
+		{
+			std::uint8_t length = message[offset];
+			if(!length)
+			{
+				++offset;
+				return true;
+			}
+
+			// A compression pointer ends the name.
+			if((length & 0xc0) == 0xc0)
+			{
+				offset += 2;
+				return offset <= size;
+			}
+
+			if(length & 0xc0)
+				return false;
+
+			offset += 1 + length;
+		}
+		return false;
+	}
+
+	/** Compares an uncompressed domain name against a normalised name. */
+	static bool match_name(
+		std::uint8_t const * message,
+		std::size_t size,
+		std::size_t &offset,
+		std::string const& name)
+	{
+		std::size_t position = 0;
+		while(offset < size)
+		{
+			std::uint8_t length = message[offset++];
+			if(!length)
+				return position == name.size();
+			if(length & 0xc0 || offset + length > size)
+				return false;
+
+			if(position)
+			{
+				if(position >= name.size() || name[position] != '.')
+					return false;
+				++position;
+			}
+
+			for(std::size_t i = 0; i < length; i++, position++)
+				if(position >= name.size()
+				|| std::tolower(message[offset + i]) != name[position])
+					return false;
+
+			offset += length;
+		}
+		return false;
+	}
+
+	/** Encodes a DNS query.
+	@return
+		Whether the name was valid. */
+	static bool encode_query(
+		std::string const& name,
+		std::uint16_t id,
+		std::uint16_t type,
+		std::vector<std::uint8_t> &out)
+	{
+		out.clear();
+		write16(out, id);
+		write16(out, kFlagRecursion);
+		write16(out, 1);
+		write16(out, 0);
+		write16(out, 0);
+		write16(out, 0);
+
+		std::size_t begin = 0;
+		while(begin < name.size())
+		{
+			std::size_t end = name.find('.', begin);
+			if(end == std::string::npos)
+				end = name.size();
+
+			std::size_t length = end - begin;
+			if(!length || length > 63)
+				return false;
+
+			out.push_back(length);
+			out.insert(out.end(), name.begin() + begin, name.begin() + end);
+			begin = end + 1;
+		}
+		out.push_back(0);
+
+		if(out.size() - kHeaderSize > 255)
+			return false;
+
+		write16(out, type);
+		write16(out, kClassIn);
+		return true;
+	}
+
+	/** A TCP connection used for retrying truncated answers. */
+	class Resolver::Stream : public StreamSocket
+	{
+		/** Whether the connection was established. */
+		bool m_connected;
+		/** The length-prefixed query. */
+		std::vector<std::uint8_t> m_output;
+		/** How much of the query was sent. */
+		std::size_t m_sent;
+		/** The length-prefixed answer received so far. */
+		std::vector<std::uint8_t> m_input;
+	public:
+		/** Connects to the name server and prepares the query. */
+		Stream(
+			SocketAddress const& nameserver,
+			std::vector<std::uint8_t> const& query):
+			StreamSocket(nameserver.family),
+			m_connected(false),
+			m_output(),
+			m_sent(0),
+			m_input()
+		{
+			write16(m_output, query.size());
+			m_output.insert(m_output.end(), query.begin(), query.end());
+
+			switch(connect(nameserver))
+			{
+			case Status::kSuccess:
+				m_connected = true;
+			case Status::kInProgress:
+				break;
+			default:
+				close();
+			}
+		}
+
+		/** Advances the exchange without blocking.
+		@return
+			`Status::kSuccess` once the whole answer was received, `Status::kNotReady` while the exchange is still running, or `Status::kError`. */
+		Status step()
+		{
+			if(!exists())
+				return Status::kError;
+
+			if(!m_connected)
+			{
+				Status status = finish_connect();
+				if(status == Status::kInProgress)
+					return Status::kNotReady;
+				if(status != Status::kSuccess)
+					return Status::kError;
+				m_connected = true;
+			}
+
+			while(m_sent < m_output.size())
+			{
+				std::size_t sent;
+				Status status = send(
+					m_output.data() + m_sent,
+					m_output.size() - m_sent,
+					sent);
+				if(status != Status::kSuccess)
+					return status;
+				m_sent += sent;
+			}
+
+			for(;;)
+			{
+				if(m_input.size() >= 2
+				&& m_input.size() >= 2 + std::size_t(read16(m_input.data())))
+					return Status::kSuccess;
+
+				std::uint8_t buffer[1024];
+				std::size_t received;
+				Status status = recv(buffer, sizeof(buffer), received);
+				if(status != Status::kSuccess)
+					return status;
+				// The server closed the connection early.
+				if(!received)
+					return Status::kError;
+
+				m_input.insert(m_input.end(), buffer, buffer + received);
+			}
+		}
+
+		/** The received answer, without length prefix. */
+		std::vector<std::uint8_t> answer() const
+		{
+			return std::vector<std::uint8_t>(
+				m_input.begin() + 2,
+				m_input.begin() + 2 + read16(m_input.data()));
+		}
+	};
+
+	Resolver::Resolver(
+		SocketAddress const& nameserver,
+		bool ipv6,
+		std::chrono::steady_clock::duration timeout,
+		unsigned max_attempts):
+		DatagramSocket(nameserver.family),
+		m_nameserver(nameserver),
+		m_ipv6(ipv6),
+		m_timeout(timeout),
+		m_max_attempts(max_attempts),
+		m_cache(),
+		m_queries(),
+		m_ids(),
+		m_random(std::random_device()()),
+		m_statistics()
+	{
+		assert(max_attempts != 0);
+
+		// Only accept answers from the name server.
+		if(Status::kSuccess != DatagramSocket::connect(nameserver))
+			DatagramSocket::close();
+	}
+
+	Resolver::~Resolver()
+	{
+	}
+
+	bool Resolver::system_nameserver(
+		SocketAddress &out)
+	{
+		std::FILE * file = std::fopen("/etc/resolv.conf", "r");
+		if(!file)
+			return false;
+
+		bool found = false;
+		char line[256];
+		while(!found && std::fgets(line, sizeof(line), file))
+		{
+			char address[64];
+			if(1 != std::sscanf(line, " nameserver %63s", address))
+				continue;
+
+			IPv4Address ipv4;
+			IPv6Address ipv6;
+			if(IPv4Address::parse(address, ipv4))
+			{
+				out = IPv4SocketAddress(ipv4, kPort);
+				found = true;
+			} else if(IPv6Address::parse(address, ipv6))
+			{
+				IPv6SocketAddress sa;
+				sa.address = ipv6;
+				sa.field = 0;
+				sa.scope = 0;
+				sa.port = kPort;
+				out = sa;
+				found = true;
+			}
+		}
+
+		std::fclose(file);
+		return found;
+	}
+
+	std::string Resolver::normalise(
+		char const * name)
+	{
+		assert(name != nullptr);
+
+		std::string normalised(name);
+		for(char &c : normalised)
+			c = std::tolower(c);
+
+		if(!normalised.empty() && normalised.back() == '.')
+			normalised.pop_back();
+
+		return normalised;
+	}
+
+	std::uint16_t Resolver::allocate_id()
+	{
+		std::uint16_t id;
+		do {
+			id = m_random();
+		} while(m_ids.count(id));
+		return id;
+	}
+
+	bool Resolver::cached(
+		std::string const& name,
+		std::vector<AddressInfo> &out,
+		bool expired)
+	{
+		auto it = m_cache.find(name);
+		if(it == m_cache.end())
+			return false;
+
+		if(!expired && it->second.expires <= std::chrono::steady_clock::now())
+			return false;
+
+		out = it->second.addresses;
+		return true;
+	}
+
+	bool Resolver::lookup(
+		char const * name,
+		std::vector<AddressInfo> &out)
+	{
+		AddressInfo info;
+		IPv4Address ipv4;
+		IPv6Address ipv6;
+		if(IPv4Address::parse(name, ipv4))
+		{
+			info.address = IPv4SocketAddress(ipv4, 0);
+			out.assign(1, info);
+			return true;
+		} else if(IPv6Address::parse(name, ipv6))
+		{
+			IPv6SocketAddress sa;
+			sa.address = ipv6;
+			sa.field = 0;
+			sa.scope = 0;
+			sa.port = 0;
+			info.address = sa;
+			out.assign(1, info);
+			return true;
+		}
+
+		if(!cached(normalise(name), out, false))
+			return false;
+
+		++m_statistics.hits;
+		return true;
+	}
+
+	bool Resolver::start(
+		char const * name)
+	{
+		std::string normalised = normalise(name);
+
+		if(m_queries.count(normalised))
+		{
+			++m_statistics.coalesced;
+			return true;
+		}
+
+		++m_statistics.misses;
+
+		Query &query = m_queries[normalised];
+		query.question_count = 0;
+		query.ttl = kMaxTtl;
+		query.attempts = 1;
+		query.sent = std::chrono::steady_clock::now();
+
+		if(m_ipv6)
+			query.questions[query.question_count++].type = kTypeAaaa;
+		query.questions[query.question_count++].type = kTypeA;
+
+		bool sent = true;
+		for(std::size_t i = 0; i < query.question_count; i++)
+		{
+			Question &question = query.questions[i];
+			question.id = allocate_id();
+			question.answered = false;
+			m_ids[question.id] = normalised;
+
+			sent = sent && send(normalised, question);
+		}
+
+		if(!sent)
+		{
+			for(std::size_t i = 0; i < query.question_count; i++)
+				m_ids.erase(query.questions[i].id);
+			m_queries.erase(normalised);
+		}
+
+		return sent;
+	}
+
+	Status Resolver::begin(
+		char const * name,
+		std::vector<AddressInfo> &out)
+	{
+		if(lookup(name, out))
+			return Status::kSuccess;
+		return start(name) ? Status::kNotReady : Status::kError;
+	}
+
+	bool Resolver::finished(
+		char const * name,
+		std::vector<AddressInfo> &out)
+	{
+		std::string normalised = normalise(name);
+		if(m_queries.count(normalised))
+			return false;
+
+		// Answers with a TTL of 0 are expired, but still valid for waiting lookups.
+		if(!cached(normalised, out, true))
+			out.clear();
+		return true;
+	}
+
+	bool Resolver::send(
+		std::string const& name,
+		Question const& question)
+	{
+		std::vector<std::uint8_t> message;
+		if(!encode_query(name, question.id, question.type, message))
+			return false;
+
+		std::size_t sent;
+		return Status::kSuccess == DatagramSocket::send(
+			message.data(),
+			message.size(),
+			sent);
+	}
+
+	bool Resolver::handle(
+		std::uint8_t const * message,
+		std::size_t size,
+		bool tcp)
+	{
+		if(size < kHeaderSize)
+			return false;
+
+		std::uint16_t id = read16(message);
+		std::uint16_t flags = read16(message + 2);
+
+		auto name_it = m_ids.find(id);
+		if(name_it == m_ids.end() || !(flags & kFlagResponse))
+			return false;
+
+		// Copy the name, as the ID entry may be removed.
+		std::string const name = name_it->second;
+		Query &query = m_queries.at(name);
+
+		Question * question = nullptr;
+		for(std::size_t i = 0; i < query.question_count; i++)
+			if(query.questions[i].id == id)
+				question = &query.questions[i];
+		assert(question != nullptr);
+
+		// Ignore duplicate answers, and UDP answers after switching to TCP.
+		if(question->answered || (question->stream && !tcp))
+			return false;
+
+		// Make sure that the answer belongs to the question.
+		std::size_t offset = kHeaderSize;
+		if(read16(message + 4) != 1
+		|| !match_name(message, size, offset, name)
+		|| offset + 4 > size
+		|| read16(message + offset) != question->type
+		|| read16(message + offset + 2) != kClassIn)
+			return false;
+		offset += 4;
+
+		if(flags & kFlagTruncated)
+		{
+			if(tcp)
+				return false;
+
+			std::vector<std::uint8_t> retry;
+			encode_query(name, question->id, question->type, retry);
+			question->stream.reset(new Stream(m_nameserver, retry));
+			++m_statistics.truncated;
+			return false;
+		}
+
+		std::uint16_t rcode = flags & kRcodeMask;
+		std::uint16_t answers = read16(message + 6);
+		std::uint16_t authorities = read16(message + 8);
+		bool found = false;
+
+		for(std::uint16_t i = 0; i < answers; i++)
+		{
+			if(!skip_name(message, size, offset) || offset + 10 > size)
+				return false;
+
+			std::uint16_t type = read16(message + offset);
+			std::uint16_t rclass = read16(message + offset + 2);
+			std::uint32_t ttl = read32(message + offset + 4);
+			std::uint16_t length = read16(message + offset + 8);
+			offset += 10;
+
+			if(offset + length > size)
+				return false;
+
+			if(rclass == kClassIn && type == question->type)
+			{
+				AddressInfo info;
+				if(type == kTypeA && length == 4)
+				{
+					info.address = IPv4SocketAddress(
+						IPv4Address(
+							message[offset],
+							message[offset+1],
+							message[offset+2],
+							message[offset+3]),
+						0);
+				} else if(type == kTypeAaaa && length == 16)
+				{
+					IPv6SocketAddress ipv6;
+					std::uint16_t * words = &ipv6.address.d0;
+					for(std::size_t word = 0; word < 8; word++)
+						words[word] = read16(message + offset + 2 * word);
+					ipv6.field = 0;
+					ipv6.scope = 0;
+					ipv6.port = 0;
+					info.address = ipv6;
+				} else
+				{
+					offset += length;
+					continue;
+				}
+
+				query.addresses.push_back(std::move(info));
+				query.ttl = std::min(query.ttl, ttl);
+				found = true;
+			}
+
+			offset += length;
+		}
+
+		if(!found)
+		{
+			// Negative answers are cached as long as the zone's SOA record says.
+			std::uint32_t negative = kNegativeTtl;
+			if(rcode == 0 || rcode == kRcodeNxdomain)
+			{
+				for(std::uint16_t i = 0; i < authorities; i++)
+				{
+					if(!skip_name(message, size, offset) || offset + 10 > size)
+						break;
+
+					std::uint16_t type = read16(message + offset);
+					std::uint32_t ttl = read32(message + offset + 4);
+					std::uint16_t length = read16(message + offset + 8);
+					offset += 10;
+
+					std::size_t rdata = offset;
+					if(type == kTypeSoa
+					&& skip_name(message, size, rdata)
+					&& skip_name(message, size, rdata)
+					&& rdata + 20 <= size)
+					{
+						negative = std::min(ttl, read32(message + rdata + 16));
+						break;
+					}
+
+					offset += length;
+				}
+			} else
+			{
+				// Do not cache server failures.
+				negative = 0;
+			}
+
+			query.ttl = std::min(query.ttl, negative);
+		}
+
+		question->answered = true;
+		question->stream.reset();
+		m_ids.erase(id);
+
+		for(std::size_t i = 0; i < query.question_count; i++)
+			if(!query.questions[i].answered)
+				return false;
+
+		complete(name, query);
+		return true;
+	}
+
+	void Resolver::complete(
+		std::string const& name,
+		Query &query)
+	{
+		for(std::size_t i = 0; i < query.question_count; i++)
+			if(!query.questions[i].answered)
+				m_ids.erase(query.questions[i].id);
+
+		std::stable_partition(
+			query.addresses.begin(),
+			query.addresses.end(),
+			[](AddressInfo const& info) {
+				return info.address.family == AddressFamily::kIPv6;
+			});
+
+		Entry &entry = m_cache[name];
+		entry.addresses = std::move(query.addresses);
+		entry.expires = std::chrono::steady_clock::now()
+			+ std::chrono::seconds(query.ttl);
+
+		m_queries.erase(name);
+	}
+
+
+	bool Resolver::step_streams()
+	{
+		struct Answer
+		{
+			std::vector<std::uint8_t> message;
+			std::uint16_t id;
+		};
+
+		// Answers are handled afterwards, as that may remove queries.
+		std::vector<Answer> answers;
+		std::vector<std::string> failed;
+
+		for(auto &entry : m_queries)
+		{
+			Query &query = entry.second;
+			for(std::size_t i = 0; i < query.question_count; i++)
+			{
+				Question &question = query.questions[i];
+				if(!question.stream)
+					continue;
+
+				switch(question.stream->step())
+				{
+				case Status::kSuccess:
+					answers.push_back(Answer{question.stream->answer(), question.id});
+				case Status::kNotReady:
+					break;
+				default:
+					failed.push_back(entry.first);
+				}
+			}
+		}
+
+		bool completed = false;
+		for(Answer const& answer : answers)
+			if(m_ids.count(answer.id))
+				completed |= handle(answer.message.data(), answer.message.size(), true);
+
+		for(std::string const& name : failed)
+		{
+			auto it = m_queries.find(name);
+			if(it == m_queries.end())
+				continue;
+
+			it->second.ttl = 0;
+			complete(name, it->second);
+			completed = true;
+		}
+
+		return completed;
+	}
+
+	bool Resolver::poll_answers(
+		bool completed)
+	{
+		bool success = true;
+		std::uint8_t buffer[kMaxUdpMessage];
+		for(bool pending = true; pending;)
+		{
+			std::size_t received;
+			switch(DatagramSocket::recv(buffer, sizeof(buffer), received))
+			{
+			case Status::kSuccess:
+				completed |= handle(buffer, received, false);
+				break;
+			case Status::kNotReady:
+				pending = false;
+				break;
+			default:
+				pending = false;
+				success = false;
+			}
+		}
+
+		completed |= step_streams();
+
+		// Wake all waiting lookups, as any of them may have completed.
+		if(completed)
+			Socket::m_input.notify_all();
+
+		return success;
+	}
+
+	bool Resolver::process()
+	{
+		return poll_answers(false);
+	}
+
+	bool Resolver::update()
+	{
+		auto const now = std::chrono::steady_clock::now();
+		std::vector<std::string> failed;
+
+		for(auto &entry : m_queries)
+		{
+			Query &query = entry.second;
+			if(now - query.sent < m_timeout)
+				continue;
+
+			if(query.attempts >= m_max_attempts)
+			{
+				failed.push_back(entry.first);
+				continue;
+			}
+
+			++query.attempts;
+			query.sent = now;
+
+			for(std::size_t i = 0; i < query.question_count; i++)
+			{
+				Question &question = query.questions[i];
+				if(question.answered)
+					continue;
+
+				if(question.stream)
+				{
+					std::vector<std::uint8_t> retry;
+					encode_query(entry.first, question.id, question.type, retry);
+					question.stream.reset(new Stream(m_nameserver, retry));
+				} else
+					send(entry.first, question);
+			}
+		}
+
+		for(std::string const& name : failed)
+		{
+			++m_statistics.timeouts;
+			Query &query = m_queries.at(name);
+			query.ttl = 0;
+			complete(name, query);
+		}
+
+		return poll_answers(!failed.empty());
+	}
+
+	void Resolver::prune()
+	{
+		auto const now = std::chrono::steady_clock::now();
+		for(auto it = m_cache.begin(); it != m_cache.end();)
+			if(it->second.expires <= now)
+				it = m_cache.erase(it);
+			else
+				++it;
+	}
+
+	CR_IMPL(Resolver::Resolve)
+		if(resolver->lookup(name, out))
+			CR_RETURN;
+
+		if(!resolver->start(name))
+			CR_THROW;
+
+		while(!resolver->finished(name, out))
+		{
+			CR_AWAIT(resolver->Socket::m_input.wait());
+			if(!resolver->process())
+				CR_THROW;
+		}
+	CR_FINALLY
+	CR_IMPL_END
+}
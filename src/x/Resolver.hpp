@@ -0,0 +1,258 @@
+/** @file Resolver.hpp
+	Contains the netlib::x::Resolver class used for asynchronous host name resolution. */
+#ifndef __netlib_x_resolver_hpp_defined
+#define __netlib_x_resolver_hpp_defined
+
+#include "../Socket.hpp"
+#include "../HostInfo.hpp"
+#include "../defines.hpp"
+
+#include <libcr/primitives.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Asynchronous, caching DNS stub resolver.
+		Unlike `netlib::resolve_name()`, this does not block: queries are sent to a recursive name server via UDP, and answers are received via polling. Truncated answers are retried over TCP. Answers are cached for as long as their TTL allows, and concurrent lookups of the same name share a single query.
+
+		The resolver has to be watched by the poller for input. Additionally, `update()` has to be called regularly (for example, after every `Poller::poll()`), as it handles retransmissions, timeouts, and the progress of TCP queries. */
+	class Resolver : private DatagramSocket
+	{
+		friend class ::netlib::Poller;
+	public:
+		/** Usage statistics of a resolver. */
+		struct Statistics
+		{
+			/** How many lookups were answered from the cache. */
+			std::uint64_t hits;
+			/** How many lookups started a new query. */
+			std::uint64_t misses;
+			/** How many lookups joined an already running query. */
+			std::uint64_t coalesced;
+			/** How many queries had to be retried over TCP. */
+			std::uint64_t truncated;
+			/** How many queries timed out. */
+			std::uint64_t timeouts;
+		};
+	private:
+		class Stream;
+
+		/** A cached answer. */
+		struct Entry
+		{
+			/** The resolved addresses. Empty if the name could not be resolved. */
+			std::vector<AddressInfo> addresses;
+			/** When the answer expires. */
+			std::chrono::steady_clock::time_point expires;
+		};
+
+		/** A question within a query, one per record type. */
+		struct Question
+		{
+			/** The DNS message ID. */
+			std::uint16_t id;
+			/** The record type. */
+			std::uint16_t type;
+			/** Whether the question was answered. */
+			bool answered;
+			/** The TCP connection, if the UDP answer was truncated. */
+			std::unique_ptr<Stream> stream;
+		};
+
+		/** A running query for a name. */
+		struct Query
+		{
+			/** The questions, one per record type. */
+			Question questions[2];
+			/** The number of questions. */
+			std::size_t question_count;
+			/** The addresses received so far. */
+			std::vector<AddressInfo> addresses;
+			/** The minimal TTL of all received records, in seconds. */
+			std::uint32_t ttl;
+			/** How often the query was sent. */
+			unsigned attempts;
+			/** When the query was last sent. */
+			std::chrono::steady_clock::time_point sent;
+		};
+
+		/** The name server address. */
+		SocketAddress m_nameserver;
+		/** Whether to also query IPv6 addresses. */
+		bool m_ipv6;
+		/** How long to wait for an answer before retrying. */
+		std::chrono::steady_clock::duration m_timeout;
+		/** How often to send a query before giving up. */
+		unsigned m_max_attempts;
+		/** The cached answers, by normalised name. */
+		std::unordered_map<std::string, Entry> m_cache;
+		/** The running queries, by normalised name. */
+		std::unordered_map<std::string, Query> m_queries;
+		/** The names of the running queries, by message ID. */
+		std::unordered_map<std::uint16_t, std::string> m_ids;
+		/** Generates unpredictable message IDs. */
+		std::mt19937 m_random;
+		/** The usage statistics. */
+		Statistics m_statistics;
+
+		/** Looks up a cached answer.
+		@param[in] name:
+			The normalised name.
+		@param[out] out:
+			The cached addresses.
+		@param[in] expired:
+			Whether to also return expired answers.
+		@return
+			Whether an answer was cached. */
+		bool cached(
+			std::string const& name,
+			std::vector<AddressInfo> &out,
+			bool expired);
+		/** Resolves numeric addresses and cached names without querying.
+		@return
+			Whether the name was resolved. */
+		bool lookup(
+			char const * name,
+			std::vector<AddressInfo> &out);
+		/** Starts a query for a name, or joins a running query.
+		@return
+			Whether the query could be sent. */
+		bool start(
+			char const * name);
+		/** Receives pending UDP answers, advances TCP queries, and wakes waiting lookups.
+		@param[in] completed:
+			Whether a query already completed.
+		@return
+			Whether the operation succeeded. */
+		bool poll_answers(
+			bool completed);
+		/** Advances all TCP queries.
+		@return
+			Whether a query completed. */
+		bool step_streams();
+		/** Sends a question via UDP. */
+		bool send(
+			std::string const& name,
+			Question const& question);
+		/** Handles a received DNS message.
+		@return
+			Whether a query completed. */
+		bool handle(
+			std::uint8_t const * message,
+			std::size_t size,
+			bool tcp);
+		/** Completes a query and caches its result. */
+		void complete(
+			std::string const& name,
+			Query &query);
+		/** Allocates an unused message ID. */
+		std::uint16_t allocate_id();
+		/** Converts a name to its normalised form. */
+		static std::string normalise(
+			char const * name);
+
+	public:
+		/** The default port of DNS servers. */
+		static constexpr port_t kPort = 53;
+
+		/** Creates a resolver.
+		@param[in] nameserver:
+			The address of the recursive name server to query.
+		@param[in] ipv6:
+			Whether to also query IPv6 addresses.
+		@param[in] timeout:
+			How long to wait for an answer before retrying.
+		@param[in] max_attempts:
+			How often to send a query before giving up. */
+		explicit Resolver(
+			SocketAddress const& nameserver,
+			bool ipv6 = true,
+			std::chrono::steady_clock::duration timeout = std::chrono::seconds(1),
+			unsigned max_attempts = 3);
+
+		Resolver(Resolver const&) = delete;
+		Resolver &operator=(Resolver const&) = delete;
+
+		~Resolver();
+
+		static constexpr Resolver * cast_from_base(
+			Socket * base);
+		static constexpr Resolver const * cast_from_base(
+			Socket const * base);
+
+		/** Retrieves the first name server configured in `/etc/resolv.conf`.
+		@param[out] out:
+			The name server's address.
+		@return
+			Whether a name server was found. */
+		static bool system_nameserver(
+			SocketAddress &out);
+
+		/** Whether the resolver's socket could be created. */
+		using DatagramSocket::exists;
+
+		/** Receives and handles pending answers.
+			This is called by `Resolve`, and usually does not need to be called directly.
+		@return
+			Whether the operation succeeded. */
+		bool process();
+
+		/** Retransmits unanswered queries, handles timeouts, and advances TCP queries.
+			Must be called regularly.
+		@return
+			Whether the operation succeeded. */
+		bool update();
+
+		/** Starts resolving a host name without waiting, for event loops that do not use coroutines.
+			Numeric addresses and cached names are resolved immediately. Otherwise, poll the resolver and call `update()` until `finished()` returns true.
+		@param[in] name:
+			The host name.
+		@param[out] out:
+			On success, the addresses retrieved, with IPv6 addresses first.
+		@return
+			`Status::kSuccess` if the name was resolved immediately, `Status::kNotReady` if a query was started or joined, and `Status::kError` if the query could not be sent. */
+		Status begin(
+			char const * name,
+			std::vector<AddressInfo> &out);
+		/** Checks whether the lookup of a name started by `begin()` finished, and retrieves its result.
+		@param[in] name:
+			The host name.
+		@param[out] out:
+			Once finished, the addresses retrieved, with IPv6 addresses first. Empty, if the name could not be resolved.
+		@return
+			Whether the lookup finished. */
+		bool finished(
+			char const * name,
+			std::vector<AddressInfo> &out);
+
+		/** Removes all expired answers from the cache. */
+		void prune();
+
+		/** The resolver's usage statistics. */
+		NETLIB_INL Statistics const& statistics() const;
+
+		/** Resolves a host name.
+			Numeric addresses are returned without querying the name server.
+		@param[in] name:
+			The host name. Must stay valid until the coroutine finished.
+		@param[out] out:
+			The addresses retrieved, with IPv6 addresses first. Empty, if the name could not be resolved. */
+		COROUTINE(Resolve, void)
+		CR_STATE(
+			(Resolver *) resolver,
+			(char const *) name,
+			(std::vector<AddressInfo> &) out)
+		CR_EXTERNAL
+	};
+}
+
+#include "Resolver.inl"
+
+#endif
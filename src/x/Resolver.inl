@@ -0,0 +1,19 @@
+namespace netlib::x
+{
+	constexpr Resolver * Resolver::cast_from_base(
+		Socket * base)
+	{
+		return static_cast<Resolver *>(base);
+	}
+
+	constexpr Resolver const * Resolver::cast_from_base(
+		Socket const * base)
+	{
+		return static_cast<Resolver const *>(base);
+	}
+
+	Resolver::Statistics const& Resolver::statistics() const
+	{
+		return m_statistics;
+	}
+}
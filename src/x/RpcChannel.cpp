@@ -0,0 +1,316 @@
+#include "RpcChannel.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	/** Marks response frames in the header's size field. */
+	static constexpr std::uint32_t kResponseFlag = 0x80000000;
+
+	static void store_u32(
+		std::uint8_t * out,
+		std::uint32_t value)
+	{
+		out[0] = std::uint8_t(value >> 24);
+		out[1] = std::uint8_t(value >> 16);
+		out[2] = std::uint8_t(value >> 8);
+		out[3] = std::uint8_t(value);
+	}
+
+	static std::uint32_t load_u32(
+		std::uint8_t const * in)
+	{
+		return (std::uint32_t(in[0]) << 24)
+			| (std::uint32_t(in[1]) << 16)
+			| (std::uint32_t(in[2]) << 8)
+			| std::uint32_t(in[3]);
+	}
+
+	RpcCall::RpcCall():
+		m_id(0),
+		m_state(State::kIdle),
+		m_deadline(),
+		m_response(),
+		m_done()
+	{
+	}
+
+	RpcChannel::RpcChannel(
+		BufferedConnection &connection,
+		std::size_t max_message_size):
+		m_connection(&connection),
+		m_max_message_size(max_message_size),
+		m_next_id(0),
+		m_calls(),
+		m_deadlines(),
+		m_backlog(),
+		m_backlog_sent(0),
+		m_request_size(0),
+		m_request(false),
+		m_failed(false)
+	{
+		assert(max_message_size <= ~kResponseFlag);
+		assert(kHeaderSize + max_message_size <= connection.input().capacity());
+	}
+
+	RpcChannel::~RpcChannel()
+	{
+		fail();
+	}
+
+	bool RpcChannel::write_frame(
+		bool response,
+		std::uint32_t id,
+		void const * payload,
+		std::size_t size)
+	{
+		if(m_failed || size > ~kResponseFlag)
+			return false;
+
+		std::uint8_t header[kHeaderSize];
+		store_u32(header, std::uint32_t(size) | (response ? kResponseFlag : 0));
+		store_u32(header + 4, id);
+
+		// Frames must not overtake the backlog, and are never split between the output buffer and the backlog, so that the output buffer only needs to be checked once.
+		if(m_backlog.empty()
+		&& m_connection->output().free_space() >= kHeaderSize + size)
+		{
+			if(m_connection->write(header, kHeaderSize) != kHeaderSize
+			|| m_connection->write(payload, size) != size)
+			{
+				fail();
+				return false;
+			}
+		} else
+		{
+			m_backlog.insert(m_backlog.end(), header, header + kHeaderSize);
+			m_backlog.insert(m_backlog.end(),
+				static_cast<std::uint8_t const *>(payload),
+				static_cast<std::uint8_t const *>(payload) + size);
+		}
+		return true;
+	}
+
+	void RpcChannel::finish(
+		RpcCall &call,
+		RpcCall::State state)
+	{
+		call.m_state = state;
+		// The call may be destroyed by its coroutine once it is woken, so this must come last.
+		call.m_done.notify_all();
+	}
+
+	bool RpcChannel::start(
+		RpcCall &call,
+		void const * request,
+		std::size_t size,
+		std::chrono::steady_clock::duration timeout)
+	{
+		assert(call.m_state != RpcCall::State::kPending);
+
+		// Skip IDs that are still in use after wrapping around.
+		do {
+			call.m_id = m_next_id++;
+		} while(m_calls.count(call.m_id));
+
+		if(!write_frame(false, call.m_id, request, size))
+		{
+			call.m_state = RpcCall::State::kError;
+			return false;
+		}
+
+		call.m_state = RpcCall::State::kPending;
+		call.m_deadline = std::chrono::steady_clock::now() + timeout;
+		call.m_response.clear();
+		m_calls.emplace(call.m_id, &call);
+		m_deadlines.emplace(call.m_deadline, call.m_id);
+		return true;
+	}
+
+	void RpcChannel::cancel(
+		RpcCall &call)
+	{
+		if(call.m_state != RpcCall::State::kPending)
+			return;
+
+		m_calls.erase(call.m_id);
+		finish(call, RpcCall::State::kError);
+	}
+
+	bool RpcChannel::dispatch()
+	{
+		util::Buffer const& input = m_connection->input();
+		while(!m_request && input.size() >= kHeaderSize)
+		{
+			std::uint8_t header[kHeaderSize];
+			input.peek(header, kHeaderSize);
+			std::uint32_t const field = load_u32(header);
+			std::uint32_t const id = load_u32(header + 4);
+			std::size_t const size = field & ~kResponseFlag;
+
+			if(size > m_max_message_size)
+			{
+				fail();
+				return false;
+			}
+			if(input.size() < kHeaderSize + size)
+				break;
+
+			if(!(field & kResponseFlag))
+			{
+				m_request = true;
+				m_request_size = size;
+				break;
+			}
+
+			auto it = m_calls.find(id);
+			if(it == m_calls.end())
+			{
+				// The call timed out or was cancelled.
+				m_connection->skip(kHeaderSize + size);
+				continue;
+			}
+
+			RpcCall &call = *it->second;
+			m_calls.erase(it);
+			m_connection->skip(kHeaderSize);
+			call.m_response.resize(size);
+			m_connection->read(call.m_response.data(), size);
+			finish(call, RpcCall::State::kSuccess);
+		}
+
+		return true;
+	}
+
+	bool RpcChannel::receive()
+	{
+		if(m_failed)
+			return false;
+
+		util::Buffer const& input = m_connection->input();
+		std::size_t const before = input.size();
+		if(!m_connection->receive_some()
+		|| (!input.full() && input.size() == before))
+		{
+			fail();
+			return false;
+		}
+
+		return dispatch();
+	}
+
+	bool RpcChannel::next_request(
+		std::uint32_t &id,
+		std::string_view &payload)
+	{
+		if(!m_request)
+			return false;
+
+		if(m_connection->input().continuous_data() < kHeaderSize + m_request_size)
+			m_connection->linearize_input();
+
+		std::uint8_t const * frame = static_cast<std::uint8_t const *>(m_connection->input().data());
+		id = load_u32(frame + 4);
+		payload = std::string_view(
+			reinterpret_cast<char const *>(frame + kHeaderSize),
+			m_request_size);
+		return true;
+	}
+
+	bool RpcChannel::finish_request()
+	{
+		assert(m_request);
+
+		m_connection->skip(kHeaderSize + m_request_size);
+		m_request = false;
+		return dispatch();
+	}
+
+	bool RpcChannel::reply(
+		std::uint32_t id,
+		void const * payload,
+		std::size_t size)
+	{
+		return write_frame(true, id, payload, size);
+	}
+
+	bool RpcChannel::update()
+	{
+		auto const now = std::chrono::steady_clock::now();
+		while(!m_deadlines.empty() && m_deadlines.top().first <= now)
+		{
+			auto const [deadline, id] = m_deadlines.top();
+			m_deadlines.pop();
+
+			// Finished calls leave their entries behind, and their IDs may have been reused since.
+			auto it = m_calls.find(id);
+			if(it == m_calls.end() || it->second->m_deadline != deadline)
+				continue;
+
+			RpcCall &call = *it->second;
+			m_calls.erase(it);
+			finish(call, RpcCall::State::kTimeout);
+		}
+
+		if(m_failed)
+			return false;
+
+		// Move as much of the backlog as possible into the output buffer, both before and after the flush, so that the next flush sends a full buffer.
+		for(int round = 0; round < 2; round++)
+		{
+			if(std::size_t const rest = m_backlog.size() - m_backlog_sent)
+			{
+				m_backlog_sent += m_connection->write(m_backlog.data() + m_backlog_sent, rest);
+				if(m_backlog_sent == m_backlog.size())
+				{
+					m_backlog.clear();
+					m_backlog_sent = 0;
+				} else if(m_backlog_sent >= m_backlog.size() / 2)
+				{
+					// Drop the sent part while the peer reads slower than calls are made, so that the backlog does not keep growing. Waiting until at least half of it was sent keeps the copying linear.
+					m_backlog.erase(m_backlog.begin(), m_backlog.begin() + m_backlog_sent);
+					m_backlog_sent = 0;
+				}
+			}
+
+			std::size_t sent;
+			if(!round
+			&& Status::kError == m_connection->flush(m_connection->output().size(), sent))
+			{
+				fail();
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void RpcChannel::fail()
+	{
+		m_failed = true;
+		m_backlog.clear();
+		m_backlog_sent = 0;
+		while(!m_deadlines.empty())
+			m_deadlines.pop();
+
+		// Waking a call may destroy it, so it has to be removed first.
+		while(!m_calls.empty())
+		{
+			RpcCall &call = *m_calls.begin()->second;
+			m_calls.erase(m_calls.begin());
+			finish(call, RpcCall::State::kError);
+		}
+	}
+
+	CR_IMPL(RpcChannel::Call)
+		if(!channel->start(call, request, size, timeout))
+			CR_THROW;
+
+		while(call.state() == RpcCall::State::kPending)
+			CR_AWAIT(call.m_done.wait());
+
+		if(call.state() != RpcCall::State::kSuccess)
+			CR_THROW;
+	CR_FINALLY
+	CR_IMPL_END
+}
@@ -0,0 +1,215 @@
+/** @file RpcChannel.hpp
+	Contains the netlib::x::RpcChannel class used for multiplexing concurrent calls over a single connection. */
+#ifndef __netlib_x_rpcchannel_hpp_defined
+#define __netlib_x_rpcchannel_hpp_defined
+
+#include "BufferedConnection.hpp"
+
+#include <libcr/primitives.hpp>
+#include <libcr/mt/ConditionVariable.hpp>
+
+#include <unordered_map>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <string_view>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** The state of a single call made through an `RpcChannel`.
+		Must stay at the same address while the call is pending, and can be reused for further calls afterwards, which keeps the response buffer's memory. */
+	class RpcCall
+	{
+		friend class RpcChannel;
+	public:
+		/** The progress of a call. */
+		enum class State
+		{
+			/** The call was not started yet. */
+			kIdle,
+			/** The call waits for its response. */
+			kPending,
+			/** The response arrived. */
+			kSuccess,
+			/** The deadline passed before the response arrived. */
+			kTimeout,
+			/** The call was cancelled, or the connection failed. */
+			kError
+		};
+	private:
+		/** The call's request ID. */
+		std::uint32_t m_id;
+		/** The call's progress. */
+		State m_state;
+		/** When the call times out. */
+		std::chrono::steady_clock::time_point m_deadline;
+		/** The response payload. */
+		std::vector<std::uint8_t> m_response;
+		/** Notified when the call finished. */
+		cr::mt::ConditionVariable m_done;
+	public:
+		RpcCall();
+		RpcCall(RpcCall const&) = delete;
+		RpcCall &operator=(RpcCall const&) = delete;
+
+		/** The call's progress. */
+		inline State state() const;
+		/** The response payload, once the call succeeded. */
+		inline std::vector<std::uint8_t> const& response() const;
+	};
+
+	/** Multiplexes concurrent calls over a single `BufferedConnection`.
+		Every request frame carries a request ID, which the peer copies into its response frame, so that responses can arrive in any order and are dispatched to the waiting calls. Outgoing frames are only buffered when calls are started or answered, and sent by `update()`, so that all frames of a poll iteration share a single flush.
+
+		Frames consist of an 8-byte header followed by the payload: the payload size as a 32-bit big-endian integer, whose highest bit marks responses, followed by the 32-bit big-endian request ID. The same channel can also serve requests sent by its peer.
+
+		The channel does not own the connection, which has to be watched by a poller. Call `receive()` whenever the connection is readable, and `update()` after every `Poller::poll()`, with a poll timeout below the shortest call timeout. */
+	class RpcChannel
+	{
+	public:
+		/** The size of a frame header, in bytes. */
+		static constexpr std::size_t kHeaderSize = 8;
+	private:
+		/** The connection. */
+		BufferedConnection * m_connection;
+		/** The maximum payload size of received frames, in bytes. */
+		std::size_t m_max_message_size;
+		/** The next request ID. */
+		std::uint32_t m_next_id;
+		/** The pending calls, by request ID. */
+		std::unordered_map<std::uint32_t, RpcCall *> m_calls;
+		/** The pending calls' deadlines, the earliest first. Entries of calls that already finished are skipped. */
+		std::priority_queue<
+			std::pair<std::chrono::steady_clock::time_point, std::uint32_t>,
+			std::vector<std::pair<std::chrono::steady_clock::time_point, std::uint32_t>>,
+			std::greater<std::pair<std::chrono::steady_clock::time_point, std::uint32_t>>> m_deadlines;
+		/** Frames that did not fit into the output buffer, in order. */
+		std::vector<std::uint8_t> m_backlog;
+		/** How many bytes at the beginning of the backlog were already moved to the output buffer. */
+		std::size_t m_backlog_sent;
+		/** The payload size of the request at the beginning of the input buffer, if `m_request` is set. */
+		std::size_t m_request_size;
+		/** Whether a complete request is at the beginning of the input buffer. */
+		bool m_request;
+		/** Whether the connection failed. */
+		bool m_failed;
+
+		/** Buffers a frame.
+		@return
+			Whether the frame could be buffered. */
+		bool write_frame(
+			bool response,
+			std::uint32_t id,
+			void const * payload,
+			std::size_t size);
+		/** Finishes a call, and wakes its coroutine. */
+		static void finish(
+			RpcCall &call,
+			RpcCall::State state);
+		/** Dispatches all complete responses in the input buffer, up to the next request.
+		@return
+			Whether the received frames were valid. */
+		bool dispatch();
+	public:
+		/** Creates a channel.
+		@param[in] connection:
+			The connection, which must outlive the channel. Its input buffer must be able to hold a whole frame.
+		@param[in] max_message_size:
+			The maximum payload size of received frames, in bytes. Larger frames fail the connection. */
+		RpcChannel(
+			BufferedConnection &connection,
+			std::size_t max_message_size);
+
+		RpcChannel(RpcChannel const&) = delete;
+		RpcChannel &operator=(RpcChannel const&) = delete;
+
+		/** Fails all pending calls. */
+		~RpcChannel();
+
+		/** Starts a call without waiting for it.
+			The request is buffered, and sent by the next `update()`.
+		@param[in] call:
+			The call's state. Must not be pending.
+		@param[in] request:
+			The request payload.
+		@param[in] size:
+			The request payload's size, in bytes.
+		@param[in] timeout:
+			How long to wait for the response.
+		@return
+			Whether the call was started. Fails if the channel failed. */
+		bool start(
+			RpcCall &call,
+			void const * request,
+			std::size_t size,
+			std::chrono::steady_clock::duration timeout);
+
+		/** Cancels a pending call. Its response will be ignored. */
+		void cancel(
+			RpcCall &call);
+
+		/** Receives data, and dispatches all complete responses to their calls.
+			Must only be called when the connection is readable, as receiving nothing is taken as the peer closing the connection. Stops at the first incoming request, which has to be handled via `next_request()`.
+		@return
+			Whether the connection is still usable. Otherwise, all pending calls failed. */
+		bool receive();
+
+		/** Retrieves the incoming request at the beginning of the input buffer.
+		@param[out] id:
+			The request ID, to be passed to `reply()`.
+		@param[out] payload:
+			The request payload, a view into the input buffer that is valid until `finish_request()`.
+		@return
+			Whether a complete request was received. */
+		bool next_request(
+			std::uint32_t &id,
+			std::string_view &payload);
+		/** Removes the request returned by `next_request()` from the input buffer, and dispatches the responses following it.
+		@return
+			Whether the received frames were valid. */
+		bool finish_request();
+		/** Buffers the response to a request. It is sent by the next `update()`.
+		@return
+			Whether the response could be buffered. */
+		bool reply(
+			std::uint32_t id,
+			void const * payload,
+			std::size_t size);
+
+		/** Fails all calls whose deadline passed, and flushes the buffered frames.
+		@return
+			Whether the connection is still usable. Otherwise, all pending calls failed. */
+		bool update();
+
+		/** Fails all pending calls and further calls, for example, after the connection was lost. */
+		void fail();
+
+		/** The number of pending calls. */
+		inline std::size_t pending() const;
+		/** Whether the connection failed. */
+		inline bool failed() const;
+
+		/** Makes a call and waits for its response.
+		@param[in] call:
+			The call's state, which receives the response.
+		@param[in] request:
+			The request payload. Only needs to stay valid until the coroutine first suspends.
+		@param[in] size:
+			The request payload's size, in bytes.
+		@param[in] timeout:
+			How long to wait for the response. */
+		COROUTINE(Call, void)
+		CR_STATE(
+			(RpcChannel *) channel,
+			(RpcCall &) call,
+			(void const *) request,
+			(std::size_t) size,
+			(std::chrono::steady_clock::duration) timeout)
+		CR_EXTERNAL
+	};
+}
+
+#include "RpcChannel.inl"
+
+#endif
@@ -0,0 +1,22 @@
+namespace netlib::x
+{
+	RpcCall::State RpcCall::state() const
+	{
+		return m_state;
+	}
+
+	std::vector<std::uint8_t> const& RpcCall::response() const
+	{
+		return m_response;
+	}
+
+	std::size_t RpcChannel::pending() const
+	{
+		return m_calls.size();
+	}
+
+	bool RpcChannel::failed() const
+	{
+		return m_failed;
+	}
+}
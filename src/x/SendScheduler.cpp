@@ -0,0 +1,118 @@
+#include "SendScheduler.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	SendScheduler::Flow::Flow(
+		BufferedConnection &connection):
+		m_connection(&connection),
+		m_deficit(0),
+		m_index(0),
+		m_sent(0)
+	{
+	}
+
+	SendScheduler::SendScheduler(
+		double bytes_per_second,
+		std::size_t burst,
+		std::size_t quantum):
+		m_limiter(bytes_per_second > 0
+			? new util::ByteRateLimiter(bytes_per_second, burst)
+			: nullptr),
+		m_quantum(quantum),
+		m_flows(),
+		m_next(0),
+		m_turn_started(false)
+	{
+		assert(quantum);
+	}
+
+	SendScheduler::Flow * SendScheduler::add(
+		BufferedConnection &connection)
+	{
+		m_flows.emplace_back(new Flow(connection));
+		Flow * flow = m_flows.back().get();
+		flow->m_index = m_flows.size() - 1;
+		return flow;
+	}
+
+	void SendScheduler::remove(
+		Flow * flow)
+	{
+		std::size_t const index = flow->m_index;
+		if(index == m_next)
+			m_turn_started = false;
+
+		if(index != m_flows.size() - 1)
+		{
+			m_flows[index] = std::move(m_flows.back());
+			m_flows[index]->m_index = index;
+		}
+		m_flows.pop_back();
+
+		if(m_next >= m_flows.size())
+			m_next = 0;
+	}
+
+	SendScheduler::clock::duration SendScheduler::flush()
+	{
+		clock::time_point const now = clock::now();
+
+		// Stop after every flow had a turn without sending anything.
+		std::size_t idle = 0;
+		while(idle < m_flows.size())
+		{
+			Flow &flow = *m_flows[m_next];
+			BufferedConnection &connection = *flow.m_connection;
+			if(connection.output().empty())
+			{
+				flow.m_deficit = 0;
+				next_turn();
+				++idle;
+				continue;
+			}
+
+			if(!m_turn_started)
+			{
+				flow.m_deficit += m_quantum;
+				m_turn_started = true;
+			}
+
+			std::size_t limit = flow.m_deficit;
+			if(m_limiter)
+			{
+				std::size_t const available = m_limiter->available(now);
+				// The flow continues its turn once the bucket refilled.
+				if(!available)
+					return m_limiter->delay(now);
+				if(available < limit)
+					limit = available;
+			}
+
+			// Failures are not handled here, but by whoever polls the connection.
+			std::size_t sent;
+			connection.flush_some(limit, sent);
+			flow.m_sent += sent;
+			flow.m_deficit -= sent;
+			if(m_limiter && sent)
+				m_limiter->consume(sent, now);
+
+			if(connection.output().empty())
+				flow.m_deficit = 0;
+			else if(sent < limit)
+			{
+				// The socket is full: keep the unused credit, but not more than a turn's worth.
+				if(flow.m_deficit > m_quantum)
+					flow.m_deficit = m_quantum;
+			} else if(flow.m_deficit)
+				// Only the rate limit stopped the flow.
+				continue;
+
+			idle = sent ? 0 : idle + 1;
+			next_turn();
+		}
+
+		return clock::duration::max();
+	}
+}
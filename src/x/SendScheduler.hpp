@@ -0,0 +1,98 @@
+/** @file SendScheduler.hpp
+	Contains the netlib::x::SendScheduler class used for sharing bandwidth fairly between connections. */
+#ifndef __netlib_x_sendscheduler_hpp_defined
+#define __netlib_x_sendscheduler_hpp_defined
+
+#include "BufferedConnection.hpp"
+#include "../util/ByteRateLimiter.hpp"
+
+#include <memory>
+#include <vector>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Flushes the output of many connections, sharing a common bandwidth limit fairly between them.
+		Connections take turns in deficit round robin order: each turn, a connection may send up to a quantum of bytes plus whatever it could not use in its previous turn, so that connections get equal shares of the bandwidth regardless of how large their writes are. A connection whose socket is full loses its turn instead of blocking the others, and idle connections do not accumulate credit.
+
+		This is meant for bulk traffic, such as replication, that would otherwise take all of the link's bandwidth and starve latency sensitive connections on the same host: schedule only the bulk connections, and flush the others directly. The scheduler does not own the connections, and must only be used by one thread at a time. Call `flush()` after every `Poller::poll()`, and poll with a timeout of at most the returned delay. */
+	class SendScheduler
+	{
+	public:
+		typedef util::ByteRateLimiter::clock clock;
+
+		/** A scheduled connection. */
+		class Flow
+		{
+			friend class SendScheduler;
+			/** The connection. */
+			BufferedConnection * m_connection;
+			/** How many bytes the flow may still send in its current turn. */
+			std::size_t m_deficit;
+			/** The flow's index in the scheduler's flow list. */
+			std::size_t m_index;
+			/** How many bytes were sent in total. */
+			std::uint64_t m_sent;
+		public:
+			explicit Flow(
+				BufferedConnection &connection);
+
+			/** The connection. */
+			inline BufferedConnection &connection() const noexcept;
+			/** How many bytes the scheduler sent in total. */
+			inline std::uint64_t sent() const noexcept;
+		};
+	private:
+		/** Limits the total rate, or null. */
+		std::unique_ptr<util::ByteRateLimiter> m_limiter;
+		/** How many bytes a flow may send per turn. */
+		std::size_t m_quantum;
+		/** All flows. */
+		std::vector<std::unique_ptr<Flow>> m_flows;
+		/** The index of the flow whose turn it is. */
+		std::size_t m_next;
+		/** Whether the current flow already received its quantum for its turn. */
+		bool m_turn_started;
+
+		/** Ends the current flow's turn. */
+		inline void next_turn() noexcept;
+	public:
+		/** Creates a scheduler.
+		@param[in] bytes_per_second:
+			The total rate of all flows, or 0 to only share the sockets' capacity fairly.
+		@param[in] burst:
+			How many bytes may be sent at once after being idle.
+		@param[in] quantum:
+			How many bytes a flow may send per turn. Smaller quanta interleave flows more finely, at the cost of more system calls. */
+		SendScheduler(
+			double bytes_per_second,
+			std::size_t burst,
+			std::size_t quantum = 16384);
+
+		SendScheduler(SendScheduler const&) = delete;
+		SendScheduler &operator=(SendScheduler const&) = delete;
+
+		/** Adds a connection.
+		@param[in] connection:
+			The connection, which must stay valid until it is removed. It should not be flushed other than by the scheduler.
+		@return
+			The flow, which stays valid until it is removed. */
+		Flow * add(
+			BufferedConnection &connection);
+		/** Removes a connection. Its buffered output is kept. */
+		void remove(
+			Flow * flow);
+
+		/** Sends the buffered output of all flows, as far as the rate limit and the sockets allow.
+		@return
+			How long until more data can be sent, or `clock::duration::max()` if no flow is throttled by the rate limit, and the scheduler waits for output to be buffered or for sockets to become writable. */
+		clock::duration flush();
+
+		/** The number of flows. */
+		inline std::size_t flows() const noexcept;
+	};
+}
+
+#include "SendScheduler.inl"
+
+#endif
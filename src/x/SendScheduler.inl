@@ -0,0 +1,24 @@
+namespace netlib::x
+{
+	BufferedConnection &SendScheduler::Flow::connection() const noexcept
+	{
+		return *m_connection;
+	}
+
+	std::uint64_t SendScheduler::Flow::sent() const noexcept
+	{
+		return m_sent;
+	}
+
+	void SendScheduler::next_turn() noexcept
+	{
+		m_turn_started = false;
+		if(++m_next >= m_flows.size())
+			m_next = 0;
+	}
+
+	std::size_t SendScheduler::flows() const noexcept
+	{
+		return m_flows.size();
+	}
+}
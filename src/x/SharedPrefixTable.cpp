@@ -0,0 +1,137 @@
+#include "SharedPrefixTable.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace netlib::x
+{
+	constexpr std::size_t SharedPrefixTable::kMaxReaders;
+
+	SharedPrefixTable::Reader::Reader(
+		SharedPrefixTable &shared):
+		m_shared(&shared),
+		m_slot(kMaxReaders)
+	{
+		for(std::size_t i = 0; i < kMaxReaders; i++)
+		{
+			bool expected = false;
+			if(shared.m_hazards[i].used.compare_exchange_strong(
+				expected,
+				true,
+				std::memory_order_acquire))
+			{
+				m_slot = i;
+				break;
+			}
+		}
+	}
+
+	SharedPrefixTable::Reader::~Reader()
+	{
+		if(valid())
+		{
+			Hazard &hazard = m_shared->m_hazards[m_slot];
+			hazard.table.store(nullptr, std::memory_order_release);
+			hazard.used.store(false, std::memory_order_release);
+		}
+	}
+
+	std::uint32_t SharedPrefixTable::Reader::lookup(
+		SocketAddress const& address)
+	{
+		assert(valid());
+
+		std::atomic<PrefixTable const *> &announced = m_shared->m_hazards[m_slot].table;
+
+		// Announce the table, then make sure it was not replaced in the meantime.
+		PrefixTable const * table = m_shared->m_current.load(std::memory_order_acquire);
+		for(;;)
+		{
+			announced.store(table, std::memory_order_seq_cst);
+			PrefixTable const * current = m_shared->m_current.load(std::memory_order_seq_cst);
+			if(current == table)
+				break;
+			table = current;
+		}
+
+		std::uint32_t value = table->lookup(address);
+		announced.store(nullptr, std::memory_order_release);
+		return value;
+	}
+
+	ConnectionListener::Verdict SharedPrefixTable::Reader::allow_listed(
+		void * reader,
+		SocketAddress const& address)
+	{
+		return static_cast<Reader *>(reader)->lookup(address) != PrefixTable::kNone
+			? ConnectionListener::Verdict::kAccept
+			: ConnectionListener::Verdict::kReset;
+	}
+
+	ConnectionListener::Verdict SharedPrefixTable::Reader::deny_listed(
+		void * reader,
+		SocketAddress const& address)
+	{
+		return static_cast<Reader *>(reader)->lookup(address) == PrefixTable::kNone
+			? ConnectionListener::Verdict::kAccept
+			: ConnectionListener::Verdict::kReset;
+	}
+
+	SharedPrefixTable::SharedPrefixTable():
+		SharedPrefixTable(PrefixTable())
+	{
+	}
+
+	SharedPrefixTable::SharedPrefixTable(
+		PrefixTable table):
+		m_current(new PrefixTable(std::move(table))),
+		m_publish(),
+		m_retired()
+	{
+		for(Hazard &hazard : m_hazards)
+		{
+			hazard.table.store(nullptr, std::memory_order_relaxed);
+			hazard.used.store(false, std::memory_order_relaxed);
+		}
+	}
+
+	SharedPrefixTable::~SharedPrefixTable()
+	{
+#ifndef NDEBUG
+		for(Hazard const& hazard : m_hazards)
+			assert(!hazard.used.load() && "Readers still exist.");
+#endif
+		delete m_current.load();
+	}
+
+	void SharedPrefixTable::publish(
+		PrefixTable table)
+	{
+		std::unique_ptr<PrefixTable const> next(new PrefixTable(std::move(table)));
+
+		std::lock_guard<std::mutex> lock(m_publish);
+		m_retired.emplace_back(m_current.exchange(
+			next.release(),
+			std::memory_order_seq_cst));
+		reclaim();
+	}
+
+	void SharedPrefixTable::reclaim()
+	{
+		PrefixTable const * announced[kMaxReaders];
+		std::size_t count = 0;
+		for(Hazard const& hazard : m_hazards)
+			if(PrefixTable const * table = hazard.table.load(std::memory_order_seq_cst))
+				announced[count++] = table;
+
+		m_retired.erase(
+			std::remove_if(
+				m_retired.begin(),
+				m_retired.end(),
+				[&](std::unique_ptr<PrefixTable const> const& table) {
+					return std::find(announced, announced + count, table.get())
+						== announced + count;
+				}),
+			m_retired.end());
+	}
+}
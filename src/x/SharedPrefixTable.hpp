@@ -0,0 +1,113 @@
+/** @file SharedPrefixTable.hpp
+	Contains the netlib::x::SharedPrefixTable class used for sharing a replaceable prefix table between threads. */
+#ifndef __netlib_x_sharedprefixtable_hpp_defined
+#define __netlib_x_sharedprefixtable_hpp_defined
+
+#include "PrefixTable.hpp"
+#include "ConnectionListener.hpp"
+#include "../defines.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+namespace netlib::x
+{
+	/** A prefix table that can be replaced while other threads are looking up addresses.
+		Readers never lock or allocate: every reading thread owns a `Reader`, which announces the table it is currently using in a hazard slot. Publishing a new table swaps it in atomically, and replaced tables are deleted by a later `publish()` once no reader announces them anymore. This makes it possible to reload large allow/deny lists without pausing the threads that accept connections. */
+	class SharedPrefixTable
+	{
+	public:
+		/** The maximum number of readers. */
+		static constexpr std::size_t kMaxReaders = 64;
+
+		/** A thread's handle for looking up addresses.
+			A reader must only be used by one thread at a time. */
+		class Reader
+		{
+			/** The shared table. */
+			SharedPrefixTable * m_shared;
+			/** The reader's hazard slot. */
+			std::size_t m_slot;
+		public:
+			/** Registers a reader.
+				Check `valid()` to find out whether a hazard slot was available.
+			@param[in] shared:
+				The shared table to read. Must outlive the reader. */
+			explicit Reader(
+				SharedPrefixTable &shared);
+			Reader(Reader const&) = delete;
+			Reader &operator=(Reader const&) = delete;
+			/** Unregisters the reader. */
+			~Reader();
+
+			/** Whether the reader got a hazard slot. */
+			NETLIB_INL bool valid() const;
+
+			/** Looks up an address in the current table.
+			@return
+				The value of the longest matching prefix, or `PrefixTable::kNone`. */
+			std::uint32_t lookup(
+				SocketAddress const& address);
+
+			/** Connection filter that only accepts addresses matching a prefix, and resets all other connections.
+				For use with `ConnectionListener::filter()`.
+			@param[in] reader:
+				The reader to use. */
+			static ConnectionListener::Verdict allow_listed(
+				void * reader,
+				SocketAddress const& address);
+			/** Connection filter that only accepts addresses matching no prefix, and resets all other connections.
+				For use with `ConnectionListener::filter()`.
+			@param[in] reader:
+				The reader to use. */
+			static ConnectionListener::Verdict deny_listed(
+				void * reader,
+				SocketAddress const& address);
+		};
+
+	private:
+		/** A reader's announcement of the table it uses. */
+		struct alignas(64) Hazard
+		{
+			/** The announced table. */
+			std::atomic<PrefixTable const *> table;
+			/** Whether the slot is owned by a reader. */
+			std::atomic<bool> used;
+		};
+
+		/** The current table. */
+		std::atomic<PrefixTable const *> m_current;
+		/** The hazard slots. */
+		Hazard m_hazards[kMaxReaders];
+		/** Serialises publishing. */
+		std::mutex m_publish;
+		/** Replaced tables that may still be in use. */
+		std::vector<std::unique_ptr<PrefixTable const>> m_retired;
+
+		/** Deletes retired tables that are not announced by any reader. */
+		void reclaim();
+	public:
+		/** Creates a shared table holding an empty table. */
+		SharedPrefixTable();
+		/** Creates a shared table holding the given table. */
+		explicit SharedPrefixTable(
+			PrefixTable table);
+		SharedPrefixTable(SharedPrefixTable const&) = delete;
+		SharedPrefixTable &operator=(SharedPrefixTable const&) = delete;
+		/** Deletes all tables. All readers must have been destroyed. */
+		~SharedPrefixTable();
+
+		/** Replaces the current table.
+			Readers see the new table from their next lookup on. Replaced tables that are no longer used by any reader are deleted.
+		@param[in] table:
+			The new table. */
+		void publish(
+			PrefixTable table);
+	};
+}
+
+#include "SharedPrefixTable.inl"
+
+#endif
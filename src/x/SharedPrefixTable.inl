@@ -0,0 +1,7 @@
+namespace netlib::x
+{
+	bool SharedPrefixTable::Reader::valid() const
+	{
+		return m_slot != kMaxReaders;
+	}
+}
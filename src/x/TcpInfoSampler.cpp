@@ -0,0 +1,79 @@
+#include "TcpInfoSampler.hpp"
+
+#include <cassert>
+
+namespace netlib::x
+{
+	TcpInfoSampler::TcpInfoSampler(
+		std::size_t capacity,
+		std::chrono::steady_clock::duration interval):
+		m_ring(capacity),
+		m_first(0),
+		m_size(0),
+		m_overwritten(0),
+		m_interval(interval),
+		m_last_update(std::chrono::steady_clock::now()),
+		m_due(0)
+	{
+		assert(capacity != 0);
+		assert(interval.count() > 0);
+	}
+
+	void TcpInfoSampler::sample(
+		Socket const& socket,
+		std::chrono::steady_clock::time_point now)
+	{
+		if(socket.type() != SocketType::kStream)
+			return;
+
+		// Overwrite the oldest sample if the ring is full.
+		std::size_t index = (m_first + m_size) % m_ring.size();
+		Sample &sample = m_ring[index];
+		if(!socket.tcp_info(sample.info))
+			return;
+		sample.time = now;
+		sample.socket = &socket;
+
+		if(m_size == m_ring.size())
+		{
+			m_first = (m_first + 1) % m_ring.size();
+			++m_overwritten;
+		} else
+			++m_size;
+	}
+
+	std::size_t TcpInfoSampler::update(
+		Poller &poller)
+	{
+		auto const now = std::chrono::steady_clock::now();
+		double const elapsed = double((now - m_last_update).count()) / double(m_interval.count());
+		m_last_update = now;
+
+		// Every interval, each socket is due once. Never sample a socket twice per call.
+		m_due += elapsed * double(poller.size());
+		if(m_due > double(poller.size()))
+			m_due = double(poller.size());
+
+		std::size_t const due = std::size_t(m_due);
+		m_due -= double(due);
+
+		return poller.sweep(due, [this, now](Socket const& socket) {
+			sample(socket, now);
+		});
+	}
+
+	std::size_t TcpInfoSampler::take(
+		Sample * out,
+		std::size_t count)
+	{
+		if(count > m_size)
+			count = m_size;
+
+		for(std::size_t i = 0; i < count; i++)
+			out[i] = m_ring[(m_first + i) % m_ring.size()];
+
+		m_first = (m_first + count) % m_ring.size();
+		m_size -= count;
+		return count;
+	}
+}
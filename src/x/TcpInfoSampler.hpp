@@ -0,0 +1,102 @@
+/** @file TcpInfoSampler.hpp
+	Contains the netlib::x::TcpInfoSampler class used for periodically recording TCP connection statistics. */
+#ifndef __netlib_x_tcpinfosampler_hpp_defined
+#define __netlib_x_tcpinfosampler_hpp_defined
+
+#include "../Socket.hpp"
+#include "../Poller.hpp"
+#include "../defines.hpp"
+
+#include <vector>
+#include <chrono>
+#include <cinttypes>
+
+namespace netlib::x
+{
+	/** Periodically samples the kernel statistics (`Socket::tcp_info()`) of all TCP sockets watched by a poller into a fixed-size ring.
+		Instead of sampling all sockets at once, every `update()` samples only the share of sockets that became due since the previous call, continuing where it stopped. This spreads the cost evenly, so that even with many sockets, each call only costs a few system calls. Once the ring is full, the oldest samples are overwritten.
+
+		`update()` has to be called regularly (for example, after every `Poller::poll()`). */
+	class TcpInfoSampler
+	{
+	public:
+		/** A recorded sample. */
+		struct Sample
+		{
+			/** When the sample was taken. */
+			std::chrono::steady_clock::time_point time;
+			/** The sampled socket. Only identifies the socket, which might not exist anymore. */
+			Socket const * socket;
+			/** The socket's statistics. */
+			TcpInfo info;
+		};
+	private:
+		/** The samples. */
+		std::vector<Sample> m_ring;
+		/** The index of the oldest sample. */
+		std::size_t m_first;
+		/** The number of samples. */
+		std::size_t m_size;
+		/** How many samples were overwritten before being taken. */
+		std::uint64_t m_overwritten;
+		/** How long a pass over all sockets takes. */
+		std::chrono::steady_clock::duration m_interval;
+		/** When `update()` was last called. */
+		std::chrono::steady_clock::time_point m_last_update;
+		/** The fraction of a socket that is due but was not sampled yet. */
+		double m_due;
+
+		/** Samples a socket, if it is a TCP socket. */
+		void sample(
+			Socket const& socket,
+			std::chrono::steady_clock::time_point now);
+	public:
+		/** Creates a sampler.
+		@param[in] capacity:
+			The number of samples to keep.
+		@param[in] interval:
+			How often to sample each socket. */
+		explicit TcpInfoSampler(
+			std::size_t capacity,
+			std::chrono::steady_clock::duration interval = std::chrono::seconds(1));
+
+		/** Samples the sockets that are due.
+		@param[in,out] poller:
+			The poller whose sockets to sample.
+		@return
+			The number of visited sockets. */
+		std::size_t update(
+			Poller &poller);
+
+		/** The number of samples. */
+		NETLIB_INL std::size_t size() const;
+		/** Whether there are no samples. */
+		NETLIB_INL bool empty() const;
+		/** The maximum number of samples. */
+		NETLIB_INL std::size_t capacity() const;
+		/** How many samples were overwritten before being taken. */
+		NETLIB_INL std::uint64_t overwritten() const;
+
+		/** Retrieves a sample, counting from the oldest. */
+		NETLIB_INL Sample const& operator[](
+			std::size_t index) const;
+
+		/** Removes the oldest samples.
+		@param[out] out:
+			Where to copy the samples to.
+		@param[in] count:
+			How many samples to take at most.
+		@return
+			The number of samples taken. */
+		std::size_t take(
+			Sample * out,
+			std::size_t count);
+
+		/** Removes all samples. */
+		NETLIB_INL void clear();
+	};
+}
+
+#include "TcpInfoSampler.inl"
+
+#endif
@@ -0,0 +1,37 @@
+#include <cassert>
+
+namespace netlib::x
+{
+	std::size_t TcpInfoSampler::size() const
+	{
+		return m_size;
+	}
+
+	bool TcpInfoSampler::empty() const
+	{
+		return !m_size;
+	}
+
+	std::size_t TcpInfoSampler::capacity() const
+	{
+		return m_ring.size();
+	}
+
+	std::uint64_t TcpInfoSampler::overwritten() const
+	{
+		return m_overwritten;
+	}
+
+	TcpInfoSampler::Sample const& TcpInfoSampler::operator[](
+		std::size_t index) const
+	{
+		assert(index < m_size);
+		return m_ring[(m_first + index) % m_ring.size()];
+	}
+
+	void TcpInfoSampler::clear()
+	{
+		m_first = 0;
+		m_size = 0;
+	}
+}
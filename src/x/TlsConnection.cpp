@@ -0,0 +1,314 @@
+#include "TlsConnection.hpp"
+
+#ifdef NETLIB_TLS
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <cassert>
+#include <stdexcept>
+
+namespace netlib::x
+{
+	TlsContext::TlsContext(
+		bool server,
+		bool kernel_offload):
+		m_context(::SSL_CTX_new(server ? ::TLS_server_method() : ::TLS_client_method())),
+		m_server(server)
+	{
+		if(!m_context)
+			throw std::runtime_error("Failed to create TLS context.");
+
+		::SSL_CTX_set_min_proto_version(m_context, TLS1_2_VERSION);
+		// Behave like nonblocking sockets, which may send only part of the data.
+		::SSL_CTX_set_mode(m_context, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+#ifdef SSL_OP_ENABLE_KTLS
+		if(kernel_offload)
+			::SSL_CTX_set_options(m_context, SSL_OP_ENABLE_KTLS);
+#else
+		(void) kernel_offload;
+#endif
+
+		if(server)
+			::SSL_CTX_set_num_tickets(m_context, 0);
+		else
+		{
+			::SSL_CTX_set_verify(m_context, SSL_VERIFY_PEER, nullptr);
+			::SSL_CTX_set_default_verify_paths(m_context);
+		}
+	}
+
+	TlsContext::~TlsContext()
+	{
+		::SSL_CTX_free(m_context);
+	}
+
+	bool TlsContext::load_certificate(
+		char const * certificate_file,
+		char const * key_file)
+	{
+		::ERR_clear_error();
+		return 1 == ::SSL_CTX_use_certificate_chain_file(m_context, certificate_file)
+			&& 1 == ::SSL_CTX_use_PrivateKey_file(m_context, key_file, SSL_FILETYPE_PEM)
+			&& 1 == ::SSL_CTX_check_private_key(m_context);
+	}
+
+	bool TlsContext::use_certificate(
+		char const * certificate_pem,
+		char const * key_pem)
+	{
+		::ERR_clear_error();
+		::BIO * bio = ::BIO_new_mem_buf(certificate_pem, -1);
+		if(!bio)
+			return false;
+
+		// The first certificate is the own one, the rest form the chain.
+		bool success = false;
+		if(::X509 * certificate = ::PEM_read_bio_X509(bio, nullptr, nullptr, nullptr))
+		{
+			success = 1 == ::SSL_CTX_use_certificate(m_context, certificate);
+			::X509_free(certificate);
+
+			::SSL_CTX_clear_chain_certs(m_context);
+			while(success)
+			{
+				::X509 * intermediate = ::PEM_read_bio_X509(bio, nullptr, nullptr, nullptr);
+				if(!intermediate)
+					break;
+				// Takes ownership on success.
+				if(1 != ::SSL_CTX_add0_chain_cert(m_context, intermediate))
+				{
+					::X509_free(intermediate);
+					success = false;
+				}
+			}
+		}
+		::BIO_free(bio);
+		if(!success)
+			return false;
+
+		if(!(bio = ::BIO_new_mem_buf(key_pem, -1)))
+			return false;
+		::EVP_PKEY * key = ::PEM_read_bio_PrivateKey(bio, nullptr, nullptr, nullptr);
+		::BIO_free(bio);
+		if(!key)
+			return false;
+
+		success = 1 == ::SSL_CTX_use_PrivateKey(m_context, key)
+			&& 1 == ::SSL_CTX_check_private_key(m_context);
+		::EVP_PKEY_free(key);
+		// The end of the chain is not an error.
+		::ERR_clear_error();
+		return success;
+	}
+
+	void TlsContext::disable_tls13()
+	{
+		::SSL_CTX_set_max_proto_version(m_context, TLS1_2_VERSION);
+	}
+
+	/** Makes a context verify its peers. */
+	static void require_verification(
+		::SSL_CTX * context,
+		bool server)
+	{
+		::SSL_CTX_set_verify(
+			context,
+			server ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_PEER,
+			nullptr);
+	}
+
+	bool TlsContext::load_trusted(
+		char const * file)
+	{
+		::ERR_clear_error();
+		if(1 != ::SSL_CTX_load_verify_locations(m_context, file, nullptr))
+			return false;
+		require_verification(m_context, m_server);
+		return true;
+	}
+
+	bool TlsContext::use_trusted(
+		char const * pem)
+	{
+		::ERR_clear_error();
+		::BIO * bio = ::BIO_new_mem_buf(pem, -1);
+		if(!bio)
+			return false;
+
+		::X509_STORE * store = ::SSL_CTX_get_cert_store(m_context);
+		std::size_t added = 0;
+		while(::X509 * certificate = ::PEM_read_bio_X509(bio, nullptr, nullptr, nullptr))
+		{
+			if(1 == ::X509_STORE_add_cert(store, certificate))
+				++added;
+			::X509_free(certificate);
+		}
+		::BIO_free(bio);
+		// The end of the data is not an error.
+		::ERR_clear_error();
+
+		if(!added)
+			return false;
+		require_verification(m_context, m_server);
+		return true;
+	}
+
+	TlsConnection::TlsConnection(
+		TlsContext &context,
+		StreamSocket && socket,
+		char const * host_name):
+		StreamSocket(std::move(socket)),
+		m_ssl(::SSL_new(context.m_context)),
+		m_wants_write(false),
+		m_established(false)
+	{
+		if(!m_ssl)
+			throw std::runtime_error("Failed to create TLS connection.");
+
+		// The socket stays open when the OpenSSL connection is freed.
+		if(1 != ::SSL_set_fd(m_ssl, m_socket))
+		{
+			::SSL_free(m_ssl);
+			throw std::runtime_error("Failed to create TLS connection.");
+		}
+
+		if(context.server())
+			::SSL_set_accept_state(m_ssl);
+		else
+		{
+			::SSL_set_connect_state(m_ssl);
+			if(host_name
+			&& (1 != ::SSL_set_tlsext_host_name(m_ssl, host_name)
+				|| 1 != ::SSL_set1_host(m_ssl, host_name)))
+			{
+				::SSL_free(m_ssl);
+				throw std::runtime_error("Failed to set TLS host name.");
+			}
+		}
+	}
+
+	TlsConnection::~TlsConnection()
+	{
+		if(m_ssl)
+			::SSL_free(m_ssl);
+	}
+
+	Status TlsConnection::status(
+		int result)
+	{
+		switch(::SSL_get_error(m_ssl, result))
+		{
+		case SSL_ERROR_WANT_READ:
+			m_wants_write = false;
+			return Status::kNotReady;
+		case SSL_ERROR_WANT_WRITE:
+			m_wants_write = true;
+			return Status::kNotReady;
+		default:
+			return Status::kError;
+		}
+	}
+
+	Status TlsConnection::handshake()
+	{
+		assert(m_ssl);
+
+		if(m_established)
+			return Status::kSuccess;
+
+		::ERR_clear_error();
+		int const result = ::SSL_do_handshake(m_ssl);
+		if(result != 1)
+			return status(result);
+
+		m_established = true;
+		return Status::kSuccess;
+	}
+
+	bool TlsConnection::kernel_send() const
+	{
+		return m_ssl && BIO_get_ktls_send(::SSL_get_wbio(m_ssl));
+	}
+
+	bool TlsConnection::kernel_receive() const
+	{
+		return m_ssl && BIO_get_ktls_recv(::SSL_get_rbio(m_ssl));
+	}
+
+	Status TlsConnection::send(
+		void const * data,
+		std::size_t size,
+		std::size_t &sent)
+	{
+		assert(m_ssl);
+
+		::ERR_clear_error();
+		int const result = ::SSL_write_ex(m_ssl, data, size, &sent);
+		if(result != 1)
+		{
+			Status const failure = status(result);
+			NETLIB_STAT(detail::count_send(m_counters, failure == Status::kNotReady, true, size, 0));
+			return failure;
+		}
+
+		NETLIB_STAT(detail::count_send(m_counters, false, false, size, sent));
+		return Status::kSuccess;
+	}
+
+	Status TlsConnection::recv(
+		void * data,
+		std::size_t size,
+		std::size_t &received)
+	{
+		assert(m_ssl);
+
+		::ERR_clear_error();
+		int const result = ::SSL_read_ex(m_ssl, data, size, &received);
+		if(result != 1)
+		{
+			// A closure alert ends the stream like a shutdown of a plain socket.
+			if(::SSL_get_error(m_ssl, result) == SSL_ERROR_ZERO_RETURN)
+			{
+				received = 0;
+				return Status::kSuccess;
+			}
+			Status const failure = status(result);
+			NETLIB_STAT(detail::count_receive(m_counters, failure == Status::kNotReady, true, 0));
+			return failure;
+		}
+
+		NETLIB_STAT(detail::count_receive(m_counters, false, false, received));
+		return Status::kSuccess;
+	}
+
+	Status TlsConnection::shutdown()
+	{
+		assert(m_ssl);
+
+		::ERR_clear_error();
+		// 0 means that the alert was sent, but the peer's was not received yet.
+		int const result = ::SSL_shutdown(m_ssl);
+		return result >= 0 ? Status::kSuccess : status(result);
+	}
+
+	bool TlsConnection::detach(
+		StreamSocket &out)
+	{
+		if(!m_ssl
+		|| !m_established
+		|| !kernel_send()
+		|| !kernel_receive()
+		|| ::SSL_has_pending(m_ssl))
+			return false;
+
+		::SSL_free(m_ssl);
+		m_ssl = nullptr;
+		out = std::move(static_cast<StreamSocket &>(*this));
+		return true;
+	}
+}
+
+#endif
@@ -0,0 +1,181 @@
+/** @file TlsConnection.hpp
+	Contains the netlib::x::TlsConnection class used for encrypted connections, with encryption offloaded to the kernel where possible.
+	TLS only exists if netlib was built with `NETLIB_TLS` defined (CMake option `NETLIB_TLS`), which requires OpenSSL. Applications must then also define `NETLIB_TLS` to use it. */
+#ifndef __netlib_x_tlsconnection_hpp_defined
+#define __netlib_x_tlsconnection_hpp_defined
+
+#include "../defines.hpp"
+
+#ifdef NETLIB_TLS
+
+#include "../Socket.hpp"
+
+// OpenSSL's types, so that its headers are not needed here.
+struct ssl_st;
+struct ssl_ctx_st;
+
+namespace netlib::x
+{
+	/** The TLS configuration shared by many connections: their role, certificate, and which peers are trusted.
+		Wraps an OpenSSL `SSL_CTX`, and must outlive all connections created with it. */
+	class TlsContext
+	{
+		friend class TlsConnection;
+		/** The OpenSSL context. */
+		::ssl_ctx_st * m_context;
+		/** Whether connections accept handshakes. */
+		bool m_server;
+	public:
+		/** Creates a context that only allows TLS 1.2 and newer.
+			Servers send no session tickets, so that after the handshake, no TLS messages other than application data reach clients whose connections were detached (see `TlsConnection::detach()`).
+		@param[in] server:
+			Whether connections accept handshakes, or initiate them.
+		@param[in] kernel_offload:
+			Whether to hand record encryption to the kernel after handshakes, where supported (`TCP_ULP` "tls" on GNU/Linux, and an OpenSSL built with kTLS support). */
+		TlsContext(
+			bool server,
+			bool kernel_offload = true);
+
+		TlsContext(TlsContext const&) = delete;
+		TlsContext &operator=(TlsContext const&) = delete;
+
+		~TlsContext();
+
+		/** Loads the certificate chain and private key presented to peers.
+		@param[in] certificate_file:
+			The PEM file containing the certificate, followed by any intermediate certificates.
+		@param[in] key_file:
+			The PEM file containing the private key.
+		@return
+			Whether both were loaded and match. */
+		bool load_certificate(
+			char const * certificate_file,
+			char const * key_file);
+		/** Like `load_certificate()`, but with the PEM data in memory. */
+		bool use_certificate(
+			char const * certificate_pem,
+			char const * key_pem);
+
+		/** Makes connections verify their peers' certificates against the certificates in a PEM file. Clients always verify servers, servers require client certificates once trusted certificates were configured.
+		@return
+			Whether the file could be loaded. */
+		bool load_trusted(
+			char const * file);
+		/** Like `load_trusted()`, but with the PEM data in memory. */
+		bool use_trusted(
+			char const * pem);
+
+		/** Restricts connections to TLS 1.2.
+			Some OpenSSL versions can only offload receiving to the kernel for TLS 1.2, which is needed to detach connections. */
+		void disable_tls13();
+
+		/** Whether connections accept handshakes. */
+		inline bool server() const noexcept;
+	};
+
+	/** A TLS connection whose handshake runs in user space, and whose records are then encrypted by the kernel, where possible.
+		Once kernel TLS is active in a direction, the socket itself sends or receives plaintext, so everything that works on plain sockets, such as `x::BufferedConnection`, `x::Proxy`'s `splice()`, or `sendfile()`, works on the encrypted connection without passing the data through user space. Without kernel support, `send()` and `recv()` encrypt and decrypt in user space, and the connection cannot be detached.
+
+		Watch the connection with a poller, and call `handshake()` whenever the socket polled as ready until it succeeds, polling for output while `wants_write()`. */
+	class TlsConnection : protected StreamSocket
+	{
+		friend class ::netlib::Poller;
+		/** The OpenSSL connection, or null once detached. */
+		::ssl_st * m_ssl;
+		/** Whether the last operation waits for the socket to become writable. */
+		bool m_wants_write;
+		/** Whether the handshake completed. */
+		bool m_established;
+
+		/** Translates the result of an OpenSSL operation. */
+		Status status(
+			int result);
+	public:
+		using StreamSocket::operator bool;
+		using StreamSocket::exists;
+		using StreamSocket::address;
+
+		static constexpr TlsConnection * cast_from_base(
+			Socket * socket);
+
+		/** Prepares a TLS connection on a connected socket, without starting the handshake.
+			Throws `std::runtime_error` if OpenSSL fails.
+		@param[in] context:
+			The shared configuration, which must outlive the connection.
+		@param[in] socket:
+			The connected socket.
+		@param[in] host_name:
+			For clients, the server's name, which is sent to the server (SNI) and checked against its certificate, or null. */
+		TlsConnection(
+			TlsContext &context,
+			StreamSocket && socket,
+			char const * host_name = nullptr);
+
+		TlsConnection(TlsConnection const&) = delete;
+		TlsConnection &operator=(TlsConnection const&) = delete;
+
+		/** Closes the connection without sending a closure alert. */
+		~TlsConnection();
+
+		/** Continues the handshake.
+		@return
+			`Status::kSuccess` once the handshake completed, `Status::kNotReady` while it waits for the socket, and `Status::kError` if it failed, for example, because the peer's certificate was rejected. */
+		Status handshake();
+		/** Whether the last operation that was not ready waits for output, rather than input. */
+		inline bool wants_write() const noexcept;
+		/** Whether the handshake completed. */
+		inline bool established() const noexcept;
+
+		/** Whether the kernel encrypts sent data. */
+		bool kernel_send() const;
+		/** Whether the kernel decrypts received data. */
+		bool kernel_receive() const;
+
+		/** Encrypts and sends at most `size` bytes of `data`.
+		@param[in] data:
+			The data to send.
+		@param[in] size:
+			How many bytes to send at most.
+		@param[out] sent:
+			On success, the number of bytes sent.
+		@return
+			Whether the operation succeeded. After `Status::kNotReady`, the next call has to pass at least the same data again, as part of it may already be encrypted. */
+		Status send(
+			void const * data,
+			std::size_t size,
+			std::size_t &sent);
+		/** Receives and decrypts at most `size` bytes into `data`.
+		@param[out] data:
+			Where to receive the incoming data into.
+		@param[in] size:
+			How many bytes to receive at most.
+		@param[out] received:
+			On success, the number of bytes received. 0 means that the peer closed the connection.
+		@return
+			Whether the operation succeeded. */
+		Status recv(
+			void * data,
+			std::size_t size,
+			std::size_t &received);
+
+		/** Sends a closure alert, after which no more data can be sent.
+		@return
+			Whether the operation succeeded. */
+		Status shutdown();
+
+		/** Hands the established connection over as a plain socket that sends and receives plaintext, for example to wrap it in an `x::BufferedConnection`.
+			Only possible if the kernel handles both directions, and no decrypted data is pending in user space. Afterwards, receiving fails on TLS messages other than application data, such as key updates, and closure alerts are not sent.
+		@param[out] out:
+			Receives the socket.
+		@return
+			Whether the connection was detached. */
+		bool detach(
+			StreamSocket &out);
+	};
+}
+
+#include "TlsConnection.inl"
+
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+namespace netlib::x
+{
+	bool TlsContext::server() const noexcept
+	{
+		return m_server;
+	}
+
+	constexpr TlsConnection * TlsConnection::cast_from_base(
+		Socket * base)
+	{
+		return static_cast<TlsConnection *>(base);
+	}
+
+	bool TlsConnection::wants_write() const noexcept
+	{
+		return m_wants_write;
+	}
+
+	bool TlsConnection::established() const noexcept
+	{
+		return m_established;
+	}
+}
@@ -0,0 +1,700 @@
+#include "WebSocket.hpp"
+
+#include <cstring>
+#include <cassert>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define NETLIB_WEBSOCKET_X86
+#include <immintrin.h>
+#endif
+
+namespace netlib::x::websocket
+{
+	namespace
+	{
+		/** Appended to a client's key to compute the server's answer (RFC 6455, section 1.3). */
+		constexpr std::string_view kGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+		/** The size of a `Sec-WebSocket-Accept` value, in characters. */
+		constexpr std::size_t kAcceptSize = 28;
+
+		inline std::uint32_t rotate_left(
+			std::uint32_t value,
+			unsigned bits)
+		{
+			return (value << bits) | (value >> (32 - bits));
+		}
+
+		/** Processes a 64-byte SHA-1 block. */
+		void sha1_block(
+			std::uint32_t (&state)[5],
+			std::uint8_t const * block)
+		{
+			std::uint32_t w[80];
+			for(int i = 0; i < 16; i++)
+				w[i] = std::uint32_t(block[4*i]) << 24
+					| std::uint32_t(block[4*i+1]) << 16
+					| std::uint32_t(block[4*i+2]) << 8
+					| std::uint32_t(block[4*i+3]);
+			for(int i = 16; i < 80; i++)
+				w[i] = rotate_left(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+			std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+			for(int i = 0; i < 80; i++)
+			{
+				std::uint32_t f, k;
+				if(i < 20)
+				{
+					f = (b & c) | (~b & d);
+					k = 0x5a827999;
+				} else if(i < 40)
+				{
+					f = b ^ c ^ d;
+					k = 0x6ed9eba1;
+				} else if(i < 60)
+				{
+					f = (b & c) | (b & d) | (c & d);
+					k = 0x8f1bbcdc;
+				} else
+				{
+					f = b ^ c ^ d;
+					k = 0xca62c1d6;
+				}
+
+				std::uint32_t const temp = rotate_left(a, 5) + f + e + k + w[i];
+				e = d;
+				d = c;
+				c = rotate_left(b, 30);
+				b = a;
+				a = temp;
+			}
+
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+			state[4] += e;
+		}
+
+		/** Computes the SHA-1 hash of a client key followed by `kGuid`. SHA-1 is only used for the handshake, where it is not security relevant. */
+		void sha1_key(
+			std::string_view key,
+			std::uint8_t (&out)[20])
+		{
+			std::uint32_t state[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+			// The key and GUID always fit into two blocks, including the padding.
+			std::uint8_t message[128] = {};
+			std::uint64_t const size = key.size() + kGuid.size();
+			assert(size <= sizeof(message) - 9);
+			std::memcpy(message, key.data(), key.size());
+			std::memcpy(message + key.size(), kGuid.data(), kGuid.size());
+			message[size] = 0x80;
+			std::size_t const blocks = size + 9 <= 64 ? 1 : 2;
+			for(int i = 0; i < 8; i++)
+				message[64 * blocks - 1 - i] = std::uint8_t((size * 8) >> (8 * i));
+
+			for(std::size_t i = 0; i < blocks; i++)
+				sha1_block(state, message + 64 * i);
+
+			for(int i = 0; i < 5; i++)
+				for(int j = 0; j < 4; j++)
+					out[4*i+j] = std::uint8_t(state[i] >> (24 - 8 * j));
+		}
+
+		/** Encodes data in base64, with padding. `out` must hold `(size + 2) / 3 * 4` characters. */
+		void base64(
+			std::uint8_t const * data,
+			std::size_t size,
+			char * out)
+		{
+			static char const kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+			for(; size >= 3; size -= 3, data += 3)
+			{
+				std::uint32_t const bits = std::uint32_t(data[0]) << 16 | std::uint32_t(data[1]) << 8 | data[2];
+				*out++ = kAlphabet[bits >> 18];
+				*out++ = kAlphabet[(bits >> 12) & 63];
+				*out++ = kAlphabet[(bits >> 6) & 63];
+				*out++ = kAlphabet[bits & 63];
+			}
+			if(size)
+			{
+				std::uint32_t const bits = std::uint32_t(data[0]) << 16 | (size > 1 ? std::uint32_t(data[1]) << 8 : 0);
+				*out++ = kAlphabet[bits >> 18];
+				*out++ = kAlphabet[(bits >> 12) & 63];
+				*out++ = size > 1 ? kAlphabet[(bits >> 6) & 63] : '=';
+				*out++ = '=';
+			}
+		}
+
+		/** Computes the `Sec-WebSocket-Accept` value for a client's key. */
+		void accept_value(
+			std::string_view key,
+			char (&out)[kAcceptSize])
+		{
+			std::uint8_t hash[20];
+			sha1_key(key, hash);
+			base64(hash, sizeof(hash), out);
+		}
+
+		/** Whether an opcode is defined by RFC 6455. */
+		inline bool valid(
+			std::uint8_t opcode)
+		{
+			return opcode <= 0x2 || (opcode >= 0x8 && opcode <= 0xA);
+		}
+
+		/** Whether a peer may send a close frame's status code (RFC 6455, section 7.4). Codes that are reserved, only reported locally, or not registered are invalid, while 3000 to 4999 are left to libraries and applications. */
+		inline bool valid_close_code(
+			std::uint16_t code)
+		{
+			return (code >= 1000 && code <= 1003)
+				|| (code >= 1007 && code <= 1014)
+				|| (code >= 3000 && code <= 4999);
+		}
+
+		/** Whether an opcode belongs to a control frame. */
+		inline bool control(
+			Opcode opcode)
+		{
+			return static_cast<std::uint8_t>(opcode) & 0x8;
+		}
+
+		/** Rotates a masking key so that it starts at the given payload offset. */
+		inline void rotate_key(
+			std::uint8_t const (&key)[4],
+			std::uint64_t offset,
+			std::uint8_t (&out)[4])
+		{
+			for(unsigned i = 0; i < 4; i++)
+				out[i] = key[(offset + i) & 3];
+		}
+
+#ifdef NETLIB_WEBSOCKET_X86
+		__attribute__((target("avx2")))
+		void mask_avx2(
+			void * data,
+			std::size_t size,
+			std::uint8_t const (&key)[4],
+			std::uint64_t offset)
+		{
+			std::uint8_t rotated[4];
+			rotate_key(key, offset, rotated);
+			std::int32_t pattern;
+			std::memcpy(&pattern, rotated, 4);
+			__m256i const mask = _mm256_set1_epi32(pattern);
+
+			std::uint8_t * bytes = static_cast<std::uint8_t *>(data);
+			std::size_t const vectors = size / 32;
+			for(std::size_t i = 0; i < vectors; i++, bytes += 32)
+			{
+				__m256i * const p = reinterpret_cast<__m256i *>(bytes);
+				_mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), mask));
+			}
+
+			// Whole vectors keep the key's alignment.
+			detail::mask_portable(bytes, size - 32 * vectors, key, offset);
+		}
+#endif
+
+		typedef void (*MaskFunction)(void *, std::size_t, std::uint8_t const (&)[4], std::uint64_t);
+
+		/** Selects the fastest masking implementation the processor supports. */
+		MaskFunction select_mask()
+		{
+#ifdef NETLIB_WEBSOCKET_X86
+			__builtin_cpu_init();
+			if(__builtin_cpu_supports("avx2"))
+				return &mask_avx2;
+#endif
+			return &detail::mask_portable;
+		}
+
+		/** Checks a piece of UTF-8 text, which may begin or end within a code point (RFC 3629, section 4).
+		@param[in,out] state:
+			The number of continuation bytes still expected, and the allowed range of the next one. 0 between code points.
+		@return
+			Whether the piece is valid so far. */
+		bool valid_utf8(
+			std::uint8_t const * data,
+			std::size_t size,
+			std::uint32_t &state)
+		{
+			unsigned needed = state & 0xff;
+			unsigned lower = (state >> 8) & 0xff;
+			unsigned upper = state >> 16;
+
+			for(std::size_t i = 0; i < size;)
+			{
+				if(!needed)
+				{
+					// Skip ASCII quickly, as text is mostly ASCII.
+					for(std::uint64_t word; size - i >= 8; i += 8)
+					{
+						std::memcpy(&word, data + i, 8);
+						if(word & 0x8080808080808080)
+							break;
+					}
+					if(i == size)
+						break;
+
+					std::uint8_t const lead = data[i++];
+					if(lead < 0x80)
+						continue;
+
+					// Overlong forms, surrogates, and code points above U+10FFFF are invalid.
+					lower = 0x80;
+					upper = 0xbf;
+					if(lead < 0xc2)
+						return false;
+					else if(lead < 0xe0)
+						needed = 1;
+					else if(lead < 0xf0)
+					{
+						needed = 2;
+						if(lead == 0xe0)
+							lower = 0xa0;
+						else if(lead == 0xed)
+							upper = 0x9f;
+					} else if(lead < 0xf5)
+					{
+						needed = 3;
+						if(lead == 0xf0)
+							lower = 0x90;
+						else if(lead == 0xf4)
+							upper = 0x8f;
+					} else
+						return false;
+					continue;
+				}
+
+				std::uint8_t const byte = data[i++];
+				if(byte < lower || byte > upper)
+					return false;
+				lower = 0x80;
+				upper = 0xbf;
+				--needed;
+			}
+
+			state = needed ? needed | lower << 8 | upper << 16 : 0;
+			return true;
+		}
+	}
+
+	namespace detail
+	{
+		void mask_portable(
+			void * data,
+			std::size_t size,
+			std::uint8_t const (&key)[4],
+			std::uint64_t offset)
+		{
+			std::uint8_t rotated[8];
+			rotate_key(key, offset, reinterpret_cast<std::uint8_t (&)[4]>(rotated));
+			std::memcpy(rotated + 4, rotated, 4);
+			std::uint64_t pattern;
+			std::memcpy(&pattern, rotated, 8);
+
+			std::uint8_t * bytes = static_cast<std::uint8_t *>(data);
+			for(; size >= 8; size -= 8, bytes += 8)
+			{
+				std::uint64_t word;
+				std::memcpy(&word, bytes, 8);
+				word ^= pattern;
+				std::memcpy(bytes, &word, 8);
+			}
+			for(std::size_t i = 0; i < size; i++)
+				bytes[i] ^= rotated[i];
+		}
+	}
+
+	bool is_upgrade(
+		http::Request const& request)
+	{
+		http::Header const * const version = request.find("sec-websocket-version");
+		http::Header const * const key = request.find("sec-websocket-key");
+		return request.method == "GET"
+			&& request.minor_version >= 1
+			&& request.has_token("upgrade", "websocket")
+			&& request.has_token("connection", "upgrade")
+			&& version && version->value == "13"
+			&& key && key->value.size() == kKeySize;
+	}
+
+	bool accept(
+		BufferedConnection &connection,
+		http::Request const& request,
+		std::string_view protocol)
+	{
+		if(!is_upgrade(request))
+			return false;
+
+		char value[kAcceptSize];
+		accept_value(request.find("sec-websocket-key")->value, value);
+
+		http::ResponseWriter response(101, "Switching Protocols");
+		response.header("Upgrade", "websocket");
+		response.header("Connection", "Upgrade");
+		response.header("Sec-WebSocket-Accept", std::string_view(value, sizeof(value)));
+		if(!protocol.empty())
+			response.header("Sec-WebSocket-Protocol", protocol);
+
+		std::size_t sent;
+		return response.send_head(connection, sent) && sent == response.head_size();
+	}
+
+	void client_key(
+		std::uint8_t const (&nonce)[16],
+		char (&out)[kKeySize])
+	{
+		base64(nonce, sizeof(nonce), out);
+	}
+
+	bool request(
+		BufferedConnection &connection,
+		std::string_view host,
+		std::string_view target,
+		std::string_view key)
+	{
+		std::string_view const parts[] = {
+			"GET ", target, " HTTP/1.1\r\n"
+			"Host: ", host, "\r\n"
+			"Upgrade: websocket\r\n"
+			"Connection: Upgrade\r\n"
+			"Sec-WebSocket-Version: 13\r\n"
+			"Sec-WebSocket-Key: ", key, "\r\n"
+			"\r\n"
+		};
+
+		std::size_t size = 0;
+		for(std::string_view part : parts)
+			size += part.size();
+		if(size > connection.output().free_space())
+			return false;
+
+		for(std::string_view part : parts)
+			connection.write(part.data(), part.size());
+		return true;
+	}
+
+	bool verify(
+		http::Response const& response,
+		std::string_view key)
+	{
+		if(response.status != 101
+		|| !response.has_token("upgrade", "websocket")
+		|| !response.has_token("connection", "upgrade"))
+			return false;
+
+		http::Header const * const accepted = response.find("sec-websocket-accept");
+		if(!accepted)
+			return false;
+
+		char expected[kAcceptSize];
+		accept_value(key, expected);
+		return accepted->value == std::string_view(expected, sizeof(expected));
+	}
+
+	void mask(
+		void * data,
+		std::size_t size,
+		std::uint8_t const (&key)[4],
+		std::uint64_t offset)
+	{
+		static MaskFunction const function = select_mask();
+		function(data, size, key, offset);
+	}
+
+	std::size_t encode_header(
+		std::uint8_t * out,
+		Opcode opcode,
+		std::uint64_t size,
+		bool fin,
+		std::uint8_t const * key)
+	{
+		assert(!control(opcode) || (fin && size <= kMaxControlSize));
+
+		out[0] = std::uint8_t((fin ? 0x80 : 0) | static_cast<std::uint8_t>(opcode));
+		std::uint8_t const masked = key ? 0x80 : 0;
+
+		std::size_t length;
+		if(size < 126)
+		{
+			out[1] = std::uint8_t(masked | size);
+			length = 2;
+		} else if(size <= 0xffff)
+		{
+			out[1] = masked | 126;
+			out[2] = std::uint8_t(size >> 8);
+			out[3] = std::uint8_t(size);
+			length = 4;
+		} else
+		{
+			out[1] = masked | 127;
+			for(int i = 0; i < 8; i++)
+				out[2 + i] = std::uint8_t(size >> (56 - 8 * i));
+			length = 10;
+		}
+
+		if(key)
+		{
+			std::memcpy(out + length, key, 4);
+			length += 4;
+		}
+		return length;
+	}
+
+	bool send(
+		BufferedConnection &connection,
+		Opcode opcode,
+		void const * payload,
+		std::size_t size,
+		std::size_t &sent,
+		bool fin)
+	{
+		std::uint8_t header[kMaxHeaderSize];
+		DataSlice const slices[] = {
+			{ header, encode_header(header, opcode, size, fin, nullptr) },
+			{ payload, size }
+		};
+		return connection.write_gathered(slices, size ? 2 : 1, sent);
+	}
+
+	bool send_masked(
+		BufferedConnection &connection,
+		Opcode opcode,
+		void const * payload,
+		std::size_t size,
+		std::uint8_t const (&key)[4],
+		bool fin)
+	{
+		std::uint8_t header[kMaxHeaderSize];
+		std::size_t const header_size = encode_header(header, opcode, size, fin, key);
+		if(connection.output().free_space() < header_size + size)
+		{
+			connection.flush_some();
+			if(connection.output().free_space() < header_size + size)
+				return false;
+		}
+
+		connection.write(header, header_size);
+
+		// Mask a copy, as the payload must stay untouched.
+		std::uint8_t chunk[4096];
+		for(std::size_t offset = 0; offset < size; offset += sizeof(chunk))
+		{
+			std::size_t const length = size - offset < sizeof(chunk) ? size - offset : sizeof(chunk);
+			std::memcpy(chunk, static_cast<std::uint8_t const *>(payload) + offset, length);
+			mask(chunk, length, key, offset);
+			connection.write(chunk, length);
+		}
+		return true;
+	}
+
+	bool send_close(
+		BufferedConnection &connection,
+		CloseCode code,
+		std::size_t &sent,
+		std::string_view reason)
+	{
+		assert(code != CloseCode::kNoStatus);
+
+		std::uint8_t payload[kMaxControlSize];
+		std::uint16_t const value = static_cast<std::uint16_t>(code);
+		payload[0] = std::uint8_t(value >> 8);
+		payload[1] = std::uint8_t(value);
+		if(reason.size() > kMaxControlSize - 2)
+			reason = reason.substr(0, kMaxControlSize - 2);
+		std::memcpy(payload + 2, reason.data(), reason.size());
+
+		return send(connection, Opcode::kClose, payload, 2 + reason.size(), sent);
+	}
+
+	CloseCode close_code(
+		std::string_view payload)
+	{
+		if(payload.size() < 2)
+			return CloseCode::kNoStatus;
+		return static_cast<CloseCode>(
+			std::uint16_t(static_cast<std::uint8_t>(payload[0]) << 8 | static_cast<std::uint8_t>(payload[1])));
+	}
+
+	EncodedFrame::EncodedFrame(
+		Opcode opcode,
+		void const * payload,
+		std::size_t size,
+		bool fin):
+		m_frame(kMaxHeaderSize + size)
+	{
+		std::size_t const header_size = encode_header(m_frame.data(), opcode, size, fin, nullptr);
+		std::memcpy(m_frame.data() + header_size, payload, size);
+		m_frame.resize(header_size + size);
+	}
+
+	Reader::Reader(
+		bool server,
+		std::uint64_t max_message_size):
+		m_max_message_size(max_message_size),
+		m_server(server),
+		m_in_frame(false),
+		m_fin(false),
+		m_message(Opcode::kContinuation),
+		m_message_size(0),
+		m_remaining(0),
+		m_offset(0),
+		m_key(),
+		m_masked(false),
+		m_utf8(0),
+		m_error(CloseCode::kProtocolError)
+	{
+	}
+
+	ParseStatus Reader::read(
+		BufferedConnection &connection,
+		Piece &out,
+		std::size_t &consumed)
+	{
+		util::Buffer const& input = connection.input();
+		consumed = 0;
+		m_error = CloseCode::kProtocolError;
+
+		if(!m_in_frame)
+		{
+			if(input.size() < 2)
+				return ParseStatus::kIncomplete;
+			if(input.continuous_data() < 2)
+				connection.linearize_input();
+
+			std::uint8_t const * header = static_cast<std::uint8_t const *>(input.data());
+			bool const fin = header[0] & 0x80;
+			bool const masked = header[1] & 0x80;
+			std::uint8_t const opcode = header[0] & 0x0f;
+			std::uint8_t const length = header[1] & 0x7f;
+
+			// No extensions are negotiated, so the reserved bits must be 0.
+			if((header[0] & 0x70) || !valid(opcode) || masked != m_server)
+				return ParseStatus::kInvalid;
+
+			std::size_t const header_size = 2
+				+ (length == 126 ? 2 : length == 127 ? 8 : 0)
+				+ (masked ? 4 : 0);
+			if(input.size() < header_size)
+				return ParseStatus::kIncomplete;
+			if(input.continuous_data() < header_size)
+			{
+				connection.linearize_input();
+				header = static_cast<std::uint8_t const *>(input.data());
+			}
+
+			std::uint64_t size = length;
+			if(length == 126)
+				size = std::uint64_t(header[2]) << 8 | header[3];
+			else if(length == 127)
+			{
+				size = 0;
+				for(int i = 0; i < 8; i++)
+					size = size << 8 | header[2 + i];
+				if(size >> 63)
+					return ParseStatus::kInvalid;
+			}
+
+			Opcode const type = static_cast<Opcode>(opcode);
+			if(control(type))
+			{
+				if(!fin || size > kMaxControlSize)
+					return ParseStatus::kInvalid;
+
+				// Control frames are small, and returned whole.
+				if(input.size() < header_size + size)
+					return ParseStatus::kIncomplete;
+				if(input.continuous_data() < header_size + size)
+				{
+					connection.linearize_input();
+					header = static_cast<std::uint8_t const *>(input.data());
+				}
+
+				char * const payload = static_cast<char *>(connection.input_data()) + header_size;
+				if(masked)
+					mask(payload, size, reinterpret_cast<std::uint8_t const (&)[4]>(header[header_size - 4]), 0);
+
+				// A close frame's payload starts with a status code, followed by a reason in UTF-8 (RFC 6455, section 5.5.1).
+				if(type == Opcode::kClose)
+				{
+					if(size == 1
+					|| (size && !valid_close_code(static_cast<std::uint16_t>(close_code(std::string_view(payload, size))))))
+						return ParseStatus::kInvalid;
+					std::uint32_t state = 0;
+					if(size > 2 && (!valid_utf8(reinterpret_cast<std::uint8_t const *>(payload) + 2, size - 2, state) || state))
+					{
+						m_error = CloseCode::kInvalidData;
+						return ParseStatus::kInvalid;
+					}
+				}
+
+				out.opcode = type;
+				out.data = std::string_view(payload, size);
+				out.last = true;
+				consumed = header_size + size;
+				return ParseStatus::kComplete;
+			}
+
+			// A continuation frame needs a message to continue, and a new message must not interrupt one.
+			if((type == Opcode::kContinuation) != (m_message != Opcode::kContinuation))
+				return ParseStatus::kInvalid;
+			if(type != Opcode::kContinuation)
+			{
+				m_message = type;
+				m_message_size = 0;
+				m_utf8 = 0;
+			}
+			if(size > m_max_message_size - m_message_size)
+			{
+				m_error = CloseCode::kTooLarge;
+				return ParseStatus::kTooLarge;
+			}
+			m_message_size += size;
+
+			m_in_frame = true;
+			m_fin = fin;
+			m_remaining = size;
+			m_offset = 0;
+			m_masked = masked;
+			if(masked)
+				std::memcpy(m_key, header + header_size - 4, 4);
+			consumed = header_size;
+		}
+
+		// Read as much of the data frame's payload as is continuous.
+		std::size_t const available = input.continuous_data() - consumed;
+		if(!available && m_remaining && !consumed)
+			return ParseStatus::kIncomplete;
+
+		std::size_t const length = m_remaining < available ? std::size_t(m_remaining) : available;
+		char * const payload = static_cast<char *>(connection.input_data()) + consumed;
+		if(m_masked)
+			mask(payload, length, m_key, m_offset);
+
+		m_remaining -= length;
+		m_offset += length;
+		consumed += length;
+
+		// Text has to be valid UTF-8 (RFC 6455, section 8.1). Code points can span pieces, so one is only incomplete at the message's end.
+		if(m_message == Opcode::kText
+		&& (!valid_utf8(reinterpret_cast<std::uint8_t const *>(payload), length, m_utf8) || (m_fin && !m_remaining && m_utf8)))
+		{
+			m_error = CloseCode::kInvalidData;
+			return ParseStatus::kInvalid;
+		}
+
+		out.opcode = m_message;
+		out.data = std::string_view(payload, length);
+		out.last = m_fin && !m_remaining;
+
+		if(!m_remaining)
+		{
+			m_in_frame = false;
+			if(m_fin)
+				m_message = Opcode::kContinuation;
+		}
+		return ParseStatus::kComplete;
+	}
+}
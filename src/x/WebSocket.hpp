@@ -0,0 +1,308 @@
+/** @file WebSocket.hpp
+	Contains the netlib::x::websocket module, WebSocket (RFC 6455) handshakes and framing on top of `BufferedConnection` and `x::http`. */
+#ifndef __netlib_x_websocket_hpp_defined
+#define __netlib_x_websocket_hpp_defined
+
+#include "BufferedConnection.hpp"
+#include "Http.hpp"
+
+#include <string_view>
+#include <vector>
+#include <cinttypes>
+
+/** WebSockets on top of `BufferedConnection`.
+	After the HTTP upgrade handshake, frames are parsed in place from the connection's input buffer: payloads are unmasked where they were received, and returned as views. Fragmented messages are returned piece by piece, and control frames can arrive between the fragments. */
+namespace netlib::x::websocket
+{
+	using http::ParseStatus;
+
+	/** Frame opcodes. */
+	enum class Opcode : std::uint8_t
+	{
+		/** Continues a fragmented message. */
+		kContinuation = 0x0,
+		/** A text message, in UTF-8. */
+		kText = 0x1,
+		/** A binary message. */
+		kBinary = 0x2,
+		/** Closes the connection. */
+		kClose = 0x8,
+		/** Requests a pong with the same payload. */
+		kPing = 0x9,
+		/** Answers a ping. */
+		kPong = 0xA
+	};
+
+	/** Status codes of close frames. */
+	enum class CloseCode : std::uint16_t
+	{
+		kNormal = 1000,
+		kGoingAway = 1001,
+		kProtocolError = 1002,
+		kUnsupportedData = 1003,
+		/** Reported for close frames without a status code. Never sent. */
+		kNoStatus = 1005,
+		kInvalidData = 1007,
+		kPolicyViolation = 1008,
+		kTooLarge = 1009,
+		kInternalError = 1011
+	};
+
+	/** The maximum size of a frame header, in bytes. */
+	constexpr std::size_t kMaxHeaderSize = 14;
+	/** The maximum payload size of control frames, in bytes. */
+	constexpr std::size_t kMaxControlSize = 125;
+	/** The size of a `client_key()`, in characters. */
+	constexpr std::size_t kKeySize = 24;
+
+	/** Checks whether a request asks for a WebSocket upgrade (RFC 6455, section 4.2.1). */
+	bool is_upgrade(
+		http::Request const& request);
+
+	/** Accepts an upgrade request by sending the "101 Switching Protocols" response.
+		Afterwards, the connection carries WebSocket frames.
+	@param[in] connection:
+		The connection the request was received on.
+	@param[in] request:
+		The upgrade request. Its head has to be removed from the input buffer afterwards.
+	@param[in] protocol:
+		The subprotocol to confirm, or empty.
+	@return
+		Whether the request was a valid upgrade request, and the whole response was sent or buffered. */
+	bool accept(
+		BufferedConnection &connection,
+		http::Request const& request,
+		std::string_view protocol = std::string_view());
+
+	/** Creates the key of a client's upgrade request.
+	@param[in] nonce:
+		16 random bytes, which must be chosen anew for each request.
+	@param[out] out:
+		The key. */
+	void client_key(
+		std::uint8_t const (&nonce)[16],
+		char (&out)[kKeySize]);
+
+	/** Sends a client's upgrade request.
+	@param[in] connection:
+		The connection to the server.
+	@param[in] host:
+		The value of the `Host` header field.
+	@param[in] target:
+		The request target, such as "/updates".
+	@param[in] key:
+		The key created by `client_key()`.
+	@return
+		Whether the request fit into the output buffer. */
+	bool request(
+		BufferedConnection &connection,
+		std::string_view host,
+		std::string_view target,
+		std::string_view key);
+
+	/** Checks whether a server accepted a client's upgrade request.
+	@param[in] response:
+		The server's response.
+	@param[in] key:
+		The key the client sent.
+	@return
+		Whether the connection now carries WebSocket frames. */
+	bool verify(
+		http::Response const& response,
+		std::string_view key);
+
+	/** Masks or unmasks data in place, which is the same operation.
+		Uses AVX2 if the processor supports it.
+	@param[in,out] data:
+		The data.
+	@param[in] size:
+		The data's size, in bytes.
+	@param[in] key:
+		The frame's masking key.
+	@param[in] offset:
+		The data's offset within the frame's payload, as the key repeats every 4 bytes. */
+	void mask(
+		void * data,
+		std::size_t size,
+		std::uint8_t const (&key)[4],
+		std::uint64_t offset = 0);
+
+	/** Encodes a frame header.
+	@param[out] out:
+		Receives the header. Must hold `kMaxHeaderSize` bytes.
+	@param[in] opcode:
+		The frame's opcode.
+	@param[in] size:
+		The payload size, in bytes.
+	@param[in] fin:
+		Whether the frame is the last one of its message.
+	@param[in] key:
+		The masking key, or null for unmasked frames. Clients must mask their frames, servers must not.
+	@return
+		The header's size, in bytes. */
+	std::size_t encode_header(
+		std::uint8_t * out,
+		Opcode opcode,
+		std::uint64_t size,
+		bool fin,
+		std::uint8_t const * key);
+
+	/** Sends an unmasked frame, as servers do, with its header and payload in a single gathered write.
+	@param[out] sent:
+		How many bytes of the frame were sent or buffered. If less than the frame's size, the output buffer is full: flush it and send the rest.
+	@return
+		Whether the operation succeeded. Fails if the socket failed. */
+	bool send(
+		BufferedConnection &connection,
+		Opcode opcode,
+		void const * payload,
+		std::size_t size,
+		std::size_t &sent,
+		bool fin = true);
+
+	/** Sends a masked frame, as clients do.
+		The payload is masked while it is copied into the output buffer.
+	@return
+		Whether the frame fit into the output buffer. If it did not, nothing was buffered. */
+	bool send_masked(
+		BufferedConnection &connection,
+		Opcode opcode,
+		void const * payload,
+		std::size_t size,
+		std::uint8_t const (&key)[4],
+		bool fin = true);
+
+	/** Sends an unmasked close frame.
+	@param[out] sent:
+		How many bytes of the frame were sent or buffered.
+	@return
+		Whether the operation succeeded. Fails if the socket failed. */
+	bool send_close(
+		BufferedConnection &connection,
+		CloseCode code,
+		std::size_t &sent,
+		std::string_view reason = std::string_view());
+
+	/** Retrieves the status code of a close frame's payload.
+	@return
+		The status code, or `CloseCode::kNoStatus` if the payload is empty. */
+	CloseCode close_code(
+		std::string_view payload);
+
+	/** A complete, unmasked frame that is encoded once and then sent to any number of connections, for broadcasting. */
+	class EncodedFrame
+	{
+		/** The header and payload. */
+		std::vector<std::uint8_t> m_frame;
+	public:
+		/** Encodes a frame.
+		@param[in] opcode:
+			The frame's opcode.
+		@param[in] payload:
+			The payload.
+		@param[in] size:
+			The payload's size, in bytes.
+		@param[in] fin:
+			Whether the frame is the last one of its message. */
+		EncodedFrame(
+			Opcode opcode,
+			void const * payload,
+			std::size_t size,
+			bool fin = true);
+
+		/** The encoded frame. */
+		inline std::uint8_t const * data() const noexcept;
+		/** The encoded frame's size, in bytes. */
+		inline std::size_t size() const noexcept;
+
+		/** Sends the frame over a connection.
+		@param[out] sent:
+			How many bytes of the frame were sent or buffered. If less than `size()`, the output buffer is full: flush it and send the rest.
+		@return
+			Whether the operation succeeded. Fails if the socket failed. */
+		inline bool send(
+			BufferedConnection &connection,
+			std::size_t &sent) const;
+	};
+
+	/** A piece of a received message. */
+	struct Piece
+	{
+		/** The message's opcode. Continuation frames report the opcode of the message they continue. */
+		Opcode opcode;
+		/** The unmasked payload, a view into the input buffer. Control frames are always returned whole. */
+		std::string_view data;
+		/** Whether this piece ends the message. */
+		bool last;
+	};
+
+	/** Reads frames from a connection's input buffer. */
+	class Reader
+	{
+		/** The maximum message size, in bytes. */
+		std::uint64_t m_max_message_size;
+		/** Whether the reader is on the server side, where all frames must be masked, or on the client side, where none may be masked. */
+		bool m_server;
+		/** Whether the payload of a data frame is being read. */
+		bool m_in_frame;
+		/** Whether the current frame ends its message. */
+		bool m_fin;
+		/** The opcode of the message being received, or `Opcode::kContinuation` between messages. */
+		Opcode m_message;
+		/** The size of the message being received so far, in bytes. */
+		std::uint64_t m_message_size;
+		/** The unread size of the current frame's payload, in bytes. */
+		std::uint64_t m_remaining;
+		/** How many bytes of the current frame's payload were read. */
+		std::uint64_t m_offset;
+		/** The current frame's masking key. */
+		std::uint8_t m_key[4];
+		/** Whether the current frame is masked. */
+		bool m_masked;
+		/** The UTF-8 decoding state of the text message being received, whose pieces can end within a code point. 0 between code points. */
+		std::uint32_t m_utf8;
+		/** The close code for the last error. */
+		CloseCode m_error;
+	public:
+		/** Creates a reader.
+		@param[in] server:
+			Whether the reader is on the server side.
+		@param[in] max_message_size:
+			The maximum size of a message, in bytes. */
+		explicit Reader(
+			bool server,
+			std::uint64_t max_message_size = std::uint64_t(1) << 24);
+
+		/** Reads the next piece of a message from a connection's input buffer, and unmasks it in place.
+			Call repeatedly while it returns `ParseStatus::kComplete`. Afterwards, always remove `consumed` bytes from the input buffer via `BufferedConnection::skip()`, after the piece is no longer used.
+		@param[in] connection:
+			The connection.
+		@param[out] out:
+			On success, the piece. Pieces of data messages can be empty.
+		@param[out] consumed:
+			How many bytes of the input buffer were consumed, including frame headers.
+		@return
+			`ParseStatus::kComplete` if a piece was read, `ParseStatus::kIncomplete` if more data is needed, `ParseStatus::kInvalid` if the peer violated the protocol, sent a close frame with an invalid status code, or sent text that is not valid UTF-8, and `ParseStatus::kTooLarge` if a message exceeded the maximum size. On errors, close the connection with `error()`. */
+		ParseStatus read(
+			BufferedConnection &connection,
+			Piece &out,
+			std::size_t &consumed);
+
+		/** The close code for the last error returned by `read()`: `CloseCode::kProtocolError`, `CloseCode::kInvalidData`, or `CloseCode::kTooLarge`. */
+		inline CloseCode error() const noexcept;
+	};
+
+	namespace detail
+	{
+		/** The portable implementation of `mask()`, which is also used if the processor lacks AVX2. */
+		void mask_portable(
+			void * data,
+			std::size_t size,
+			std::uint8_t const (&key)[4],
+			std::uint64_t offset);
+	}
+}
+
+#include "WebSocket.inl"
+
+#endif
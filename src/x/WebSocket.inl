@@ -0,0 +1,25 @@
+namespace netlib::x::websocket
+{
+	std::uint8_t const * EncodedFrame::data() const noexcept
+	{
+		return m_frame.data();
+	}
+
+	std::size_t EncodedFrame::size() const noexcept
+	{
+		return m_frame.size();
+	}
+
+	bool EncodedFrame::send(
+		BufferedConnection &connection,
+		std::size_t &sent) const
+	{
+		DataSlice const slice = { m_frame.data(), m_frame.size() };
+		return connection.write_gathered(&slice, 1, sent);
+	}
+
+	CloseCode Reader::error() const noexcept
+	{
+		return m_error;
+	}
+}
@@ -3,8 +3,24 @@
 #ifndef __netlib_x_x_hpp_defined
 #define __netlib_x_x_hpp_defined
 
+#include "AdmissionControl.hpp"
 #include "BufferedConnection.hpp"
 #include "ConnectionListener.hpp"
+#include "ConnectionPool.hpp"
+#include "Connector.hpp"
+#include "FanOut.hpp"
+#include "Handoff.hpp"
+#include "Http.hpp"
+#include "PrefixTable.hpp"
+#include "Proxy.hpp"
+#include "ReliableChannel.hpp"
+#include "Resolver.hpp"
+#include "RpcChannel.hpp"
+#include "SendScheduler.hpp"
+#include "SharedPrefixTable.hpp"
+#include "TcpInfoSampler.hpp"
+#include "TlsConnection.hpp"
+#include "WebSocket.hpp"
 
 
 /** Extensions that sit on top of the socket library.